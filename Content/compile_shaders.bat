@@ -1,2 +0,0 @@
-c:\VulkanSDK\1.0.49.0\Bin\glslangValidator.exe -V shader.vert
-c:\VulkanSDK\1.0.49.0\Bin\glslangValidator.exe -V shader.frag
\ No newline at end of file
@@ -1,13 +1,140 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#if defined(BINDLESS)
+#extension GL_EXT_nonuniform_qualifier : enable
+#endif
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Virtual texture tiles, match CT_VIRTUAL_TILE_SIZE and CT_VIRTUAL_TILE_BORDER on the CPU.
+const uint TILE_SIZE = 128u;
+const uint TILE_BORDER = 4u;
+const uint TILE_STRIDE = TILE_SIZE + 2u * TILE_BORDER;
+// Page table entry of a tile that has nothing resident to stand in for it, and the push constant of materials whose
+// texture isn't virtual.
+const uint PAGE_MISSING = 0xFFFFFFFFu;
+// Only one pixel in each block of this size reports the tiles it needs.
+const uint FEEDBACK_SPACING = 4u;
+
+// Features of the variant, specialized when its pipeline is created so the compiler leaves out what the variant doesn't
+// use; they match FragmentSpecialization and MaterialTexturing on the CPU. The defaults are the ubershader's.
+// How the material's texture is sampled - 0 picks the way per draw, 1 from the texture array, 2 through the virtual
+// texture's page table and 3 not at all, the color comes from the vertices.
+layout(constant_id = 0) const uint TEXTURING = 0u;
+// Is the texture's color modulated by the vertex color?
+layout(constant_id = 1) const bool VERTEX_COLOR = false;
+// Are fragments whose alpha is under the threshold discarded?
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+const uint TEXTURING_ANY = 0u;
+const uint TEXTURING_ARRAY = 1u;
+const uint TEXTURING_VIRTUAL = 2u;
+const uint TEXTURING_NONE = 3u;
+const float ALPHA_THRESHOLD = 0.5;
+
+// Material textures are arrays, materials whose small textures were packed together differ only in the layer. Bound
+// bindless, all of them are in one partially bound array and each material picks its own by index.
+#if defined(BINDLESS)
+layout(binding = 1) uniform sampler2DArray atexMaterials[];
+#define MATERIAL_TEXTURE atexMaterials[material.iTexture]
+#else
+layout(binding = 1) uniform sampler2DArray texSampler;
+#define MATERIAL_TEXTURE texSampler
+#endif
+
+// Slot in the tile cache of each virtual texture tile - x in the lowest 8 bits, then y and the level of the resident
+// tile, which is the tile itself or the finest of its parents that is in the cache.
+layout(std430, binding = 2) readonly buffer PageTableBuffer {
+    uint aiPageTable[];
+};
+
+// Tiles of all virtual textures, with borders for filtering.
+layout(binding = 3) uniform sampler2D texTileCache;
+
+// One bit for each page table entry, set when the tile is needed.
+layout(std430, binding = 4) buffer FeedbackBuffer {
+    uint aiFeedback[];
+};
+
+// Per draw material constants, matches MaterialPushConstants on the CPU.
+layout(push_constant) uniform MaterialPushConstants {
+    // Index of the material's texture in the bindless array, and the layer of the texture that holds its image.
+    uint iTexture;
+    uint iTextureLayer;
+    // Page table entry of the first tile of the material's virtual texture, PAGE_MISSING if the texture isn't virtual.
+    uint iFirstPageEntry;
+    // Size and number of levels of the virtual texture.
+    uint dimVirtualWidth;
+    uint dimVirtualHeight;
+    uint ctVirtualLevels;
+} material;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTextureCoord;
 
 layout(location = 0) out vec4 outColor;
 
+// Number of tiles along a side of a level, matches GetVirtualTileCount on the CPU.
+uvec2 GetTileCount(uint iLevel) {
+    uvec2 vecLevelSize = (uvec2(material.dimVirtualWidth, material.dimVirtualHeight) + (1u << iLevel) - 1u) >> iLevel;
+    return max((vecLevelSize + TILE_SIZE - 1u) / TILE_SIZE, uvec2(1u));
+}
+
+// Sample the material's virtual texture through the page table, and report the tile the pixel needs.
+vec4 SampleVirtualTexture() {
+    vec2 vecSize = vec2(material.dimVirtualWidth, material.dimVirtualHeight);
+
+    // the level comes from the pixel's footprint in texels, the texture repeats so coordinates are wrapped after that
+    vec2 vecTexels = fragTextureCoord * vecSize;
+    float fFootprint = max(dot(dFdx(vecTexels), dFdx(vecTexels)), dot(dFdy(vecTexels), dFdy(vecTexels)));
+    uint iLevel = uint(clamp(0.5 * log2(fFootprint), 0.0, float(material.ctVirtualLevels - 1)));
+    vec2 vecCoords = fract(fragTextureCoord);
+
+    // tiles are numbered level by level from the finest one, row by row within a level
+    uint iEntry = material.iFirstPageEntry;
+    for (uint iCoarser = 0; iCoarser < iLevel; iCoarser++) {
+        uvec2 vecCount = GetTileCount(iCoarser);
+        iEntry += vecCount.x * vecCount.y;
+    }
+    uvec2 vecCount = GetTileCount(iLevel);
+    uvec2 vecTile = min(uvec2(vecCoords * vecSize / float(1u << iLevel)) / TILE_SIZE, vecCount - 1u);
+    iEntry += vecTile.y * vecCount.x + vecTile.x;
+
+    // a sparse grid of pixels is enough to find all the tiles in view
+    if (uint(gl_FragCoord.x) % FEEDBACK_SPACING == 0 && uint(gl_FragCoord.y) % FEEDBACK_SPACING == 0) {
+        atomicOr(aiFeedback[iEntry / 32], 1u << (iEntry % 32));
+    }
+
+    // the resident tile may be a coarser one, the position inside it is found at its level
+    uint iPage = aiPageTable[iEntry];
+    if (iPage == PAGE_MISSING) {
+        return vec4(0.5, 0.5, 0.5, 1.0);
+    }
+    uvec2 vecSlot = uvec2(iPage & 0xFF, (iPage >> 8) & 0xFF);
+    vec2 vecLevelTexels = vecCoords * vecSize / float(1u << (iPage >> 16));
+    vec2 vecInTile = vecLevelTexels - floor(vecLevelTexels / TILE_SIZE) * TILE_SIZE;
+    vec2 vecCacheTexels = vec2(vecSlot * TILE_STRIDE + TILE_BORDER) + vecInTile;
+
+    // the cache has a single level, and the borders cover the bilinear footprint
+    return textureLod(texTileCache, vecCacheTexels / vec2(textureSize(texTileCache, 0)), 0.0);
+}
+
 void main() {
-    outColor = texture(texSampler, fragTextureCoord);
+    // the conditions on the constants are resolved when the variant is compiled, only the ubershader picks the way to
+    // sample per draw, so it can draw any material
+    if (TEXTURING == TEXTURING_VIRTUAL) {
+        outColor = SampleVirtualTexture();
+    } else if (TEXTURING == TEXTURING_ARRAY) {
+        outColor = texture(MATERIAL_TEXTURE, vec3(fragTextureCoord, material.iTextureLayer));
+    } else if (TEXTURING == TEXTURING_NONE) {
+        outColor = vec4(1.0);
+    } else if (material.iFirstPageEntry != PAGE_MISSING) {
+        outColor = SampleVirtualTexture();
+    } else {
+        outColor = texture(MATERIAL_TEXTURE, vec3(fragTextureCoord, material.iTextureLayer));
+    }
+
+    if (VERTEX_COLOR || TEXTURING == TEXTURING_NONE) {
+        outColor.rgb *= fragColor;
+    }
+    if (ALPHA_TEST && outColor.a < ALPHA_THRESHOLD) {
+        discard;
+    }
 }
\ No newline at end of file
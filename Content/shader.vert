@@ -1,15 +1,16 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-// Uniform buffer description.
-layout(binding = 0) uniform UniformBufferObject {
-    // Model transform.
-    mat4 tModel;
-    // View transform.
-    mat4 tView;
-    // Projection transform.
-    mat4 tProjection;
-} ubo;
+// Camera of the frame, matches FrameUniformBufferObject on the CPU.
+layout(binding = 0) uniform FrameUniformBufferObject {
+    // View and projection transforms, combined on the CPU.
+    mat4 tViewProjection;
+} frame;
+
+// Model transforms of the objects, a draw's first instance is the object it draws.
+layout(std430, binding = 5) readonly buffer ObjectBuffer {
+    mat4 atModels[];
+};
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -23,7 +24,8 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTextureCoord;
 
 void main() {
-    gl_Position = ubo.tProjection * ubo.tView * ubo.tModel * vec4(inPosition, 1.0);
+    // two matrix-vector products, the matrices aren't multiplied together for every vertex
+    gl_Position = frame.tViewProjection * (atModels[gl_InstanceIndex] * vec4(inPosition, 1.0));
     fragColor = inColor;
 	fragTextureCoord = inTextureCoord;
 }
\ No newline at end of file
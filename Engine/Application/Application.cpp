@@ -9,6 +9,9 @@
 #include "GfxAPI/GfxAPI.h"
 #include "GfxAPI/Window.h"
 
+// Frames rendered before measuring starts, so that caches and clocks settle.
+static const uint32_t CT_BENCHMARK_WARMUP_FRAMES = 60;
+
 
 // Run the application - initialize, run the main loop, cleanup at the end.
 void Application::Run() {
@@ -54,6 +57,51 @@ void Application::MainLoop() {
 }
 
 
+// Render the scene with and without texture mipmaps and report the GPU frame times.
+void Application::RunMipmapBenchmark(uint32_t ctFrames) {
+    InitializeGraphics();
+    GfxAPI *apiGfx = GfxAPI::Get();
+    std::shared_ptr<Window> wndWindow = apiGfx->GetWindow();
+
+    // textures are loaded in the background, both modes are measured with all of them in place
+    while (apiGfx->IsLoadingAssets() && !wndWindow->ShouldClose()) {
+        wndWindow->ProcessMessages();
+        apiGfx->Render();
+    }
+
+    // the same scene is rendered in both modes, textures are minified when the model is small on screen, which is
+    // where sampling only the full resolution level costs the most
+    std::cout << "Mipmap benchmark, " << ctFrames << " frames per mode, GPU time per frame" << std::endl;
+    for (int iMode = 0; iMode < 2 && !wndWindow->ShouldClose(); iMode++) {
+        const bool bMipmaps = iMode == 1;
+        apiGfx->SetTextureMipmapsEnabled(bMipmaps);
+
+        std::vector<double> atmFrames;
+        for (uint32_t iFrame = 0; iFrame < CT_BENCHMARK_WARMUP_FRAMES + ctFrames && !wndWindow->ShouldClose(); iFrame++) {
+            wndWindow->ProcessMessages();
+            apiGfx->Render();
+            if (iFrame >= CT_BENCHMARK_WARMUP_FRAMES) {
+                atmFrames.push_back(apiGfx->GetLastFrameTime());
+            }
+        }
+        if (atmFrames.empty()) {
+            break;
+        }
+
+        // report the median, which ignores occasional hitches, and the mean
+        double tmTotal = 0.0;
+        for (double tmFrame : atmFrames) {
+            tmTotal += tmFrame;
+        }
+        std::nth_element(atmFrames.begin(), atmFrames.begin() + atmFrames.size() / 2, atmFrames.end());
+        std::cout << (bMipmaps ? "    mipmaps:    " : "    no mipmaps: ") << "median " << atmFrames[atmFrames.size() / 2]
+            << " ms, mean " << tmTotal / atmFrames.size() << " ms" << std::endl;
+    }
+
+    Cleanup();
+}
+
+
 // Clean up Vulkan API and destroy the application window
 void Application::Cleanup() {
     GfxAPI::Get()->Destroy();
@@ -9,6 +9,8 @@ public:
 
     // Run the application - initialize, run the main loop, cleanup at the end.
 	void Run();
+    // Render the scene with and without texture mipmaps and report the GPU frame times.
+    void RunMipmapBenchmark(uint32_t ctFrames);
 
 private:
     // Grapics API to use in the application.
@@ -12,6 +12,35 @@ Options::Options()
     // use the Vulkan APi by default
     _optGfxAPIType = GfxAPIType::GFX_API_TYPE_VULKAN;
 
+    // let imports use up to 1GB, larger models are streamed
+    _ctImportMemoryLimit = 1024ULL * 1024 * 1024;
+
+    // cull meshlets whenever the model has them
+    _optShouldCullMeshlets = true;
+
+    // switch to a finer level of detail once the error reaches a pixel, and back only once it is under 3/4 of a pixel
+    _fLodErrorThreshold = 1.0f;
+    _fLodHysteresis = 0.25f;
+
+    // compress textures whenever the device can sample compressed formats
+    _optShouldCompressTextures = true;
+
+    // stream material textures within 256MB, keeping levels up to 128x128 always resident
+    _optShouldStreamTextures = true;
+    _ctTextureStreamingBudget = 256ULL * 1024 * 1024;
+    _dimTextureStreamingMinSize = 128;
+    // pack textures up to 256x256 into arrays, a single layer of them is too small to be worth streaming anyway
+    _dimTextureArrayMaxSize = 256;
+    // textures of 8k and up would take most of the streaming budget for a single level, they are virtual textures with
+    // their tiles cached in a 4k texture
+    _dimVirtualTextureMinSize = 8192;
+    _dimVirtualTextureCacheSize = 4096;
+
+    // reload assets whose files change, only loose files are watched so a shipped package is never reloaded
+    _optShouldHotReloadAssets = true;
+    // optimize the shaders the engine compiles, they are cached so it is only paid when a shader changes
+    _optShouldOptimizeShaders = true;
+
     // Vulkan specific
 
     // enable validation layers only in debug builds
@@ -20,6 +49,19 @@ Options::Options()
     #else
         _optShouldUseValiationLayers = true;
     #endif
+
+    // link pipelines from libraries where the device has them, as linking takes microseconds, and swap in the
+    // optimized pipelines as they are done
+    _optShouldUsePipelineLibraries = true;
+    _optShouldOptimizeLinkedPipelines = true;
+
+    // draw without render passes and framebuffers where the device can, so recreating the swap chain doesn't create
+    // them again and pipelines only depend on the attachment formats
+    _optShouldUseDynamicRendering = true;
+
+    // bind the textures of all materials at once where the device can, so a frame binds descriptors once and textures
+    // change without recording the command buffers again
+    _optShouldUseBindlessTextures = true;
 }
 
 
@@ -22,10 +22,50 @@ public:
     // Get the graphics API type the application should use.
     enum GfxAPIType GetGfxAPIType() const { return _optGfxAPIType; }
 
+    // Get the most memory asset import may use, in bytes. Larger models are streamed through temporary files.
+    uint64_t GetImportMemoryLimit() const { return _ctImportMemoryLimit; }
+
+    // Should invisible meshlets be culled on the GPU before drawing?
+    bool ShouldCullMeshlets() const { return _optShouldCullMeshlets; }
+    // Get the largest error of a mesh level of detail on screen, in pixels, before a finer level is used.
+    float GetLodErrorThreshold() const { return _fLodErrorThreshold; }
+    // Get the fraction below the threshold a coarser level's error must be before it is used.
+    float GetLodHysteresis() const { return _fLodHysteresis; }
+    // Should textures be block compressed when the device supports it? Compressed textures are cached next to the images.
+    bool ShouldCompressTextures() const { return _optShouldCompressTextures; }
+    // Should the finer mip levels of material textures be streamed in as they are needed?
+    bool ShouldStreamTextures() const { return _optShouldStreamTextures; }
+    // Get the most bytes the resident levels of streamed textures may add up to.
+    uint64_t GetTextureStreamingBudget() const { return _ctTextureStreamingBudget; }
+    // Get the size of the largest mip level that is always resident, in texels along the longer side.
+    uint32_t GetTextureStreamingMinSize() const { return _dimTextureStreamingMinSize; }
+    // Get the size of the largest texture that is packed into a texture array with others of its format and size, in
+    // texels along the longer side. Packing is off at 0.
+    uint32_t GetTextureArrayMaxSize() const { return _dimTextureArrayMaxSize; }
+    // Get the size of the smallest texture that is split into tiles and virtually textured, in texels along the longer
+    // side. Virtual texturing is off at 0.
+    uint32_t GetVirtualTextureMinSize() const { return _dimVirtualTextureMinSize; }
+    // Get the size of the texture that caches the tiles of virtual textures, in texels along each side.
+    uint32_t GetVirtualTextureCacheSize() const { return _dimVirtualTextureCacheSize; }
+    // Should shaders, textures and the model be reloaded while running when their files change?
+    bool ShouldHotReloadAssets() const { return _optShouldHotReloadAssets; }
+    // Should compiled shaders be run through the SPIR-V optimizer before they are cached?
+    bool ShouldOptimizeShaders() const { return _optShouldOptimizeShaders; }
+
     // Vulkan specific
 
     // Should the application use validation layers and error callback?
     bool ShouldUseValidationLayers() const { return _optShouldUseValiationLayers;  }
+    // Should graphics pipelines be linked from precompiled parts when the device supports pipeline libraries?
+    bool ShouldUsePipelineLibraries() const { return _optShouldUsePipelineLibraries; }
+    // Should pipelines linked from parts be linked again with link time optimization in the background?
+    bool ShouldOptimizeLinkedPipelines() const { return _optShouldOptimizeLinkedPipelines; }
+    // Should frames be drawn with dynamic rendering instead of render pass and framebuffer objects when the device
+    // supports it?
+    bool ShouldUseDynamicRendering() const { return _optShouldUseDynamicRendering; }
+    // Should material textures be bound through one bindless descriptor set when the device supports descriptor
+    // indexing?
+    bool ShouldUseBindlessTextures() const { return _optShouldUseBindlessTextures; }
 
 private:
     // Options objects shouldnt be created or destroyed from the outside.
@@ -40,9 +80,40 @@ private:
     // Which graphics API should the application use (Vulkan/Null...)
     enum GfxAPIType _optGfxAPIType;
 
+    // Most memory asset import may use.
+    uint64_t _ctImportMemoryLimit;
+
+    // Should invisible meshlets be culled on the GPU before drawing?
+    bool _optShouldCullMeshlets;
+    // Largest error of a level of detail on screen, and the fraction below it a coarser level needs.
+    float _fLodErrorThreshold;
+    float _fLodHysteresis;
+    // Should textures be block compressed when the device supports it?
+    bool _optShouldCompressTextures;
+    // Should texture levels be streamed, with how much memory, and from which level size down are they always resident?
+    bool _optShouldStreamTextures;
+    uint64_t _ctTextureStreamingBudget;
+    uint32_t _dimTextureStreamingMinSize;
+    // Largest texture packed into a texture array.
+    uint32_t _dimTextureArrayMaxSize;
+    // Smallest virtual texture, and the size of the tile cache.
+    uint32_t _dimVirtualTextureMinSize;
+    uint32_t _dimVirtualTextureCacheSize;
+    // Should assets be reloaded when their files change?
+    bool _optShouldHotReloadAssets;
+    // Should compiled shaders be optimized?
+    bool _optShouldOptimizeShaders;
+
     // Vulkan specific
 
     // Should the application use validation layers and error callback?
     bool _optShouldUseValiationLayers;
+    // Should pipelines be linked from libraries, and optimized once linked?
+    bool _optShouldUsePipelineLibraries;
+    bool _optShouldOptimizeLinkedPipelines;
+    // Should frames be drawn with dynamic rendering?
+    bool _optShouldUseDynamicRendering;
+    // Should material textures be bound bindless?
+    bool _optShouldUseBindlessTextures;
 };
 
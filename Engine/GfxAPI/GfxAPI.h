@@ -32,6 +32,13 @@ public:
     // Render a frame.
     virtual void Render() = 0;
 
+    // Enable or disable sampling from the smaller mip levels of textures, to compare their cost.
+    virtual void SetTextureMipmapsEnabled(bool bEnabled) = 0;
+    // Get how long the GPU took to render the last frame, in milliseconds.
+    virtual double GetLastFrameTime() const = 0;
+    // Are assets still loading in the background?
+    virtual bool IsLoadingAssets() const = 0;
+
 protected:
     // Constructor and destructor are only available to derived classes.
     GfxAPI() {};
@@ -16,5 +16,12 @@ public:
 
     // Render a frame.
     virtual void Render();
+
+    // Enable or disable sampling from the smaller mip levels of textures, does nothing.
+    virtual void SetTextureMipmapsEnabled(bool bEnabled) {}
+    // Get how long the GPU took to render the last frame, nothing is rendered so it is always 0.
+    virtual double GetLastFrameTime() const { return 0.0; }
+    // Are assets still loading in the background? Nothing is loaded.
+    virtual bool IsLoadingAssets() const { return false; }
 };
 
@@ -7,18 +7,100 @@
 #include "Config/Options.h"
 #include "GfxAPI/Window.h"
 
+#include "Import/AssetPackager.h"
+#include "Import/ImageDecoder.h"
+#include "Import/MeshImporter.h"
+#include "Import/ShaderCompiler.h"
+#include "Import/TextureImporter.h"
+#include "Platform/FileSystem.h"
+#include "Platform/MappedFile.h"
+#include "Platform/ThreadPool.h"
+#include "Resources/KtxFile.h"
+#include "Resources/MeshFile.h"
+#include "Resources/TextureArrayPacker.h"
+#include "Resources/VirtualTextureFile.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ThirdParty/stb_image.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "../ThirdParty/tiny_obj_loader.h"
-
 // List of validation layers' names that we want to enable.
 const std::vector<const char*> validationLayers = {
     // this is a standard set of validation layers, not a single layer
     "VK_LAYER_LUNARG_standard_validation"
 };
 
+// Package the assets are loaded from, and the directory of the loose files it is built from.
+static const char *STR_ASSET_PACKAGE_FILENAME = "../assets.pak";
+static const char *STR_ASSET_DIRECTORY = "../";
+// The example model, and the engine mesh it is imported into.
+static const char *STR_MODEL_FILENAME = "../sphere.obj";
+static const char *STR_MODEL_MESH_FILENAME = "../sphere.mesh";
+static const char *STR_MODEL_MESH_ASSET = "sphere.mesh";
+// Texture used by materials that don't have their own.
+static const char *STR_DEFAULT_TEXTURE_ASSET = "uv_checker.png";
+// Compiled vertex and fragment shaders of the graphics pipeline. The fragment shader's variants are specialized from
+// the same code; its default variant is the ubershader, which handles every way of texturing through the push
+// constants, so it can draw any material right away.
+static const char *STR_VERTEX_SHADER_ASSET = "vert.spv";
+static const char *STR_FRAGMENT_SHADER_ASSET = "frag.spv";
+// Fragment shader of bindless textures, compiled from the same source; it picks the material's texture from the array
+// of all textures, and is used instead of the other one when textures are bound bindless.
+static const char *STR_BINDLESS_FRAGMENT_SHADER_ASSET = "frag_bindless.spv";
+// Number of textures the bindless texture array holds; the array is partially bound, so unused ones cost nothing.
+static const uint32_t CT_BINDLESS_TEXTURES = 1024;
+// Extension of the compressed texture files cached next to the images.
+static const char *STR_TEXTURE_FILE_EXTENSION = ".ktx2";
+// Extension of the tiled virtual texture files cached next to the images.
+static const char *STR_VIRTUAL_TEXTURE_FILE_EXTENSION = ".vtex";
+// Compiled meshlet culling shader, culling is skipped if it is missing.
+static const char *STR_CULL_SHADER_ASSET = "cull.spv";
+// Number of meshlets one workgroup of the culling shader tests, matches local_size_x in cull.comp.
+static const uint32_t CT_CULL_WORKGROUP_SIZE = 64;
+// Compiled mip downsampling shader, used for formats that can't be blitted.
+static const char *STR_MIP_SHADER_ASSET = "mip.spv";
+// Assets that go into the package.
+static const char *ASTR_PACKAGED_ASSETS[] = { STR_MODEL_MESH_ASSET, STR_DEFAULT_TEXTURE_ASSET, STR_VERTEX_SHADER_ASSET, STR_FRAGMENT_SHADER_ASSET,
+    STR_BINDLESS_FRAGMENT_SHADER_ASSET, STR_CULL_SHADER_ASSET, STR_MIP_SHADER_ASSET };
+// GLSL sources of the shaders and the assets they are compiled into. They are compiled before the package is built,
+// and again when they change; the compiled code is cached in the cache directory by the hash of what it is built from.
+// A source compiled into several assets is compiled with a different define for each.
+struct ShaderSource {
+    const char *strSourceFilename;
+    const char *strAsset;
+    const char *strDefine;
+};
+static const ShaderSource ASRC_SHADER_SOURCES[] = { { "../shader.vert", STR_VERTEX_SHADER_ASSET, nullptr },
+    { "../shader.frag", STR_FRAGMENT_SHADER_ASSET, nullptr }, { "../shader.frag", STR_BINDLESS_FRAGMENT_SHADER_ASSET, "BINDLESS" },
+    { "../cull.comp", STR_CULL_SHADER_ASSET, nullptr }, { "../mip.comp", STR_MIP_SHADER_ASSET, nullptr } };
+static const char *STR_SHADER_CACHE_DIRECTORY = "../ShaderCache/";
+
+// Compile a shader's source into its asset.
+static void CompileShaderSource(const ShaderSource &srcShader, bool bOptimize) {
+    std::vector<std::string> astrDefines;
+    if (srcShader.strDefine != nullptr) {
+        astrDefines.push_back(srcShader.strDefine);
+    }
+    ShaderCompiler::CompileGlsl(srcShader.strSourceFilename, astrDefines, bOptimize, std::string(STR_ASSET_DIRECTORY) + srcShader.strAsset,
+        STR_SHADER_CACHE_DIRECTORY);
+}
+
+// Number of objects in the object buffer, and the object of the model; draws pass their object as the first instance.
+static const uint32_t CT_OBJECTS = 1;
+static const uint32_t ID_MODEL_OBJECT = 0;
+// Most levels the downsampling shader writes in one dispatch, and the size of the tile one workgroup reduces.
+static const uint32_t CT_MIP_LEVELS_PER_DISPATCH = 6;
+static const uint32_t CT_MIP_TILE_SIZE = 64;
+// Most data a single vkCmdUpdateBuffer can write.
+static const VkDeviceSize CT_MAX_BUFFER_UPDATE_SIZE = 65536;
+// Most assets finished on the main thread in one frame, as creating their resources stalls the frame.
+static const uint32_t CT_MAX_ASSET_FINISHES_PER_FRAME = 1;
+// Smallest size of the staging ring streamed texture levels and virtual texture tiles are loaded through, it holds
+// the loads of several frames.
+static const VkDeviceSize CT_STAGING_RING_MIN_SIZE = 32 * 1024 * 1024;
+// Compiled pipelines saved between runs, and how often the cache is saved while running if pipelines were added.
+static const char *STR_PIPELINE_CACHE_FILENAME = "../pipelines.cache";
+static const uint32_t CT_PIPELINE_CACHE_SAVE_INTERVAL_SECONDS = 30;
+
 
 // Callback that will be invoked on errors in validation layers
 static VKAPI_ATTR VkBool32 VKAPI_CALL ValidationErrorCallback(
@@ -56,34 +138,51 @@ bool GfxAPIVulkan::Initialize(uint32_t dimWidth, uint32_t dimHeight) {
     SelectPhysicalDevice();
     // create the logical device
     CreateLogicalDevice();
+    // create the pipeline cache, warm with the pipelines compiled by the previous run
+    CreatePipelineCache();
+    // map the package the assets are loaded from, rebuilding it first if the loose files changed
+    OpenAssetPackage();
 
     // create the swap chain
     CreateSwapChain();
     // create image views
     CreateImageViews();
-    // create the render pass
-    CreateRenderPass();
+    // create the render pass, dynamic rendering doesn't use one
+    if (!bDynamicRendering) {
+        CreateRenderPass();
+    }
     // create descriptor set layout
     CreateDescriptorSetLayout();
-    // create the graphics pipeline
-    CreateGraphicsPipeline();
+    // create the graphics pipeline layout and the pipeline of opaque meshes, which materials use until theirs are ready
+    CreateGraphicsPipelines();
+    idDefaultPipeline = FindGraphicsPipeline(GetDefaultPipelineState());
     // create the command pool
     CreateCommandPool();
 
     // create resources needed for depth testing
     CreateDepthResources();
-    // create the framebuffers
-    CreateFramebuffers();
+    // create the framebuffers, dynamic rendering draws to the image views directly
+    if (!bDynamicRendering) {
+        CreateFramebuffers();
+    }
 
-    // create a texture
-    CreateTextureImage();
+    // pick the formats textures are compressed to
+    SelectTextureFormats();
+    // create the default texture
+    CreateTextureImage(STR_DEFAULT_TEXTURE_ASSET, vkhImageData, vkhImageMemory, ctImageMipLevels, fmtImageFormat);
     // create a texture view
     CreateTextureImageVeiw();
-    // create a sampler for the texture
-    CreateImageSampler();
 
     // load the example model
     LoadModel();
+    // set up the model's materials with the default texture, their textures are imported in the background
+    CreateMaterials();
+    // compile the pipelines of the model's materials on the workers, while the rest is set up
+    RequestMaterialPipelines();
+    // create the tile cache of virtual textures, at its smallest until the textures are imported
+    CreateVirtualTextureCache();
+    // create a sampler for the textures, it is created again once the textures' mip counts are known
+    CreateImageSampler();
     // create the vertex buffer
     CreateVertexBuffers();
     // create the index buffer
@@ -92,9 +191,13 @@ bool GfxAPIVulkan::Initialize(uint32_t dimWidth, uint32_t dimHeight) {
     CreateUniformBuffers();
     // create the descriptor pool
     CreateDescriptorPool();
-    // create the descriptor set
-    CreateDescriptorSet();
+    // create the descriptor sets
+    CreateDescriptorSets();
+    // set up culling of the model's meshlets
+    InitializeMeshletCulling();
 
+    // create the queries that measure frame time
+    CreateFrameTimeQueries();
     // allocate command buffers
     CreateCommandBuffers();
 
@@ -103,6 +206,8 @@ bool GfxAPIVulkan::Initialize(uint32_t dimWidth, uint32_t dimHeight) {
 
     // create the semaphores
     CreateSemaphores();
+    // watch the files of the assets, to reload the ones that change
+    WatchAssetFiles();
 
     return true;
 }
@@ -118,13 +223,26 @@ bool GfxAPIVulkan::Destroy() {
     
     // destroy the desctiptor pool
     vkDestroyDescriptorPool(vkhLogicalDevice, vkhDescriptorPool, nullptr);
-    // destroy the descriptor set layout
-    vkDestroyDescriptorSetLayout(vkhLogicalDevice, vkhDescriptorSetLayout, nullptr);
+    // destroy the descriptor set and pipeline layouts
+    DestroyLayouts();
     // destroy the uniform buffer
     vkDestroyBuffer(vkhLogicalDevice, vkhUniformBuffer, nullptr);
     // release memory used by the uniform buffer
     vkFreeMemory(vkhLogicalDevice, vkhUniformBufferMemory, nullptr);
-
+    // destroy the object buffer and release its memory
+    vkDestroyBuffer(vkhLogicalDevice, vkhObjectBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhObjectBufferMemory, nullptr);
+
+    // stop watching the asset files, reloads in progress are thrown away with the other assets
+    fwAssetFiles.Clear();
+    mapReloadHandles.clear();
+    // destroy the tile cache of virtual textures, before the files its loads read from are closed
+    DestroyVirtualTextureCache();
+    // destroy the model's materials and their textures, waiting for the imports still in progress
+    DestroyMaterials();
+    // destroy the staging ring, once the loads from it are done
+    FinishFrameUploads();
+    DestroyStagingRing();
     // destroy the texture sampler
     vkDestroySampler(vkhLogicalDevice, vkhImageSampler, nullptr);
     // destroy the image view for the texture
@@ -144,13 +262,26 @@ bool GfxAPIVulkan::Destroy() {
     // release memory used by the uniform buffer
     vkFreeMemory(vkhLogicalDevice, vkhIndexBufferMemory, nullptr);
 
+    // destroy the meshlet culling pipeline and buffers
+    DestroyMeshletCulling();
+    // destroy the mip downsampling pipeline
+    DestroyMipPipeline();
+    // destroy the frame time queries
+    if (vkhFrameTimeQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(vkhLogicalDevice, vkhFrameTimeQueryPool, nullptr);
+    }
+
     // destroy semaphores
     DestroySemaphores();
     // destoy the command pool
     vkDestroyCommandPool(vkhLogicalDevice, vkhCommandPool, nullptr);
+    // save and destroy the pipeline cache
+    DestroyPipelineCache();
 
     // destroy the logical devics
     vkDestroyDevice(vkhLogicalDevice, nullptr);
+    // unmap the asset package
+    pkgAssets.Close();
     // remove the validation callback
     DestroyValidationErrorCallback();
     // destroy the window surface
@@ -177,14 +308,18 @@ void GfxAPIVulkan::InitializeSwapChain() {
     CreateSwapChain();
     // create image views
     CreateImageViews();
-    // create the render pass
-    CreateRenderPass();
-    // create the graphics pipeline
-    CreateGraphicsPipeline();
+    // create the render pass, dynamic rendering doesn't use one
+    if (!bDynamicRendering) {
+        CreateRenderPass();
+    }
+    // create the graphics pipelines of all known states
+    CreateGraphicsPipelines();
     // create resources needed for depth testing
     CreateDepthResources();
-    // create the framebuffers
-    CreateFramebuffers();
+    // create the framebuffers, dynamic rendering draws to the image views directly
+    if (!bDynamicRendering) {
+        CreateFramebuffers();
+    }
     // allocate command buffers
     CreateCommandBuffers();
     // record the command buffers - NOTE: this is for the simple drawing from the tutorial.
@@ -207,12 +342,13 @@ void GfxAPIVulkan::DestroySwapChain() {
     // destroy the framebuffers
     DestroyFramebuffers();
 
-    // destroy the pipeline
-    vkDestroyPipeline(vkhLogicalDevice, vkhPipeline, nullptr);
-	// destroy the pipeline layout
-	vkDestroyPipelineLayout(vkhLogicalDevice, vkhPipelineLayout, nullptr);
+    // destroy the graphics pipelines, they are created again for the same states; the compiles in
+    // progress use the render pass, so they are finished first
+    WaitForGraphicsPipelines();
+    DestroyGraphicsPipelines();
 	// destroy the render pass
 	vkDestroyRenderPass(vkhLogicalDevice, vkhRenderPass, nullptr);
+	vkhRenderPass = VK_NULL_HANDLE;
 	// destroy the image views
     DestroyImageViews();
     // destroy the swap chain
@@ -294,6 +430,13 @@ void GfxAPIVulkan::CreateInstance() {
     if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to create a Vulkan instance");
     }
+
+#ifdef VK_KHR_get_physical_device_properties2
+    // remember if the extended device queries are there, the optional device features are queried with them
+    bPhysicalDeviceProperties2 = std::find_if(astrRequiredExtensions.begin(), astrRequiredExtensions.end(), [](const char *strExtension) {
+        return strcmp(strExtension, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0;
+    }) != astrRequiredExtensions.end();
+#endif
 }
 
 
@@ -313,11 +456,32 @@ void GfxAPIVulkan::GetRequiredInstanceExtensions(std::vector<const char*> &astrR
     if (Options::Get().ShouldUseValidationLayers()) {
         astrRequiredExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
     }
+
+#ifdef VK_KHR_get_physical_device_properties2
+    // the device features of pipeline libraries, dynamic rendering and descriptor indexing can only be queried through
+    // the extended queries, none of them is used without them
+    if ((Options::Get().ShouldUsePipelineLibraries() || Options::Get().ShouldUseDynamicRendering() || Options::Get().ShouldUseBindlessTextures())
+        && IsInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+        astrRequiredExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+#endif
 }
 
 
 // Check if all required instance extensions are supported
 void GfxAPIVulkan::CheckInstanceExtensionSupport(const std::vector<const char*> &astrRequiredExtensions) const {
+    // go through all required extensions
+    for (const char *strExtension : astrRequiredExtensions) {
+        // if the extension was not found, throw an exception
+        if (!IsInstanceExtensionAvailable(strExtension)) {
+            throw std::runtime_error("Not all required extensions are supported");
+        }
+    }
+}
+
+
+// Is the instance extension supported?
+bool GfxAPIVulkan::IsInstanceExtensionAvailable(const char *strExtension) const {
     // get the number of supported extensions
     uint32_t ctExtensions = 0;
     vkEnumerateInstanceExtensionProperties(nullptr, &ctExtensions, nullptr);
@@ -327,22 +491,13 @@ void GfxAPIVulkan::CheckInstanceExtensionSupport(const std::vector<const char*>
     // get the extension details
     vkEnumerateInstanceExtensionProperties(nullptr, &ctExtensions, aAvailableExtensions.data());
 
-    // go through all required extensions
-    for (const char *strExtension : astrRequiredExtensions) {
-        bool bFound = false;
-        // search for the extension in the list of supported extensions
-        for (const auto &propsExtension : aAvailableExtensions) {
-            // if found, mark it and exit
-            if (strcmp(strExtension, propsExtension.extensionName) == 0) {
-                bFound = true;
-                break;
-            }
-        }
-        // if the extension was not found, throw an exception
-        if (!bFound) {
-            throw std::runtime_error("Not all required extensions are supported");
+    // search for the extension in the list of supported extensions
+    for (const auto &propsExtension : aAvailableExtensions) {
+        if (strcmp(strExtension, propsExtension.extensionName) == 0) {
+            return true;
         }
     }
+    return false;
 }
 
 
@@ -357,31 +512,34 @@ void GfxAPIVulkan::GetRequiredDeviceExtensions(std::vector<const char*> &astrReq
 
 // Check if all required device extensions are supported
 void GfxAPIVulkan::CheckDeviceExtensionSupport(const VkPhysicalDevice &device, const std::vector<const char*> &astrRequiredExtensions) const {
+    // go through all required extensions
+    for (const char *strExtension : astrRequiredExtensions) {
+        // if the extension was not found, throw an exception
+        if (!IsDeviceExtensionAvailable(device, strExtension)) {
+            throw std::runtime_error("Not all required extensions are supported");
+        }
+    }
+}
+
+
+// Is the device extension supported?
+bool GfxAPIVulkan::IsDeviceExtensionAvailable(const VkPhysicalDevice &device, const char *strExtension) const {
     // get the number of supported extensions
     uint32_t ctExtensions = 0;
-    vkEnumerateDeviceExtensionProperties(device,nullptr, &ctExtensions, nullptr);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &ctExtensions, nullptr);
 
     // prepare a vector to hold the extensions
     std::vector<VkExtensionProperties> aAvailableExtensions(ctExtensions);
     // get the extension details
     vkEnumerateDeviceExtensionProperties(device, nullptr, &ctExtensions, aAvailableExtensions.data());
 
-    // go through all required extensions
-    for (const char *strExtension : astrRequiredExtensions) {
-        bool bFound = false;
-        // search for the extension in the list of supported extensions
-        for (const auto &propsExtension : aAvailableExtensions) {
-            // if found, mark it and exit
-            if (strcmp(strExtension, propsExtension.extensionName) == 0) {
-                bFound = true;
-                break;
-            }
-        }
-        // if the extension was not found, throw an exception
-        if (!bFound) {
-            throw std::runtime_error("Not all required extensions are supported");
+    // search for the extension in the list of supported extensions
+    for (const auto &propsExtension : aAvailableExtensions) {
+        if (strcmp(strExtension, propsExtension.extensionName) == 0) {
+            return true;
         }
     }
+    return false;
 }
 
 // Set up the validation layers.
@@ -470,6 +628,17 @@ void GfxAPIVulkan::CreateSurface() {
     }
 }
 
+// How much a device type is preferred when selecting the physical device, higher is better.
+static int GetDeviceTypeRank(VkPhysicalDeviceType idType) {
+    switch (idType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:            return 1;
+    default:                                     return 0;
+    }
+}
+
 // Select the physical device (graphics card) to render on
 void GfxAPIVulkan::SelectPhysicalDevice() {
     // enumerate the available physical devices
@@ -485,26 +654,37 @@ void GfxAPIVulkan::SelectPhysicalDevice() {
     std::vector<VkPhysicalDevice> aPhysicalDevices(ctDevices);
     vkEnumeratePhysicalDevices(vkhAPIInstance, &ctDevices, aPhysicalDevices.data());
 
-    // find the first physical device that fits the needs
+    // find the best physical device that fits the needs - discrete GPUs are preferred, but any device with the
+    // required features will do, including software implementations running on the CPU
+    VkPhysicalDevice vkhBestDevice = VK_NULL_HANDLE;
+    int iBestRank = -1;
     for (const VkPhysicalDevice &device : aPhysicalDevices) {
-        if (IsDeviceSuitable(device)) {
-            vkhPhysicalDevice = device;
-            break;
+        if (!IsDeviceSuitable(device)) {
+            continue;
+        }
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        const int iRank = GetDeviceTypeRank(deviceProperties.deviceType);
+        if (iRank > iBestRank) {
+            vkhBestDevice = device;
+            iBestRank = iRank;
         }
     }
 
     // if no suitable physical device was found, throw
-    if (vkhPhysicalDevice == VK_NULL_HANDLE) {
+    if (vkhBestDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("No suitable physical device found");
     }
+    vkhPhysicalDevice = vkhBestDevice;
+
+    // queue families and swap chain support were queried for every candidate, query them again for the selected one
+    FindQueueFamilies(vkhPhysicalDevice);
+    QuerySwapChainSupport(vkhPhysicalDevice);
 }
 
 
 // Does the device support all required features?
 bool GfxAPIVulkan::IsDeviceSuitable(const VkPhysicalDevice &device) {
-    // get the data for properties of this device
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
     // get the data about supported features
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
@@ -513,11 +693,8 @@ bool GfxAPIVulkan::IsDeviceSuitable(const VkPhysicalDevice &device) {
     if (!deviceFeatures.samplerAnisotropy) {
         return false;
     }
-
-    // NOTE: This is only an example of device property and feature selection, the real implementation would be more elaborate
-    // and would probably select the best device available
-    // the GfxAPIVulkan requires a discrete GPU and geometry shader support
-    if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU || !deviceFeatures.geometryShader) {
+    // the fragment shader writes the virtual texture tiles it samples to a storage buffer
+    if (!deviceFeatures.fragmentStoresAndAtomics) {
         return false;
     }
 
@@ -553,11 +730,17 @@ void GfxAPIVulkan::FindQueueFamilies(const VkPhysicalDevice &device) {
     std::vector<VkQueueFamilyProperties> aQueueFamilies(ctQueueFamilies);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &ctQueueFamilies, aQueueFamilies.data());
 
+    // forget the families found for previously checked devices
+    iGraphicsQueueFamily = -1;
+    iPresentationQueueFamily = -1;
+
     // find the queue families that support required features
     for (uint32_t iQueueFamily = 0; iQueueFamily < ctQueueFamilies; iQueueFamily++) {
         const auto &qfQueueFamily = aQueueFamilies[iQueueFamily];
         // if this is the first queue family that supports graphics commands, store its index
-        if (iGraphicsQueueFamily < 0 && qfQueueFamily.queueCount > 0 && (qfQueueFamily.queueFlags | VK_QUEUE_GRAPHICS_BIT)) {
+        // it also has to support compute commands, as meshlet culling is recorded into the same command buffers
+        const VkQueueFlags flgRequired = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        if (iGraphicsQueueFamily < 0 && qfQueueFamily.queueCount > 0 && (qfQueueFamily.queueFlags & flgRequired) == flgRequired) {
             iGraphicsQueueFamily = iQueueFamily;
         }
 
@@ -746,7 +929,7 @@ void GfxAPIVulkan::CreateImageViews() {
     // for each swap chain image, create the view
     for (size_t iImage = 0; iImage < avkhImages.size(); ++iImage) {
         // create the image view
-        avkhImageViews[iImage] = CreateImageView(avkhImages[iImage], fmtSurfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT);
+        avkhImageViews[iImage] = CreateImageView(avkhImages[iImage], fmtSurfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
     }
 }
 
@@ -788,10 +971,16 @@ void GfxAPIVulkan::CreateLogicalDevice() {
     infoLogicalDevice.queueCreateInfoCount = static_cast<uint32_t>(setQueueFamilies.size());
 
     // list the needed device features
-    // NOTE: not specifying any for now, will revisit later
     VkPhysicalDeviceFeatures deviceFeatures = {};
     // request texture sampling anisotropy
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // request storage buffer writes from the fragment shader, for virtual texture feedback
+    deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+    // request block compressed textures if the device has them, textures are left uncompressed otherwise
+    VkPhysicalDeviceFeatures featuresSupported;
+    vkGetPhysicalDeviceFeatures(vkhPhysicalDevice, &featuresSupported);
+    bTextureCompressionBC = featuresSupported.textureCompressionBC == VK_TRUE;
+    deviceFeatures.textureCompressionBC = featuresSupported.textureCompressionBC;
 
     // set required features
     infoLogicalDevice.pEnabledFeatures = &deviceFeatures;
@@ -799,6 +988,89 @@ void GfxAPIVulkan::CreateLogicalDevice() {
     // enable the required extensions
     std::vector<const char*> astrRequiredExtensions;
     GetRequiredDeviceExtensions(astrRequiredExtensions);
+
+    // the optional features below are queried with the extended queries, an instance extension function that is
+    // looked up; the features that are there are chained into the device description
+    bPipelineLibraries = false;
+    bDynamicRendering = false;
+#ifdef VK_KHR_get_physical_device_properties2
+    PFN_vkGetPhysicalDeviceFeatures2KHR pfnGetPhysicalDeviceFeatures2 = nullptr;
+    if (bPhysicalDeviceProperties2) {
+        pfnGetPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(vkhAPIInstance, "vkGetPhysicalDeviceFeatures2KHR"));
+    }
+    VkPhysicalDeviceFeatures2KHR featuresDevice = {};
+    featuresDevice.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+#endif
+
+    // link pipelines from libraries if the device has them, they are created whole otherwise
+#ifdef VK_EXT_graphics_pipeline_library
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT featuresPipelineLibrary = {};
+    featuresPipelineLibrary.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if (pfnGetPhysicalDeviceFeatures2 != nullptr && Options::Get().ShouldUsePipelineLibraries()
+        && IsDeviceExtensionAvailable(vkhPhysicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+        && IsDeviceExtensionAvailable(vkhPhysicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        featuresDevice.pNext = &featuresPipelineLibrary;
+        pfnGetPhysicalDeviceFeatures2(vkhPhysicalDevice, &featuresDevice);
+        bPipelineLibraries = featuresPipelineLibrary.graphicsPipelineLibrary == VK_TRUE;
+    }
+    if (bPipelineLibraries) {
+        astrRequiredExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        astrRequiredExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        featuresPipelineLibrary.pNext = const_cast<void *>(infoLogicalDevice.pNext);
+        infoLogicalDevice.pNext = &featuresPipelineLibrary;
+    }
+#endif
+    std::cout << (bPipelineLibraries ? "Linking graphics pipelines from pipeline libraries" : "Creating graphics pipelines whole") << std::endl;
+
+    // render without render pass and framebuffer objects if the device can, on Vulkan 1.0 dynamic rendering needs the
+    // extensions it was built on as well
+#ifdef VK_KHR_dynamic_rendering
+    const char *astrDynamicRenderingExtensions[] = { VK_KHR_MULTIVIEW_EXTENSION_NAME, VK_KHR_MAINTENANCE2_EXTENSION_NAME,
+        VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME };
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR featuresDynamicRendering = {};
+    featuresDynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    if (pfnGetPhysicalDeviceFeatures2 != nullptr && Options::Get().ShouldUseDynamicRendering()
+        && std::all_of(std::begin(astrDynamicRenderingExtensions), std::end(astrDynamicRenderingExtensions), [this](const char *strExtension) {
+            return IsDeviceExtensionAvailable(vkhPhysicalDevice, strExtension);
+        })) {
+        featuresDevice.pNext = &featuresDynamicRendering;
+        pfnGetPhysicalDeviceFeatures2(vkhPhysicalDevice, &featuresDevice);
+        bDynamicRendering = featuresDynamicRendering.dynamicRendering == VK_TRUE;
+    }
+    if (bDynamicRendering) {
+        astrRequiredExtensions.insert(astrRequiredExtensions.end(), std::begin(astrDynamicRenderingExtensions), std::end(astrDynamicRenderingExtensions));
+        featuresDynamicRendering.pNext = const_cast<void *>(infoLogicalDevice.pNext);
+        infoLogicalDevice.pNext = &featuresDynamicRendering;
+    }
+#endif
+    std::cout << (bDynamicRendering ? "Rendering with dynamic rendering" : "Rendering with render passes") << std::endl;
+
+    // bind the textures of all materials through one set if the device can index arrays of them and update them while
+    // the set is bound; the array is indexed by a push constant, so dynamic indexing is enough
+    bBindlessTextures = false;
+#ifdef VK_EXT_descriptor_indexing
+    const char *astrDescriptorIndexingExtensions[] = { VK_KHR_MAINTENANCE3_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT featuresDescriptorIndexing = {};
+    featuresDescriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (pfnGetPhysicalDeviceFeatures2 != nullptr && Options::Get().ShouldUseBindlessTextures()
+        && featuresSupported.shaderSampledImageArrayDynamicIndexing == VK_TRUE
+        && std::all_of(std::begin(astrDescriptorIndexingExtensions), std::end(astrDescriptorIndexingExtensions), [this](const char *strExtension) {
+            return IsDeviceExtensionAvailable(vkhPhysicalDevice, strExtension);
+        })) {
+        featuresDevice.pNext = &featuresDescriptorIndexing;
+        pfnGetPhysicalDeviceFeatures2(vkhPhysicalDevice, &featuresDevice);
+        bBindlessTextures = featuresDescriptorIndexing.runtimeDescriptorArray == VK_TRUE
+            && featuresDescriptorIndexing.descriptorBindingPartiallyBound == VK_TRUE
+            && featuresDescriptorIndexing.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE;
+    }
+    if (bBindlessTextures) {
+        astrRequiredExtensions.insert(astrRequiredExtensions.end(), std::begin(astrDescriptorIndexingExtensions), std::end(astrDescriptorIndexingExtensions));
+        featuresDescriptorIndexing.pNext = const_cast<void *>(infoLogicalDevice.pNext);
+        infoLogicalDevice.pNext = &featuresDescriptorIndexing;
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    }
+#endif
+    std::cout << (bBindlessTextures ? "Binding material textures bindless" : "Binding a descriptor set per material texture") << std::endl;
     infoLogicalDevice.enabledExtensionCount = static_cast<uint32_t>(astrRequiredExtensions.size());
     infoLogicalDevice.ppEnabledExtensionNames = astrRequiredExtensions.data();
 
@@ -821,20 +1093,129 @@ void GfxAPIVulkan::CreateLogicalDevice() {
     vkGetDeviceQueue(vkhLogicalDevice, iGraphicsQueueFamily, 0, &vkhGraphicsQueue);
     // retreive the handle to the presentation
     vkGetDeviceQueue(vkhLogicalDevice, iPresentationQueueFamily, 0, &vkhPresentationQueue);
+
+#ifdef VK_KHR_dynamic_rendering
+    // the commands of dynamic rendering are device extension functions, so they are looked up
+    if (bDynamicRendering) {
+        pfnCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(vkhLogicalDevice, "vkCmdBeginRenderingKHR"));
+        pfnCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(vkhLogicalDevice, "vkCmdEndRenderingKHR"));
+    }
+#endif
+}
+
+
+// Create the pipeline cache, with the data saved by a previous run.
+void GfxAPIVulkan::CreatePipelineCache() {
+    // the file is checked against the device and driver, data saved with a different one is useless or worse
+    std::vector<char> achData;
+    bPipelineCacheLoaded = PipelineCacheFile::Read(STR_PIPELINE_CACHE_FILENAME, GetPipelineCacheIdentity(), achData);
+
+    // the driver's own header leads the data; drivers should reject data that doesn't match them, but not all do
+    if (bPipelineCacheLoaded) {
+        const PipelineCacheFileHeader hdrIdentity = GetPipelineCacheIdentity();
+        uint32_t aiHeader[4] = {};
+        if (achData.size() >= sizeof(aiHeader) + VK_UUID_SIZE) {
+            memcpy(aiHeader, achData.data(), sizeof(aiHeader));
+        }
+        if (aiHeader[0] < sizeof(aiHeader) + VK_UUID_SIZE || aiHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            || aiHeader[2] != hdrIdentity.idVendor || aiHeader[3] != hdrIdentity.idDevice
+            || memcmp(achData.data() + sizeof(aiHeader), hdrIdentity.auuidPipelineCache, VK_UUID_SIZE) != 0) {
+            std::cerr << "Pipeline cache " << STR_PIPELINE_CACHE_FILENAME << " doesn't match the device, it is thrown away" << std::endl;
+            achData.clear();
+            bPipelineCacheLoaded = false;
+        }
+    }
+
+    // describe the pipeline cache
+    VkPipelineCacheCreateInfo infoPipelineCache = {};
+    infoPipelineCache.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    infoPipelineCache.initialDataSize = achData.size();
+    infoPipelineCache.pInitialData = achData.empty() ? nullptr : achData.data();
+
+    // the driver may still reject the data, an empty cache is better than none
+    if (vkCreatePipelineCache(vkhLogicalDevice, &infoPipelineCache, nullptr, &vkhPipelineCache) != VK_SUCCESS) {
+        infoPipelineCache.initialDataSize = 0;
+        infoPipelineCache.pInitialData = nullptr;
+        bPipelineCacheLoaded = false;
+        if (vkCreatePipelineCache(vkhLogicalDevice, &infoPipelineCache, nullptr, &vkhPipelineCache) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create the pipeline cache");
+        }
+    }
+    ctSavedPipelineCacheBytes = bPipelineCacheLoaded ? achData.size() : 0;
+    tmPipelineCacheSaved = std::chrono::steady_clock::now();
+}
+
+
+// Save the pipeline cache on a worker, if pipelines were added to it.
+void GfxAPIVulkan::SavePipelineCache() {
+    tmPipelineCacheSaved = std::chrono::steady_clock::now();
+
+    // the cache only grows, the same size means nothing was added since the last save
+    size_t ctDataBytes = 0;
+    if (vkGetPipelineCacheData(vkhLogicalDevice, vkhPipelineCache, &ctDataBytes, nullptr) != VK_SUCCESS || ctDataBytes == ctSavedPipelineCacheBytes) {
+        return;
+    }
+    std::shared_ptr<std::vector<char>> pachData = std::make_shared<std::vector<char>>(ctDataBytes);
+    if (vkGetPipelineCacheData(vkhLogicalDevice, vkhPipelineCache, &ctDataBytes, pachData->data()) != VK_SUCCESS) {
+        return;
+    }
+    pachData->resize(ctDataBytes);
+
+    // saves go through the same file one at a time, the previous one has long finished by now
+    if (futPipelineCacheSaved.valid()) {
+        futPipelineCacheSaved.wait();
+    }
+    const PipelineCacheFileHeader hdrIdentity = GetPipelineCacheIdentity();
+    futPipelineCacheSaved = ThreadPool::Get().Submit([hdrIdentity, pachData]() {
+        try {
+            PipelineCacheFile::Write(STR_PIPELINE_CACHE_FILENAME, hdrIdentity, *pachData);
+        }
+        catch (const std::runtime_error &e) {
+            std::cerr << "Failed to save the pipeline cache: " << e.what() << std::endl;
+        }
+    });
+    ctSavedPipelineCacheBytes = ctDataBytes;
+}
+
+
+// Save the pipeline cache one last time and destroy it.
+void GfxAPIVulkan::DestroyPipelineCache() {
+    SavePipelineCache();
+    if (futPipelineCacheSaved.valid()) {
+        futPipelineCacheSaved.wait();
+    }
+    vkDestroyPipelineCache(vkhLogicalDevice, vkhPipelineCache, nullptr);
+    vkhPipelineCache = VK_NULL_HANDLE;
+}
+
+
+// Get the identity of the device and driver that saved pipeline cache data must match.
+PipelineCacheFileHeader GfxAPIVulkan::GetPipelineCacheIdentity() const {
+    VkPhysicalDeviceProperties propsDevice;
+    vkGetPhysicalDeviceProperties(vkhPhysicalDevice, &propsDevice);
+
+    PipelineCacheFileHeader hdrIdentity = {};
+    hdrIdentity.idVendor = propsDevice.vendorID;
+    hdrIdentity.idDevice = propsDevice.deviceID;
+    hdrIdentity.idDriverVersion = propsDevice.driverVersion;
+    memcpy(hdrIdentity.auuidPipelineCache, propsDevice.pipelineCacheUUID, CT_PIPELINE_CACHE_UUID_SIZE);
+    return hdrIdentity;
 }
 
 
 // Load shader code and create the module.
-VkShaderModule GfxAPIVulkan::CreateShaderModule(const std::string &strFilename) {
-    // NOTE: This needs to be recoded to support relative paths and proper resource management
-    auto achShaderCode = LoadShader(strFilename);
+VkShaderModule GfxAPIVulkan::CreateShaderModule(const std::string &strAssetName) {
+    // the code is used straight from the package mapping, where every asset starts on a page boundary, or from the
+    // reloaded file's allocation
+    uint64_t ctCodeBytes;
+    const char *pchCode = GetAssetData(strAssetName, ctCodeBytes);
 
     // describe the shader module
     VkShaderModuleCreateInfo infoShaderModule = {};
     infoShaderModule.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     // bind the shader binary code
-    infoShaderModule.codeSize = achShaderCode.size();
-    infoShaderModule.pCode = reinterpret_cast<const uint32_t*> (achShaderCode.data());
+    infoShaderModule.codeSize = static_cast<size_t>(ctCodeBytes);
+    infoShaderModule.pCode = reinterpret_cast<const uint32_t*> (pchCode);
 
     // createh the shader module
     VkShaderModule modShaderModule;
@@ -845,28 +1226,360 @@ VkShaderModule GfxAPIVulkan::CreateShaderModule(const std::string &strFilename)
     return modShaderModule;
 }
 
-// Load shader bytecode from a file.
-std::vector<char> GfxAPIVulkan::LoadShader(const std::string &filename) {
-    // open the file and position at the end
-    std::ifstream fsFile(filename, std::ios::ate | std::ios::binary);
+// Read the interface of a shader from its compiled code.
+ShaderInterface GfxAPIVulkan::ReflectShader(const std::string &strAssetName) const {
+    uint64_t ctCodeBytes;
+    const char *pchCode = GetAssetData(strAssetName, ctCodeBytes);
+    try {
+        return ShaderReflection::Reflect(pchCode, ctCodeBytes);
+    }
+    catch (const std::runtime_error &e) {
+        throw std::runtime_error(strAssetName + ": " + e.what());
+    }
+}
+
+// Map the package the assets are loaded from.
+void GfxAPIVulkan::OpenAssetPackage() {
+    // the loose files are only there during development, a shipped package is used as it is; the model is imported
+    // first, as its mesh goes into the package
+    if (FileSystem::FileExists(STR_MODEL_FILENAME)) {
+        MeshImporter::ImportObjIfOutOfDate(STR_MODEL_FILENAME, STR_MODEL_MESH_FILENAME);
+    }
+    // the shaders are compiled from their sources, which are only there during development too
+    CompileShaders();
+    std::vector<std::string> astrFilenames;
+    for (const char *strAsset : ASTR_PACKAGED_ASSETS) {
+        astrFilenames.push_back(std::string(STR_ASSET_DIRECTORY) + strAsset);
+    }
+    AssetPackager::PackFilesIfOutOfDate(astrFilenames, STR_ASSET_PACKAGE_FILENAME);
+
+    // the package stays mapped for the lifetime of the API, assets are used from it in place
+    pkgAssets.Open(STR_ASSET_PACKAGE_FILENAME);
+}
+
+
+// Compile the shaders from their sources into their assets.
+void GfxAPIVulkan::CompileShaders() {
+    std::vector<const ShaderSource *> apsrcSources;
+    for (const ShaderSource &srcShader : ASRC_SHADER_SOURCES) {
+        if (FileSystem::FileExists(srcShader.strSourceFilename)) {
+            apsrcSources.push_back(&srcShader);
+        }
+    }
+    if (apsrcSources.empty()) {
+        return;
+    }
+    // the compiled shaders are kept with their sources, so without the compiler they are used as they are
+    if (!ShaderCompiler::IsAvailable()) {
+        std::cerr << "Shader compiler not found, using the compiled shaders; install the Vulkan SDK or set VULKAN_SDK to compile them" << std::endl;
+        return;
+    }
+
+    // each compile is a process of its own, so they all run at once; cached shaders are only copied
+    std::vector<std::string> astrErrors(apsrcSources.size());
+    const bool bOptimize = Options::Get().ShouldOptimizeShaders();
+    ThreadPool::Get().ParallelFor(static_cast<uint32_t>(apsrcSources.size()), [&apsrcSources, &astrErrors, bOptimize](uint32_t iSource) {
+        try {
+            CompileShaderSource(*apsrcSources[iSource], bOptimize);
+        }
+        catch (const std::runtime_error &e) {
+            astrErrors[iSource] = e.what();
+        }
+    });
+    // a shader that doesn't compile keeps its previous code, like one that fails to reload
+    for (const std::string &strError : astrErrors) {
+        if (!strError.empty()) {
+            std::cerr << strError << std::endl;
+        }
+    }
+}
+
+
+// Get the data of an asset in the package, or of its reloaded loose file.
+const char *GfxAPIVulkan::GetAssetData(const std::string &strAssetName, uint64_t &ctBytes) const {
+    auto itReloaded = mapReloadedAssets.find(strAssetName);
+    if (itReloaded != mapReloadedAssets.end()) {
+        ctBytes = itReloaded->second.size();
+        return itReloaded->second.data();
+    }
+    return pkgAssets.GetAsset(strAssetName, ctBytes);
+}
+
 
-    // if the file failed to open, throw an error
-    if (!fsFile.is_open()) {
-        throw std::runtime_error("Failed to open file");
+// Watch the loose files of the assets.
+void GfxAPIVulkan::WatchAssetFiles() {
+    if (!Options::Get().ShouldHotReloadAssets()) {
+        return;
+    }
+
+    // the model is reloaded when its source is imported again, which writes its mesh; files that aren't there, like
+    // the loose files next to a shipped package, are never reloaded
+    std::vector<std::string> astrFilenames = { STR_MODEL_FILENAME };
+    for (const ShaderSource &srcShader : ASRC_SHADER_SOURCES) {
+        // a source compiled into several assets is watched once
+        if (std::find(astrFilenames.begin(), astrFilenames.end(), srcShader.strSourceFilename) == astrFilenames.end()) {
+            astrFilenames.push_back(srcShader.strSourceFilename);
+        }
+    }
+    for (const char *strAsset : ASTR_PACKAGED_ASSETS) {
+        astrFilenames.push_back(std::string(STR_ASSET_DIRECTORY) + strAsset);
+    }
+    for (const std::shared_ptr<TextureImport> &impTexture : aimpTextureImports) {
+        astrFilenames.push_back(impTexture->upUpload.strFilename);
+    }
+
+    // reloading is a convenience, a file that can't be watched isn't fatal
+    for (const std::string &strFilename : astrFilenames) {
+        if (!FileSystem::FileExists(strFilename)) {
+            continue;
+        }
+        try {
+            fwAssetFiles.Watch(strFilename);
+        }
+        catch (const std::runtime_error &e) {
+            std::cerr << "Changes of " << strFilename << " won't be reloaded: " << e.what() << std::endl;
+        }
+    }
+}
+
+
+// Reload the assets whose files changed since the last frame.
+void GfxAPIVulkan::ReloadChangedAssets() {
+    std::vector<std::string> astrChanged;
+    fwAssetFiles.Poll(astrChanged);
+    for (const std::string &strFilename : astrChanged) {
+        std::cout << "Reloading " << strFilename << std::endl;
+
+        // the model's source is imported into its mesh on a worker, the mesh is then reloaded as it changed
+        if (strFilename == STR_MODEL_FILENAME) {
+            AssetManager::AssetLoader ldrImport;
+            ldrImport.fnLoad = []() { MeshImporter::ImportObjIfOutOfDate(STR_MODEL_FILENAME, STR_MODEL_MESH_FILENAME); };
+            RequestReload(strFilename, ldrImport);
+            continue;
+        }
+        // a shader's source is compiled on a worker in the same way, into all of its assets, which are reloaded if
+        // their code changed
+        std::vector<ShaderSource> asrcChanged;
+        for (const ShaderSource &srcShader : ASRC_SHADER_SOURCES) {
+            if (strFilename == srcShader.strSourceFilename) {
+                asrcChanged.push_back(srcShader);
+            }
+        }
+        if (!asrcChanged.empty()) {
+            AssetManager::AssetLoader ldrCompile;
+            const bool bOptimize = Options::Get().ShouldOptimizeShaders();
+            ldrCompile.fnLoad = [asrcChanged, bOptimize]() {
+                for (const ShaderSource &srcShader : asrcChanged) {
+                    CompileShaderSource(srcShader, bOptimize);
+                }
+            };
+            RequestReload(strFilename, ldrCompile);
+        }
+        for (const char *strAsset : ASTR_PACKAGED_ASSETS) {
+            if (strFilename == std::string(STR_ASSET_DIRECTORY) + strAsset) {
+                ReloadPackagedAsset(strAsset);
+            }
+        }
+        for (const std::shared_ptr<TextureImport> &impTexture : aimpTextureImports) {
+            if (strFilename == impTexture->upUpload.strFilename) {
+                ReloadMaterialTexture(*impTexture);
+            }
+        }
+    }
+}
+
+
+// Request the asset that reloads a file, or load it again if it was requested before.
+void GfxAPIVulkan::RequestReload(const std::string &strFilename, const AssetManager::AssetLoader &ldrReload) {
+    auto itReload = mapReloadHandles.find(strFilename);
+    if (itReload != mapReloadHandles.end()) {
+        amAssets.Reload(itReload->second);
+    } else {
+        mapReloadHandles[strFilename] = amAssets.Request("reload of " + strFilename, {}, ldrReload);
+    }
+}
+
+
+// Read an asset's changed loose file on a worker, and rebuild what uses it once it is read.
+void GfxAPIVulkan::ReloadPackagedAsset(const std::string &strAssetName) {
+    const std::string strFilename = STR_ASSET_DIRECTORY + strAssetName;
+    std::shared_ptr<std::vector<char>> pachData = std::make_shared<std::vector<char>>();
+    AssetManager::AssetLoader ldrReload;
+    ldrReload.fnLoad = [pachData, strFilename]() {
+        MappedFile mfFile;
+        mfFile.Open(strFilename);
+        pachData->assign(mfFile.GetData(), mfFile.GetData() + mfFile.GetSize());
+    };
+    ldrReload.fnFinish = [this, pachData, strAssetName]() {
+        // pipelines compiling on workers may be reading the shader code that is about to change; optimized pipelines
+        // collected here replace the ones the commands were recorded with
+        if (WaitForGraphicsPipelines()) {
+            RecordCommandBuffers();
+        }
+        // the previous data is used again if the new one can't be, e.g. shader code that doesn't make a pipeline
+        std::vector<char> achPrevious;
+        std::vector<char> &achData = mapReloadedAssets[strAssetName];
+        achPrevious.swap(achData);
+        achData = *pachData;
+        try {
+            ApplyReloadedAsset(strAssetName);
+        }
+        catch (const std::runtime_error &) {
+            achData.swap(achPrevious);
+            if (achData.empty()) {
+                mapReloadedAssets.erase(strAssetName);
+            }
+            throw;
+        }
+    };
+    RequestReload(strFilename, ldrReload);
+}
+
+
+// Rebuild what uses a packaged asset.
+void GfxAPIVulkan::ApplyReloadedAsset(const std::string &strAssetName) {
+    if (strAssetName == STR_VERTEX_SHADER_ASSET || strAssetName == GetFragmentShaderAsset()) {
+        ReloadGraphicsPipelines();
+    } else if (strAssetName == STR_CULL_SHADER_ASSET) {
+        ReloadCullPipeline();
+    } else if (strAssetName == STR_MIP_SHADER_ASSET) {
+        // the downsampling pipeline is created on its next use
+        DestroyMipPipeline();
+    } else if (strAssetName == STR_DEFAULT_TEXTURE_ASSET) {
+        ReloadDefaultTexture();
+    } else if (strAssetName == STR_MODEL_MESH_ASSET) {
+        ReloadModel();
+    }
+}
+
+
+// Create the graphics pipelines again with the current shaders.
+void GfxAPIVulkan::ReloadGraphicsPipelines() {
+    // the new pipelines replace the old ones only if all of them are created; the libraries are compiled again from
+    // the current shaders, and the old ones are kept to link with if that fails
+    const std::vector<VkPipeline> avkhOldPipelines = avkhPipelines;
+    const VkPipelineLayout vkhOldPipelineLayout = vkhPipelineLayout;
+    const VkPushConstantRange rngOldPushConstants = rngMaterialPushConstants;
+    std::array<std::unordered_map<PipelineState, std::shared_ptr<PipelineLibrary>, PipelineStateHash>, CT_PIPELINE_LIBRARY_PARTS> amapOldLibraries;
+    amapOldLibraries.swap(amapPipelineLibraries);
+    try {
+        CreateGraphicsPipelines();
+    }
+    catch (const std::runtime_error &) {
+        vkhPipelineLayout = vkhOldPipelineLayout;
+        rngMaterialPushConstants = rngOldPushConstants;
+        amapPipelineLibraries.swap(amapOldLibraries);
+        throw;
+    }
+
+    // the previous frame is done, so the old pipelines are no longer in use
+    for (VkPipeline vkhOldPipeline : avkhOldPipelines) {
+        vkDestroyPipeline(vkhLogicalDevice, vkhOldPipeline, nullptr);
+    }
+    for (const auto &mapOldLibraries : amapOldLibraries) {
+        for (const auto &itLibrary : mapOldLibraries) {
+            vkDestroyPipeline(vkhLogicalDevice, *itLibrary.second->pvkhPipeline, nullptr);
+        }
+    }
+    RecordCommandBuffers();
+}
+
+
+// Create the culling pipeline again with the current shader.
+void GfxAPIVulkan::ReloadCullPipeline() {
+    if (!bCullMeshlets) {
+        return;
+    }
+    const VkPipeline vkhOldPipeline = vkhCullPipeline;
+    const VkPipelineLayout vkhOldPipelineLayout = vkhCullPipelineLayout;
+    try {
+        CreateCullPipeline();
+    }
+    catch (const std::runtime_error &) {
+        if (vkhCullPipelineLayout != vkhOldPipelineLayout) {
+            vkDestroyPipelineLayout(vkhLogicalDevice, vkhCullPipelineLayout, nullptr);
+        }
+        vkhCullPipeline = vkhOldPipeline;
+        vkhCullPipelineLayout = vkhOldPipelineLayout;
+        throw;
+    }
+
+    vkDestroyPipeline(vkhLogicalDevice, vkhOldPipeline, nullptr);
+    vkDestroyPipelineLayout(vkhLogicalDevice, vkhOldPipelineLayout, nullptr);
+    RecordCommandBuffers();
+}
+
+
+// Create the default texture again from its current image.
+void GfxAPIVulkan::ReloadDefaultTexture() {
+    // the old texture stays if the image can't be decoded
+    VkImage vkhNewImage;
+    VkDeviceMemory vkhNewMemory;
+    CreateTextureImage(STR_DEFAULT_TEXTURE_ASSET, vkhNewImage, vkhNewMemory, ctImageMipLevels, fmtImageFormat);
+    vkDestroyImageView(vkhLogicalDevice, vkhImageView, nullptr);
+    vkDestroyImage(vkhLogicalDevice, vkhImageData, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhImageMemory, nullptr);
+    vkhImageData = vkhNewImage;
+    vkhImageMemory = vkhNewMemory;
+    CreateTextureImageVeiw();
+
+    // the sampler covers the levels of the largest texture, which may be the new one
+    vkDestroySampler(vkhLogicalDevice, vkhImageSampler, nullptr);
+    CreateImageSampler();
+    UpdateMaterialDescriptorSets();
+    RecordCommandBuffers();
+}
+
+
+// Create the model's buffers again from its current mesh.
+void GfxAPIVulkan::ReloadModel() {
+    // the materials' textures and descriptor sets are made for the materials the model had, and the culling pass is
+    // set up for meshlets, so a model that changed those needs a restart
+    uint64_t ctMeshBytes;
+    const char *pchMesh = GetAssetData(STR_MODEL_MESH_ASSET, ctMeshBytes);
+    MeshFile meshFile;
+    meshFile.Open(pchMesh, ctMeshBytes, STR_MODEL_MESH_ASSET);
+    std::vector<MeshMaterial> amatNewMaterials;
+    std::vector<Meshlet> ameshNewMeshlets;
+    meshFile.ReadSection(MESH_SECTION_MATERIALS, amatNewMaterials);
+    meshFile.ReadSection(MESH_SECTION_MESHLETS, ameshNewMeshlets);
+    if (amatNewMaterials.size() != amatMaterials.size()) {
+        throw std::runtime_error("The model's materials changed, restart to load it");
+    }
+    if (bCullMeshlets && ameshNewMeshlets.empty()) {
+        throw std::runtime_error("The model no longer has meshlets, restart to load it");
     }
 
-    // get the file size and preallocate the read buffer
-    size_t ctFileSize = static_cast<size_t>(fsFile.tellg());
-    std::vector<char> achReadBuffer(ctFileSize);
+    LoadModel();
+    vkDestroyBuffer(vkhLogicalDevice, vkhVertexBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhVertexBufferMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhIndexBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhIndexBufferMemory, nullptr);
+    CreateVertexBuffers();
+    CreateIndexBuffers();
+    if (bCullMeshlets) {
+        DestroyMeshletBuffers();
+        CreateMeshletBuffers();
+        WriteCullDescriptorSet();
+    }
 
-    // rewind to the beginning and read the content into the buffer
-    fsFile.seekg(0);
-    fsFile.read(achReadBuffer.data(), ctFileSize);
+    // the model may have other levels of detail, the selection starts over
+    selModelLod = LodSelector();
+    RecordCommandBuffers();
+}
 
-    // close the file
-    fsFile.close();
 
-    return achReadBuffer;
+// Import a material texture's changed image again.
+void GfxAPIVulkan::ReloadMaterialTexture(TextureImport &impTexture) {
+    // the import replaces texture files the textures may have mapped, so the textures are destroyed first; they are
+    // all created again once it is done, as packing and the tile cache depend on all of them
+    DestroyVirtualTextureCache();
+    DestroyMaterialTextures();
+    CreateVirtualTextureCache();
+    UpdateMaterialDescriptorSets();
+    RequestMaterialPipelines();
+    RecordCommandBuffers();
+    amAssets.Reload(impTexture.hTexture);
 }
 
 
@@ -963,99 +1676,650 @@ void GfxAPIVulkan::CreateRenderPass() {
 }
 
 
-// Create descriptor sets - used to bind uniforms to shaders.
+// Create the descriptor set layout of the materials.
 void GfxAPIVulkan::CreateDescriptorSetLayout() {
-    // describe the descriptor set binding for the uniform buffer
-    VkDescriptorSetLayoutBinding infoUniformBinding = {};
-    // set the binding index (defined in the shader)
-    infoUniformBinding.binding = 0;
-    // this describes a uniform buffer
-    infoUniformBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    // it contains a single uniform buffer object
-    infoUniformBinding.descriptorCount = 1;
-    // the descriptor set is meant for the vertex program
-    infoUniformBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-    // describe the descriptor set binding for the texture sampler
-    VkDescriptorSetLayoutBinding infoSamplerBinding = {};
-    // set the binding index (defined in the shader)
-    infoSamplerBinding.binding = 1;
-    // this describes a uniform buffer
-    infoSamplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    // it contains a single uniform buffer object
-    infoSamplerBinding.descriptorCount = 1;
-    // the descriptor set is meant for the vertex program
-    infoSamplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    // no immutable samplers
-    infoSamplerBinding.pImmutableSamplers = nullptr;
+    // the bindless shader is only there if it was compiled, each texture owner gets a set of its own without it
+    if (bBindlessTextures && !pkgAssets.HasAsset(STR_BINDLESS_FRAGMENT_SHADER_ASSET)) {
+        std::cerr << "Bindless textures disabled, " << STR_BINDLESS_FRAGMENT_SHADER_ASSET << " is missing" << std::endl;
+        bBindlessTextures = false;
+    }
+    // the ubershader reads every descriptor a material has, the specialized shaders read some of them
+    const std::vector<ShaderInterface> aifcShaders = { ReflectShader(STR_VERTEX_SHADER_ASSET), ReflectShader(GetFragmentShaderAsset()) };
+    for (const ShaderInterface &ifcShader : aifcShaders) {
+        for (const ShaderBinding &bndResource : ifcShader.abndBindings) {
+            if (bndResource.iSet != 0) {
+                throw std::runtime_error("Material shaders read descriptors from a set other than 0");
+            }
+        }
+    }
+    abndMaterialBindings = ShaderReflection::GetSetBindings(aifcShaders, 0);
+    if (!bBindlessTextures) {
+        vkhDescriptorSetLayout = RequestDescriptorSetLayout(abndMaterialBindings);
+        return;
+    }
+
+#ifdef VK_EXT_descriptor_indexing
+    // bound bindless, the unsized texture array holds every material's texture; textures that aren't loaded yet are
+    // left unbound, and the textures and the tile cache, which is read with the same sampler, are replaced while the
+    // set is bound, so the commands aren't recorded again when they change
+    std::vector<VkFlags> aflgBindingFlags(abndMaterialBindings.size(), 0);
+    bool bTextureArray = false;
+    for (uint32_t iBinding = 0; iBinding < abndMaterialBindings.size(); iBinding++) {
+        VkDescriptorSetLayoutBinding &bndBinding = abndMaterialBindings[iBinding];
+        if (bndBinding.binding == 1 && bndBinding.descriptorCount == 0) {
+            bndBinding.descriptorCount = CT_BINDLESS_TEXTURES;
+            aflgBindingFlags[iBinding] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+            bTextureArray = true;
+        } else if (bndBinding.binding == 3) {
+            aflgBindingFlags[iBinding] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+        }
+    }
+    if (!bTextureArray) {
+        throw std::runtime_error("The bindless fragment shader doesn't read the texture array");
+    }
+    vkhDescriptorSetLayout = RequestDescriptorSetLayout(abndMaterialBindings, aflgBindingFlags);
+#endif
+}
+
 
+// Get the descriptor set layout with the bindings.
+VkDescriptorSetLayout GfxAPIVulkan::RequestDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &abndBindings, const std::vector<VkFlags> &aflgBindingFlags) {
+    // the binding flags are mixed into the hash of the bindings the same way, as FNV-1a
+    uint64_t idHash = ShaderReflection::HashSetBindings(abndBindings);
+    for (VkFlags flgBinding : aflgBindingFlags) {
+        idHash = (idHash ^ flgBinding) * 1099511628211ULL;
+    }
+    auto itLayout = mapDescriptorSetLayouts.find(idHash);
+    if (itLayout != mapDescriptorSetLayouts.end()) {
+        return itLayout->second;
+    }
 
     // describe the descriptor set layout
     VkDescriptorSetLayoutCreateInfo infoDescriptorSetLayout = {};
     infoDescriptorSetLayout.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-
-    // create an array of layout bindings
-    std::array<VkDescriptorSetLayoutBinding, 2> ainfoBindings = { infoUniformBinding, infoSamplerBinding };
-    // set the binding description
-    infoDescriptorSetLayout.bindingCount = static_cast<uint32_t>(ainfoBindings.size());
-    infoDescriptorSetLayout.pBindings = ainfoBindings.data();
+    infoDescriptorSetLayout.bindingCount = static_cast<uint32_t>(abndBindings.size());
+    infoDescriptorSetLayout.pBindings = abndBindings.data();
+    // bindings updated after they are bound need a pool that allows it too
+#ifdef VK_EXT_descriptor_indexing
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT infoBindingFlags = {};
+    infoBindingFlags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    infoBindingFlags.bindingCount = static_cast<uint32_t>(aflgBindingFlags.size());
+    infoBindingFlags.pBindingFlags = aflgBindingFlags.data();
+    if (!aflgBindingFlags.empty()) {
+        infoDescriptorSetLayout.pNext = &infoBindingFlags;
+    }
+    if (std::any_of(aflgBindingFlags.begin(), aflgBindingFlags.end(), [](VkFlags flgBinding) { return (flgBinding & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0; })) {
+        infoDescriptorSetLayout.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    }
+#endif
 
     // create the layout
-    if (vkCreateDescriptorSetLayout(vkhLogicalDevice, &infoDescriptorSetLayout, nullptr, &vkhDescriptorSetLayout) != VK_SUCCESS) {
+    VkDescriptorSetLayout vkhSetLayout;
+    if (vkCreateDescriptorSetLayout(vkhLogicalDevice, &infoDescriptorSetLayout, nullptr, &vkhSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("Unable to create the descriptor set layout");
     }
+    mapDescriptorSetLayouts[idHash] = vkhSetLayout;
+    return vkhSetLayout;
 }
 
-// Create the graphics pipeline.
-void GfxAPIVulkan::CreateGraphicsPipeline() {
-
-    // load the vertex module
-    VkShaderModule modVert = CreateShaderModule("../vert.spv");
-    // describe the vertex shader stage
-    VkPipelineShaderStageCreateInfo infoShaderStageVert = {};
-    infoShaderStageVert.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    // this is the vertex shader stage
-    infoShaderStageVert.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    // bind the vertex module
-    infoShaderStageVert.pName = "main";
-    infoShaderStageVert.module = modVert;
-
-    // load the fragment module
-    VkShaderModule modFrag = CreateShaderModule("../frag.spv");
-    // describe the fragment shader stage
-    VkPipelineShaderStageCreateInfo infoShaderStageFrag = {};
-    infoShaderStageFrag.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    // this is the fragment shader stage
-    infoShaderStageFrag.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    // bind the vertex module
-    infoShaderStageFrag.pName = "main";
-    infoShaderStageFrag.module = modFrag;
-
-    // create the array of shader stages to bind to the pipeline
-    VkPipelineShaderStageCreateInfo aciShaderStages[] = { infoShaderStageVert, infoShaderStageFrag };
 
-    // describe the vertex program inputs
-	VkPipelineVertexInputStateCreateInfo infoVertexInput = {};
-	infoVertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	// bind the binding descriptions
-    auto descBinding = Vertex::GetBindingDescription();
-	infoVertexInput.vertexBindingDescriptionCount = 1;
-	infoVertexInput.pVertexBindingDescriptions = &descBinding;
-	// bind the vertex attributes
-    auto adescAttributes = Vertex::GetAttributeDescriptions();
-	infoVertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(adescAttributes.size());
-	infoVertexInput.pVertexAttributeDescriptions = adescAttributes.data();
+// Get the pipeline layout with the set layouts and push constant ranges.
+VkPipelineLayout GfxAPIVulkan::RequestPipelineLayout(const std::vector<VkDescriptorSetLayout> &avkhSetLayouts, const std::vector<VkPushConstantRange> &arngPushConstants) {
+    const uint64_t idHash = ShaderReflection::HashPipelineLayout(avkhSetLayouts, arngPushConstants);
+    auto itLayout = mapPipelineLayouts.find(idHash);
+    if (itLayout != mapPipelineLayouts.end()) {
+        return itLayout->second;
+    }
 
-	// describe the topology and if primitive restart will be used
-    VkPipelineInputAssemblyStateCreateInfo infoInputAssembly = {};
-    infoInputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	// triangle list will be used
-	infoInputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	// no primitive restart (if this is set to TRUE, index of 0xFFFF/0xFFFFFFFF means that the next index starts a new primitive)
-	infoInputAssembly.primitiveRestartEnable = VK_FALSE;
-    infoInputAssembly.flags = 0;
+	// describe the pipeline layout
+	VkPipelineLayoutCreateInfo infoPipelineLayout = {};
+	infoPipelineLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    // bind the descriptor set layouts
+	infoPipelineLayout.setLayoutCount = static_cast<uint32_t>(avkhSetLayouts.size());
+	infoPipelineLayout.pSetLayouts = avkhSetLayouts.data();
+    // bind the push constant ranges
+	infoPipelineLayout.pushConstantRangeCount = static_cast<uint32_t>(arngPushConstants.size());
+	infoPipelineLayout.pPushConstantRanges = arngPushConstants.data();
 
-	// describe the rendering viewport
+	// create the pipeline layout
+    VkPipelineLayout vkhLayout;
+	if (vkCreatePipelineLayout(vkhLogicalDevice, &infoPipelineLayout, nullptr, &vkhLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the pipeline layout!");
+	}
+    mapPipelineLayouts[idHash] = vkhLayout;
+    return vkhLayout;
+}
+
+
+// Destroy the cached descriptor set and pipeline layouts.
+void GfxAPIVulkan::DestroyLayouts() {
+    for (const auto &itLayout : mapPipelineLayouts) {
+        vkDestroyPipelineLayout(vkhLogicalDevice, itLayout.second, nullptr);
+    }
+    mapPipelineLayouts.clear();
+    vkhPipelineLayout = VK_NULL_HANDLE;
+    for (const auto &itLayout : mapDescriptorSetLayouts) {
+        vkDestroyDescriptorSetLayout(vkhLogicalDevice, itLayout.second, nullptr);
+    }
+    mapDescriptorSetLayouts.clear();
+    vkhDescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+// Create the graphics pipeline layout and the pipelines of all known states.
+void GfxAPIVulkan::CreateGraphicsPipelines() {
+    // the layout is reflected from the default shaders, which read everything a material has; the material descriptor
+    // sets were allocated with the set layout, so shaders that change it need a restart; the shaders are checked against
+    // the layout's bindings, as those give the bindless texture array its size
+    const std::vector<ShaderInterface> aifcShaders = { ReflectShader(STR_VERTEX_SHADER_ASSET), ReflectShader(GetFragmentShaderAsset()) };
+    const std::vector<VkDescriptorSetLayoutBinding> abndBindings = ShaderReflection::GetSetBindings(aifcShaders, 0);
+    if (abndBindings.size() != abndMaterialBindings.size() || !std::all_of(aifcShaders.begin(), aifcShaders.end(), [this](const ShaderInterface &ifcShader) {
+            return ShaderReflection::IsCompatible(ifcShader, 0, abndMaterialBindings);
+        })) {
+        throw std::runtime_error("Shaders read different material descriptors, restart to use them");
+    }
+    // the material constants are pushed for each draw
+    const std::vector<VkPushConstantRange> arngPushConstants = ShaderReflection::GetPushConstantRanges(aifcShaders);
+    if (arngPushConstants.size() != 1 || arngPushConstants[0].size < sizeof(MaterialPushConstants)) {
+        throw std::runtime_error("Shaders don't read the material push constants");
+    }
+    vkhPipelineLayout = RequestPipelineLayout({ vkhDescriptorSetLayout }, arngPushConstants);
+    rngMaterialPushConstants = arngPushConstants[0];
+
+    // all states are compiled at once on the workers, which share the internally synchronized pipeline cache; with
+    // pipeline libraries, the parts all states share are compiled once and each pipeline is only linked from them, the
+    // libraries are submitted first so they are being compiled by the time the links wait for them
+    const uint32_t ctPipelines = static_cast<uint32_t>(apsPipelineStates.size());
+    std::vector<std::vector<std::shared_ptr<PipelineLibrary>>> aaplLibraries(ctPipelines);
+    if (bPipelineLibraries) {
+        for (uint32_t iPipeline = 0; iPipeline < ctPipelines; iPipeline++) {
+            aaplLibraries[iPipeline] = RequestPipelineLibraries(apsPipelineStates[iPipeline]);
+        }
+    }
+    std::vector<VkPipeline> avkhNewPipelines(ctPipelines, VK_NULL_HANDLE);
+    std::vector<std::string> astrErrors(ctPipelines);
+    ThreadPool::Get().ParallelFor(ctPipelines, [this, &aaplLibraries, &avkhNewPipelines, &astrErrors](uint32_t iPipeline) {
+        try {
+            if (bPipelineLibraries) {
+                avkhNewPipelines[iPipeline] = LinkGraphicsPipeline(aaplLibraries[iPipeline], false);
+            } else {
+                avkhNewPipelines[iPipeline] = CreateGraphicsPipeline(apsPipelineStates[iPipeline]);
+            }
+        }
+        catch (const std::runtime_error &e) {
+            astrErrors[iPipeline] = e.what();
+        }
+    });
+
+    // pipelines that failed before may fail again, their materials keep the ubershader; any other failed pipeline
+    // leaves the previous ones, e.g. when a reloaded shader doesn't compile
+    for (uint32_t iPipeline = 0; iPipeline < ctPipelines; iPipeline++) {
+        if (avkhNewPipelines[iPipeline] == VK_NULL_HANDLE && !abFailedPipelines[iPipeline]) {
+            for (VkPipeline vkhNewPipeline : avkhNewPipelines) {
+                vkDestroyPipeline(vkhLogicalDevice, vkhNewPipeline, nullptr);
+            }
+            DestroyPipelineLibraries();
+            throw std::runtime_error(astrErrors[iPipeline]);
+        }
+    }
+    for (uint32_t iPipeline = 0; iPipeline < ctPipelines; iPipeline++) {
+        abFailedPipelines[iPipeline] = avkhNewPipelines[iPipeline] == VK_NULL_HANDLE;
+    }
+    avkhPipelines = avkhNewPipelines;
+
+    // the fast linked pipelines are optimized in the background, like the ones linked when they are requested
+    if (bPipelineLibraries && Options::Get().ShouldOptimizeLinkedPipelines()) {
+        for (uint32_t iPipeline = 0; iPipeline < ctPipelines; iPipeline++) {
+            if (avkhPipelines[iPipeline] != VK_NULL_HANDLE) {
+                RequestPipelineLink(iPipeline, aaplLibraries[iPipeline], true);
+            }
+        }
+    }
+}
+
+
+// Destroy the graphics pipelines.
+void GfxAPIVulkan::DestroyGraphicsPipelines() {
+    for (VkPipeline vkhOldPipeline : avkhPipelines) {
+        vkDestroyPipeline(vkhLogicalDevice, vkhOldPipeline, nullptr);
+    }
+    avkhPipelines.clear();
+    DestroyPipelineLibraries();
+}
+
+
+// Destroy the pipeline libraries.
+void GfxAPIVulkan::DestroyPipelineLibraries() {
+    for (auto &mapLibraries : amapPipelineLibraries) {
+        for (auto &itLibrary : mapLibraries) {
+            // a library that failed stays null
+            itLibrary.second->futCompiled.wait();
+            vkDestroyPipeline(vkhLogicalDevice, *itLibrary.second->pvkhPipeline, nullptr);
+        }
+        mapLibraries.clear();
+    }
+}
+
+
+// Get the libraries of the parts of a pipeline state, compiling those that are new on workers.
+std::vector<std::shared_ptr<GfxAPIVulkan::PipelineLibrary>> GfxAPIVulkan::RequestPipelineLibraries(const PipelineState &psState) {
+    std::vector<std::shared_ptr<PipelineLibrary>> aplLibraries;
+    for (uint32_t iPart = 0; iPart < CT_PIPELINE_LIBRARY_PARTS; iPart++) {
+        const PipelineLibraryPart idPart = static_cast<PipelineLibraryPart>(1 << iPart);
+        const PipelineState psPart = psState.GetPart(idPart);
+        std::shared_ptr<PipelineLibrary> &plLibrary = amapPipelineLibraries[iPart][psPart];
+        if (plLibrary == nullptr) {
+            // the job holds only the handle it writes, the library holds the job's future
+            plLibrary = std::make_shared<PipelineLibrary>();
+            plLibrary->pvkhPipeline = std::make_shared<VkPipeline>(VK_NULL_HANDLE);
+            std::shared_ptr<VkPipeline> pvkhPipeline = plLibrary->pvkhPipeline;
+            plLibrary->futCompiled = ThreadPool::Get().Submit([this, psPart, idPart, pvkhPipeline]() {
+                *pvkhPipeline = CreateGraphicsPipeline(psPart, idPart);
+            }).share();
+        }
+        aplLibraries.push_back(plLibrary);
+    }
+    return aplLibraries;
+}
+
+
+// Link a graphics pipeline from the libraries of its parts.
+VkPipeline GfxAPIVulkan::LinkGraphicsPipeline(const std::vector<std::shared_ptr<PipelineLibrary>> &aplLibraries, bool bOptimize) {
+    // the libraries are submitted before whatever links them, so they are already being compiled; all of them are
+    // waited for before a failed one rethrows
+    for (const std::shared_ptr<PipelineLibrary> &plLibrary : aplLibraries) {
+        plLibrary->futCompiled.wait();
+    }
+    std::vector<VkPipeline> avkhLibraries;
+    for (const std::shared_ptr<PipelineLibrary> &plLibrary : aplLibraries) {
+        plLibrary->futCompiled.get();
+        avkhLibraries.push_back(*plLibrary->pvkhPipeline);
+    }
+
+#ifdef VK_EXT_graphics_pipeline_library
+    // the pipeline is made of the libraries only
+    VkPipelineLibraryCreateInfoKHR infoLibraries = {};
+    infoLibraries.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    infoLibraries.libraryCount = static_cast<uint32_t>(avkhLibraries.size());
+    infoLibraries.pLibraries = avkhLibraries.data();
+
+    VkGraphicsPipelineCreateInfo infoGraphicsPipeline = {};
+    infoGraphicsPipeline.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    infoGraphicsPipeline.pNext = &infoLibraries;
+    // a fast link only puts the compiled parts together; with link time optimization the driver compiles the parts
+    // again as one, which takes about as long as creating the pipeline whole but draws faster
+    infoGraphicsPipeline.flags = bOptimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    infoGraphicsPipeline.layout = vkhPipelineLayout;
+    infoGraphicsPipeline.basePipelineHandle = VK_NULL_HANDLE;
+    infoGraphicsPipeline.basePipelineIndex = -1;
+
+    VkPipeline vkhNewPipeline;
+    if (vkCreateGraphicsPipelines(vkhLogicalDevice, vkhPipelineCache, 1, &infoGraphicsPipeline, nullptr, &vkhNewPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to link the graphics pipeline");
+    }
+    return vkhNewPipeline;
+#else
+    throw std::runtime_error("Pipeline libraries aren't supported by the Vulkan headers");
+#endif
+}
+
+
+// Link a pipeline from its libraries on a worker.
+void GfxAPIVulkan::RequestPipelineLink(uint32_t idPipeline, const std::vector<std::shared_ptr<PipelineLibrary>> &aplLibraries, bool bOptimize) {
+    PipelineCompile cmpCompile;
+    cmpCompile.idPipeline = idPipeline;
+    cmpCompile.pvkhPipeline = std::make_shared<VkPipeline>(VK_NULL_HANDLE);
+    cmpCompile.aplLibraries = aplLibraries;
+    cmpCompile.bOptimized = bOptimize;
+    std::shared_ptr<VkPipeline> pvkhPipeline = cmpCompile.pvkhPipeline;
+    cmpCompile.futCompiled = ThreadPool::Get().Submit([this, aplLibraries, bOptimize, pvkhPipeline]() {
+        *pvkhPipeline = LinkGraphicsPipeline(aplLibraries, bOptimize);
+    });
+    acmpPipelineCompiles.push_back(std::move(cmpCompile));
+}
+
+
+// Get the id of the graphics pipeline of a state, compiling it on a worker the first time.
+uint32_t GfxAPIVulkan::RequestGraphicsPipeline(const PipelineState &psState) {
+    auto itPipeline = mapPipelineIds.find(psState);
+    if (itPipeline != mapPipelineIds.end()) {
+        return itPipeline->second;
+    }
+
+    const uint32_t idPipeline = static_cast<uint32_t>(apsPipelineStates.size());
+    apsPipelineStates.push_back(psState);
+    avkhPipelines.push_back(VK_NULL_HANDLE);
+    abFailedPipelines.push_back(false);
+    mapPipelineIds[psState] = idPipeline;
+
+    // the pipeline cache is internally synchronized, so the workers share it; what else the compile reads only changes
+    // after the compiles in progress are waited for
+    if (!IsCompilingPipelines()) {
+        tmPipelineCompilesStarted = std::chrono::steady_clock::now();
+    }
+    // with pipeline libraries, only the parts no other state shares are compiled, and the pipeline is fast linked
+    if (bPipelineLibraries) {
+        RequestPipelineLink(idPipeline, RequestPipelineLibraries(psState), false);
+        return idPipeline;
+    }
+    PipelineCompile cmpCompile;
+    cmpCompile.idPipeline = idPipeline;
+    cmpCompile.pvkhPipeline = std::make_shared<VkPipeline>(VK_NULL_HANDLE);
+    cmpCompile.bOptimized = false;
+    std::shared_ptr<VkPipeline> pvkhPipeline = cmpCompile.pvkhPipeline;
+    cmpCompile.futCompiled = ThreadPool::Get().Submit([this, psState, pvkhPipeline]() {
+        *pvkhPipeline = CreateGraphicsPipeline(psState);
+    });
+    acmpPipelineCompiles.push_back(std::move(cmpCompile));
+    return idPipeline;
+}
+
+
+// Get the id of the graphics pipeline of a state, waiting for the pipeline.
+uint32_t GfxAPIVulkan::FindGraphicsPipeline(const PipelineState &psState) {
+    const uint32_t idPipeline = RequestGraphicsPipeline(psState);
+    for (PipelineCompile &cmpCompile : acmpPipelineCompiles) {
+        if (cmpCompile.idPipeline == idPipeline) {
+            cmpCompile.futCompiled.wait();
+        }
+    }
+    UpdateGraphicsPipelines();
+    if (avkhPipelines[idPipeline] == VK_NULL_HANDLE) {
+        throw std::runtime_error("Failed to create the graphics pipeline");
+    }
+    return idPipeline;
+}
+
+
+// Request the pipelines the model's materials are drawn with.
+void GfxAPIVulkan::RequestMaterialPipelines() {
+    // workers take the compiles in order, so the materials of the level of detail drawn first go first, then those of
+    // the other levels, then the materials no submesh uses
+    std::vector<uint32_t> aiLods = { selModelLod.GetLod() };
+    for (uint32_t iLod = 0; iLod < alodLods.size(); iLod++) {
+        if (iLod != selModelLod.GetLod()) {
+            aiLods.push_back(iLod);
+        }
+    }
+    std::vector<uint32_t> aiMaterials;
+    std::vector<bool> abListed(amatMaterials.size(), false);
+    for (uint32_t iLod : aiLods) {
+        const MeshLod &lodLevel = alodLods[iLod];
+        for (uint32_t iSubmesh = lodLevel.iFirstSubmesh; iSubmesh < lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes; iSubmesh++) {
+            const uint32_t idMaterial = asubSubmeshes[iSubmesh].idMaterial;
+            if (!abListed[idMaterial]) {
+                abListed[idMaterial] = true;
+                aiMaterials.push_back(idMaterial);
+            }
+        }
+    }
+    for (uint32_t iMaterial = 0; iMaterial < amatMaterials.size(); iMaterial++) {
+        if (!abListed[iMaterial]) {
+            aiMaterials.push_back(iMaterial);
+        }
+    }
+
+    // the ubershader pipelines go before all specialized ones, as they are what a material draws with until its
+    // specialized pipeline is ready
+    aidMaterialPipelines.resize(amatMaterials.size());
+    aidMaterialFallbackPipelines.resize(amatMaterials.size());
+    for (uint32_t iMaterial : aiMaterials) {
+        aidMaterialFallbackPipelines[iMaterial] = RequestGraphicsPipeline(GetUbershaderPipelineState(GetMaterialPipelineState(iMaterial)));
+    }
+    for (uint32_t iMaterial : aiMaterials) {
+        aidMaterialPipelines[iMaterial] = RequestGraphicsPipeline(GetMaterialPipelineState(iMaterial));
+    }
+}
+
+
+// Collect the pipelines compiled on workers.
+bool GfxAPIVulkan::UpdateGraphicsPipelines() {
+    bool bCollected = false;
+    bool bCompiled = false;
+    for (size_t iCompile = 0; iCompile < acmpPipelineCompiles.size(); ) {
+        PipelineCompile &cmpCompile = acmpPipelineCompiles[iCompile];
+        if (cmpCompile.futCompiled.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            iCompile++;
+            continue;
+        }
+        std::future<void> futCompiled = std::move(cmpCompile.futCompiled);
+        const uint32_t idPipeline = cmpCompile.idPipeline;
+        const std::shared_ptr<VkPipeline> pvkhPipeline = cmpCompile.pvkhPipeline;
+        const std::vector<std::shared_ptr<PipelineLibrary>> aplLibraries = std::move(cmpCompile.aplLibraries);
+        const bool bOptimized = cmpCompile.bOptimized;
+        acmpPipelineCompiles.erase(acmpPipelineCompiles.begin() + iCompile);
+        try {
+            futCompiled.get();
+        }
+        catch (const std::runtime_error &e) {
+            // a pipeline that fails, e.g. because its shader variant doesn't compile, stays null and its materials keep
+            // the ubershader; it is tried again when the pipelines are created again; a failed optimization just
+            // leaves the fast linked pipeline
+            if (bOptimized) {
+                std::cerr << "Failed to optimize the pipeline with " << apsPipelineStates[idPipeline].strFragmentShader << ", keeping the fast linked one: " << e.what() << std::endl;
+            } else {
+                std::cerr << "Failed to compile the pipeline with " << apsPipelineStates[idPipeline].strFragmentShader << ", using the ubershader: " << e.what() << std::endl;
+                abFailedPipelines[idPipeline] = true;
+            }
+            continue;
+        }
+
+        // the optimized pipeline replaces the fast linked one, which the previous frame was the last to use; fast
+        // linked pipelines are optimized next, behind the compiles already queued
+        if (bOptimized) {
+            vkDestroyPipeline(vkhLogicalDevice, avkhPipelines[idPipeline], nullptr);
+        } else {
+            bCompiled = true;
+            if (!aplLibraries.empty() && Options::Get().ShouldOptimizeLinkedPipelines()) {
+                RequestPipelineLink(idPipeline, aplLibraries, true);
+            }
+        }
+        avkhPipelines[idPipeline] = *pvkhPipeline;
+        bCollected = true;
+    }
+
+    // how long the workers took for a whole batch shows how compiling scales with cores and what the cache saves
+    if (bCompiled && !IsCompilingPipelines()) {
+        const double tmCompiles = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tmPipelineCompilesStarted).count();
+        std::cout << (bPipelineLibraries ? "Linked" : "Compiled") << " graphics pipelines on " << ThreadPool::Get().GetWorkerCount() << " workers in "
+            << tmCompiles << " ms with a " << (bPipelineCacheLoaded ? "warm" : "cold") << " pipeline cache" << std::endl;
+    }
+    return bCollected;
+}
+
+
+// Wait for the pipelines being compiled on workers and collect them.
+bool GfxAPIVulkan::WaitForGraphicsPipelines() {
+    // collecting fast linked pipelines requests their optimization, which is waited for as well
+    bool bCollected = false;
+    while (!acmpPipelineCompiles.empty()) {
+        for (PipelineCompile &cmpCompile : acmpPipelineCompiles) {
+            cmpCompile.futCompiled.wait();
+        }
+        bCollected = UpdateGraphicsPipelines() || bCollected;
+    }
+    return bCollected;
+}
+
+
+// Are pipelines that materials are waiting for still being compiled? Optimizations don't count, the materials already
+// draw with the fast linked pipelines.
+bool GfxAPIVulkan::IsCompilingPipelines() const {
+    for (const PipelineCompile &cmpCompile : acmpPipelineCompiles) {
+        if (!cmpCompile.bOptimized) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Get the pipeline a material is drawn with.
+VkPipeline GfxAPIVulkan::GetMaterialPipeline(uint32_t iMaterial) const {
+    // the specialized pipeline if it is ready, else the ubershader with the material's state, which is compiled
+    // first; the default pipeline only stands in while that one is compiling too
+    if (avkhPipelines[aidMaterialPipelines[iMaterial]] != VK_NULL_HANDLE) {
+        return avkhPipelines[aidMaterialPipelines[iMaterial]];
+    }
+    if (avkhPipelines[aidMaterialFallbackPipelines[iMaterial]] != VK_NULL_HANDLE) {
+        return avkhPipelines[aidMaterialFallbackPipelines[iMaterial]];
+    }
+    return avkhPipelines[idDefaultPipeline];
+}
+
+
+// Get the fragment shader the materials are drawn with.
+const char *GfxAPIVulkan::GetFragmentShaderAsset() const {
+    return bBindlessTextures ? STR_BINDLESS_FRAGMENT_SHADER_ASSET : STR_FRAGMENT_SHADER_ASSET;
+}
+
+
+// Get the pipeline state of opaque meshes.
+PipelineState GfxAPIVulkan::GetDefaultPipelineState() {
+    PipelineState psState;
+    psState.strVertexShader = STR_VERTEX_SHADER_ASSET;
+    psState.strFragmentShader = GetFragmentShaderAsset();
+    // the ubershader variant, without vertex colors or alpha test
+    psState.idTexturing = MATERIAL_TEXTURING_ANY;
+    psState.bVertexColor = VK_FALSE;
+    psState.bAlphaTest = VK_FALSE;
+    // indexed triangle lists of mesh vertices
+    psState.idVertexLayout = VERTEX_LAYOUT_MESH;
+    psState.topTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    // filled polygons, with back faces culled; front faces use counter-clockwise winding
+    psState.pmPolygonMode = VK_POLYGON_MODE_FILL;
+    psState.flgCullMode = VK_CULL_MODE_BACK_BIT;
+    psState.ffFrontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    // depth tested and written, fragments closer than the depth buffer pass
+    psState.bDepthTest = VK_TRUE;
+    psState.bDepthWrite = VK_TRUE;
+    psState.opDepthCompare = VK_COMPARE_OP_LESS;
+    // no blending, the fragment color overwrites the framebuffer
+    psState.bBlend = VK_FALSE;
+    psState.bfSourceColor = VK_BLEND_FACTOR_ONE;
+    psState.bfDestinationColor = VK_BLEND_FACTOR_ZERO;
+    psState.opColorBlend = VK_BLEND_OP_ADD;
+    psState.bfSourceAlpha = VK_BLEND_FACTOR_ONE;
+    psState.bfDestinationAlpha = VK_BLEND_FACTOR_ZERO;
+    psState.opAlphaBlend = VK_BLEND_OP_ADD;
+    // the attachments of the render pass
+    psState.fmtColor = fmtSurfaceFormat.format;
+    psState.fmtDepth = FindDepthFormat();
+    psState.ctSamples = VK_SAMPLE_COUNT_1_BIT;
+    return psState;
+}
+
+
+// Get the pipeline state a material is drawn with.
+PipelineState GfxAPIVulkan::GetMaterialPipelineState(uint32_t iMaterial) {
+    // mesh files don't describe blending, culling, vertex colors or alpha test yet, so every material is drawn as an
+    // opaque mesh; the fragment shader is specialized for the way the material's texture is sampled, which changes
+    // once its texture is imported
+    PipelineState psState = GetDefaultPipelineState();
+    psState.idTexturing = aresMaterials[iMaterial].vtfTexture != nullptr ? MATERIAL_TEXTURING_VIRTUAL : MATERIAL_TEXTURING_ARRAY;
+    return psState;
+}
+
+
+// Get the ubershader variant of a pipeline state.
+PipelineState GfxAPIVulkan::GetUbershaderPipelineState(const PipelineState &psState) {
+    // only the texturing is picked per draw, the other features stay specialized
+    PipelineState psUbershader = psState;
+    psUbershader.idTexturing = MATERIAL_TEXTURING_ANY;
+    return psUbershader;
+}
+
+
+// Create the graphics pipeline of a pipeline state, or the library of some of its parts.
+VkPipeline GfxAPIVulkan::CreateGraphicsPipeline(const PipelineState &psState, uint32_t flgParts) {
+    // the shaders are checked against the materials' layout before anything is created, a shader that reads other
+    // descriptors fails its pipeline, so its materials keep the ubershader; the vertex input is described from the
+    // vertex shader's inputs
+    ShaderInterface ifcVertexShader;
+    if (flgParts & (PIPELINE_PART_VERTEX_INPUT | PIPELINE_PART_PRE_RASTERIZATION)) {
+        ifcVertexShader = ReflectShader(psState.strVertexShader);
+        CheckMaterialShader(psState.strVertexShader, ifcVertexShader);
+    }
+    if (flgParts & PIPELINE_PART_FRAGMENT_SHADER) {
+        CheckMaterialShader(psState.strFragmentShader, ReflectShader(psState.strFragmentShader));
+    }
+    std::vector<VkVertexInputAttributeDescription> adescAttributes;
+    if (flgParts & PIPELINE_PART_VERTEX_INPUT) {
+        adescAttributes = GetVertexAttributeDescriptions(psState.idVertexLayout, ifcVertexShader);
+    }
+
+    // the array of shader stages to bind to the pipeline, a library has only the shader of its part
+    std::vector<VkPipelineShaderStageCreateInfo> aciShaderStages;
+
+    // load the vertex module
+    VkShaderModule modVert = VK_NULL_HANDLE;
+    if (flgParts & PIPELINE_PART_PRE_RASTERIZATION) {
+        modVert = CreateShaderModule(psState.strVertexShader);
+        // describe the vertex shader stage
+        VkPipelineShaderStageCreateInfo infoShaderStageVert = {};
+        infoShaderStageVert.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        // this is the vertex shader stage
+        infoShaderStageVert.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        // bind the vertex module
+        infoShaderStageVert.pName = "main";
+        infoShaderStageVert.module = modVert;
+        aciShaderStages.push_back(infoShaderStageVert);
+    }
+
+    // load the fragment module, and specialize it for the state's features; the constants outlive the stage info
+    VkShaderModule modFrag = VK_NULL_HANDLE;
+    static const std::array<VkSpecializationMapEntry, 3> aentSpecialization = { {
+        // constant id, offset and size of each constant
+        { 0, offsetof(FragmentSpecialization, idTexturing), sizeof(uint32_t) },
+        { 1, offsetof(FragmentSpecialization, bVertexColor), sizeof(VkBool32) },
+        { 2, offsetof(FragmentSpecialization, bAlphaTest), sizeof(VkBool32) },
+    } };
+    const FragmentSpecialization specFragment = { static_cast<uint32_t>(psState.idTexturing), psState.bVertexColor, psState.bAlphaTest };
+    VkSpecializationInfo infoSpecialization = {};
+    infoSpecialization.mapEntryCount = static_cast<uint32_t>(aentSpecialization.size());
+    infoSpecialization.pMapEntries = aentSpecialization.data();
+    infoSpecialization.dataSize = sizeof(specFragment);
+    infoSpecialization.pData = &specFragment;
+    if (flgParts & PIPELINE_PART_FRAGMENT_SHADER) {
+        try {
+            modFrag = CreateShaderModule(psState.strFragmentShader);
+        }
+        catch (const std::runtime_error &) {
+            vkDestroyShaderModule(vkhLogicalDevice, modVert, nullptr);
+            throw;
+        }
+        // describe the fragment shader stage
+        VkPipelineShaderStageCreateInfo infoShaderStageFrag = {};
+        infoShaderStageFrag.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        // this is the fragment shader stage
+        infoShaderStageFrag.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        // bind the vertex module
+        infoShaderStageFrag.pName = "main";
+        infoShaderStageFrag.module = modFrag;
+        infoShaderStageFrag.pSpecializationInfo = &infoSpecialization;
+        aciShaderStages.push_back(infoShaderStageFrag);
+    }
+
+    // describe the vertex program inputs
+	VkPipelineVertexInputStateCreateInfo infoVertexInput = {};
+	infoVertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	// bind the binding descriptions
+    auto descBinding = GetVertexBindingDescription();
+	infoVertexInput.vertexBindingDescriptionCount = 1;
+	infoVertexInput.pVertexBindingDescriptions = &descBinding;
+	// bind the vertex attributes
+	infoVertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(adescAttributes.size());
+	infoVertexInput.pVertexAttributeDescriptions = adescAttributes.data();
+
+	// describe the topology and if primitive restart will be used
+    VkPipelineInputAssemblyStateCreateInfo infoInputAssembly = {};
+    infoInputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	// set the topology of the primitives
+	infoInputAssembly.topology = psState.topTopology;
+	// no primitive restart (if this is set to TRUE, index of 0xFFFF/0xFFFFFFFF means that the next index starts a new primitive)
+	infoInputAssembly.primitiveRestartEnable = VK_FALSE;
+    infoInputAssembly.flags = 0;
+
+	// describe the rendering viewport
 	VkViewport vpViewport = {};
 	// viweport coves the full screen
 	vpViewport.x = 0.0f;
@@ -1089,14 +2353,13 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
 	infoRasterizationState.depthClampEnable = VK_FALSE;
 	// geometry should be rasterized (FALSE means no fragments will be produced)
 	infoRasterizationState.rasterizerDiscardEnable = VK_FALSE;
-	// we want polygons to be filled with fragments (as opposed to just points or lines)
-	infoRasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+	// fill polygons with fragments, or draw just their edges or points
+	infoRasterizationState.polygonMode = psState.pmPolygonMode;
 	// thickness of lines, in number of fragments
 	infoRasterizationState.lineWidth = 1.0f;
-	// enable back face culling
-	infoRasterizationState.cullMode = VK_CULL_MODE_BACK_BIT;
-	// forward facing faces use clockwise vetex winding
-	infoRasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	// set which faces are culled, and the vertex winding of front faces
+	infoRasterizationState.cullMode = psState.flgCullMode;
+	infoRasterizationState.frontFace = psState.ffFrontFace;
 	// no depth bias
 	infoRasterizationState.depthBiasEnable = VK_FALSE;
 	infoRasterizationState.depthBiasConstantFactor = 0.0f;
@@ -1111,7 +2374,7 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
 	infoMultisampling.sampleShadingEnable = VK_FALSE;
 	// set the rest of multisampling values to the simplest
 	// NOTE: they are not described in the tutorial, so no comments for them at this point
-	infoMultisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	infoMultisampling.rasterizationSamples = psState.ctSamples;
 	infoMultisampling.minSampleShading = 1.0f;
 	infoMultisampling.pSampleMask = nullptr;
 	infoMultisampling.alphaToCoverageEnable = VK_FALSE;
@@ -1122,15 +2385,15 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
 	VkPipelineColorBlendAttachmentState infoColorBlendAttachment = {};
 	// fragments wi write RGBA channels
 	infoColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	// blending is disabled, fragment color will overwrite the framebuffer value
-	infoColorBlendAttachment.blendEnable = VK_FALSE;
-	// setting the default color blend params
-	infoColorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	infoColorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	infoColorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	infoColorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	infoColorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	infoColorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	// without blending, fragment color will overwrite the framebuffer value
+	infoColorBlendAttachment.blendEnable = psState.bBlend;
+	// set the color blend params
+	infoColorBlendAttachment.srcColorBlendFactor = psState.bfSourceColor;
+	infoColorBlendAttachment.dstColorBlendFactor = psState.bfDestinationColor;
+	infoColorBlendAttachment.colorBlendOp = psState.opColorBlend;
+	infoColorBlendAttachment.srcAlphaBlendFactor = psState.bfSourceAlpha;
+	infoColorBlendAttachment.dstAlphaBlendFactor = psState.bfDestinationAlpha;
+	infoColorBlendAttachment.alphaBlendOp = psState.opAlphaBlend;
 
 	// describe the color blending state of the pipeline (will include the reference to the blend state attachment)
 	VkPipelineColorBlendStateCreateInfo infoColorBlendState = {};
@@ -1149,29 +2412,14 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
 	infoColorBlendState.blendConstants[3] = 0.0f;
 
 
-	// describe the graphics pipeline layout
-	VkPipelineLayoutCreateInfo infoPipelineLayout = {};
-	infoPipelineLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    // bind the descriptor set layout
-	infoPipelineLayout.setLayoutCount = 1;
-	infoPipelineLayout.pSetLayouts = &vkhDescriptorSetLayout;
-    // not using push constants at the moment
-	infoPipelineLayout.pushConstantRangeCount = 0;
-	infoPipelineLayout.pPushConstantRanges = 0;
-
-	// create the pipeline layout
-	if (vkCreatePipelineLayout(vkhLogicalDevice, &infoPipelineLayout, nullptr, &vkhPipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create the pipeline layout!");
-	}
-
     // describe the depth and stencil state
     VkPipelineDepthStencilStateCreateInfo infoPipelineDepthStencilState = {};
     infoPipelineDepthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    // enable depth testing and writing to depth
-    infoPipelineDepthStencilState.depthTestEnable = VK_TRUE;
-    infoPipelineDepthStencilState.depthWriteEnable = VK_TRUE;
-    // depth test passes (fragment can be written) if its value is lesser than one in the depth buffer
-    infoPipelineDepthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
+    // set up depth testing and writing to depth
+    infoPipelineDepthStencilState.depthTestEnable = psState.bDepthTest;
+    infoPipelineDepthStencilState.depthWriteEnable = psState.bDepthWrite;
+    // depth test passes (fragment can be written) if its value compares with the one in the depth buffer
+    infoPipelineDepthStencilState.depthCompareOp = psState.opDepthCompare;
     // not using the depth range test
     infoPipelineDepthStencilState.depthBoundsTestEnable = VK_FALSE;
     infoPipelineDepthStencilState.minDepthBounds = 0.0f;
@@ -1185,8 +2433,8 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
     VkGraphicsPipelineCreateInfo infoGraphicsPipeline = {};
     infoGraphicsPipeline.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     // bind the shader stages
-    infoGraphicsPipeline.stageCount = 2;
-    infoGraphicsPipeline.pStages = aciShaderStages;
+    infoGraphicsPipeline.stageCount = static_cast<uint32_t>(aciShaderStages.size());
+    infoGraphicsPipeline.pStages = aciShaderStages.data();
     // bind the rest of prepared configurations
     infoGraphicsPipeline.pVertexInputState = &infoVertexInput;
     infoGraphicsPipeline.pInputAssemblyState = &infoInputAssembly;
@@ -1198,21 +2446,90 @@ void GfxAPIVulkan::CreateGraphicsPipeline() {
     infoGraphicsPipeline.pDynamicState = nullptr;
     // set the pipeline layout
     infoGraphicsPipeline.layout = vkhPipelineLayout;
-    // set up the render pass
+    // set up the render pass, any pass with the state's attachments would do; with dynamic rendering there is none
+    // and only the formats of the attachments are given
     infoGraphicsPipeline.renderPass = vkhRenderPass;
     infoGraphicsPipeline.subpass = 0;
+#ifdef VK_KHR_dynamic_rendering
+    VkPipelineRenderingCreateInfoKHR infoRendering = {};
+    infoRendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    infoRendering.colorAttachmentCount = 1;
+    infoRendering.pColorAttachmentFormats = &psState.fmtColor;
+    infoRendering.depthAttachmentFormat = psState.fmtDepth;
+    infoRendering.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    if (bDynamicRendering) {
+        infoGraphicsPipeline.pNext = &infoRendering;
+    }
+#endif
     // this pipeline doesn't derive from another pipeline (could be done as an optimization)
     infoGraphicsPipeline.basePipelineHandle = VK_NULL_HANDLE;
     infoGraphicsPipeline.basePipelineIndex = -1;
 
-    // create the graphics pipeline
-    if (vkCreateGraphicsPipelines(vkhLogicalDevice, VK_NULL_HANDLE, 1, &infoGraphicsPipeline, nullptr, &vkhPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create the graphics pipeline");
+#ifdef VK_EXT_graphics_pipeline_library
+    // a library is created with the state of its parts, the state of the others is ignored; it keeps what link time
+    // optimization needs, so the pipelines linked from it can be optimized later
+    VkGraphicsPipelineLibraryCreateInfoEXT infoPipelineLibrary = {};
+    infoPipelineLibrary.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    infoPipelineLibrary.flags = flgParts;
+    if (flgParts != PIPELINE_PARTS_ALL) {
+        infoPipelineLibrary.pNext = infoGraphicsPipeline.pNext;
+        infoGraphicsPipeline.pNext = &infoPipelineLibrary;
+        infoGraphicsPipeline.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
     }
+#endif
+
+    // create the graphics pipeline
+    VkPipeline vkhNewPipeline;
+    const VkResult statusResult = vkCreateGraphicsPipelines(vkhLogicalDevice, vkhPipelineCache, 1, &infoGraphicsPipeline, nullptr, &vkhNewPipeline);
 
     // destroy shader modules - they are a part of the graphics pipeline
     vkDestroyShaderModule(vkhLogicalDevice, modFrag, nullptr);
     vkDestroyShaderModule(vkhLogicalDevice, modVert, nullptr);
+
+    if (statusResult != VK_SUCCESS) {
+        throw std::runtime_error(flgParts != PIPELINE_PARTS_ALL ? "Failed to create the graphics pipeline library" : "Failed to create the graphics pipeline");
+    }
+    return vkhNewPipeline;
+}
+
+
+// Describe the vertex attributes a vertex shader reads from the vertex layout.
+std::vector<VkVertexInputAttributeDescription> GfxAPIVulkan::GetVertexAttributeDescriptions(VertexLayout idVertexLayout, const ShaderInterface &ifcVertexShader) {
+    // meshes are the only vertices so far, their attributes are at the locations the shaders read them from
+    if (idVertexLayout != VERTEX_LAYOUT_MESH) {
+        throw std::runtime_error("Unknown vertex layout");
+    }
+    static const VkVertexInputAttributeDescription adescMeshAttributes[] = {
+        // location, binding, format and offset of the position, color and texture coordinates
+        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, vecPosition) },
+        { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, colColor) },
+        { 2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, vecTexCoords) },
+    };
+
+    // the shader reads only the attributes it declares, each must be in the layout in the format it is declared with
+    std::vector<VkVertexInputAttributeDescription> adescAttributes;
+    for (const ShaderVertexInput &inInput : ifcVertexShader.ainVertexInputs) {
+        auto itAttribute = std::find_if(std::begin(adescMeshAttributes), std::end(adescMeshAttributes), [&inInput](const VkVertexInputAttributeDescription &descAttribute) {
+            return descAttribute.location == inInput.iLocation;
+        });
+        if (itAttribute == std::end(adescMeshAttributes) || itAttribute->format != inInput.fmtFormat) {
+            throw std::runtime_error("Vertex shader reads an input the vertex layout doesn't have, at location " + std::to_string(inInput.iLocation));
+        }
+        adescAttributes.push_back(*itAttribute);
+    }
+    return adescAttributes;
+}
+
+
+// Check that a shader works with the materials' layout.
+void GfxAPIVulkan::CheckMaterialShader(const std::string &strAssetName, const ShaderInterface &ifcShader) const {
+    if (!ShaderReflection::IsCompatible(ifcShader, 0, abndMaterialBindings)) {
+        throw std::runtime_error(strAssetName + " reads descriptors the materials don't have");
+    }
+    if (ifcShader.ctPushConstantBytes > 0
+        && ((rngMaterialPushConstants.stageFlags & ifcShader.flgStage) == 0 || ifcShader.ctPushConstantBytes > rngMaterialPushConstants.size)) {
+        throw std::runtime_error(strAssetName + " reads push constants the materials don't have");
+    }
 }
 
 
@@ -1257,6 +2574,7 @@ void GfxAPIVulkan::DestroyFramebuffers() {
     for (VkFramebuffer vkhFramebuffer : avkhFramebuffers) {
         vkDestroyFramebuffer(vkhLogicalDevice, vkhFramebuffer, nullptr);
     }
+    avkhFramebuffers.clear();
 }
 
 
@@ -1267,8 +2585,8 @@ void GfxAPIVulkan::CreateCommandPool() {
     infoCommandPool.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     // bind the graphics queue family to the command pool
     infoCommandPool.queueFamilyIndex = iGraphicsQueueFamily;
-    // clear all flags
-    infoCommandPool.flags = 0;
+    // command buffers are recorded again when the model's level of detail changes
+    infoCommandPool.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     // create the command pool
     if (vkCreateCommandPool(vkhLogicalDevice, &infoCommandPool, nullptr, &vkhCommandPool) != VK_SUCCESS) {
@@ -1278,8 +2596,8 @@ void GfxAPIVulkan::CreateCommandPool() {
 
 // Create the command buffers.
 void GfxAPIVulkan::CreateCommandBuffers() {
-    // one command buffer is needed per framebuffer
-    avkhCommandBuffers.resize(avkhFramebuffers.size());
+    // one command buffer is needed per swap chain image
+    avkhCommandBuffers.resize(avkhImageViews.size());
 
     // describe the allocation of command buffers - all will be allocated with one call
     VkCommandBufferAllocateInfo infoAllocateBuffers = {};
@@ -1313,7 +2631,7 @@ void GfxAPIVulkan::RecordCommandBuffers() {
     acolClearColors[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
     acolClearColors[1].depthStencil = { 1.0f, 0 };
 
-    // describe how the render pass will be used
+    // describe how the render pass will be used, when rendering with one
     VkRenderPassBeginInfo infoRenderPassBegin = {};
     infoRenderPassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     // bind the render pass definition
@@ -1334,26 +2652,92 @@ void GfxAPIVulkan::RecordCommandBuffers() {
         // bind the frame buffer to the render pass
         infoRenderPassBegin.framebuffer = avkhFramebuffers[iCommandBuffer];
 
-        // issue (record) the command to begin the render pass, with the command executed from the primary buffer
-        vkCmdBeginRenderPass(vkhCommandBuffer, &infoRenderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
-        // issue the command to bind the graphics pipeline
-        vkCmdBindPipeline(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkhPipeline);
+        // time the frame from the start of the command buffer, frames never overlap so they all use the same queries
+        if (vkhFrameTimeQueryPool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(vkhCommandBuffer, vkhFrameTimeQueryPool, 0, 2);
+            vkCmdWriteTimestamp(vkhCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, vkhFrameTimeQueryPool, 0);
+        }
 
+        // gather the triangles of visible meshlets, this has to happen outside of the render pass
+        if (bCullMeshlets) {
+            RecordMeshletCulling(vkhCommandBuffer);
+        }
+
+        // issue (record) the command to begin the render pass, with the command executed from the primary buffer
+        if (bDynamicRendering) {
+            RecordBeginRendering(vkhCommandBuffer, iCommandBuffer, acolClearColors);
+        } else {
+            vkCmdBeginRenderPass(vkhCommandBuffer, &infoRenderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+        }
         // bind the vertex buffer
         VkBuffer avkhBuffers[] = { vkhVertexBuffer };
         VkDeviceSize actOffsets[] = { 0 };
         vkCmdBindVertexBuffers(vkhCommandBuffer, 0, 1, avkhBuffers, actOffsets);
-        // bind the index buffer
-        vkCmdBindIndexBuffer(vkhCommandBuffer, vkhIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-        // bind the descriptor sets
-        vkCmdBindDescriptorSets(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkhPipelineLayout, 0, 1, &vkhDescriptorSet, 0, nullptr);
+        // bind the index buffer - when culling, only the triangles of visible meshlets are drawn
+        vkCmdBindIndexBuffer(vkhCommandBuffer, bCullMeshlets ? vkhCulledIndexBuffer : vkhIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        // draw the submeshes of the selected level of detail, they are sorted by material so the material is set only
+        // when it changes; materials that share a texture array share the descriptor set and differ only in the layer,
+        // and materials with the same pipeline state share the pipeline; all pipelines have the same layout, so the
+        // descriptor set stays bound when the pipeline changes, and the bindless set is bound once for the frame
+        const MeshLod &lodLevel = alodLods[selModelLod.GetLod()];
+        uint32_t idBoundMaterial = UINT32_MAX;
+        VkPipeline vkhBoundPipeline = VK_NULL_HANDLE;
+        VkDescriptorSet vkhBoundDescriptorSet = VK_NULL_HANDLE;
+        for (uint32_t iSubmesh = lodLevel.iFirstSubmesh; iSubmesh < lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes; iSubmesh++) {
+            const MeshSubmesh &subSubmesh = asubSubmeshes[iSubmesh];
+            if (subSubmesh.idMaterial != idBoundMaterial) {
+                idBoundMaterial = subSubmesh.idMaterial;
+                const MaterialResources &resMaterial = aresMaterials[idBoundMaterial];
+                if (GetMaterialPipeline(idBoundMaterial) != vkhBoundPipeline) {
+                    vkhBoundPipeline = GetMaterialPipeline(idBoundMaterial);
+                    vkCmdBindPipeline(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkhBoundPipeline);
+                }
+                if (resMaterial.vkhDescriptorSet != vkhBoundDescriptorSet) {
+                    vkhBoundDescriptorSet = resMaterial.vkhDescriptorSet;
+                    vkCmdBindDescriptorSets(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkhPipelineLayout, 0, 1, &vkhBoundDescriptorSet, 0, nullptr);
+                }
+                // the texture is the owner's element of the bindless array; virtual textures are found through the page
+                // table, from the entry of their first tile
+                MaterialPushConstants pcMaterial = { resMaterial.iTextureOwner, resMaterial.iTextureLayer, ID_VIRTUAL_PAGE_MISSING, 0, 0, 0 };
+                if (resMaterial.vtfTexture != nullptr) {
+                    pcMaterial.iFirstPageEntry = vtcVirtualTextures.GetFirstPageEntry(resMaterial.idVirtualTexture);
+                    pcMaterial.dimVirtualWidth = resMaterial.vtfTexture->GetWidth();
+                    pcMaterial.dimVirtualHeight = resMaterial.vtfTexture->GetHeight();
+                    pcMaterial.ctVirtualLevels = resMaterial.vtfTexture->GetLevelCount();
+                }
+                vkCmdPushConstants(vkhCommandBuffer, vkhPipelineLayout, rngMaterialPushConstants.stageFlags, 0, sizeof(pcMaterial), &pcMaterial);
+            }
 
-        // issue the draw command to draw index buffers
-        vkCmdDrawIndexed(vkhCommandBuffer, static_cast<uint32_t>(aiIndices.size()), 1, 0, 0, 0);
+            // issue the draw command to draw index buffers
+            if (bCullMeshlets) {
+                // the culling pass wrote the index count into the submesh's draw command
+                vkCmdDrawIndexedIndirect(vkhCommandBuffer, vkhDrawCommandBuffer, iSubmesh * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+            } else {
+                vkCmdDrawIndexed(vkhCommandBuffer, subSubmesh.ctIndices, 1, subSubmesh.iFirstIndex, subSubmesh.iVertexOffset, ID_MODEL_OBJECT);
+            }
+        }
 
         // issue the command to end the render pass
-        vkCmdEndRenderPass(vkhCommandBuffer);
+        if (bDynamicRendering) {
+            RecordEndRendering(vkhCommandBuffer, iCommandBuffer);
+        } else {
+            vkCmdEndRenderPass(vkhCommandBuffer);
+        }
+
+        // make the tiles the fragment shader asked for visible to the host, which reads them for the next frame
+        if (!aiVirtualMaterials.empty()) {
+            VkMemoryBarrier infoBarrier = {};
+            infoBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            infoBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            infoBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &infoBarrier, 0, nullptr, 0, nullptr);
+        }
+
+        // the frame is done once all its commands are
+        if (vkhFrameTimeQueryPool != VK_NULL_HANDLE) {
+            vkCmdWriteTimestamp(vkhCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, vkhFrameTimeQueryPool, 1);
+        }
 
         // end the command buffer
         if (vkEndCommandBuffer(vkhCommandBuffer) != VK_SUCCESS) {
@@ -1362,6 +2746,82 @@ void GfxAPIVulkan::RecordCommandBuffers() {
     }
 }
 
+// Begin rendering to a swap chain image and the depth buffer without a render pass.
+void GfxAPIVulkan::RecordBeginRendering(VkCommandBuffer vkhCommandBuffer, uint32_t iImage, const std::array<VkClearValue, 2> &acolClearColors) {
+#ifdef VK_KHR_dynamic_rendering
+    // without a render pass to do it, the image is moved to the color attachment layout here; the previous contents are
+    // cleared, so they are discarded, and the presentation that read them was waited for before the stage
+    VkImageMemoryBarrier infoBarrier = {};
+    infoBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoBarrier.srcAccessMask = 0;
+    infoBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    infoBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.image = avkhImages[iImage];
+    infoBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoBarrier.subresourceRange.baseMipLevel = 0;
+    infoBarrier.subresourceRange.levelCount = 1;
+    infoBarrier.subresourceRange.baseArrayLayer = 0;
+    infoBarrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+
+    // the attachments are cleared like the render pass' were; the depth buffer stays in the depth attachment layout
+    VkRenderingAttachmentInfoKHR infoColorAttachment = {};
+    infoColorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    infoColorAttachment.imageView = avkhImageViews[iImage];
+    infoColorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    infoColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    infoColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    infoColorAttachment.clearValue = acolClearColors[0];
+
+    VkRenderingAttachmentInfoKHR infoDepthAttachment = {};
+    infoDepthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    infoDepthAttachment.imageView = vkhDeptImageView;
+    infoDepthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    infoDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    infoDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    infoDepthAttachment.clearValue = acolClearColors[1];
+
+    VkRenderingInfoKHR infoRendering = {};
+    infoRendering.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    infoRendering.renderArea.offset = { 0, 0 };
+    infoRendering.renderArea.extent = exExtent;
+    infoRendering.layerCount = 1;
+    infoRendering.colorAttachmentCount = 1;
+    infoRendering.pColorAttachments = &infoColorAttachment;
+    infoRendering.pDepthAttachment = &infoDepthAttachment;
+    pfnCmdBeginRendering(vkhCommandBuffer, &infoRendering);
+#endif
+}
+
+
+// End rendering to a swap chain image without a render pass.
+void GfxAPIVulkan::RecordEndRendering(VkCommandBuffer vkhCommandBuffer, uint32_t iImage) {
+#ifdef VK_KHR_dynamic_rendering
+    pfnCmdEndRendering(vkhCommandBuffer);
+
+    // move the image to the layout it is presented in, once it is drawn
+    VkImageMemoryBarrier infoBarrier = {};
+    infoBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    infoBarrier.dstAccessMask = 0;
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    infoBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.image = avkhImages[iImage];
+    infoBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoBarrier.subresourceRange.baseMipLevel = 0;
+    infoBarrier.subresourceRange.levelCount = 1;
+    infoBarrier.subresourceRange.baseArrayLayer = 0;
+    infoBarrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+#endif
+}
+
+
 // Create semaphores for syncing buffer and renderer access.
 void GfxAPIVulkan::CreateSemaphores() {
     
@@ -1389,51 +2849,199 @@ void GfxAPIVulkan::CreateDepthResources() {
     VkFormat fmtDepth = FindDepthFormat();
 
     // create the depth image
-    CreateImage(exExtent.width, exExtent.height, fmtDepth, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhDepthImageData, vkhDepthImageMemory);
+    CreateImage(exExtent.width, exExtent.height, 1, fmtDepth, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhDepthImageData, vkhDepthImageMemory);
     // create the image view for depth
-    vkhDeptImageView = CreateImageView(vkhDepthImageData, fmtDepth, VK_IMAGE_ASPECT_DEPTH_BIT);
+    vkhDeptImageView = CreateImageView(vkhDepthImageData, fmtDepth, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 
     // transition the layout to one suitable for depth attachment
-    TransitionImageLayout(vkhDepthImageData, fmtDepth, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    TransitionImageLayout(vkhDepthImageData, fmtDepth, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 }
 
 
-// Create a texture.
-void GfxAPIVulkan::CreateTextureImage() {
-    // load the image ising the stb library
-    int dimWidth, dimHeight, ctChannels;
-    stbi_uc *imgRawData = stbi_load("../uv_checker.png", &dimWidth, &dimHeight, &ctChannels, STBI_rgb_alpha);
-
-    // if the image failed to load, throw an exception
-    if (!imgRawData) {
-        throw std::runtime_error("Failed to load the texture.");
+// Pick the formats textures are compressed to.
+void GfxAPIVulkan::SelectTextureFormats() {
+    // streaming loads levels from texture files, so they are used even when they are not compressed
+    bUseTextureFiles = Options::Get().ShouldStreamTextures();
+    if (!bTextureCompressionBC || !Options::Get().ShouldCompressTextures()) {
+        return;
     }
+    bUseTextureFiles = true;
 
-    // image is four channels per pixel
-    VkDeviceSize ctImageSize = dimWidth * dimHeight * 4;
+    // opaque images only need BC1, images with transparency prefer the better quality of BC7 over BC3; RGBA8 is
+    // always supported and ends both lists
+    const VkFormatFeatureFlags flagFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    fmtOpaqueTexture = FindSupportedFormat({ VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM }, VK_IMAGE_TILING_OPTIMAL, flagFeatures);
+    fmtTranslucentTexture = FindSupportedFormat({ VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_R8G8B8A8_UNORM }, VK_IMAGE_TILING_OPTIMAL, flagFeatures);
+}
 
-    // create a staging buffer - it is a source in a memory transfer operation, and is located on the host
-    VkBuffer vkhStagingBuffer;
-    VkDeviceMemory vkhStagingMemory;
-    CreateBuffer(ctImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhStagingBuffer, vkhStagingMemory);
 
-    // to copy the image values to GPU memory, it first needs to be mapped to CPU
-    void *pMappedMemory;
-    vkMapMemory(vkhLogicalDevice, vkhStagingMemory, 0, ctImageSize, 0, &pMappedMemory);
-    // copy the buffer to mapped memory
-    memcpy(pMappedMemory, imgRawData, ctImageSize);
+// Create a texture from an image in the asset package, with a full mip chain.
+void GfxAPIVulkan::CreateTextureImage(const std::string &strAssetName, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat) {
+    // the image is decoded straight from the package mapping
+    std::vector<TextureUpload> aupUploads(1);
+    aupUploads[0].strFilename = strAssetName;
+    aupUploads[0].pchData = GetAssetData(strAssetName, aupUploads[0].ctBytes);
+    DecodeTextureImages(aupUploads);
+    CreateTextureImageFromUpload(aupUploads[0], vkhImage, vkhMemory, ctMipLevels, fmtFormat);
+}
+
+
+// Decode images straight into their staging buffers, all of them at once on the thread pool.
+void GfxAPIVulkan::DecodeTextureImages(std::vector<TextureUpload> &aupUploads) {
+    // the staging buffers are sized from the image headers and mapped up front, as Vulkan calls stay on this thread
+    std::vector<uint8_t *> apbMappedMemory(aupUploads.size());
+    for (size_t iUpload = 0; iUpload < aupUploads.size(); iUpload++) {
+        TextureUpload &upUpload = aupUploads[iUpload];
+        if (upUpload.pchData != nullptr) {
+            ImageDecoder::GetImageSize(upUpload.pchData, upUpload.ctBytes, upUpload.strFilename, upUpload.dimWidth, upUpload.dimHeight);
+        } else {
+            ImageDecoder::GetImageSize(upUpload.strFilename, upUpload.dimWidth, upUpload.dimHeight);
+        }
+        // image is four channels per pixel
+        const VkDeviceSize ctImageSize = VkDeviceSize(upUpload.dimWidth) * upUpload.dimHeight * 4;
+        // create a staging buffer - it is a source in a memory transfer operation, and is located on the host
+        CreateBuffer(ctImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, upUpload.vkhStagingBuffer, upUpload.vkhStagingMemory);
+        vkMapMemory(vkhLogicalDevice, upUpload.vkhStagingMemory, 0, ctImageSize, 0, reinterpret_cast<void **>(&apbMappedMemory[iUpload]));
+    }
+
+    // the workers decode into the mapped memory directly, without an intermediate copy of the image
+    ThreadPool::Get().ParallelFor(static_cast<uint32_t>(aupUploads.size()), [&](uint32_t iUpload) {
+        const TextureUpload &upUpload = aupUploads[iUpload];
+        if (upUpload.pchData != nullptr) {
+            ImageDecoder::DecodeRgba(upUpload.pchData, upUpload.ctBytes, upUpload.strFilename, upUpload.dimWidth, upUpload.dimHeight, apbMappedMemory[iUpload]);
+        } else {
+            ImageDecoder::DecodeRgba(upUpload.strFilename, upUpload.dimWidth, upUpload.dimHeight, apbMappedMemory[iUpload]);
+        }
+    });
+
     // unmap memory, let the GPU take over
-    vkUnmapMemory(vkhLogicalDevice, vkhStagingMemory);
+    for (const TextureUpload &upUpload : aupUploads) {
+        vkUnmapMemory(vkhLogicalDevice, upUpload.vkhStagingMemory);
+    }
+}
 
-    // release texture memory
-    stbi_image_free(imgRawData);
+
+// Create a texture from an image decoded into a staging buffer, with a full mip chain.
+void GfxAPIVulkan::CreateTextureImageFromUpload(const TextureUpload &upUpload, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat) {
+    const std::string &strFilename = upUpload.strFilename;
+    const uint32_t dimWidth = upUpload.dimWidth;
+    const uint32_t dimHeight = upUpload.dimHeight;
+    const VkBuffer vkhStagingBuffer = upUpload.vkhStagingBuffer;
+    const VkDeviceMemory vkhStagingMemory = upUpload.vkhStagingMemory;
+
+    // the smaller levels are generated from the first one on the GPU, by blitting if the format allows it and with the
+    // downsampling shader otherwise; the image is a source of the blits or a storage image for the shader
+    fmtFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    VkImageUsageFlags flagUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    ctMipLevels = GetMipLevelCount(dimWidth, dimHeight);
+    if (CanBlitMipmaps(fmtFormat)) {
+        flagUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    } else if (CanComputeMipmaps(fmtFormat)) {
+        flagUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    } else {
+        std::cerr << "Mipmaps can't be generated, " << strFilename << " has a single level" << std::endl;
+        ctMipLevels = 1;
+    }
+    ctMaxTextureMipLevels = std::max(ctMaxTextureMipLevels, ctMipLevels);
 
     // create the image
-    CreateImage(dimWidth, dimHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhImageData, vkhImageMemory);
+    CreateImage(dimWidth, dimHeight, ctMipLevels, fmtFormat, VK_IMAGE_TILING_OPTIMAL, flagUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhImage, vkhMemory);
     // prepare the image to receive data from the staging buffer
-    TransitionImageLayout(vkhImageData, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    TransitionImageLayout(vkhImage, fmtFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ctMipLevels);
     // copy data from the staging buffer to the image
-    CoypBufferToImage(vkhStagingBuffer, vkhImageData, dimWidth, dimHeight);
+    CoypBufferToImage(vkhStagingBuffer, vkhImage, dimWidth, dimHeight);
+    // fill the rest of the mip chain, which also prepares the image for reading from shaders
+    if (ctMipLevels > 1) {
+        GenerateMipmaps(vkhImage, fmtFormat, dimWidth, dimHeight, ctMipLevels);
+    } else {
+        TransitionImageLayout(vkhImage, fmtFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+    }
+
+    // destroy the staging buffer
+    vkDestroyBuffer(vkhLogicalDevice, vkhStagingBuffer, nullptr);
+    // free buffer memory
+    vkFreeMemory(vkhLogicalDevice, vkhStagingMemory, nullptr);
+}
+
+
+// Import an image into its texture file if the file is out of date.
+std::string GfxAPIVulkan::ImportTextureFile(const std::string &strFilename) {
+    // the TextureFormat values are the matching VkFormat values
+    const std::string strTextureFilename = strFilename + STR_TEXTURE_FILE_EXTENSION;
+    TextureImporter::ImportImageIfOutOfDate(strFilename, strTextureFilename,
+        static_cast<enum TextureFormat>(fmtOpaqueTexture), static_cast<enum TextureFormat>(fmtTranslucentTexture));
+    return strTextureFilename;
+}
+
+
+// Create a texture from a KTX2 texture file, uploading all its levels as they are.
+void GfxAPIVulkan::CreateCompressedTextureImage(const std::string &strFilename, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat) {
+    KtxFile ktxTexture;
+    ktxTexture.Open(strFilename);
+    fmtFormat = static_cast<VkFormat>(ktxTexture.GetFormat());
+    ctMipLevels = ktxTexture.GetLevelCount();
+    CreateTextureImageFromFile(ktxTexture, 0, vkhImage, vkhMemory);
+}
+
+
+// Create an image with all the levels of a texture file, and upload the levels from iFirstLevel to the smallest one.
+void GfxAPIVulkan::CreateTextureImageFromFile(const KtxFile &ktxTexture, uint32_t iFirstLevel, VkImage &vkhImage, VkDeviceMemory &vkhMemory) {
+    CreateTextureArrayFromFiles({ &ktxTexture }, iFirstLevel, vkhImage, vkhMemory);
+}
+
+
+// Create an image array with one texture file in each layer, with all their levels, and upload the levels from
+// iFirstLevel to the smallest one.
+void GfxAPIVulkan::CreateTextureArrayFromFiles(const std::vector<const KtxFile *> &aktxLayers, uint32_t iFirstLevel, VkImage &vkhImage, VkDeviceMemory &vkhMemory) {
+    const KtxFile &ktxFirst = *aktxLayers[0];
+    const uint32_t ctLayers = static_cast<uint32_t>(aktxLayers.size());
+    const VkFormat fmtFormat = static_cast<VkFormat>(ktxFirst.GetFormat());
+    const uint32_t ctLevels = ktxFirst.GetLevelCount();
+    const uint32_t ctMipLevels = ctLevels - iFirstLevel;
+    // the sampler covers all levels of the texture, including the ones that aren't resident yet
+    ctMaxTextureMipLevels = std::max(ctMaxTextureMipLevels, ctLevels);
+
+    // all levels of all layers go into one staging buffer, each at an offset that's a multiple of the block size
+    std::vector<VkBufferImageCopy> ainfoRegions(ctLayers * ctMipLevels);
+    VkDeviceSize ctStagingSize = 0;
+    for (uint32_t iLayer = 0; iLayer < ctLayers; iLayer++) {
+        for (uint32_t iLevel = 0; iLevel < ctMipLevels; iLevel++) {
+            uint64_t ctLevelBytes;
+            aktxLayers[iLayer]->GetLevel(iFirstLevel + iLevel, ctLevelBytes);
+            VkBufferImageCopy &infoRegion = ainfoRegions[iLayer * ctMipLevels + iLevel];
+            infoRegion = {};
+            infoRegion.bufferOffset = ctStagingSize;
+            infoRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            infoRegion.imageSubresource.mipLevel = iFirstLevel + iLevel;
+            infoRegion.imageSubresource.baseArrayLayer = iLayer;
+            infoRegion.imageSubresource.layerCount = 1;
+            infoRegion.imageExtent = { std::max(ktxFirst.GetWidth() >> (iFirstLevel + iLevel), 1u), std::max(ktxFirst.GetHeight() >> (iFirstLevel + iLevel), 1u), 1 };
+            ctStagingSize += (ctLevelBytes + CT_KTX_LEVEL_ALIGNMENT - 1) / CT_KTX_LEVEL_ALIGNMENT * CT_KTX_LEVEL_ALIGNMENT;
+        }
+    }
+
+    // create a staging buffer and copy the levels straight from the mapped files
+    VkBuffer vkhStagingBuffer;
+    VkDeviceMemory vkhStagingMemory;
+    CreateBuffer(ctStagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhStagingBuffer, vkhStagingMemory);
+    char *pchMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhStagingMemory, 0, ctStagingSize, 0, reinterpret_cast<void **>(&pchMappedMemory));
+    for (uint32_t iLayer = 0; iLayer < ctLayers; iLayer++) {
+        for (uint32_t iLevel = 0; iLevel < ctMipLevels; iLevel++) {
+            uint64_t ctLevelBytes;
+            const uint8_t *pbLevel = aktxLayers[iLayer]->GetLevel(iFirstLevel + iLevel, ctLevelBytes);
+            memcpy(pchMappedMemory + ainfoRegions[iLayer * ctMipLevels + iLevel].bufferOffset, pbLevel, static_cast<size_t>(ctLevelBytes));
+        }
+    }
+    vkUnmapMemory(vkhLogicalDevice, vkhStagingMemory);
+
+    // create the image with all levels, copy the uploaded ones to it and prepare it for reading from shaders; the
+    // levels that aren't uploaded are never sampled until streaming copies them in
+    CreateImage(ktxFirst.GetWidth(), ktxFirst.GetHeight(), ctLevels, fmtFormat, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhImage, vkhMemory, ctLayers);
+    TransitionImageLayout(vkhImage, fmtFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ctLevels, ctLayers);
+    CopyBufferToImageRegions(vkhStagingBuffer, vkhImage, ainfoRegions);
+    TransitionImageLayout(vkhImage, fmtFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, ctLevels, ctLayers);
 
     // destroy the staging buffer
     vkDestroyBuffer(vkhLogicalDevice, vkhStagingBuffer, nullptr);
@@ -1444,7 +3052,7 @@ void GfxAPIVulkan::CreateTextureImage() {
 
 // Create a view for the texture.
 void GfxAPIVulkan::CreateTextureImageVeiw() {
-    vkhImageView = CreateImageView(vkhImageData, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    vkhImageView = CreateImageView(vkhImageData, fmtImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, ctImageMipLevels, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
 }
 
 
@@ -1470,11 +3078,12 @@ void GfxAPIVulkan::CreateImageSampler() {
     // set compare options - not used in this filtering method
     infoSampler.compareEnable = VK_FALSE;
     infoSampler.compareOp = VK_COMPARE_OP_ALWAYS;
-    // set mipmaping options to no mipmaps
+    // blend between mip levels, over the levels of the largest texture - views of smaller ones limit it further; with
+    // mipmaps disabled only the full resolution level is sampled
     infoSampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     infoSampler.mipLodBias = 0.0f;
     infoSampler.minLod = 0.0f;
-    infoSampler.maxLod = 0.0f;
+    infoSampler.maxLod = bTextureMipmapsEnabled ? static_cast<float>(ctMaxTextureMipLevels) : 0.0f;
 
     // create the sampler
     if (vkCreateSampler(vkhLogicalDevice, &infoSampler, nullptr, &vkhImageSampler) != VK_SUCCESS) {
@@ -1519,22 +3128,23 @@ bool GfxAPIVulkan::FormatHasStencilComponent(VkFormat fmtFormat) {
 
 
 // Create an image view
-VkImageView GfxAPIVulkan::CreateImageView(VkImage vkhImage, VkFormat fmtFormat, VkImageAspectFlags flagImageAspect) {
+VkImageView GfxAPIVulkan::CreateImageView(VkImage vkhImage, VkFormat fmtFormat, VkImageAspectFlags flagImageAspect, uint32_t ctMipLevels, uint32_t iBaseMipLevel,
+    VkImageViewType vitType, uint32_t ctLayers) {
 
     // describe the image view
     VkImageViewCreateInfo infoImageView = {};
     infoImageView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     // set the image
     infoImageView.image = vkhImage;
-    // it is a view into a RGBA 2D texture
-    infoImageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    // it is a view into a 2D texture or a texture array
+    infoImageView.viewType = vitType;
     infoImageView.format = fmtFormat;
-    // it is color map with no mipmaps or layers
+    // it shows all layers and a range of the mip levels
     infoImageView.subresourceRange.aspectMask = flagImageAspect;
-    infoImageView.subresourceRange.layerCount = 1;
+    infoImageView.subresourceRange.layerCount = ctLayers;
     infoImageView.subresourceRange.baseArrayLayer = 0;
-    infoImageView.subresourceRange.levelCount = 1;
-    infoImageView.subresourceRange.baseMipLevel = 0;
+    infoImageView.subresourceRange.levelCount = ctMipLevels;
+    infoImageView.subresourceRange.baseMipLevel = iBaseMipLevel;
 
     // create the image view
     VkImageView vkhView;
@@ -1546,7 +3156,8 @@ VkImageView GfxAPIVulkan::CreateImageView(VkImage vkhImage, VkFormat fmtFormat,
 }
 
 // Create an image.
-void GfxAPIVulkan::CreateImage(uint32_t dimWidth, uint32_t dimHeight, VkFormat fmtFormat, VkImageTiling imtTiling, VkImageUsageFlags flagUsage, VkMemoryPropertyFlags flagMemoryProperties, VkImage &vkhImage, VkDeviceMemory &vkhMemory) {
+void GfxAPIVulkan::CreateImage(uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels, VkFormat fmtFormat, VkImageTiling imtTiling, VkImageUsageFlags flagUsage, VkMemoryPropertyFlags flagMemoryProperties, VkImage &vkhImage, VkDeviceMemory &vkhMemory,
+    uint32_t ctLayers) {
     // describe the image
     VkImageCreateInfo infoImage = {};
     infoImage.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1556,10 +3167,10 @@ void GfxAPIVulkan::CreateImage(uint32_t dimWidth, uint32_t dimHeight, VkFormat f
     infoImage.extent.width = dimWidth;
     infoImage.extent.height = dimHeight;
     infoImage.extent.depth = 1;
-    // no mipmaps
-    infoImage.mipLevels = 1;
-    // not an image array
-    infoImage.arrayLayers = 1;
+    // number of mip levels
+    infoImage.mipLevels = ctMipLevels;
+    // number of layers, more than one for an image array
+    infoImage.arrayLayers = ctLayers;
     // set the image format
     infoImage.format = fmtFormat;
     // use the optimal tiling (won't be able to directly access texels)
@@ -1603,7 +3214,7 @@ void GfxAPIVulkan::CreateImage(uint32_t dimWidth, uint32_t dimHeight, VkFormat f
 
 
 // Change image layout to what is needed for rendering.
-void GfxAPIVulkan::TransitionImageLayout(VkImage vkhImage, VkFormat fmtFormat, VkImageLayout imlOldLayout, VkImageLayout imlNewLayout) {
+void GfxAPIVulkan::TransitionImageLayout(VkImage vkhImage, VkFormat fmtFormat, VkImageLayout imlOldLayout, VkImageLayout imlNewLayout, uint32_t ctMipLevels, uint32_t ctLayers) {
     // begin recording a one time command buffer
     VkCommandBuffer vkhCommandBuffer = BeginOneTimeCommand();
 
@@ -1618,11 +3229,11 @@ void GfxAPIVulkan::TransitionImageLayout(VkImage vkhImage, VkFormat fmtFormat, V
     infoImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     // set the image
     infoImageMemoryBarrier.image = vkhImage;
-    // not a 3D image, so only one layer
-    infoImageMemoryBarrier.subresourceRange.layerCount = 1;
+    // transition all layers of an image array
+    infoImageMemoryBarrier.subresourceRange.layerCount = ctLayers;
     infoImageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
-    // no mipmaps either
-    infoImageMemoryBarrier.subresourceRange.levelCount = 1;
+    // transition the first ctMipLevels levels
+    infoImageMemoryBarrier.subresourceRange.levelCount = ctMipLevels;
     infoImageMemoryBarrier.subresourceRange.baseMipLevel = 0;
     
     // if transitioning a depth buffer
@@ -1712,50 +3323,879 @@ void GfxAPIVulkan::CoypBufferToImage(VkBuffer vkhBuffer, VkImage vkhImage, uint3
 }
 
 
+// Copy regions of a buffer to the image.
+void GfxAPIVulkan::CopyBufferToImageRegions(VkBuffer vkhBuffer, VkImage vkhImage, const std::vector<VkBufferImageCopy> &ainfoRegions) {
+    VkCommandBuffer vkhCommandBuffer = BeginOneTimeCommand();
+    vkCmdCopyBufferToImage(vkhCommandBuffer, vkhBuffer, vkhImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(ainfoRegions.size()), ainfoRegions.data());
+    EndOneTimeCommand(vkhCommandBuffer);
+}
+
+
+// Get the number of levels in a full mip chain of an image.
+uint32_t GfxAPIVulkan::GetMipLevelCount(uint32_t dimWidth, uint32_t dimHeight) {
+    // each level is half the size of the previous one, rounded down, until both sides are one texel
+    uint32_t ctMipLevels = 1;
+    for (uint32_t dimLargest = std::max(dimWidth, dimHeight); dimLargest > 1; dimLargest /= 2) {
+        ctMipLevels++;
+    }
+    return ctMipLevels;
+}
+
+
+// Can the mip chain of an image with the format be generated by blitting?
+bool GfxAPIVulkan::CanBlitMipmaps(VkFormat fmtFormat) {
+    // blits between levels of the same image need the format to be a blit source and destination, with linear filtering
+    VkFormatProperties propsFormat;
+    vkGetPhysicalDeviceFormatProperties(vkhPhysicalDevice, fmtFormat, &propsFormat);
+    const VkFormatFeatureFlags flagRequired = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (propsFormat.optimalTilingFeatures & flagRequired) == flagRequired;
+}
+
+
+// Can the mip chain of an image with the format be generated by the downsampling shader?
+bool GfxAPIVulkan::CanComputeMipmaps(VkFormat fmtFormat) {
+    // the shader reads and writes RGBA8 storage images
+    if (fmtFormat != VK_FORMAT_R8G8B8A8_UNORM || !pkgAssets.HasAsset(STR_MIP_SHADER_ASSET)) {
+        return false;
+    }
+    VkFormatProperties propsFormat;
+    vkGetPhysicalDeviceFormatProperties(vkhPhysicalDevice, fmtFormat, &propsFormat);
+    return (propsFormat.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+
+// Generate the mip chain of an image from its first level.
+void GfxAPIVulkan::GenerateMipmaps(VkImage vkhImage, VkFormat fmtFormat, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels) {
+    if (CanBlitMipmaps(fmtFormat)) {
+        GenerateMipmapsWithBlit(vkhImage, dimWidth, dimHeight, ctMipLevels);
+    } else {
+        GenerateMipmapsWithCompute(vkhImage, fmtFormat, dimWidth, dimHeight, ctMipLevels);
+    }
+}
+
+
+// Generate the mip chain by blitting each level into the next one.
+void GfxAPIVulkan::GenerateMipmapsWithBlit(VkImage vkhImage, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels) {
+    // begin recording a one time command buffer
+    VkCommandBuffer vkhCommandBuffer = BeginOneTimeCommand();
+
+    // barriers move one level at a time
+    VkImageMemoryBarrier infoImageMemoryBarrier = {};
+    infoImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoImageMemoryBarrier.image = vkhImage;
+    infoImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoImageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    infoImageMemoryBarrier.subresourceRange.layerCount = 1;
+    infoImageMemoryBarrier.subresourceRange.levelCount = 1;
+
+    int32_t dimLevelWidth = static_cast<int32_t>(dimWidth);
+    int32_t dimLevelHeight = static_cast<int32_t>(dimHeight);
+    for (uint32_t iLevel = 1; iLevel < ctMipLevels; iLevel++) {
+        // the previous level was written by a copy or a blit, wait for it and make it the blit source
+        infoImageMemoryBarrier.subresourceRange.baseMipLevel = iLevel - 1;
+        infoImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        infoImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        infoImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        infoImageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoImageMemoryBarrier);
+
+        // scale the whole previous level down into this one, with linear filtering
+        const int32_t dimNextWidth = std::max(dimLevelWidth / 2, 1);
+        const int32_t dimNextHeight = std::max(dimLevelHeight / 2, 1);
+        VkImageBlit infoBlit = {};
+        infoBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        infoBlit.srcSubresource.mipLevel = iLevel - 1;
+        infoBlit.srcSubresource.baseArrayLayer = 0;
+        infoBlit.srcSubresource.layerCount = 1;
+        infoBlit.srcOffsets[0] = { 0, 0, 0 };
+        infoBlit.srcOffsets[1] = { dimLevelWidth, dimLevelHeight, 1 };
+        infoBlit.dstSubresource = infoBlit.srcSubresource;
+        infoBlit.dstSubresource.mipLevel = iLevel;
+        infoBlit.dstOffsets[0] = { 0, 0, 0 };
+        infoBlit.dstOffsets[1] = { dimNextWidth, dimNextHeight, 1 };
+        vkCmdBlitImage(vkhCommandBuffer, vkhImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, vkhImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &infoBlit, VK_FILTER_LINEAR);
+
+        // the previous level is done, prepare it for reading from the fragment shader
+        infoImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        infoImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        infoImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        infoImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoImageMemoryBarrier);
+
+        dimLevelWidth = dimNextWidth;
+        dimLevelHeight = dimNextHeight;
+    }
+
+    // the last level is never a blit source, it goes straight from the transfer destination to shader reads
+    infoImageMemoryBarrier.subresourceRange.baseMipLevel = ctMipLevels - 1;
+    infoImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    infoImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    infoImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoImageMemoryBarrier);
+
+    // finish recording and submit the buffer
+    EndOneTimeCommand(vkhCommandBuffer);
+}
+
+
+// Generate the mip chain with the downsampling shader, several levels per dispatch.
+void GfxAPIVulkan::GenerateMipmapsWithCompute(VkImage vkhImage, VkFormat fmtFormat, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels) {
+    if (vkhMipPipeline == VK_NULL_HANDLE) {
+        CreateMipPipeline();
+    }
+
+    // each dispatch reads one level and writes up to six following ones, each level needs a view of its own
+    std::vector<VkImageView> avkhLevelViews(ctMipLevels);
+    for (uint32_t iLevel = 0; iLevel < ctMipLevels; iLevel++) {
+        avkhLevelViews[iLevel] = CreateImageView(vkhImage, fmtFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1, iLevel);
+    }
+    const uint32_t ctDispatches = (ctMipLevels - 1 + CT_MIP_LEVELS_PER_DISPATCH - 1) / CT_MIP_LEVELS_PER_DISPATCH;
+
+    // descriptor sets for all dispatches come from a pool that lives as long as the generation
+    VkDescriptorPoolSize infoPoolSize = {};
+    infoPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    infoPoolSize.descriptorCount = ctDispatches * (1 + CT_MIP_LEVELS_PER_DISPATCH);
+    VkDescriptorPoolCreateInfo infoDescriptorPool = {};
+    infoDescriptorPool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    infoDescriptorPool.poolSizeCount = 1;
+    infoDescriptorPool.pPoolSizes = &infoPoolSize;
+    infoDescriptorPool.maxSets = ctDispatches;
+    VkDescriptorPool vkhMipDescriptorPool;
+    if (vkCreateDescriptorPool(vkhLogicalDevice, &infoDescriptorPool, nullptr, &vkhMipDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the mipmap descriptor pool");
+    }
+    std::vector<VkDescriptorSetLayout> avkhLayouts(ctDispatches, vkhMipDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo infoDescriptorSetAllocation = {};
+    infoDescriptorSetAllocation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    infoDescriptorSetAllocation.descriptorPool = vkhMipDescriptorPool;
+    infoDescriptorSetAllocation.descriptorSetCount = ctDispatches;
+    infoDescriptorSetAllocation.pSetLayouts = avkhLayouts.data();
+    std::vector<VkDescriptorSet> avkhDescriptorSets(ctDispatches);
+    if (vkAllocateDescriptorSets(vkhLogicalDevice, &infoDescriptorSetAllocation, avkhDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to allocate the mipmap descriptor sets");
+    }
+
+    // begin recording a one time command buffer
+    VkCommandBuffer vkhCommandBuffer = BeginOneTimeCommand();
+
+    // the shader reads and writes all levels in the general layout
+    VkImageMemoryBarrier infoImageMemoryBarrier = {};
+    infoImageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoImageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoImageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoImageMemoryBarrier.image = vkhImage;
+    infoImageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoImageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    infoImageMemoryBarrier.subresourceRange.layerCount = 1;
+    infoImageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+    infoImageMemoryBarrier.subresourceRange.levelCount = ctMipLevels;
+    infoImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    infoImageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    infoImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoImageMemoryBarrier);
+
+    vkCmdBindPipeline(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vkhMipPipeline);
+    for (uint32_t iDispatch = 0; iDispatch < ctDispatches; iDispatch++) {
+        const uint32_t iSource = iDispatch * CT_MIP_LEVELS_PER_DISPATCH;
+        const uint32_t ctLevels = std::min(CT_MIP_LEVELS_PER_DISPATCH, ctMipLevels - 1 - iSource);
+
+        // bind the source and the written levels, unused slots repeat the last level so the whole array is valid
+        std::array<VkDescriptorImageInfo, 1 + CT_MIP_LEVELS_PER_DISPATCH> ainfoImages = {};
+        for (uint32_t iImage = 0; iImage < ainfoImages.size(); iImage++) {
+            ainfoImages[iImage].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            ainfoImages[iImage].imageView = avkhLevelViews[iSource + std::min(iImage, ctLevels)];
+        }
+        std::array<VkWriteDescriptorSet, 2> ainfoUpdateDescriptorSets = {};
+        for (uint32_t iBinding = 0; iBinding < ainfoUpdateDescriptorSets.size(); iBinding++) {
+            ainfoUpdateDescriptorSets[iBinding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            ainfoUpdateDescriptorSets[iBinding].dstSet = avkhDescriptorSets[iDispatch];
+            ainfoUpdateDescriptorSets[iBinding].dstBinding = iBinding;
+            ainfoUpdateDescriptorSets[iBinding].dstArrayElement = 0;
+            ainfoUpdateDescriptorSets[iBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        }
+        ainfoUpdateDescriptorSets[0].descriptorCount = 1;
+        ainfoUpdateDescriptorSets[0].pImageInfo = &ainfoImages[0];
+        ainfoUpdateDescriptorSets[1].descriptorCount = CT_MIP_LEVELS_PER_DISPATCH;
+        ainfoUpdateDescriptorSets[1].pImageInfo = &ainfoImages[1];
+        vkUpdateDescriptorSets(vkhLogicalDevice, static_cast<uint32_t>(ainfoUpdateDescriptorSets.size()), ainfoUpdateDescriptorSets.data(), 0, nullptr);
+
+        // one workgroup per tile of the source level
+        vkCmdBindDescriptorSets(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vkhMipPipelineLayout, 0, 1, &avkhDescriptorSets[iDispatch], 0, nullptr);
+        vkCmdPushConstants(vkhCommandBuffer, vkhMipPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ctLevels), &ctLevels);
+        const uint32_t dimSourceWidth = std::max(dimWidth >> iSource, 1u);
+        const uint32_t dimSourceHeight = std::max(dimHeight >> iSource, 1u);
+        vkCmdDispatch(vkhCommandBuffer, (dimSourceWidth + CT_MIP_TILE_SIZE - 1) / CT_MIP_TILE_SIZE, (dimSourceHeight + CT_MIP_TILE_SIZE - 1) / CT_MIP_TILE_SIZE, 1);
+
+        // the next dispatch reads the last level this one wrote
+        VkMemoryBarrier infoMemoryBarrier = {};
+        infoMemoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        infoMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        infoMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &infoMemoryBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    // prepare all levels for reading from the fragment shader
+    infoImageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    infoImageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    infoImageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    infoImageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoImageMemoryBarrier);
+
+    // finish recording and submit the buffer, it is complete when this returns
+    EndOneTimeCommand(vkhCommandBuffer);
+
+    // the views and descriptor sets were only needed by the dispatches
+    vkDestroyDescriptorPool(vkhLogicalDevice, vkhMipDescriptorPool, nullptr);
+    for (VkImageView vkhLevelView : avkhLevelViews) {
+        vkDestroyImageView(vkhLogicalDevice, vkhLevelView, nullptr);
+    }
+}
+
+
+// Create the pipeline of the downsampling shader.
+void GfxAPIVulkan::CreateMipPipeline() {
+    // the source level, and the array of levels written
+    std::array<VkDescriptorSetLayoutBinding, 2> ainfoBindings = {};
+    for (uint32_t iBinding = 0; iBinding < ainfoBindings.size(); iBinding++) {
+        ainfoBindings[iBinding].binding = iBinding;
+        ainfoBindings[iBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        ainfoBindings[iBinding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    ainfoBindings[0].descriptorCount = 1;
+    ainfoBindings[1].descriptorCount = CT_MIP_LEVELS_PER_DISPATCH;
+
+    VkDescriptorSetLayoutCreateInfo infoDescriptorSetLayout = {};
+    infoDescriptorSetLayout.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    infoDescriptorSetLayout.bindingCount = static_cast<uint32_t>(ainfoBindings.size());
+    infoDescriptorSetLayout.pBindings = ainfoBindings.data();
+    if (vkCreateDescriptorSetLayout(vkhLogicalDevice, &infoDescriptorSetLayout, nullptr, &vkhMipDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to create the mipmap descriptor set layout");
+    }
+
+    // the number of levels to write is a push constant
+    VkPushConstantRange infoPushConstants = {};
+    infoPushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    infoPushConstants.offset = 0;
+    infoPushConstants.size = sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo infoPipelineLayout = {};
+    infoPipelineLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    infoPipelineLayout.setLayoutCount = 1;
+    infoPipelineLayout.pSetLayouts = &vkhMipDescriptorSetLayout;
+    infoPipelineLayout.pushConstantRangeCount = 1;
+    infoPipelineLayout.pPushConstantRanges = &infoPushConstants;
+    if (vkCreatePipelineLayout(vkhLogicalDevice, &infoPipelineLayout, nullptr, &vkhMipPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the mipmap pipeline layout");
+    }
+
+    // load the compute module
+    VkShaderModule modComp = CreateShaderModule(STR_MIP_SHADER_ASSET);
+
+    // describe the compute pipeline, it has a single stage
+    VkComputePipelineCreateInfo infoComputePipeline = {};
+    infoComputePipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    infoComputePipeline.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    infoComputePipeline.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    infoComputePipeline.stage.module = modComp;
+    infoComputePipeline.stage.pName = "main";
+    infoComputePipeline.layout = vkhMipPipelineLayout;
+
+    // create the pipeline
+    VkResult statusResult = vkCreateComputePipelines(vkhLogicalDevice, vkhPipelineCache, 1, &infoComputePipeline, nullptr, &vkhMipPipeline);
+
+    // the shader module is no longer needed once the pipeline is created
+    vkDestroyShaderModule(vkhLogicalDevice, modComp, nullptr);
+
+    if (statusResult != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the mipmap pipeline");
+    }
+}
+
+
+// Destroy the pipeline of the downsampling shader, if it was created.
+void GfxAPIVulkan::DestroyMipPipeline() {
+    if (vkhMipPipeline == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDestroyPipeline(vkhLogicalDevice, vkhMipPipeline, nullptr);
+    vkDestroyPipelineLayout(vkhLogicalDevice, vkhMipPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(vkhLogicalDevice, vkhMipDescriptorSetLayout, nullptr);
+    vkhMipPipeline = VK_NULL_HANDLE;
+}
+
+
 // Load the example model.
 void GfxAPIVulkan::LoadModel() {
-    // vertex attributes - position, normal, uv, color
-    tinyobj::attrib_t vatrVertexAttributes;
-    // object's meshes, named
-    std::vector<tinyobj::shape_t> ameshMeshes;
-    // materials used by the object
-    std::vector<tinyobj::material_t> amatMaterials;
-    // error string will be stored here, if any
-    std::string strError;
-
-    // load the model from the object file
-    if (!tinyobj::LoadObj(&vatrVertexAttributes, &ameshMeshes, &amatMaterials, &strError, "../sphere.obj")) {
-        throw std::runtime_error("Failed to load the model:  " + strError);
-    }
-
-    // combine all meshes into a single vertex and index buffer
-    // go through all vertices in all meshes in the model
-    for (const auto &meshMesh : ameshMeshes) {
-        for (const auto iVertex : meshMesh.mesh.indices) {
-            // read vertex attributes
-            Vertex vVertex = {};
-            // read the position
-            vVertex.vecPosition = {
-                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 0],
-                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 1],
-                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 2],
-            };
-            // read the UV coordinaets
-            vVertex.vecTexCoords = {
-                vatrVertexAttributes.texcoords[iVertex.texcoord_index * 2 + 0],
-                1.0f - vatrVertexAttributes.texcoords[iVertex.texcoord_index * 2 + 1],
+    // read the vertices and indices from the mesh in the package, it was imported when the package was built
+    uint64_t ctMeshBytes;
+    const char *pchMesh = GetAssetData(STR_MODEL_MESH_ASSET, ctMeshBytes);
+    MeshFile meshFile;
+    meshFile.Open(pchMesh, ctMeshBytes, STR_MODEL_MESH_ASSET);
+    meshFile.ReadSection(MESH_SECTION_VERTICES, avVertices);
+    meshFile.ReadSection(MESH_SECTION_INDICES, aiIndices);
+    meshFile.ReadSection(MESH_SECTION_MESHLETS, ameshMeshlets);
+    meshFile.ReadSection(MESH_SECTION_LODS, alodLods);
+    meshFile.ReadSection(MESH_SECTION_SUBMESHES, asubSubmeshes);
+    meshFile.ReadSection(MESH_SECTION_MATERIALS, amatMaterials);
+
+    // find the bounds of the model, for selecting its level of detail
+    glm::vec3 vecMin(std::numeric_limits<float>::max());
+    glm::vec3 vecMax(-std::numeric_limits<float>::max());
+    for (const Vertex &vVertex : avVertices) {
+        vecMin = glm::min(vecMin, vVertex.vecPosition);
+        vecMax = glm::max(vecMax, vVertex.vecPosition);
+    }
+    const glm::vec3 vecCenter = (vecMin + vecMax) * 0.5f;
+    float fRadius = 0.0f;
+    for (const Vertex &vVertex : avVertices) {
+        fRadius = std::max(fRadius, glm::length(vVertex.vecPosition - vecCenter));
+    }
+    sphModelBounds = glm::vec4(vecCenter, fRadius);
+}
+
+
+// Create the texture of a material with only its smallest levels resident.
+void GfxAPIVulkan::CreateStreamedTexture(const std::string &strTextureFilename, uint32_t iMaterial) {
+    MaterialResources &resMaterial = aresMaterials[iMaterial];
+
+    // the file stays mapped while the texture exists, levels are read from it as they are needed
+    resMaterial.ktxTexture = std::make_shared<KtxFile>();
+    resMaterial.ktxTexture->Open(strTextureFilename);
+    const KtxFile &ktxTexture = *resMaterial.ktxTexture;
+    resMaterial.fmtFormat = static_cast<VkFormat>(ktxTexture.GetFormat());
+
+    // levels up to the minimum size are always resident
+    const uint32_t dimMinSize = Options::Get().GetTextureStreamingMinSize();
+    std::vector<uint64_t> actLevelBytes(ktxTexture.GetLevelCount());
+    uint32_t iPinnedLevel = 0;
+    for (uint32_t iLevel = 0; iLevel < ktxTexture.GetLevelCount(); iLevel++) {
+        ktxTexture.GetLevel(iLevel, actLevelBytes[iLevel]);
+        if (std::max(ktxTexture.GetWidth(), ktxTexture.GetHeight()) >> iLevel > dimMinSize) {
+            iPinnedLevel = iLevel + 1;
+        }
+    }
+    resMaterial.idStreamedTexture = stmTextures.AddTexture(actLevelBytes, iPinnedLevel);
+    aiStreamedMaterials.push_back(iMaterial);
+
+    // the image is created with all levels once, streaming only copies levels in and moves the view
+    resMaterial.iFirstLevel = stmTextures.GetResidentLevel(resMaterial.idStreamedTexture);
+    resMaterial.ctMipLevels = ktxTexture.GetLevelCount();
+    CreateTextureImageFromFile(ktxTexture, resMaterial.iFirstLevel, resMaterial.vkhImage, resMaterial.vkhImageMemory);
+}
+
+
+// Record copying the level above a streamed texture's first level from the staging ring into its image.
+void GfxAPIVulkan::UploadStreamedLevel(MaterialResources &resMaterial, VkDeviceSize iStagingOffset) {
+    const KtxFile &ktxTexture = *resMaterial.ktxTexture;
+    const uint32_t iLevel = resMaterial.iFirstLevel - 1;
+    VkCommandBuffer vkhCommandBuffer = GetFrameUploadCommandBuffer();
+
+    // nothing samples the level, as it is outside of the view, so its old contents are dropped
+    VkImageMemoryBarrier infoBarrier = {};
+    infoBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.image = resMaterial.vkhImage;
+    infoBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoBarrier.subresourceRange.baseMipLevel = iLevel;
+    infoBarrier.subresourceRange.levelCount = 1;
+    infoBarrier.subresourceRange.layerCount = 1;
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoBarrier.srcAccessMask = 0;
+    infoBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+
+    VkBufferImageCopy infoRegion = {};
+    infoRegion.bufferOffset = iStagingOffset;
+    infoRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoRegion.imageSubresource.mipLevel = iLevel;
+    infoRegion.imageSubresource.layerCount = 1;
+    infoRegion.imageExtent = { std::max(ktxTexture.GetWidth() >> iLevel, 1u), std::max(ktxTexture.GetHeight() >> iLevel, 1u), 1 };
+    vkCmdCopyBufferToImage(vkhCommandBuffer, vkhStagingRingBuffer, resMaterial.vkhImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &infoRegion);
+
+    // prepare the level for reading from shaders, the frame's drawing commands come after the uploads
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    infoBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    infoBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+
+    aiFrameUploadStaging.push_back(iStagingOffset);
+    SetStreamedTextureFirstLevel(resMaterial, iLevel);
+}
+
+
+// Point the view of a streamed texture at another first level.
+void GfxAPIVulkan::SetStreamedTextureFirstLevel(MaterialResources &resMaterial, uint32_t iFirstLevel) {
+    // the previous frame is done with the old view, the device is idle between frames
+    vkDestroyImageView(vkhLogicalDevice, resMaterial.vkhImageView, nullptr);
+    resMaterial.iFirstLevel = iFirstLevel;
+    resMaterial.vkhImageView = CreateImageView(resMaterial.vkhImage, resMaterial.fmtFormat, VK_IMAGE_ASPECT_COLOR_BIT, resMaterial.ctMipLevels - iFirstLevel, iFirstLevel,
+        VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+}
+
+
+// Start copying the level above a streamed texture's first level from its file to the staging ring in the background.
+bool GfxAPIVulkan::StartTextureLevelLoad(uint32_t idTexture) {
+    const uint32_t iMaterial = aiStreamedMaterials[idTexture];
+    const MaterialResources &resMaterial = aresMaterials[iMaterial];
+    uint64_t ctLevelBytes;
+    const uint8_t *pbLevel = resMaterial.ktxTexture->GetLevel(resMaterial.iFirstLevel - 1, ctLevelBytes);
+
+    TextureLevelLoad loadLevel;
+    loadLevel.iMaterial = iMaterial;
+    if (!AllocateStaging(ctLevelBytes, loadLevel.iStagingOffset)) {
+        return false;
+    }
+    char *pchStaging = pchStagingRingMemory + loadLevel.iStagingOffset;
+    loadLevel.futCopied = ThreadPool::Get().Submit([pchStaging, pbLevel, ctLevelBytes]() {
+        memcpy(pchStaging, pbLevel, static_cast<size_t>(ctLevelBytes));
+    });
+    aloadTextureLevels.push_back(std::move(loadLevel));
+    return true;
+}
+
+
+// Add the virtual texture of a material, its tiles are loaded into the tile cache when they are sampled.
+void GfxAPIVulkan::CreateVirtualTexture(const std::string &strTextureFilename, uint32_t iMaterial) {
+    MaterialResources &resMaterial = aresMaterials[iMaterial];
+
+    // the file stays mapped while the texture exists, tiles are read from it as they are needed
+    resMaterial.vtfTexture = std::make_shared<VirtualTextureFile>();
+    resMaterial.vtfTexture->Open(strTextureFilename);
+    resMaterial.fmtFormat = static_cast<VkFormat>(resMaterial.vtfTexture->GetFormat());
+    resMaterial.idVirtualTexture = vtcVirtualTextures.AddTexture(resMaterial.vtfTexture->GetWidth(), resMaterial.vtfTexture->GetHeight());
+    aiVirtualMaterials.push_back(iMaterial);
+}
+
+
+// Create the tile cache, the page table and the feedback buffer of virtual textures, and load the coarsest tiles.
+void GfxAPIVulkan::CreateVirtualTextureCache() {
+    // the cache holds as many whole slots as fit the size from the options and the device's limit, a single one when
+    // there are no virtual textures; page table entries hold the slot's coordinates in 8 bits each
+    uint32_t ctSlots = 1;
+    if (!aiVirtualMaterials.empty()) {
+        VkPhysicalDeviceProperties propsDevice;
+        vkGetPhysicalDeviceProperties(vkhPhysicalDevice, &propsDevice);
+        const uint32_t dimCacheSize = std::min(Options::Get().GetVirtualTextureCacheSize(), propsDevice.limits.maxImageDimension2D);
+        ctSlots = std::min(std::max(dimCacheSize / CT_VIRTUAL_TILE_STRIDE, 1u), 256u);
+    }
+    vtcVirtualTextures.Initialize(ctSlots, ctSlots);
+
+    // all virtual textures are imported in the format for images with transparency
+    fmtTileCache = fmtTranslucentTexture;
+    const uint32_t dimCache = ctSlots * CT_VIRTUAL_TILE_STRIDE;
+    CreateImage(dimCache, dimCache, 1, fmtTileCache, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhTileCacheImage, vkhTileCacheMemory);
+    // a slot is only sampled once a tile is copied into it, until then its contents don't matter
+    TransitionImageLayout(vkhTileCacheImage, fmtTileCache, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+    TransitionImageLayout(vkhTileCacheImage, fmtTileCache, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+    vkhTileCacheView = CreateImageView(vkhTileCacheImage, fmtTileCache, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+    // the page table and the feedback change every frame, they stay in host memory
+    const uint32_t ctEntries = std::max(vtcVirtualTextures.GetPageEntryCount(), 1u);
+    CreateBuffer(ctEntries * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        vkhPageTableBuffer, vkhPageTableMemory);
+    ctFeedbackBytes = (ctEntries + 31) / 32 * sizeof(uint32_t);
+    CreateBuffer(ctFeedbackBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        vkhFeedbackBuffer, vkhFeedbackMemory);
+    void *pMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhFeedbackMemory, 0, ctFeedbackBytes, 0, &pMappedMemory);
+    memset(pMappedMemory, 0, static_cast<size_t>(ctFeedbackBytes));
+    vkUnmapMemory(vkhLogicalDevice, vkhFeedbackMemory);
+
+    // the coarsest tiles are loaded right away, so every virtual texture can be sampled from the first frame; as many
+    // as the staging ring has room for go at a time, it holds no other loads here
+    std::vector<VirtualTextureCache::TileLoad> aloadPinned;
+    vtcVirtualTextures.Update(nullptr, aloadPinned);
+    for (size_t iPinned = 0; iPinned < aloadPinned.size();) {
+        while (iPinned < aloadPinned.size() && StartVirtualTileLoad(aloadPinned[iPinned])) {
+            iPinned++;
+        }
+        if (aloadVirtualTiles.empty()) {
+            throw std::runtime_error("No room in the staging ring for the virtual texture tiles");
+        }
+        for (VirtualTileLoad &loadTile : aloadVirtualTiles) {
+            loadTile.futCopied.get();
+        }
+        CopyTilesToCache(aloadVirtualTiles);
+        FlushFrameUploads();
+    }
+    UpdatePageTableBuffer();
+}
+
+
+// Start copying a tile from its file to the staging ring in the background.
+bool GfxAPIVulkan::StartVirtualTileLoad(const VirtualTextureCache::TileLoad &loadTile) {
+    const VirtualTextureFile &vtfTexture = *aresMaterials[aiVirtualMaterials[loadTile.idTexture]].vtfTexture;
+    const uint8_t *pbTile = vtfTexture.GetTile(loadTile.iTile);
+    const VkDeviceSize ctTileBytes = vtfTexture.GetTileBytes();
+
+    VirtualTileLoad loadVirtualTile;
+    loadVirtualTile.loadTile = loadTile;
+    if (!AllocateStaging(ctTileBytes, loadVirtualTile.iStagingOffset)) {
+        return false;
+    }
+    char *pchStaging = pchStagingRingMemory + loadVirtualTile.iStagingOffset;
+    loadVirtualTile.futCopied = ThreadPool::Get().Submit([pchStaging, pbTile, ctTileBytes]() {
+        memcpy(pchStaging, pbTile, static_cast<size_t>(ctTileBytes));
+    });
+    aloadVirtualTiles.push_back(std::move(loadVirtualTile));
+    return true;
+}
+
+
+// Copy the tiles from the staging ring to their slots in the tile cache.
+void GfxAPIVulkan::CopyTilesToCache(std::vector<VirtualTileLoad> &aloadTiles) {
+    if (aloadTiles.empty()) {
+        return;
+    }
+    VkCommandBuffer vkhCommandBuffer = GetFrameUploadCommandBuffer();
+
+    // only the slots are written, the tiles in the rest of the cache are kept
+    VkImageMemoryBarrier infoBarrier = {};
+    infoBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    infoBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    infoBarrier.image = vkhTileCacheImage;
+    infoBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    infoBarrier.subresourceRange.levelCount = 1;
+    infoBarrier.subresourceRange.layerCount = 1;
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    infoBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+
+    // slots are numbered row by row, their offsets are multiples of the block size as the stride is
+    const uint32_t ctSlotsX = vtcVirtualTextures.GetSlotCountX();
+    for (VirtualTileLoad &loadTile : aloadTiles) {
+        VkBufferImageCopy infoRegion = {};
+        infoRegion.bufferOffset = loadTile.iStagingOffset;
+        infoRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        infoRegion.imageSubresource.layerCount = 1;
+        infoRegion.imageOffset = { static_cast<int32_t>(loadTile.loadTile.iSlot % ctSlotsX * CT_VIRTUAL_TILE_STRIDE), static_cast<int32_t>(loadTile.loadTile.iSlot / ctSlotsX * CT_VIRTUAL_TILE_STRIDE), 0 };
+        infoRegion.imageExtent = { CT_VIRTUAL_TILE_STRIDE, CT_VIRTUAL_TILE_STRIDE, 1 };
+        vkCmdCopyBufferToImage(vkhCommandBuffer, vkhStagingRingBuffer, vkhTileCacheImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &infoRegion);
+    }
+
+    // prepare the cache for reading from shaders again
+    infoBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    infoBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    infoBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    infoBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &infoBarrier);
+
+    // the page table can point to the tiles now, their room in the staging ring is freed with the frame
+    for (VirtualTileLoad &loadTile : aloadTiles) {
+        aiFrameUploadStaging.push_back(loadTile.iStagingOffset);
+        vtcVirtualTextures.FinishLoad(loadTile.loadTile);
+    }
+    aloadTiles.clear();
+}
+
+
+// Upload the page table to its buffer, if it changed.
+void GfxAPIVulkan::UpdatePageTableBuffer() {
+    if (!vtcVirtualTextures.IsPageTableChanged()) {
+        return;
+    }
+    const std::vector<uint32_t> &aiPageTable = vtcVirtualTextures.TakePageTable();
+    if (aiPageTable.empty()) {
+        return;
+    }
+    const VkDeviceSize ctBufferSize = aiPageTable.size() * sizeof(uint32_t);
+    void *pMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhPageTableMemory, 0, ctBufferSize, 0, &pMappedMemory);
+    memcpy(pMappedMemory, aiPageTable.data(), static_cast<size_t>(ctBufferSize));
+    vkUnmapMemory(vkhLogicalDevice, vkhPageTableMemory);
+}
+
+
+// Destroy the tile cache and the buffers of virtual textures.
+void GfxAPIVulkan::DestroyVirtualTextureCache() {
+    // run the uploads already recorded for the frame, they write to the cache, and wait for the tiles still being
+    // copied, they read from the files of the materials
+    FlushFrameUploads();
+    for (VirtualTileLoad &loadTile : aloadVirtualTiles) {
+        loadTile.futCopied.wait();
+        srStaging.Free(loadTile.iStagingOffset);
+    }
+    aloadVirtualTiles.clear();
+    aloadWaitingVirtualTiles.clear();
+    aiVirtualMaterials.clear();
+    vtcVirtualTextures.Clear();
+
+    vkDestroyImageView(vkhLogicalDevice, vkhTileCacheView, nullptr);
+    vkDestroyImage(vkhLogicalDevice, vkhTileCacheImage, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhTileCacheMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhPageTableBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhPageTableMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhFeedbackBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhFeedbackMemory, nullptr);
+}
+
+
+// Set up the model's materials with the default texture, and request their textures.
+void GfxAPIVulkan::CreateMaterials() {
+    // texture paths are relative to the mesh file
+    const std::string strDirectory = FileSystem::GetDirectory(STR_MODEL_MESH_FILENAME);
+    aresMaterials.assign(amatMaterials.size(), MaterialResources());
+    stmTextures.SetBudget(Options::Get().GetTextureStreamingBudget());
+    // until their textures are ready, all materials share the first one's default texture
+    for (MaterialResources &resMaterial : aresMaterials) {
+        resMaterial.iTextureOwner = 0;
+    }
+
+    // each image is imported once, however many materials use it
+    std::map<std::string, std::shared_ptr<TextureImport>> mapImports;
+    for (size_t iMaterial = 0; iMaterial < amatMaterials.size(); iMaterial++) {
+        const MeshMaterial &matMaterial = amatMaterials[iMaterial];
+        if (matMaterial.strDiffuseTexture[0] == 0) {
+            continue;
+        }
+
+        // a missing texture isn't fatal, the material falls back to the default one
+        const std::string strTexture = strDirectory + matMaterial.strDiffuseTexture;
+        if (!FileSystem::FileExists(strTexture)) {
+            std::cerr << "Texture of material " << matMaterial.strName << " not found, using the default: " << strTexture << std::endl;
+            continue;
+        }
+        std::shared_ptr<TextureImport> &impTexture = mapImports[strTexture];
+        if (!impTexture) {
+            impTexture = std::make_shared<TextureImport>();
+            impTexture->upUpload.strFilename = strTexture;
+            impTexture->bVirtual = false;
+            aimpTextureImports.push_back(impTexture);
+        }
+        impTexture->aiMaterials.push_back(static_cast<uint32_t>(iMaterial));
+    }
+
+    // images from the virtual texture size up are split into tiles, only the tiles that are seen are ever loaded
+    const uint32_t dimVirtualMinSize = bUseTextureFiles ? Options::Get().GetVirtualTextureMinSize() : 0;
+    // all virtual textures share the tile cache, whose format must fit images with transparency
+    const enum TextureFormat fmtVirtual = static_cast<enum TextureFormat>(fmtTranslucentTexture);
+    std::vector<AssetHandle> ahTextures;
+    for (const std::shared_ptr<TextureImport> &impTexture : aimpTextureImports) {
+        // images that aren't imported into texture files are decoded when their textures are created
+        AssetManager::AssetLoader ldrTexture;
+        if (bUseTextureFiles) {
+            // the import outlives its load, DestroyMaterials waits for the loads before throwing the imports away
+            TextureImport *pimpTexture = impTexture.get();
+            ldrTexture.fnLoad = [this, pimpTexture, dimVirtualMinSize, fmtVirtual]() {
+                TextureUpload &upUpload = pimpTexture->upUpload;
+                if (dimVirtualMinSize > 0) {
+                    ImageDecoder::GetImageSize(upUpload.strFilename, upUpload.dimWidth, upUpload.dimHeight);
+                }
+                pimpTexture->bVirtual = dimVirtualMinSize > 0 && std::max(upUpload.dimWidth, upUpload.dimHeight) >= dimVirtualMinSize;
+                if (pimpTexture->bVirtual) {
+                    TextureImporter::ImportVirtualTextureIfOutOfDate(upUpload.strFilename, upUpload.strFilename + STR_VIRTUAL_TEXTURE_FILE_EXTENSION, fmtVirtual);
+                } else {
+                    ImportTextureFile(upUpload.strFilename);
+                }
             };
-            // use constant color, white
-            vVertex.colColor = { 1.0f, 1.0f, 1.0f };
+        }
+        impTexture->hTexture = amAssets.Request(impTexture->upUpload.strFilename, {}, ldrTexture);
+        ahTextures.push_back(impTexture->hTexture);
+    }
+
+    // the textures are created together, so packing and the tile cache see all of them
+    AssetManager::AssetLoader ldrMaterials;
+    ldrMaterials.fnFinish = [this]() { FinishMaterialTextures(); };
+    ldrMaterials.fnFree = [this]() { DestroyMaterialTextures(); };
+    hMaterialTextures = amAssets.Request(STR_MODEL_MESH_ASSET + std::string(" textures"), ahTextures, ldrMaterials);
+}
+
+
+// Create the textures of the model's materials from their imported images.
+void GfxAPIVulkan::FinishMaterialTextures() {
+    // gather the textures by material, images whose import failed leave their materials with the default texture
+    std::vector<uint32_t> aiTexturedMaterials;
+    std::vector<TextureUpload> aupUploads;
+    std::vector<bool> abVirtual;
+    for (const std::shared_ptr<TextureImport> &impTexture : aimpTextureImports) {
+        if (!amAssets.IsReady(impTexture->hTexture)) {
+            continue;
+        }
+        for (uint32_t iMaterial : impTexture->aiMaterials) {
+            aiTexturedMaterials.push_back(iMaterial);
+            aupUploads.push_back(impTexture->upUpload);
+            abVirtual.push_back(impTexture->bVirtual);
+        }
+    }
+    // a reload replaces the textures made by the previous finish; the tile cache goes first, as the tiles still being
+    // copied into it read from the files of the textures, and it is created again for the virtual textures
+    DestroyVirtualTextureCache();
+    DestroyMaterialTextures();
+    for (uint32_t iMaterial = 0; iMaterial < aresMaterials.size(); iMaterial++) {
+        aresMaterials[iMaterial].iTextureOwner = iMaterial;
+    }
+    if (!bUseTextureFiles) {
+        DecodeTextureImages(aupUploads);
+    }
+
+    // small textures are packed into arrays, they are always resident as a whole and not streamed
+    std::vector<bool> abPacked(aiTexturedMaterials.size(), false);
+    if (bUseTextureFiles && Options::Get().GetTextureArrayMaxSize() > 0) {
+        std::vector<uint32_t> aiPackableTextures;
+        std::vector<uint32_t> aiPackableMaterials;
+        std::vector<std::string> astrTextureFilenames;
+        for (uint32_t iTexture = 0; iTexture < aupUploads.size(); iTexture++) {
+            if (!abVirtual[iTexture]) {
+                aiPackableTextures.push_back(iTexture);
+                aiPackableMaterials.push_back(aiTexturedMaterials[iTexture]);
+                astrTextureFilenames.push_back(aupUploads[iTexture].strFilename + STR_TEXTURE_FILE_EXTENSION);
+            }
+        }
+        std::vector<bool> abPackableTexturesPacked(aiPackableTextures.size(), false);
+        PackMaterialTextures(aiPackableMaterials, astrTextureFilenames, abPackableTexturesPacked);
+        for (size_t iPackable = 0; iPackable < aiPackableTextures.size(); iPackable++) {
+            abPacked[aiPackableTextures[iPackable]] = abPackableTexturesPacked[iPackable];
+        }
+    }
+
+    for (size_t iTexture = 0; iTexture < aiTexturedMaterials.size(); iTexture++) {
+        const std::string &strTexture = aupUploads[iTexture].strFilename;
+        MaterialResources &resMaterial = aresMaterials[aiTexturedMaterials[iTexture]];
+        if (abPacked[iTexture]) {
+            continue;
+        }
+        // virtual textures have no image of their own, they are sampled from the tile cache
+        if (abVirtual[iTexture]) {
+            CreateVirtualTexture(strTexture + STR_VIRTUAL_TEXTURE_FILE_EXTENSION, aiTexturedMaterials[iTexture]);
+            continue;
+        }
+        if (Options::Get().ShouldStreamTextures()) {
+            CreateStreamedTexture(strTexture + STR_TEXTURE_FILE_EXTENSION, aiTexturedMaterials[iTexture]);
+        } else if (bUseTextureFiles) {
+            CreateCompressedTextureImage(strTexture + STR_TEXTURE_FILE_EXTENSION, resMaterial.vkhImage, resMaterial.vkhImageMemory, resMaterial.ctMipLevels, resMaterial.fmtFormat);
+        } else {
+            CreateTextureImageFromUpload(aupUploads[iTexture], resMaterial.vkhImage, resMaterial.vkhImageMemory, resMaterial.ctMipLevels, resMaterial.fmtFormat);
+        }
+        // streamed textures are viewed from their first resident level, the others from their first level
+        resMaterial.vkhImageView = CreateImageView(resMaterial.vkhImage, resMaterial.fmtFormat, VK_IMAGE_ASPECT_COLOR_BIT, resMaterial.ctMipLevels - resMaterial.iFirstLevel,
+            resMaterial.iFirstLevel, VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+    }
+
+    // the materials that use the default texture, or a virtual one, all share the first one's descriptor set
+    uint32_t iDefaultOwner = UINT32_MAX;
+    for (uint32_t iMaterial = 0; iMaterial < aresMaterials.size(); iMaterial++) {
+        MaterialResources &resMaterial = aresMaterials[iMaterial];
+        if (resMaterial.vkhImage == VK_NULL_HANDLE && resMaterial.iTextureOwner == iMaterial) {
+            iDefaultOwner = std::min(iDefaultOwner, iMaterial);
+            resMaterial.iTextureOwner = iDefaultOwner;
+        }
+    }
+
+    // the textures are bound in place of the default one, and the sampler covers their levels; materials whose
+    // textures became virtual draw with the ubershader until their specialized pipelines are compiled
+    CreateVirtualTextureCache();
+    vkDestroySampler(vkhLogicalDevice, vkhImageSampler, nullptr);
+    CreateImageSampler();
+    UpdateMaterialDescriptorSets();
+    RequestMaterialPipelines();
+    RecordCommandBuffers();
+}
+
+
+// Pack the small textures of materials into texture arrays, the owner of each array is the material in its first layer.
+void GfxAPIVulkan::PackMaterialTextures(const std::vector<uint32_t> &aiMaterials, const std::vector<std::string> &astrTextureFilenames, std::vector<bool> &abPacked) {
+    // the layouts come from the headers of the texture files, the files stay mapped until the arrays are uploaded
+    std::vector<KtxFile> aktxTextures(astrTextureFilenames.size());
+    std::vector<TextureArrayPacker::TextureLayout> alayTextures(astrTextureFilenames.size());
+    for (size_t iTexture = 0; iTexture < astrTextureFilenames.size(); iTexture++) {
+        KtxFile &ktxTexture = aktxTextures[iTexture];
+        ktxTexture.Open(astrTextureFilenames[iTexture]);
+        alayTextures[iTexture] = { ktxTexture.GetFormat(), ktxTexture.GetWidth(), ktxTexture.GetHeight(), ktxTexture.GetLevelCount() };
+    }
+
+    VkPhysicalDeviceProperties propsDevice;
+    vkGetPhysicalDeviceProperties(vkhPhysicalDevice, &propsDevice);
+    std::vector<TextureArrayPacker::TexturePlacement> aplcPlacements;
+    const uint32_t ctArrays = TextureArrayPacker::Pack(alayTextures, Options::Get().GetTextureArrayMaxSize(), propsDevice.limits.maxImageArrayLayers, aplcPlacements);
+
+    // gather the textures of each array, in the order of their layers
+    std::vector<std::vector<uint32_t>> aaiArrayTextures(ctArrays);
+    for (uint32_t iTexture = 0; iTexture < aplcPlacements.size(); iTexture++) {
+        if (aplcPlacements[iTexture].iArray != ID_TEXTURE_NOT_PACKED) {
+            aaiArrayTextures[aplcPlacements[iTexture].iArray].push_back(iTexture);
+            abPacked[iTexture] = true;
+        }
+    }
 
-            // store vertex and its index
-            avVertices.push_back(vVertex);
-            aiIndices.push_back(static_cast<uint32_t>(aiIndices.size()));
+    for (const std::vector<uint32_t> &aiTextures : aaiArrayTextures) {
+        std::vector<const KtxFile *> aktxLayers;
+        for (uint32_t iTexture : aiTextures) {
+            aktxLayers.push_back(&aktxTextures[iTexture]);
+            MaterialResources &resMaterial = aresMaterials[aiMaterials[iTexture]];
+            resMaterial.iTextureOwner = aiMaterials[aiTextures[0]];
+            resMaterial.iTextureLayer = aplcPlacements[iTexture].iLayer;
         }
+
+        MaterialResources &resOwner = aresMaterials[aiMaterials[aiTextures[0]]];
+        resOwner.fmtFormat = static_cast<VkFormat>(aktxLayers[0]->GetFormat());
+        resOwner.ctMipLevels = aktxLayers[0]->GetLevelCount();
+        CreateTextureArrayFromFiles(aktxLayers, 0, resOwner.vkhImage, resOwner.vkhImageMemory);
+        resOwner.vkhImageView = CreateImageView(resOwner.vkhImage, resOwner.fmtFormat, VK_IMAGE_ASPECT_COLOR_BIT, resOwner.ctMipLevels, 0, VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+            static_cast<uint32_t>(aktxLayers.size()));
+    }
+}
+
+
+// Destroy the textures of the model's materials.
+void GfxAPIVulkan::DestroyMaterialTextures() {
+    // run the uploads already recorded for the frame, they write to the textures, and wait for the levels still being
+    // copied, their room in the staging ring goes away with the textures
+    FlushFrameUploads();
+    for (TextureLevelLoad &loadLevel : aloadTextureLevels) {
+        loadLevel.futCopied.wait();
+        srStaging.Free(loadLevel.iStagingOffset);
+    }
+    aloadTextureLevels.clear();
+    aidWaitingTextureLevels.clear();
+    aiStreamedMaterials.clear();
+    stmTextures.Clear();
+
+    // descriptor sets go away with the pool, only the materials' own textures are destroyed
+    for (MaterialResources &resMaterial : aresMaterials) {
+        if (resMaterial.vkhImage == VK_NULL_HANDLE) {
+            continue;
+        }
+        vkDestroyImageView(vkhLogicalDevice, resMaterial.vkhImageView, nullptr);
+        vkDestroyImage(vkhLogicalDevice, resMaterial.vkhImage, nullptr);
+        vkFreeMemory(vkhLogicalDevice, resMaterial.vkhImageMemory, nullptr);
+    }
+
+    // the materials go back to sharing the default texture
+    aresMaterials.assign(aresMaterials.size(), MaterialResources());
+    for (MaterialResources &resMaterial : aresMaterials) {
+        resMaterial.iTextureOwner = 0;
     }
 }
 
 
+// Destroy the model's materials and their textures.
+void GfxAPIVulkan::DestroyMaterials() {
+    // the textures are freed with the asset that created them, once the imports still in progress are done; the
+    // imports are only thrown away after that, as their loads write to them
+    hMaterialTextures.Release();
+    for (const std::shared_ptr<TextureImport> &impTexture : aimpTextureImports) {
+        impTexture->hTexture.Release();
+    }
+    amAssets.Clear();
+    aimpTextureImports.clear();
+    aresMaterials.clear();
+    avkhMaterialDescriptorSets.clear();
+    aidMaterialPipelines.clear();
+    aidMaterialFallbackPipelines.clear();
+}
+
+
 // Create vertex buffers.
 void GfxAPIVulkan::CreateVertexBuffers() {
     // create the vertex buffer
@@ -1806,7 +4246,8 @@ void GfxAPIVulkan::CreateIndexBuffers() {
     vkUnmapMemory(vkhLogicalDevice, vkhStagingMemory);
 
     // create the index buffer - it is located in device memory and is a memory transfer destination
-    CreateBuffer(ctBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhIndexBuffer, vkhIndexBufferMemory);
+    // the meshlet culling pass reads it as a storage buffer
+    CreateBuffer(ctBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhIndexBuffer, vkhIndexBufferMemory);
 
     // copy staging buffer contents to the index buffer
     CopyBuffer(vkhStagingBuffer, vkhIndexBuffer, ctBufferSize);
@@ -1817,27 +4258,37 @@ void GfxAPIVulkan::CreateIndexBuffers() {
     vkFreeMemory(vkhLogicalDevice, vkhStagingMemory, nullptr);
 }
 
-// Create uniform buffer.
+// Create the frame's uniform buffer and the object buffer.
 void GfxAPIVulkan::CreateUniformBuffers() {
     // get the uniform buffer size
-    VkDeviceSize ctBufferSize = sizeof(UniformBufferObject);
+    VkDeviceSize ctBufferSize = sizeof(FrameUniformBufferObject);
     // create the uniform buffer
     CreateBuffer(ctBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhUniformBuffer, vkhUniformBufferMemory);
+    // the object buffer is written by the CPU each frame too, the vertex shader reads it by the object of the draw
+    CreateBuffer(sizeof(glm::mat4) * CT_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        vkhObjectBuffer, vkhObjectBufferMemory);
 }
 
 
 // create the descriptor pool
 void GfxAPIVulkan::CreateDescriptorPool() {
     // describe the descriptors that go into this pool
-    std::array<VkDescriptorPoolSize, 2> ainfoPoolSizes = {};
+    std::array<VkDescriptorPoolSize, 3> ainfoPoolSizes = {};
     // the first one is the pool for uniform buffer descriptors
     ainfoPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    // it can allocate one descriptor
-    ainfoPoolSizes[0].descriptorCount = 1;
+    // it can allocate one descriptor for each material set and one for meshlet culling; bound bindless, all materials
+    // share a single set
+    const uint32_t ctMaterialSets = bBindlessTextures ? 1 : static_cast<uint32_t>(aresMaterials.size());
+    ainfoPoolSizes[0].descriptorCount = ctMaterialSets + 1;
     // the second one is the pool of image samplers
     ainfoPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    // it can allocate one descriptor
-    ainfoPoolSizes[1].descriptorCount = 1;
+    // it can allocate the texture and the tile cache for each material set, or the whole texture array
+    ainfoPoolSizes[1].descriptorCount = bBindlessTextures ? CT_BINDLESS_TEXTURES + 1 : 2 * ctMaterialSets;
+    // the third one is the pool of storage buffers used by meshlet culling, virtual texturing and the object transforms
+    ainfoPoolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    // meshlets, source indices, culled indices and the draw command, and the page table, the feedback and the objects of
+    // each material set
+    ainfoPoolSizes[2].descriptorCount = 4 + 3 * ctMaterialSets;
 
     // describe the descriptor pool
     VkDescriptorPoolCreateInfo infoDescriptorPool = {};
@@ -1845,8 +4296,14 @@ void GfxAPIVulkan::CreateDescriptorPool() {
     // this descriptor pool has one pool size info
     infoDescriptorPool.poolSizeCount = static_cast<uint32_t>(ainfoPoolSizes.size());
     infoDescriptorPool.pPoolSizes = ainfoPoolSizes.data();
-    // maximuma of one descriptor sets will be allocated
-    infoDescriptorPool.maxSets = 1;
+    // one descriptor set for each material set and one for meshlet culling
+    infoDescriptorPool.maxSets = ctMaterialSets + 1;
+    // the bindless set is updated while it is bound, which its pool must allow
+#ifdef VK_EXT_descriptor_indexing
+    if (bBindlessTextures) {
+        infoDescriptorPool.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    }
+#endif
 
     // create the descriptor pool
     if (vkCreateDescriptorPool(vkhLogicalDevice, &infoDescriptorPool, nullptr, &vkhDescriptorPool) != VK_SUCCESS) {
@@ -1855,23 +4312,28 @@ void GfxAPIVulkan::CreateDescriptorPool() {
 }
 
 
-// Create the descriptor set.
-void GfxAPIVulkan::CreateDescriptorSet() {
-    // prepare the layouts for binding
-    VkDescriptorSetLayout avkhLayouts[] = { vkhDescriptorSetLayout };
+// Create the descriptor sets, one for each material, or one for all of them.
+void GfxAPIVulkan::CreateDescriptorSets() {
+    // every material gets a set, as which materials own a texture changes when the textures are loaded; bound bindless,
+    // all materials share one set, and each texture owner's texture is the element of the array at the owner's index
+    if (bBindlessTextures && aresMaterials.size() > CT_BINDLESS_TEXTURES) {
+        throw std::runtime_error("The model has more materials than the bindless texture array holds");
+    }
+    std::vector<VkDescriptorSetLayout> avkhLayouts(bBindlessTextures ? 1 : aresMaterials.size(), vkhDescriptorSetLayout);
 
     //describe the descriptor set allocation
     VkDescriptorSetAllocateInfo infoDescriptorSetAllocation = {};
     infoDescriptorSetAllocation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     // bind the set layout
-    infoDescriptorSetAllocation.descriptorSetCount = 1;
-    infoDescriptorSetAllocation.pSetLayouts = avkhLayouts;
+    infoDescriptorSetAllocation.descriptorSetCount = static_cast<uint32_t>(avkhLayouts.size());
+    infoDescriptorSetAllocation.pSetLayouts = avkhLayouts.data();
     // bind the descriptor pool
     infoDescriptorSetAllocation.descriptorPool = vkhDescriptorPool;
 
-    // create the descriptor set
-    if (vkAllocateDescriptorSets(vkhLogicalDevice, &infoDescriptorSetAllocation, &vkhDescriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("Unable to allocate the descriptor set");
+    // create the descriptor sets
+    avkhMaterialDescriptorSets.resize(avkhLayouts.size());
+    if (vkAllocateDescriptorSets(vkhLogicalDevice, &infoDescriptorSetAllocation, avkhMaterialDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to allocate the descriptor sets");
     }
 
     // use a descriptor to describe the uniform buffer
@@ -1881,54 +4343,346 @@ void GfxAPIVulkan::CreateDescriptorSet() {
     // start at the beggining
     infoUniformBuffer.offset = 0;
     // size is equal to the buffer object's
-    infoUniformBuffer.range = sizeof(UniformBufferObject);
-
-    // a descriptor for the image sampler
-    VkDescriptorImageInfo infoImage = {};
-    // set the image layout to optimal for reading from a fragment shader
-    infoImage.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    // set the image view and sampler
-    infoImage.imageView = vkhImageView;
-    infoImage.sampler = vkhImageSampler;
-
-    // describe how to update the descriptor sets
-    std::array<VkWriteDescriptorSet, 2> ainfoUpdateDescriptorSets = {};
-
-    // describe the set for the uniform buffer
-    ainfoUpdateDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    // mark the set to update
-    ainfoUpdateDescriptorSets[0].dstSet = vkhDescriptorSet;
-    // set the shader binding for the uniform
-    ainfoUpdateDescriptorSets[0].dstBinding = 0;
-    // the descriptor doesn't describe an array
-    ainfoUpdateDescriptorSets[0].dstArrayElement = 0;
-    // this descriptor describes an uniform buffer
-    ainfoUpdateDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    // it holds one descriptor
-    ainfoUpdateDescriptorSets[0].descriptorCount = 1;
-    // bind the buffer info
-    ainfoUpdateDescriptorSets[0].pBufferInfo = &infoUniformBuffer;
-
-    // describe the set for the image sampler
-    ainfoUpdateDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    // mark the set to update
-    ainfoUpdateDescriptorSets[1].dstSet = vkhDescriptorSet;
-    // set the shader binding for the sampler
-    ainfoUpdateDescriptorSets[1].dstBinding = 1;
-    // the descriptor doesn't describe an array
-    ainfoUpdateDescriptorSets[1].dstArrayElement = 0;
-    // this descriptor describes a texture sampler
-    ainfoUpdateDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    // it holds one descriptor
-    ainfoUpdateDescriptorSets[1].descriptorCount = 1;
-    // bind the sampler
-    ainfoUpdateDescriptorSets[1].pImageInfo = &infoImage;
+    infoUniformBuffer.range = sizeof(FrameUniformBufferObject);
+    // and the object buffer, whole
+    VkDescriptorBufferInfo infoObjectBuffer = { vkhObjectBuffer, 0, VK_WHOLE_SIZE };
+
+    for (VkDescriptorSet vkhDescriptorSet : avkhMaterialDescriptorSets) {
+        // describe the set for the uniform buffer
+        VkWriteDescriptorSet infoUpdateDescriptorSet = {};
+        infoUpdateDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        // mark the set to update
+        infoUpdateDescriptorSet.dstSet = vkhDescriptorSet;
+        // set the shader binding for the uniform
+        infoUpdateDescriptorSet.dstBinding = 0;
+        // the descriptor doesn't describe an array
+        infoUpdateDescriptorSet.dstArrayElement = 0;
+        // this descriptor describes an uniform buffer
+        infoUpdateDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        // it holds one descriptor
+        infoUpdateDescriptorSet.descriptorCount = 1;
+        // bind the buffer info
+        infoUpdateDescriptorSet.pBufferInfo = &infoUniformBuffer;
+        // the object buffer is described the same way
+        std::array<VkWriteDescriptorSet, 2> ainfoUpdates = { infoUpdateDescriptorSet, infoUpdateDescriptorSet };
+        ainfoUpdates[1].dstBinding = 5;
+        ainfoUpdates[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        ainfoUpdates[1].pBufferInfo = &infoObjectBuffer;
+
+        // apply updates to the descriptor
+        vkUpdateDescriptorSets(vkhLogicalDevice, static_cast<uint32_t>(ainfoUpdates.size()), ainfoUpdates.data(), 0, nullptr);
+    }
+
+    // bind the textures
+    UpdateMaterialDescriptorSets();
+}
+
+
+// Update the texture descriptors of the materials, after the textures or the sampler change.
+void GfxAPIVulkan::UpdateMaterialDescriptorSets(bool bTexturesOnly) {
+    // the page table and the feedback of virtual textures are whole buffers
+    VkDescriptorBufferInfo infoPageTableBuffer = { vkhPageTableBuffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo infoFeedbackBuffer = { vkhFeedbackBuffer, 0, VK_WHOLE_SIZE };
+    // the tile cache of virtual textures is read with the same sampler as the textures, only its first level exists
+    VkDescriptorImageInfo infoTileCache = { vkhImageSampler, vkhTileCacheView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+    // the updates of all sets are applied at once, the image descriptors they point to are kept until then
+    std::vector<VkDescriptorImageInfo> ainfoImages;
+    ainfoImages.reserve(aresMaterials.size());
+    std::vector<VkWriteDescriptorSet> ainfoUpdates;
+    for (uint32_t iMaterial = 0; iMaterial < aresMaterials.size(); iMaterial++) {
+        // the owner's set is shared with the materials that use its texture, the bindless set with all materials
+        MaterialResources &resMaterial = aresMaterials[iMaterial];
+        resMaterial.vkhDescriptorSet = avkhMaterialDescriptorSets[bBindlessTextures ? 0 : resMaterial.iTextureOwner];
+        if (resMaterial.iTextureOwner != iMaterial) {
+            continue;
+        }
+
+        // a descriptor for the image sampler
+        VkDescriptorImageInfo infoImage = {};
+        // set the image layout to optimal for reading from a fragment shader
+        infoImage.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // set the image view and sampler, materials without a texture of their own use the default one
+        infoImage.imageView = resMaterial.vkhImage != VK_NULL_HANDLE ? resMaterial.vkhImageView : vkhImageView;
+        infoImage.sampler = vkhImageSampler;
+        ainfoImages.push_back(infoImage);
+
+        // describe the set for the image sampler
+        VkWriteDescriptorSet infoUpdateDescriptorSet = {};
+        infoUpdateDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        // mark the set to update
+        infoUpdateDescriptorSet.dstSet = resMaterial.vkhDescriptorSet;
+        // set the shader binding for the sampler
+        infoUpdateDescriptorSet.dstBinding = 1;
+        // the owner's texture is the owner's element of the bindless array, the descriptor isn't an array otherwise
+        infoUpdateDescriptorSet.dstArrayElement = bBindlessTextures ? iMaterial : 0;
+        // this descriptor describes a texture sampler
+        infoUpdateDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        // it holds one descriptor
+        infoUpdateDescriptorSet.descriptorCount = 1;
+        // bind the sampler
+        infoUpdateDescriptorSet.pImageInfo = &ainfoImages.back();
+        ainfoUpdates.push_back(infoUpdateDescriptorSet);
+
+        // the virtual texture descriptors are in each set, but the bindless set needs them once; the storage buffers
+        // are described the same way, they are created again with the cache, never when only the textures change
+        if (bBindlessTextures && ainfoImages.size() > 1) {
+            continue;
+        }
+        infoUpdateDescriptorSet.dstArrayElement = 0;
+        infoUpdateDescriptorSet.dstBinding = 3;
+        infoUpdateDescriptorSet.pImageInfo = &infoTileCache;
+        ainfoUpdates.push_back(infoUpdateDescriptorSet);
+        if (bTexturesOnly) {
+            continue;
+        }
+        infoUpdateDescriptorSet.dstBinding = 2;
+        infoUpdateDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        infoUpdateDescriptorSet.pImageInfo = nullptr;
+        infoUpdateDescriptorSet.pBufferInfo = &infoPageTableBuffer;
+        ainfoUpdates.push_back(infoUpdateDescriptorSet);
+        infoUpdateDescriptorSet.dstBinding = 4;
+        infoUpdateDescriptorSet.pBufferInfo = &infoFeedbackBuffer;
+        ainfoUpdates.push_back(infoUpdateDescriptorSet);
+    }
+
+    // apply updates to the descriptors
+    vkUpdateDescriptorSets(vkhLogicalDevice, static_cast<uint32_t>(ainfoUpdates.size()), ainfoUpdates.data(), 0, nullptr);
+}
+
+
+// Set up culling of the model's meshlets on the GPU, if the model has meshlets and culling is enabled.
+void GfxAPIVulkan::InitializeMeshletCulling() {
+    // culling needs meshlets and the compiled culling shader, the model is drawn as a whole otherwise
+    if (!Options::Get().ShouldCullMeshlets() || ameshMeshlets.empty()) {
+        return;
+    }
+    if (!pkgAssets.HasAsset(STR_CULL_SHADER_ASSET)) {
+        std::cerr << "Meshlet culling disabled, " << STR_CULL_SHADER_ASSET << " is missing" << std::endl;
+        return;
+    }
+    bCullMeshlets = true;
+
+    // create the buffers, the compute pipeline and bind the buffers to it
+    CreateMeshletBuffers();
+    CreateCullDescriptorSetLayout();
+    CreateCullPipeline();
+    CreateCullDescriptorSet();
+}
+
+
+// Create the buffers the culling pass reads from and writes to.
+void GfxAPIVulkan::CreateMeshletBuffers() {
+    // the meshlets are uploaded once and only read by the culling shader
+    CreateBufferWithData(ameshMeshlets.data(), sizeof(Meshlet) * ameshMeshlets.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, vkhMeshletBuffer, vkhMeshletBufferMemory);
+
+    // the culled index buffer is written by the culling shader and read as an index buffer, all meshlets of the full
+    // resolution level can be visible
+    const VkDeviceSize ctIndexBufferSize = sizeof(aiIndices[0]) * alodLods[0].ctIndices;
+    CreateBuffer(ctIndexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhCulledIndexBuffer, vkhCulledIndexBufferMemory);
+
+    // each submesh has a draw command with a single instance and no indices, the index counts of the drawn level are
+    // reset and filled in each frame; the culled indices of a level are laid out the same way as its source indices
+    acmdEmptyDraws.assign(asubSubmeshes.size(), VkDrawIndexedIndirectCommand());
+    for (const MeshLod &lodLevel : alodLods) {
+        for (uint32_t iSubmesh = lodLevel.iFirstSubmesh; iSubmesh < lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes; iSubmesh++) {
+            acmdEmptyDraws[iSubmesh].instanceCount = 1;
+            acmdEmptyDraws[iSubmesh].firstInstance = ID_MODEL_OBJECT;
+            acmdEmptyDraws[iSubmesh].firstIndex = asubSubmeshes[iSubmesh].iFirstIndex - lodLevel.iFirstIndex;
+            acmdEmptyDraws[iSubmesh].vertexOffset = asubSubmeshes[iSubmesh].iVertexOffset;
+        }
+    }
+    CreateBufferWithData(acmdEmptyDraws.data(), sizeof(VkDrawIndexedIndirectCommand) * acmdEmptyDraws.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        vkhDrawCommandBuffer, vkhDrawCommandBufferMemory);
+
+    // culling parameters change every frame, so they are kept in host memory
+    CreateBuffer(sizeof(CullUniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhCullUniformBuffer, vkhCullUniformBufferMemory);
+}
+
+
+// Create the descriptor set layout for the culling pass.
+void GfxAPIVulkan::CreateCullDescriptorSetLayout() {
+    // the culling parameters, followed by the meshlets, source indices, culled indices and the draw command
+    std::array<VkDescriptorSetLayoutBinding, 5> ainfoBindings = {};
+    for (uint32_t iBinding = 0; iBinding < ainfoBindings.size(); iBinding++) {
+        ainfoBindings[iBinding].binding = iBinding;
+        ainfoBindings[iBinding].descriptorType = iBinding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        ainfoBindings[iBinding].descriptorCount = 1;
+        ainfoBindings[iBinding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    // describe the descriptor set layout
+    VkDescriptorSetLayoutCreateInfo infoDescriptorSetLayout = {};
+    infoDescriptorSetLayout.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    infoDescriptorSetLayout.bindingCount = static_cast<uint32_t>(ainfoBindings.size());
+    infoDescriptorSetLayout.pBindings = ainfoBindings.data();
+
+    // create the layout
+    if (vkCreateDescriptorSetLayout(vkhLogicalDevice, &infoDescriptorSetLayout, nullptr, &vkhCullDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to create the culling descriptor set layout");
+    }
+}
+
+
+// Create the compute pipeline that culls meshlets.
+void GfxAPIVulkan::CreateCullPipeline() {
+    // the pipeline uses only the culling descriptor set
+    VkPipelineLayoutCreateInfo infoPipelineLayout = {};
+    infoPipelineLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    infoPipelineLayout.setLayoutCount = 1;
+    infoPipelineLayout.pSetLayouts = &vkhCullDescriptorSetLayout;
+
+    // create the pipeline layout
+    if (vkCreatePipelineLayout(vkhLogicalDevice, &infoPipelineLayout, nullptr, &vkhCullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the culling pipeline layout");
+    }
+
+    // load the compute module
+    VkShaderModule modComp = CreateShaderModule(STR_CULL_SHADER_ASSET);
+
+    // describe the compute pipeline, it has a single stage
+    VkComputePipelineCreateInfo infoComputePipeline = {};
+    infoComputePipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    infoComputePipeline.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    infoComputePipeline.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    infoComputePipeline.stage.module = modComp;
+    infoComputePipeline.stage.pName = "main";
+    infoComputePipeline.layout = vkhCullPipelineLayout;
+
+    // create the pipeline
+    VkResult statusResult = vkCreateComputePipelines(vkhLogicalDevice, vkhPipelineCache, 1, &infoComputePipeline, nullptr, &vkhCullPipeline);
+
+    // the shader module is no longer needed once the pipeline is created
+    vkDestroyShaderModule(vkhLogicalDevice, modComp, nullptr);
+
+    if (statusResult != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the culling pipeline");
+    }
+}
+
+
+// Create the descriptor set for the culling pass.
+void GfxAPIVulkan::CreateCullDescriptorSet() {
+    // describe the descriptor set allocation
+    VkDescriptorSetAllocateInfo infoDescriptorSetAllocation = {};
+    infoDescriptorSetAllocation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    infoDescriptorSetAllocation.descriptorSetCount = 1;
+    infoDescriptorSetAllocation.pSetLayouts = &vkhCullDescriptorSetLayout;
+    infoDescriptorSetAllocation.descriptorPool = vkhDescriptorPool;
+
+    // create the descriptor set
+    if (vkAllocateDescriptorSets(vkhLogicalDevice, &infoDescriptorSetAllocation, &vkhCullDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Unable to allocate the culling descriptor set");
+    }
+    WriteCullDescriptorSet();
+}
+
+
+// Point the culling descriptor set to the current buffers.
+void GfxAPIVulkan::WriteCullDescriptorSet() {
+    // the buffers in binding order, all of them are used whole
+    std::array<VkDescriptorBufferInfo, 5> ainfoBuffers = {};
+    ainfoBuffers[0].buffer = vkhCullUniformBuffer;
+    ainfoBuffers[1].buffer = vkhMeshletBuffer;
+    ainfoBuffers[2].buffer = vkhIndexBuffer;
+    ainfoBuffers[3].buffer = vkhCulledIndexBuffer;
+    ainfoBuffers[4].buffer = vkhDrawCommandBuffer;
+
+    // describe how to update the descriptor set
+    std::array<VkWriteDescriptorSet, 5> ainfoUpdateDescriptorSets = {};
+    for (uint32_t iBinding = 0; iBinding < ainfoUpdateDescriptorSets.size(); iBinding++) {
+        ainfoBuffers[iBinding].offset = 0;
+        ainfoBuffers[iBinding].range = VK_WHOLE_SIZE;
+
+        ainfoUpdateDescriptorSets[iBinding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        ainfoUpdateDescriptorSets[iBinding].dstSet = vkhCullDescriptorSet;
+        ainfoUpdateDescriptorSets[iBinding].dstBinding = iBinding;
+        ainfoUpdateDescriptorSets[iBinding].dstArrayElement = 0;
+        ainfoUpdateDescriptorSets[iBinding].descriptorType = iBinding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        ainfoUpdateDescriptorSets[iBinding].descriptorCount = 1;
+        ainfoUpdateDescriptorSets[iBinding].pBufferInfo = &ainfoBuffers[iBinding];
+    }
 
     // apply updates to the descriptor
     vkUpdateDescriptorSets(vkhLogicalDevice, static_cast<uint32_t>(ainfoUpdateDescriptorSets.size()), ainfoUpdateDescriptorSets.data(), 0, nullptr);
 }
 
 
+// Record the culling pass - must be recorded outside of a render pass.
+void GfxAPIVulkan::RecordMeshletCulling(VkCommandBuffer vkhCommandBuffer) {
+    // reset the draw commands of the level's submeshes, visible meshlets add their indices to them; updates are limited
+    // in size, so large levels are reset in pieces
+    const MeshLod &lodLevel = alodLods[selModelLod.GetLod()];
+    const VkDeviceSize ctMaxUpdateCommands = CT_MAX_BUFFER_UPDATE_SIZE / sizeof(VkDrawIndexedIndirectCommand);
+    for (uint32_t iSubmesh = lodLevel.iFirstSubmesh; iSubmesh < lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes; iSubmesh += static_cast<uint32_t>(ctMaxUpdateCommands)) {
+        const VkDeviceSize ctCommands = std::min<VkDeviceSize>(ctMaxUpdateCommands, lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes - iSubmesh);
+        vkCmdUpdateBuffer(vkhCommandBuffer, vkhDrawCommandBuffer, iSubmesh * sizeof(VkDrawIndexedIndirectCommand), ctCommands * sizeof(VkDrawIndexedIndirectCommand), &acmdEmptyDraws[iSubmesh]);
+    }
+
+    // the shader may only add to the count after the reset is done
+    VkBufferMemoryBarrier barReset = {};
+    barReset.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barReset.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barReset.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barReset.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barReset.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barReset.buffer = vkhDrawCommandBuffer;
+    barReset.offset = 0;
+    barReset.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barReset, 0, nullptr);
+
+    vkCmdBindPipeline(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vkhCullPipeline);
+    vkCmdBindDescriptorSets(vkhCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vkhCullPipelineLayout, 0, 1, &vkhCullDescriptorSet, 0, nullptr);
+    // test the meshlets of the selected level of detail, one invocation per meshlet
+    vkCmdDispatch(vkhCommandBuffer, (lodLevel.ctMeshlets + CT_CULL_WORKGROUP_SIZE - 1) / CT_CULL_WORKGROUP_SIZE, 1, 1);
+
+    // the draw may only read the command and the indices after the shader has written them
+    std::array<VkBufferMemoryBarrier, 2> abarCulled = {};
+    for (VkBufferMemoryBarrier &barCulled : abarCulled) {
+        barCulled.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barCulled.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barCulled.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barCulled.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barCulled.offset = 0;
+        barCulled.size = VK_WHOLE_SIZE;
+    }
+    abarCulled[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    abarCulled[0].buffer = vkhDrawCommandBuffer;
+    abarCulled[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+    abarCulled[1].buffer = vkhCulledIndexBuffer;
+    vkCmdPipelineBarrier(vkhCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0, 0, nullptr, static_cast<uint32_t>(abarCulled.size()), abarCulled.data(), 0, nullptr);
+}
+
+
+// Destroy all resources used by meshlet culling.
+void GfxAPIVulkan::DestroyMeshletCulling() {
+    if (!bCullMeshlets) {
+        return;
+    }
+
+    // destroy the pipeline and its layouts, the descriptor set goes away with the pool
+    vkDestroyPipeline(vkhLogicalDevice, vkhCullPipeline, nullptr);
+    vkDestroyPipelineLayout(vkhLogicalDevice, vkhCullPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(vkhLogicalDevice, vkhCullDescriptorSetLayout, nullptr);
+    DestroyMeshletBuffers();
+}
+
+
+// Destroy the buffers the culling pass reads from and writes to.
+void GfxAPIVulkan::DestroyMeshletBuffers() {
+    // destroy the buffers and release their memory
+    vkDestroyBuffer(vkhLogicalDevice, vkhCullUniformBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhCullUniformBufferMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhDrawCommandBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhDrawCommandBufferMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhCulledIndexBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhCulledIndexBufferMemory, nullptr);
+    vkDestroyBuffer(vkhLogicalDevice, vkhMeshletBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhMeshletBufferMemory, nullptr);
+}
+
+
 // Create a buffer - vertex, transfer, index...
 void GfxAPIVulkan::CreateBuffer(VkDeviceSize ctSize, VkBufferUsageFlags flgBufferUsage, VkMemoryPropertyFlags flgMemoryProperties, VkBuffer &vkhBuffer, VkDeviceMemory &vkhMemory) {
     // describe the vertex buffer
@@ -1968,6 +4722,29 @@ void GfxAPIVulkan::CreateBuffer(VkDeviceSize ctSize, VkBufferUsageFlags flgBuffe
 }
 
 
+// Create a device local buffer and fill it with data through a staging buffer.
+void GfxAPIVulkan::CreateBufferWithData(const void *pData, VkDeviceSize ctSize, VkBufferUsageFlags flgBufferUsage, VkBuffer &vkhBuffer, VkDeviceMemory &vkhMemory) {
+    // create a staging buffer - it is a source in a memory transfer operation, and is located on the host
+    VkBuffer vkhStagingBuffer;
+    VkDeviceMemory vkhStagingMemory;
+    CreateBuffer(ctSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhStagingBuffer, vkhStagingMemory);
+
+    // map the staging buffer and copy the data into it
+    void *pMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhStagingMemory, 0, ctSize, 0, &pMappedMemory);
+    memcpy(pMappedMemory, pData, static_cast<size_t>(ctSize));
+    vkUnmapMemory(vkhLogicalDevice, vkhStagingMemory);
+
+    // create the buffer in device memory and copy the staging buffer contents to it
+    CreateBuffer(ctSize, flgBufferUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vkhBuffer, vkhMemory);
+    CopyBuffer(vkhStagingBuffer, vkhBuffer, ctSize);
+
+    // destroy the staging buffer and free its memory
+    vkDestroyBuffer(vkhLogicalDevice, vkhStagingBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhStagingMemory, nullptr);
+}
+
+
 // Copy memory from one buffer to the other.
 void GfxAPIVulkan::CopyBuffer(VkBuffer vkhSourceBuffer, VkBuffer vkhDestinationBuffer, VkDeviceSize ctSize) {
     // begin recording a one time command buffer
@@ -1987,6 +4764,46 @@ void GfxAPIVulkan::CopyBuffer(VkBuffer vkhSourceBuffer, VkBuffer vkhDestinationB
 }
 
 
+// Allocate room for a load in the staging ring.
+bool GfxAPIVulkan::AllocateStaging(VkDeviceSize ctBytes, VkDeviceSize &iOffset) {
+    // copies from buffers to images need offsets that are multiples of the texel block size, the level alignment of
+    // texture files covers all formats
+    if (srStaging.Allocate(ctBytes, CT_KTX_LEVEL_ALIGNMENT, iOffset)) {
+        return true;
+    }
+    if (!srStaging.IsEmpty() || ctBytes <= srStaging.GetSize()) {
+        return false;
+    }
+
+    // the ring is created on first use, and again when a load is larger than all of it
+    DestroyStagingRing();
+    VkDeviceSize ctSize = CT_STAGING_RING_MIN_SIZE;
+    while (ctSize < ctBytes) {
+        ctSize *= 2;
+    }
+    CreateBuffer(ctSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vkhStagingRingBuffer, vkhStagingRingMemory);
+    vkMapMemory(vkhLogicalDevice, vkhStagingRingMemory, 0, ctSize, 0, reinterpret_cast<void **>(&pchStagingRingMemory));
+    srStaging.Initialize(ctSize);
+    return srStaging.Allocate(ctBytes, CT_KTX_LEVEL_ALIGNMENT, iOffset);
+}
+
+
+// Destroy the staging ring.
+void GfxAPIVulkan::DestroyStagingRing() {
+    assert(srStaging.IsEmpty());
+    if (vkhStagingRingBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+    vkUnmapMemory(vkhLogicalDevice, vkhStagingRingMemory);
+    vkDestroyBuffer(vkhLogicalDevice, vkhStagingRingBuffer, nullptr);
+    vkFreeMemory(vkhLogicalDevice, vkhStagingRingMemory, nullptr);
+    vkhStagingRingBuffer = VK_NULL_HANDLE;
+    vkhStagingRingMemory = VK_NULL_HANDLE;
+    pchStagingRingMemory = nullptr;
+    srStaging.Initialize(0);
+}
+
+
 // Start one time command recording.
 VkCommandBuffer GfxAPIVulkan::BeginOneTimeCommand() {
     // create a temporary command buffer
@@ -2038,6 +4855,38 @@ void GfxAPIVulkan::EndOneTimeCommand(VkCommandBuffer vkhCommandBuffer) {
 }
 
 
+// Get the command buffer of the frame's uploads, recording starts on first use.
+VkCommandBuffer GfxAPIVulkan::GetFrameUploadCommandBuffer() {
+    if (vkhFrameUploadCommandBuffer == VK_NULL_HANDLE) {
+        vkhFrameUploadCommandBuffer = BeginOneTimeCommand();
+    }
+    return vkhFrameUploadCommandBuffer;
+}
+
+
+// Run the frame's uploads now and wait for them.
+void GfxAPIVulkan::FlushFrameUploads() {
+    if (vkhFrameUploadCommandBuffer != VK_NULL_HANDLE) {
+        EndOneTimeCommand(vkhFrameUploadCommandBuffer);
+        vkhFrameUploadCommandBuffer = VK_NULL_HANDLE;
+    }
+    FinishFrameUploads();
+}
+
+
+// Free the frame's upload commands and their room in the staging ring.
+void GfxAPIVulkan::FinishFrameUploads() {
+    if (vkhFrameUploadCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(vkhLogicalDevice, vkhCommandPool, 1, &vkhFrameUploadCommandBuffer);
+        vkhFrameUploadCommandBuffer = VK_NULL_HANDLE;
+    }
+    for (VkDeviceSize iOffset : aiFrameUploadStaging) {
+        srStaging.Free(iOffset);
+    }
+    aiFrameUploadStaging.clear();
+}
+
+
 
 // Get the graphics memory type with the desired properties.
 uint32_t GfxAPIVulkan::FindMemoryType(uint32_t flgTypeFilter, VkMemoryPropertyFlags flgProperties) {
@@ -2066,9 +4915,9 @@ void GfxAPIVulkan::OnWindowResized(GLFWwindow* window, uint32_t width, uint32_t
     InitializeSwapChain();
 }
 
-// Update the uniform buffer - MVP matrices.
+// Update everything a frame draws with, before its commands are submitted.
 // The tutorial implementation rotates the object 90 degrees per second.
-void GfxAPIVulkan::UpdateUniformBuffer() {
+void GfxAPIVulkan::UpdateFrame() {
     // get the start time in milliseconds, once the first time this function is executed
     static auto tmStartTime = std::chrono::high_resolution_clock::now();
 
@@ -2076,30 +4925,224 @@ void GfxAPIVulkan::UpdateUniformBuffer() {
     auto tmCurrentTime = std::chrono::high_resolution_clock::now();
     float tmElapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(tmCurrentTime - tmStartTime).count() / 1000.f;
 
-    // genetate the matrices
-    UniformBufferObject uboUniforms = {};
     // calculate the model transform
-    uboUniforms.tModel = glm::rotate(glm::mat4(1.0f), tmElapsedTime * glm::radians(-45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    const glm::mat4 tModel = glm::rotate(glm::mat4(1.0f), tmElapsedTime * glm::radians(-45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     // calculate the view transform
-    uboUniforms.tView = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    const glm::vec3 vecCameraPosition(2.0f, 2.0f, 2.0f);
+    const glm::mat4 tView = glm::lookAt(vecCameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     // calculate the prijection transform
-    uboUniforms.tProjection = glm::perspective(glm::radians(45.0f), exExtent.width / (float) exExtent.height, 0.1f, 10.0f);
+    const float fFieldOfView = glm::radians(45.0f);
+    glm::mat4 tProjection = glm::perspective(fFieldOfView, exExtent.width / (float) exExtent.height, 0.1f, 10.0f);
     // correct for the difference between OpenGL and Vulkan regarding the direction of the Y clip coordinate axis
-    uboUniforms.tProjection[1][1] *= -1;
+    tProjection[1][1] *= -1;
+    // the camera's transforms are combined once here instead of for every vertex
+    const glm::mat4 tViewProjection = tProjection * tView;
+    UpdateUniformBuffer(tModel, tViewProjection);
+
+    // finish the assets that loaded in the background, and those reloaded because their files changed; the device is
+    // idle between frames so their resources can be created and bound
+    ReloadChangedAssets();
+    amAssets.Update(CT_MAX_ASSET_FINISHES_PER_FRAME);
+    // materials switch to their own pipelines as the workers finish compiling them
+    if (UpdateGraphicsPipelines()) {
+        RecordCommandBuffers();
+    }
+
+    // pick the level of detail to draw with, and the texture levels to stream in
+    float fDistance, fScale, fPixelsPerUnit;
+    MeasureModelOnScreen(tModel, vecCameraPosition, fFieldOfView, fDistance, fScale, fPixelsPerUnit);
+    SelectModelLod(fDistance, fScale, fPixelsPerUnit);
+    UpdateTextureStreaming(fDistance, fScale, fPixelsPerUnit);
+    UpdateVirtualTextures();
+
+    // the culling pass needs the same transforms
+    if (bCullMeshlets) {
+        UpdateCullUniformBuffer(tModel, tViewProjection, vecCameraPosition);
+    }
+}
+
+// Update the frame's uniform buffer and the object buffer.
+void GfxAPIVulkan::UpdateUniformBuffer(const glm::mat4 &tModel, const glm::mat4 &tViewProjection) {
+    FrameUniformBufferObject uboFrame = {};
+    uboFrame.tViewProjection = tViewProjection;
 
     // to copy the uniform buffer values to GPU memory, it first needs to be mapped to CPU
     void *pMappedMemory;
-    vkMapMemory(vkhLogicalDevice, vkhUniformBufferMemory, 0, sizeof(UniformBufferObject), 0, &pMappedMemory);
+    vkMapMemory(vkhLogicalDevice, vkhUniformBufferMemory, 0, sizeof(FrameUniformBufferObject), 0, &pMappedMemory);
     // copy the buffer to mapped memory
-    memcpy(pMappedMemory, &uboUniforms, sizeof(UniformBufferObject));
+    memcpy(pMappedMemory, &uboFrame, sizeof(FrameUniformBufferObject));
     // unmap memory, let the GPU take over
     vkUnmapMemory(vkhLogicalDevice, vkhUniformBufferMemory);
+    // the model's transform goes to its object the same way
+    vkMapMemory(vkhLogicalDevice, vkhObjectBufferMemory, ID_MODEL_OBJECT * sizeof(glm::mat4), sizeof(glm::mat4), 0, &pMappedMemory);
+    memcpy(pMappedMemory, &tModel, sizeof(glm::mat4));
+    vkUnmapMemory(vkhLogicalDevice, vkhObjectBufferMemory);
+}
+
+// Measure how the model is seen from the camera.
+void GfxAPIVulkan::MeasureModelOnScreen(const glm::mat4 &tModel, const glm::vec3 &vecCameraPosition, float fFieldOfView,
+    float &fDistance, float &fScale, float &fPixelsPerUnit) {
+    // distance from the camera to the nearest point of the model's bounds, with the bounds scaled like the model
+    fScale = std::max(glm::length(glm::vec3(tModel[0])), std::max(glm::length(glm::vec3(tModel[1])), glm::length(glm::vec3(tModel[2]))));
+    const glm::vec3 vecCenter = glm::vec3(tModel * glm::vec4(glm::vec3(sphModelBounds), 1.0f));
+    fDistance = glm::length(vecCenter - vecCameraPosition) - sphModelBounds.w * fScale;
+
+    // height in pixels of one unit seen from the distance of one unit
+    fPixelsPerUnit = exExtent.height / (2.0f * std::tan(fFieldOfView * 0.5f));
+}
+
+// Select the model's level of detail for the current transforms, commands are recorded again if it changes.
+void GfxAPIVulkan::SelectModelLod(float fDistance, float fScale, float fPixelsPerUnit) {
+    // the command buffers are idle here, as the previous frame waited for the device to finish
+    const uint32_t iPreviousLod = selModelLod.GetLod();
+    if (selModelLod.Select(alodLods, fDistance, fScale, fPixelsPerUnit) != iPreviousLod) {
+        RecordCommandBuffers();
+    }
+}
+
+// Request the texture levels the model needs at its size on screen, finish the loads that are done and start new ones.
+void GfxAPIVulkan::UpdateTextureStreaming(float fDistance, float fScale, float fPixelsPerUnit) {
+    if (aiStreamedMaterials.empty()) {
+        return;
+    }
+    // the command buffers are idle here, as the previous frame waited for the device to finish, so the views of
+    // textures can be replaced as long as the commands are recorded again, or the bindless set they use is updated
+    bool bChanged = false;
+
+    // levels that are in the staging ring are copied into their textures by the frame's uploads
+    for (size_t iLoad = 0; iLoad < aloadTextureLevels.size();) {
+        TextureLevelLoad &loadLevel = aloadTextureLevels[iLoad];
+        if (loadLevel.futCopied.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            iLoad++;
+            continue;
+        }
+        loadLevel.futCopied.get();
+        MaterialResources &resMaterial = aresMaterials[loadLevel.iMaterial];
+        UploadStreamedLevel(resMaterial, loadLevel.iStagingOffset);
+        stmTextures.FinishLoad(resMaterial.idStreamedTexture);
+        aloadTextureLevels.erase(aloadTextureLevels.begin() + iLoad);
+        bChanged = true;
+    }
+
+    // textures are assumed to be mapped over the model once, so a texture needs about as many texels across as the
+    // model covers pixels; with the camera inside the bounds everything is needed
+    const float fScreenSize = fDistance > 0.0f ? 2.0f * sphModelBounds.w * fScale * fPixelsPerUnit / fDistance : std::numeric_limits<float>::max();
+    for (uint32_t idTexture = 0; idTexture < aiStreamedMaterials.size(); idTexture++) {
+        const KtxFile &ktxTexture = *aresMaterials[aiStreamedMaterials[idTexture]].ktxTexture;
+        const float fTexelsPerPixel = std::max(ktxTexture.GetWidth(), ktxTexture.GetHeight()) / fScreenSize;
+        stmTextures.SetWantedLevel(idTexture, static_cast<uint32_t>(std::floor(std::log2(std::max(fTexelsPerPixel, 1.0f)))));
+    }
+
+    std::vector<uint32_t> aidLoads;
+    std::vector<uint32_t> aidEvictions;
+    stmTextures.Update(aidLoads, aidEvictions);
+
+    // evicted textures are viewed from their new resident level, their images stay as they are
+    for (uint32_t idTexture : aidEvictions) {
+        MaterialResources &resMaterial = aresMaterials[aiStreamedMaterials[idTexture]];
+        SetStreamedTextureFirstLevel(resMaterial, stmTextures.GetResidentLevel(idTexture));
+        bChanged = true;
+    }
+
+    // new levels are read from the files on the workers, so the frame never waits for the disk; they start in the
+    // order they were requested, as the staging ring has room for them
+    aidWaitingTextureLevels.insert(aidWaitingTextureLevels.end(), aidLoads.begin(), aidLoads.end());
+    size_t ctStarted = 0;
+    while (ctStarted < aidWaitingTextureLevels.size() && StartTextureLevelLoad(aidWaitingTextureLevels[ctStarted])) {
+        ctStarted++;
+    }
+    aidWaitingTextureLevels.erase(aidWaitingTextureLevels.begin(), aidWaitingTextureLevels.begin() + ctStarted);
+
+    // bound bindless, the new views are swapped into the bound set
+    if (bChanged) {
+        UpdateMaterialDescriptorSets(true);
+        if (!bBindlessTextures) {
+            RecordCommandBuffers();
+        }
+    }
+}
+
+// Upload the virtual texture tiles that finished loading, read which tiles the last frame sampled and start loading
+// the missing ones.
+void GfxAPIVulkan::UpdateVirtualTextures() {
+    if (aiVirtualMaterials.empty()) {
+        return;
+    }
+    // the previous frame waited for the device to finish, so the cache, the page table and the feedback are all idle
+
+    // tiles that are in their staging buffers are copied into their slots, all in one go
+    std::vector<VirtualTileLoad> aloadCopied;
+    for (size_t iLoad = 0; iLoad < aloadVirtualTiles.size();) {
+        VirtualTileLoad &loadTile = aloadVirtualTiles[iLoad];
+        if (loadTile.futCopied.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            iLoad++;
+            continue;
+        }
+        loadTile.futCopied.get();
+        aloadCopied.push_back(std::move(loadTile));
+        aloadVirtualTiles.erase(aloadVirtualTiles.begin() + iLoad);
+    }
+    CopyTilesToCache(aloadCopied);
+
+    // the tiles the last frame sampled decide what is loaded next, the feedback is then cleared for this frame
+    std::vector<VirtualTextureCache::TileLoad> aloadLoads;
+    void *pMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhFeedbackMemory, 0, ctFeedbackBytes, 0, &pMappedMemory);
+    vtcVirtualTextures.Update(static_cast<const uint32_t *>(pMappedMemory), aloadLoads);
+    memset(pMappedMemory, 0, static_cast<size_t>(ctFeedbackBytes));
+    vkUnmapMemory(vkhLogicalDevice, vkhFeedbackMemory);
+
+    // new tiles are read from the files on the workers, so the frame never waits for the disk; they start in the
+    // order they were requested, as the staging ring has room for them
+    aloadWaitingVirtualTiles.insert(aloadWaitingVirtualTiles.end(), aloadLoads.begin(), aloadLoads.end());
+    size_t ctStarted = 0;
+    while (ctStarted < aloadWaitingVirtualTiles.size() && StartVirtualTileLoad(aloadWaitingVirtualTiles[ctStarted])) {
+        ctStarted++;
+    }
+    aloadWaitingVirtualTiles.erase(aloadWaitingVirtualTiles.begin(), aloadWaitingVirtualTiles.begin() + ctStarted);
+    UpdatePageTableBuffer();
+}
+
+// Update the meshlet culling parameters for the current transforms.
+void GfxAPIVulkan::UpdateCullUniformBuffer(const glm::mat4 &tModel, const glm::mat4 &tViewProjection, const glm::vec3 &vecCameraPosition) {
+    CullUniformBufferObject uboCull = {};
+
+    // extract the frustum planes from the full transform, which gives them in model space
+    // each plane is a sum or difference of the rows of the matrix, Vulkan clip depth goes from 0 to w
+    const glm::mat4 tModelViewProjection = tViewProjection * tModel;
+    glm::vec4 avecRows[4];
+    for (int iRow = 0; iRow < 4; iRow++) {
+        avecRows[iRow] = glm::vec4(tModelViewProjection[0][iRow], tModelViewProjection[1][iRow], tModelViewProjection[2][iRow], tModelViewProjection[3][iRow]);
+    }
+    uboCull.aplnFrustum[0] = avecRows[3] + avecRows[0];
+    uboCull.aplnFrustum[1] = avecRows[3] - avecRows[0];
+    uboCull.aplnFrustum[2] = avecRows[3] + avecRows[1];
+    uboCull.aplnFrustum[3] = avecRows[3] - avecRows[1];
+    uboCull.aplnFrustum[4] = avecRows[2];
+    uboCull.aplnFrustum[5] = avecRows[3] - avecRows[2];
+    // normalize the planes so distances to them are in model units
+    for (glm::vec4 &plnPlane : uboCull.aplnFrustum) {
+        plnPlane /= glm::length(glm::vec3(plnPlane));
+    }
+
+    // the camera position in model space
+    uboCull.vecCameraPosition = glm::inverse(tModel) * glm::vec4(vecCameraPosition, 1.0f);
+    // test the meshlets of the selected level of detail
+    const MeshLod &lodLevel = alodLods[selModelLod.GetLod()];
+    uboCull.iFirstMeshlet = lodLevel.iFirstMeshlet;
+    uboCull.ctMeshlets = lodLevel.ctMeshlets;
+
+    // copy the parameters to the uniform buffer
+    void *pMappedMemory;
+    vkMapMemory(vkhLogicalDevice, vkhCullUniformBufferMemory, 0, sizeof(CullUniformBufferObject), 0, &pMappedMemory);
+    memcpy(pMappedMemory, &uboCull, sizeof(CullUniformBufferObject));
+    vkUnmapMemory(vkhLogicalDevice, vkhCullUniformBufferMemory);
 }
 
 // Render a frame.
 void GfxAPIVulkan::Render() {
-    // update model, view and perspective matrices
-    UpdateUniformBuffer();
+    // update the transforms, and what the frame draws with
+    UpdateFrame();
 
     // obtain a target image from the swap chain
     // setting max uint64 as the timeout (in nanoseconds) disables the timeout
@@ -2131,9 +5174,15 @@ void GfxAPIVulkan::Render() {
     VkPipelineStageFlags aflgWaitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
     infSubmit.pWaitDstStageMask = aflgWaitStages;
 
-    // bind the command buffer
-    infSubmit.commandBufferCount = 1;
-    infSubmit.pCommandBuffers = &avkhCommandBuffers[iImage];
+    // bind the command buffer, after the frame's uploads as it samples what they write
+    std::vector<VkCommandBuffer> avkhSubmitted;
+    if (vkhFrameUploadCommandBuffer != VK_NULL_HANDLE) {
+        vkEndCommandBuffer(vkhFrameUploadCommandBuffer);
+        avkhSubmitted.push_back(vkhFrameUploadCommandBuffer);
+    }
+    avkhSubmitted.push_back(avkhCommandBuffers[iImage]);
+    infSubmit.commandBufferCount = static_cast<uint32_t>(avkhSubmitted.size());
+    infSubmit.pCommandBuffers = avkhSubmitted.data();
 
     // set the semaphores that will be signalled when the command buffers are executed
     VkSemaphore asyncSignal[] = { vkhRenderSemaphore };
@@ -2179,4 +5228,68 @@ void GfxAPIVulkan::Render() {
     // wait for the device to finish rendering
     // not needed in a proper application where there are other things to do while the grahics card and thread to their thing
     vkDeviceWaitIdle(vkhLogicalDevice);
+    // the uploads are done as well
+    FinishFrameUploads();
+
+    // the frame is finished, so its timestamps are available
+    if (vkhFrameTimeQueryPool != VK_NULL_HANDLE) {
+        uint64_t atsTimestamps[2];
+        if (vkGetQueryPoolResults(vkhLogicalDevice, vkhFrameTimeQueryPool, 0, 2, sizeof(atsTimestamps), atsTimestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            tmLastFrame = ((atsTimestamps[1] - atsTimestamps[0]) & flgTimestampMask) * fTimestampPeriod / 1e6;
+        }
+    }
+
+    // pipelines created while running, e.g. by reloads, are saved now and then, so a crash doesn't lose them
+    if (std::chrono::steady_clock::now() - tmPipelineCacheSaved > std::chrono::seconds(CT_PIPELINE_CACHE_SAVE_INTERVAL_SECONDS)) {
+        SavePipelineCache();
+    }
+}
+
+
+// Enable or disable sampling from the smaller mip levels of textures.
+void GfxAPIVulkan::SetTextureMipmapsEnabled(bool bEnabled) {
+    if (bEnabled == bTextureMipmapsEnabled) {
+        return;
+    }
+    bTextureMipmapsEnabled = bEnabled;
+
+    // the level range is a property of the sampler, replace it and rebind it to all materials; the descriptor sets
+    // change, so the command buffers that use them are recorded again, unless they are updated while bound
+    vkDeviceWaitIdle(vkhLogicalDevice);
+    vkDestroySampler(vkhLogicalDevice, vkhImageSampler, nullptr);
+    CreateImageSampler();
+    UpdateMaterialDescriptorSets(true);
+    if (!bBindlessTextures) {
+        RecordCommandBuffers();
+    }
+}
+
+
+// Create the queries that measure the GPU time of frames.
+void GfxAPIVulkan::CreateFrameTimeQueries() {
+    // timestamps are optional on a queue, frames are not timed if the graphics queue doesn't have them
+    uint32_t ctQueueFamilies = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vkhPhysicalDevice, &ctQueueFamilies, nullptr);
+    std::vector<VkQueueFamilyProperties> aQueueFamilies(ctQueueFamilies);
+    vkGetPhysicalDeviceQueueFamilyProperties(vkhPhysicalDevice, &ctQueueFamilies, aQueueFamilies.data());
+    const uint32_t ctValidBits = aQueueFamilies[iGraphicsQueueFamily].timestampValidBits;
+    if (ctValidBits == 0) {
+        std::cerr << "The graphics queue doesn't support timestamps, frame times are not measured" << std::endl;
+        return;
+    }
+    flgTimestampMask = ctValidBits >= 64 ? ~0ULL : (1ULL << ctValidBits) - 1;
+
+    // ticks are converted to time with the device's timestamp period
+    VkPhysicalDeviceProperties propsDevice;
+    vkGetPhysicalDeviceProperties(vkhPhysicalDevice, &propsDevice);
+    fTimestampPeriod = propsDevice.limits.timestampPeriod;
+
+    // one query at the start and one at the end of a frame
+    VkQueryPoolCreateInfo infoQueryPool = {};
+    infoQueryPool.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    infoQueryPool.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    infoQueryPool.queryCount = 2;
+    if (vkCreateQueryPool(vkhLogicalDevice, &infoQueryPool, nullptr, &vkhFrameTimeQueryPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the frame time query pool");
+    }
 }
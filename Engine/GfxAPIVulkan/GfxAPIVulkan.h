@@ -1,80 +1,186 @@
 #pragma once
 #include "../GfxAPI/GfxAPI.h"
 #include <vulkan/vulkan.h>
+#include <future>
+#include <unordered_map>
+#include "../Platform/FileWatcher.h"
+#include "../Resources/AssetManager.h"
+#include "../Resources/AssetPackage.h"
+#include "../Resources/KtxFile.h"
+#include "../Resources/MeshLod.h"
+#include "../Resources/MeshMaterial.h"
+#include "../Resources/MeshSubmesh.h"
+#include "../Resources/Meshlet.h"
+#include "../Resources/PipelineCacheFile.h"
+#include "../Resources/TextureStreamer.h"
+#include "../Resources/StagingRing.h"
+#include "../Resources/Vertex.h"
+#include "../Resources/VirtualTextureCache.h"
+#include "../Resources/VirtualTextureFile.h"
+#include "PipelineState.h"
+#include "ShaderReflection.h"
 
 struct GLFWwindow;
 
 // Implementation of Vulkan graphics API.
 class GfxAPIVulkan : public GfxAPI {
 private:
-    // NOTE: refactor this
-    struct Vertex {
-        glm::vec3 vecPosition;
-        glm::vec3 colColor;
-        glm::vec2 vecTexCoords;
-
-        // Describe to the Vulkan API how to handle Vertex data.
-        static VkVertexInputBindingDescription GetBindingDescription() {
-            // describe the layout of a vertex
-            VkVertexInputBindingDescription descVertexInputBinding = {};
-            // index of the binding in the array of bindings
-            descVertexInputBinding.binding = 0;
-            // number of bytes from the start of one entry to the next
-            descVertexInputBinding.stride = sizeof(Vertex);
-            // move to next data entry after each vertex (could be instance)
-            descVertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-            return descVertexInputBinding;
-        };
-
-        // Describe each individual vertex attribute.
-        static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, 3> adescAttributes = {};
-            // set up the description of the vertex position
-            // data comes from the binding 0 (set up above)
-            adescAttributes[0].binding = 0;
-            // data goes to the location 0 (specified in the vertex shader)
-            adescAttributes[0].location = 0;
-            // data is two 32bit floats (screen x, y)
-            adescAttributes[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-            // offset of this attribute from the start of the data block
-            adescAttributes[0].offset = offsetof(Vertex, vecPosition);
-
-            // set up the description of the vertex color
-            // data comes from the binding 0 (set up above)
-            adescAttributes[1].binding = 0;
-            // data goes to the location 0 (specified in the vertex shader)
-            adescAttributes[1].location = 1;
-            // data is three 32bit floats (red, green, blue)
-            adescAttributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            // offset of this attribute from the start of the data block
-            adescAttributes[1].offset = offsetof(Vertex, colColor);
-
-            // set up the description of the texture coordinates
-            // data comes from the binding 0 (set up above)
-            adescAttributes[2].binding = 0;
-            // data goes to the location 0 (specified in the vertex shader)
-            adescAttributes[2].location = 2;
-            // data is three 32bit floats (red, green, blue)
-            adescAttributes[2].format = VK_FORMAT_R32G32_SFLOAT;
-            // offset of this attribute from the start of the data block
-            adescAttributes[2].offset = offsetof(Vertex, vecTexCoords);
-
-            return adescAttributes;
-        };
+    // Describe to the Vulkan API how to handle Vertex data.
+    static VkVertexInputBindingDescription GetVertexBindingDescription() {
+        // describe the layout of a vertex
+        VkVertexInputBindingDescription descVertexInputBinding = {};
+        // index of the binding in the array of bindings
+        descVertexInputBinding.binding = 0;
+        // number of bytes from the start of one entry to the next
+        descVertexInputBinding.stride = sizeof(Vertex);
+        // move to next data entry after each vertex (could be instance)
+        descVertexInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return descVertexInputBinding;
     };
+
     std::vector<Vertex> avVertices;
     std::vector<uint32_t> aiIndices;
+    std::vector<Meshlet> ameshMeshlets;
+    std::vector<MeshLod> alodLods;
+    std::vector<MeshSubmesh> asubSubmeshes;
+    std::vector<MeshMaterial> amatMaterials;
+    // Bounding sphere of the model, center in xyz and radius in w.
+    glm::vec4 sphModelBounds;
+    // Level of detail the model is drawn with.
+    LodSelector selModelLod;
 
 private:
-    // Uniform buffer description.
-    struct UniformBufferObject {
-        // Model transform.
-        glm::mat4 tModel;
-        // View transform.
-        glm::mat4 tView;
-        // Projection transform.
-        glm::mat4 tProjection;
+    // Camera of the frame, matches the uniform buffer in shader.vert. Objects' transforms are in the object buffer.
+    struct FrameUniformBufferObject {
+        // View and projection transforms, combined once per frame.
+        glm::mat4 tViewProjection;
+    };
+
+    // Meshlet culling parameters, matches the uniform buffer in cull.comp.
+    struct CullUniformBufferObject {
+        // Frustum planes in model space - left, right, bottom, top, near, far - pointing inwards.
+        glm::vec4 aplnFrustum[6];
+        // Camera position in model space.
+        glm::vec4 vecCameraPosition;
+        // Range of meshlets to test.
+        uint32_t iFirstMeshlet;
+        uint32_t ctMeshlets;
+    };
+
+    // Per draw material constants, matches the push constants in shader.frag.
+    struct MaterialPushConstants {
+        // Index of the material's texture in the bindless texture array, and the layer of the texture that holds its
+        // image. The index is unused when textures aren't bound bindless.
+        uint32_t iTexture;
+        uint32_t iTextureLayer;
+        // Page table entry of the first tile of the material's virtual texture, ID_VIRTUAL_PAGE_MISSING if its texture
+        // isn't virtual, and the size and number of levels of the virtual texture.
+        uint32_t iFirstPageEntry;
+        uint32_t dimVirtualWidth;
+        uint32_t dimVirtualHeight;
+        uint32_t ctVirtualLevels;
+    };
+
+    // Fragment shader features of a pipeline, matches the specialization constants in shader.frag.
+    struct FragmentSpecialization {
+        uint32_t idTexturing;
+        VkBool32 bVertexColor;
+        VkBool32 bAlphaTest;
+    };
+
+    // GPU resources of one of the model's materials.
+    struct MaterialResources {
+        // Diffuse texture, null if the material uses the default texture.
+        VkImage vkhImage;
+        VkDeviceMemory vkhImageMemory;
+        VkImageView vkhImageView;
+        uint32_t ctMipLevels;
+        VkFormat fmtFormat;
+        // Descriptor set of the material's texture owner, holding the uniform buffer and the texture.
+        VkDescriptorSet vkhDescriptorSet;
+        // Material that owns the texture and the descriptor set this material uses, and the layer of the texture that
+        // is this material's. Materials whose textures are packed into one texture array, or that all use the default
+        // texture, share the resources of the first of them; the others have no texture of their own.
+        uint32_t iTextureOwner;
+        uint32_t iTextureLayer;
+        // File the levels of a streamed texture are loaded from, null if the texture isn't streamed.
+        std::shared_ptr<KtxFile> ktxTexture;
+        // Id of a streamed texture in the streamer, and its finest resident level. The image has all the levels of the
+        // texture, the view starts at the first resident one.
+        uint32_t idStreamedTexture;
+        uint32_t iFirstLevel;
+        // File the tiles of a virtual texture are loaded from, null if the texture isn't virtual, and the texture's id
+        // in the tile cache.
+        std::shared_ptr<VirtualTextureFile> vtfTexture;
+        uint32_t idVirtualTexture;
+    };
+
+    // Image decoded into a staging buffer, waiting to be uploaded to a texture.
+    struct TextureUpload {
+        // File the image is decoded from, or the name of the image if it is decoded from memory.
+        std::string strFilename;
+        // Image already in memory, e.g. in the asset package, null if it is decoded from the file.
+        const char *pchData;
+        uint64_t ctBytes;
+        uint32_t dimWidth;
+        uint32_t dimHeight;
+        VkBuffer vkhStagingBuffer;
+        VkDeviceMemory vkhStagingMemory;
+    };
+
+    // Image file of material textures that is imported in the background.
+    struct TextureImport {
+        // The image's file, and its size once it is known.
+        TextureUpload upUpload;
+        // Is the image imported into a virtual texture? Known once it is imported.
+        bool bVirtual;
+        // Materials that use the image.
+        std::vector<uint32_t> aiMaterials;
+        // Asset that imports the image.
+        AssetHandle hTexture;
+    };
+
+    // Part of graphics pipelines compiled on a worker as a pipeline library, shared by the pipelines whose part has
+    // the same state.
+    struct PipelineLibrary {
+        // Written by the worker once the library is created.
+        std::shared_ptr<VkPipeline> pvkhPipeline;
+        // Ready when the worker is done, rethrows if the library failed. Every pipeline linked from it waits for it.
+        std::shared_future<void> futCompiled;
+    };
+
+    // Graphics pipeline being compiled on a worker.
+    struct PipelineCompile {
+        // Id of the pipeline, its slot stays null until the compile is collected.
+        uint32_t idPipeline;
+        // Written by the worker once the pipeline is created.
+        std::shared_ptr<VkPipeline> pvkhPipeline;
+        // Ready when the worker is done, rethrows if the pipeline failed.
+        std::future<void> futCompiled;
+        // Libraries the pipeline is linked from, none if it is created whole.
+        std::vector<std::shared_ptr<PipelineLibrary>> aplLibraries;
+        // Is the pipeline linked with link time optimization, to replace the fast linked one?
+        bool bOptimized;
+    };
+
+    // Mip level of a streamed texture that is being copied from its file to the staging ring in the background.
+    struct TextureLevelLoad {
+        // Material whose texture gets the level, the level is the one above its first level.
+        uint32_t iMaterial;
+        // Where the level is in the staging ring.
+        VkDeviceSize iStagingOffset;
+        // Ready when the level is in the staging ring.
+        std::future<void> futCopied;
+    };
+
+    // Tile of a virtual texture that is being copied from its file to the staging ring in the background.
+    struct VirtualTileLoad {
+        VirtualTextureCache::TileLoad loadTile;
+        // Where the tile is in the staging ring.
+        VkDeviceSize iStagingOffset;
+        // Ready when the tile is in the staging ring.
+        std::future<void> futCopied;
     };
 
 public:
@@ -94,13 +200,37 @@ public:
     // Render a frame.
     virtual void Render(); 
 
+    // Enable or disable sampling from the smaller mip levels of textures, to compare their cost.
+    virtual void SetTextureMipmapsEnabled(bool bEnabled);
+    // Get how long the GPU took to render the last frame, in milliseconds.
+    virtual double GetLastFrameTime() const { return tmLastFrame; }
+    // Are assets still loading in the background?
+    virtual bool IsLoadingAssets() const { return amAssets.IsBusy() || IsCompilingPipelines(); }
+
 private:
     // Called when the application's window is resized.
     void OnWindowResized(GLFWwindow* window, uint32_t width, uint32_t height);
 
-    // Update the uniform buffer - MVP matrices.
+    // Update everything a frame draws with: the transforms, assets that finished loading or changed, pipelines that
+    // finished compiling, the level of detail, streamed and virtual textures and the culling parameters.
     // The tutorial implementation rotates the object 90 degrees per second.
-    void UpdateUniformBuffer();
+    void UpdateFrame();
+    // Update the frame's uniform buffer with the camera and the object buffer with the model's transform.
+    void UpdateUniformBuffer(const glm::mat4 &tModel, const glm::mat4 &tViewProjection);
+    // Measure how the model is seen: the distance from the camera to its bounds, the largest scale of its transform and
+    // the height in pixels of one unit seen at the distance of one unit.
+    void MeasureModelOnScreen(const glm::mat4 &tModel, const glm::vec3 &vecCameraPosition, float fFieldOfView,
+        float &fDistance, float &fScale, float &fPixelsPerUnit);
+    // Select the model's level of detail for the current transforms, commands are recorded again if it changes.
+    void SelectModelLod(float fDistance, float fScale, float fPixelsPerUnit);
+    // Request the texture levels the model needs at its size on screen, finish the loads that are done and start new
+    // ones. Commands are recorded again if any texture changed.
+    void UpdateTextureStreaming(float fDistance, float fScale, float fPixelsPerUnit);
+    // Upload the virtual texture tiles that finished loading, read which tiles the last frame sampled and start loading
+    // the missing ones. The page table is uploaded if it changed.
+    void UpdateVirtualTextures();
+    // Update the meshlet culling parameters for the current transforms.
+    void UpdateCullUniformBuffer(const glm::mat4 &tModel, const glm::mat4 &tViewProjection, const glm::vec3 &vecCameraPosition);
 
 private:
     // Initialize the application window.
@@ -117,10 +247,14 @@ private:
     void GetRequiredInstanceExtensions(std::vector<const char*> &astrRequiredExtensions) const;
     // Check if all required instance extensions are supported.
     void CheckInstanceExtensionSupport(const std::vector<const char*> &astrRequiredExtensions) const;
+    // Is the instance extension supported?
+    bool IsInstanceExtensionAvailable(const char *strExtension) const;
     // Get the Vulkan device extensions required for the applciation to work.
     void GetRequiredDeviceExtensions(std::vector<const char*> &astrRequiredExtensions) const;
     // Check if all required device extensions are supported.
     void CheckDeviceExtensionSupport(const VkPhysicalDevice &device, const std::vector<const char*> &astrRequiredExtensions) const;
+    // Is the device extension supported?
+    bool IsDeviceExtensionAvailable(const VkPhysicalDevice &device, const char *strExtension) const;
 
     // NOTE: In the Vulkan SDK, Config directory, there is a vk_layer_settings.txt file that explains how to configure the validation layers.
     // Set up the validation layers.
@@ -159,22 +293,114 @@ private:
     // Create the logical device the application will use. Also creates the queues that commands will be submitted to.
     void CreateLogicalDevice();
 
+    // Create the pipeline cache, with the data saved by a previous run if it was saved with this device and driver.
+    void CreatePipelineCache();
+    // Save the pipeline cache on a worker, if pipelines were added to it since it was last saved.
+    void SavePipelineCache();
+    // Save the pipeline cache one last time, wait for the save and destroy the cache.
+    void DestroyPipelineCache();
+    // Get the identity of the device and driver that saved pipeline cache data must match.
+    PipelineCacheFileHeader GetPipelineCacheIdentity() const;
+
     // Create the image views needed to acces swap chain images.
     void CreateImageViews();
     // Destroy the image views.
     void DestroyImageViews();
 
-    // Load shaders and create shader modules.
-    VkShaderModule CreateShaderModule(const std::string &strFilename);
-    // Load shader bytecode from a file.
-    std::vector<char> LoadShader(const std::string &filename);
+    // Map the package the assets are loaded from. The package is rebuilt first if it is older than the loose files.
+    void OpenAssetPackage();
+    // Compile the shaders whose sources are there into their assets, through the shader cache. Shaders that don't
+    // compile keep their previous code, and all of them do if the SDK's compiler isn't available.
+    void CompileShaders();
+    // Get the data of an asset in the package, or of its loose file if the file was reloaded since the package was
+    // built. Throws if the package doesn't have the asset.
+    const char *GetAssetData(const std::string &strAssetName, uint64_t &ctBytes) const;
+    // Create a shader module from compiled code in the asset package.
+    VkShaderModule CreateShaderModule(const std::string &strAssetName);
+    // Read the interface of a shader from its compiled code in the asset package.
+    ShaderInterface ReflectShader(const std::string &strAssetName) const;
+
+    // Watch the loose files of the assets, if assets are hot reloaded.
+    void WatchAssetFiles();
+    // Reload the assets whose files changed since the last frame. Only what depends on a changed file is rebuilt.
+    void ReloadChangedAssets();
+    // Request the asset that reloads a file, or load it again if it was requested before.
+    void RequestReload(const std::string &strFilename, const AssetManager::AssetLoader &ldrReload);
+    // Read an asset's changed loose file on a worker, and rebuild what uses it once it is read.
+    void ReloadPackagedAsset(const std::string &strAssetName);
+    // Rebuild what uses a packaged asset, after its loose file was read.
+    void ApplyReloadedAsset(const std::string &strAssetName);
+    // Create the graphics pipelines again with the current shaders. The old pipelines stay if the new ones fail.
+    void ReloadGraphicsPipelines();
+    // Create the culling pipeline again with the current shader. The old pipeline stays if the new one fails.
+    void ReloadCullPipeline();
+    // Create the default texture again from its current image.
+    void ReloadDefaultTexture();
+    // Create the model's buffers again from its current mesh. The materials must stay the same.
+    void ReloadModel();
+    // Import a material texture's changed image again, the materials use the default texture until it is done.
+    void ReloadMaterialTexture(TextureImport &impTexture);
 
     // Create the render pass.
 	void CreateRenderPass();
-    // Create descriptor sets - used to bind uniforms to shaders.
+    // Create the descriptor set layout of the materials, from the descriptors the default shaders read.
     void CreateDescriptorSetLayout();
-	// Create the graphics pipeline.
-	void CreateGraphicsPipeline();
+    // Get the descriptor set layout with the bindings, created the first time the bindings are seen. The flags of the
+    // bindings, if given, are descriptor indexing flags, one for each binding.
+    VkDescriptorSetLayout RequestDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &abndBindings, const std::vector<VkFlags> &aflgBindingFlags = {});
+    // Get the pipeline layout with the set layouts and push constant ranges, created the first time they are seen.
+    VkPipelineLayout RequestPipelineLayout(const std::vector<VkDescriptorSetLayout> &avkhSetLayouts, const std::vector<VkPushConstantRange> &arngPushConstants);
+    // Destroy the cached descriptor set and pipeline layouts.
+    void DestroyLayouts();
+	// Create the layout shared by the graphics pipelines, and the pipelines of all known pipeline states. If a pipeline
+	// fails, whatever was created is destroyed and the previous pipelines are left as they were.
+	void CreateGraphicsPipelines();
+	// Destroy the graphics pipelines, the pipeline states stay known. The layouts are cached until the API is destroyed.
+	void DestroyGraphicsPipelines();
+	// Create the graphics pipeline of a pipeline state, or the pipeline library of the parts of it in flgParts.
+	VkPipeline CreateGraphicsPipeline(const PipelineState &psState, uint32_t flgParts = PIPELINE_PARTS_ALL);
+	// Describe the vertex attributes a vertex shader reads from the vertex layout. Throws if the layout doesn't have an
+	// input of the shader.
+	static std::vector<VkVertexInputAttributeDescription> GetVertexAttributeDescriptions(VertexLayout idVertexLayout, const ShaderInterface &ifcVertexShader);
+	// Check that a shader reads only the materials' descriptors and push constants, so it works with their layout.
+	void CheckMaterialShader(const std::string &strAssetName, const ShaderInterface &ifcShader) const;
+	// Destroy the pipeline libraries, after waiting for those still compiling.
+	void DestroyPipelineLibraries();
+	// Get the libraries of the parts of a pipeline state, in the order of the parts. Libraries that don't exist yet are
+	// compiled on workers.
+	std::vector<std::shared_ptr<PipelineLibrary>> RequestPipelineLibraries(const PipelineState &psState);
+	// Link a graphics pipeline from the libraries of its parts, waiting for them first. A fast link takes
+	// microseconds, an optimized link about as long as creating the pipeline whole.
+	VkPipeline LinkGraphicsPipeline(const std::vector<std::shared_ptr<PipelineLibrary>> &aplLibraries, bool bOptimize);
+	// Link the pipeline with an id from its libraries on a worker. An optimized link replaces the pipeline once it is
+	// collected.
+	void RequestPipelineLink(uint32_t idPipeline, const std::vector<std::shared_ptr<PipelineLibrary>> &aplLibraries, bool bOptimize);
+	// Get the id of the graphics pipeline of a state. The first time the state is seen, its pipeline is compiled on a
+	// worker and stays null until it is collected; workers compile pipelines in the order they are requested.
+	uint32_t RequestGraphicsPipeline(const PipelineState &psState);
+	// Get the id of the graphics pipeline of a state, waiting for the pipeline if it isn't compiled yet.
+	uint32_t FindGraphicsPipeline(const PipelineState &psState);
+	// Request the pipelines the model's materials are drawn with now, in the order they are first drawn; the ubershader
+	// pipelines of all materials go first, then the specialized ones. Called again when the materials' textures change.
+	void RequestMaterialPipelines();
+	// Collect the pipelines compiled on workers. Returns true if any were, so commands are recorded with them.
+	bool UpdateGraphicsPipelines();
+	// Wait for the pipelines being compiled or optimized on workers and collect them. Returns true if any were
+	// collected.
+	bool WaitForGraphicsPipelines();
+	// Are pipelines still being compiled or fast linked on workers? Pipelines being optimized don't count.
+	bool IsCompilingPipelines() const;
+	// Get the pipeline a material is drawn with. Until the material's specialized pipeline is compiled, it is drawn with
+	// the ubershader.
+	VkPipeline GetMaterialPipeline(uint32_t iMaterial) const;
+	// Get the fragment shader the materials are drawn with, the bindless one if textures are bound bindless.
+	const char *GetFragmentShaderAsset() const;
+	// Get the pipeline state of opaque meshes drawn with the ubershader, the state materials start from.
+	PipelineState GetDefaultPipelineState();
+	// Get the specialized pipeline state a material is drawn with.
+	PipelineState GetMaterialPipelineState(uint32_t iMaterial);
+	// Get the state that draws like the given one, but with the ubershader.
+	PipelineState GetUbershaderPipelineState(const PipelineState &psState);
 
     // Create the framebuffers.
     void CreateFramebuffers();
@@ -188,6 +414,11 @@ private:
 
     // Record the command buffers - NOTE: this is for the simple drawing from the tutorial.
     void RecordCommandBuffers();
+    // Begin rendering to a swap chain image and the depth buffer with dynamic rendering, clearing them; moves the image
+    // to the color attachment layout first.
+    void RecordBeginRendering(VkCommandBuffer vkhCommandBuffer, uint32_t iImage, const std::array<VkClearValue, 2> &acolClearColors);
+    // End dynamic rendering to a swap chain image, and move the image to the layout it is presented in.
+    void RecordEndRendering(VkCommandBuffer vkhCommandBuffer, uint32_t iImage);
 
     // Create semaphores for syncing buffer and renderer access.
     void CreateSemaphores();
@@ -197,13 +428,83 @@ private:
     // Create resources needed for depth testing.
     void CreateDepthResources();
 
-    // Create a texture.
-    void CreateTextureImage();
+    // Pick the formats textures are compressed to, the first of the preferred formats the device can sample.
+    void SelectTextureFormats();
+    // Create a texture from an image in the asset package, with a full mip chain.
+    void CreateTextureImage(const std::string &strAssetName, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat);
+    // Decode images straight into their staging buffers, all of them at once on the thread pool.
+    void DecodeTextureImages(std::vector<TextureUpload> &aupUploads);
+    // Create a texture from an image decoded into a staging buffer, with a full mip chain. The staging buffer is destroyed.
+    void CreateTextureImageFromUpload(const TextureUpload &upUpload, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat);
+    // Import an image into its texture file if the file is out of date, returns the name of the texture file.
+    std::string ImportTextureFile(const std::string &strFilename);
+    // Create a texture from a KTX2 texture file, uploading all its levels as they are.
+    void CreateCompressedTextureImage(const std::string &strFilename, VkImage &vkhImage, VkDeviceMemory &vkhMemory, uint32_t &ctMipLevels, VkFormat &fmtFormat);
+    // Create an image with all the levels of a texture file, and upload the levels from iFirstLevel to the smallest one.
+    void CreateTextureImageFromFile(const KtxFile &ktxTexture, uint32_t iFirstLevel, VkImage &vkhImage, VkDeviceMemory &vkhMemory);
+    // Create an image array with one texture file in each layer, with all their levels, and upload the levels from
+    // iFirstLevel to the smallest one; the finer ones are left for streaming to fill in. The files must all have the
+    // same format, size and number of levels.
+    void CreateTextureArrayFromFiles(const std::vector<const KtxFile *> &aktxLayers, uint32_t iFirstLevel, VkImage &vkhImage, VkDeviceMemory &vkhMemory);
+    // Pack the small textures of materials into texture arrays, the owner of each array is the material in its first
+    // layer. Marks the textures that were packed.
+    void PackMaterialTextures(const std::vector<uint32_t> &aiMaterials, const std::vector<std::string> &astrTextureFilenames, std::vector<bool> &abPacked);
+    // Create the texture of a material with only its smallest levels resident, the rest is streamed in when needed.
+    void CreateStreamedTexture(const std::string &strTextureFilename, uint32_t iMaterial);
+    // Start copying the level above a streamed texture's first level from its file to the staging ring in the
+    // background. Returns false if the ring has no room for it yet.
+    bool StartTextureLevelLoad(uint32_t idTexture);
+    // Record copying the level above a streamed texture's first level from the staging ring into its image, in the
+    // frame's uploads, and make it the first level.
+    void UploadStreamedLevel(MaterialResources &resMaterial, VkDeviceSize iStagingOffset);
+    // Point the view of a streamed texture at another first level, the levels above it aren't sampled. The caller
+    // updates the descriptor sets.
+    void SetStreamedTextureFirstLevel(MaterialResources &resMaterial, uint32_t iFirstLevel);
+    // Add the virtual texture of a material, its tiles are loaded into the tile cache when they are sampled.
+    void CreateVirtualTexture(const std::string &strTextureFilename, uint32_t iMaterial);
+    // Create the tile cache, the page table and the feedback buffer of virtual textures, and load the coarsest tile of
+    // each texture. They are created, at their smallest, even without virtual textures, as the fragment shader binds them.
+    void CreateVirtualTextureCache();
+    // Start copying a tile from its file to the staging ring in the background. Returns false if the ring has no room
+    // for it yet.
+    bool StartVirtualTileLoad(const VirtualTextureCache::TileLoad &loadTile);
+    // Record copying the tiles from the staging ring to their slots in the tile cache, in the frame's uploads. The page
+    // table can point to them right away, as the uploads run before the frame samples the cache.
+    void CopyTilesToCache(std::vector<VirtualTileLoad> &aloadTiles);
+    // Upload the page table to its buffer, if it changed.
+    void UpdatePageTableBuffer();
+    // Destroy the tile cache and the buffers of virtual textures.
+    void DestroyVirtualTextureCache();
     // Create a view for the texture.
     void CreateTextureImageVeiw();
     // Create a sampler for the texture.
     void CreateImageSampler();
 
+    // Get the number of levels in a full mip chain of an image.
+    static uint32_t GetMipLevelCount(uint32_t dimWidth, uint32_t dimHeight);
+    // Can the mip chain of an image with the format be generated by blitting?
+    bool CanBlitMipmaps(VkFormat fmtFormat);
+    // Can the mip chain of an image with the format be generated by the downsampling shader?
+    bool CanComputeMipmaps(VkFormat fmtFormat);
+    // Generate the mip chain of an image from its first level, which must be in the transfer destination layout. All
+    // levels are left ready for reading from shaders.
+    void GenerateMipmaps(VkImage vkhImage, VkFormat fmtFormat, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels);
+    // Generate the mip chain by blitting each level into the next one.
+    void GenerateMipmapsWithBlit(VkImage vkhImage, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels);
+    // Generate the mip chain with the downsampling shader, several levels per dispatch.
+    void GenerateMipmapsWithCompute(VkImage vkhImage, VkFormat fmtFormat, uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels);
+    // Create the pipeline of the downsampling shader.
+    void CreateMipPipeline();
+    // Destroy the pipeline of the downsampling shader, if it was created.
+    void DestroyMipPipeline();
+    // Update the texture descriptors of the materials, after the textures or the sampler change. If only the views of
+    // the textures and the sampler changed, the buffers of virtual textures are left as they are; the bindless set
+    // stays valid while bound after such an update, so the commands needn't be recorded again.
+    void UpdateMaterialDescriptorSets(bool bTexturesOnly = false);
+
+    // Create the queries that measure the GPU time of frames.
+    void CreateFrameTimeQueries();
+
     // Find the format to use for depth.
     VkFormat FindDepthFormat();
     // Find the first supported format from a list of formats.
@@ -211,46 +512,104 @@ private:
     // Does the format have the stencil component
     bool FormatHasStencilComponent(VkFormat fmtFormat);
 
-    // Create an image view
-    VkImageView CreateImageView(VkImage vkhImage, VkFormat fmtFormat, VkImageAspectFlags flagImageAspect);
-    // Create an image.
-    void CreateImage(uint32_t dimWidth, uint32_t dimHeight, VkFormat fmtFormat, VkImageTiling imtTiling, VkImageUsageFlags flagUsage, VkMemoryPropertyFlags flagMemoryProperties, VkImage &vkhImage, VkDeviceMemory &vkhMemory);
-    // Change image layout to what is needed for rendering.
-    void TransitionImageLayout(VkImage vkhImage, VkFormat fmtFormat, VkImageLayout imlOldLayout, VkImageLayout imlNewLayout);
+    // Create an image view of ctMipLevels levels of an image, from iBaseMipLevel on. Material textures are viewed as arrays, even
+    // when they have a single layer, as that is what the fragment shader samples.
+    VkImageView CreateImageView(VkImage vkhImage, VkFormat fmtFormat, VkImageAspectFlags flagImageAspect, uint32_t ctMipLevels, uint32_t iBaseMipLevel = 0,
+        VkImageViewType vitType = VK_IMAGE_VIEW_TYPE_2D, uint32_t ctLayers = 1);
+    // Create an image, or an image array of ctLayers layers.
+    void CreateImage(uint32_t dimWidth, uint32_t dimHeight, uint32_t ctMipLevels, VkFormat fmtFormat, VkImageTiling imtTiling, VkImageUsageFlags flagUsage, VkMemoryPropertyFlags flagMemoryProperties, VkImage &vkhImage, VkDeviceMemory &vkhMemory,
+        uint32_t ctLayers = 1);
+    // Change image layout to what is needed for rendering, for the first ctMipLevels levels of the first ctLayers layers.
+    void TransitionImageLayout(VkImage vkhImage, VkFormat fmtFormat, VkImageLayout imlOldLayout, VkImageLayout imlNewLayout, uint32_t ctMipLevels, uint32_t ctLayers = 1);
     // Copy a buffer to the image.
     void CoypBufferToImage(VkBuffer vkhBuffer, VkImage vkhImage, uint32_t dimWidth, uint32_t dimHeight);
+    // Copy regions of a buffer to the image, e.g. one per mip level.
+    void CopyBufferToImageRegions(VkBuffer vkhBuffer, VkImage vkhImage, const std::vector<VkBufferImageCopy> &ainfoRegions);
 
     // Load the example model.
     void LoadModel();
+    // Set up the model's materials with the default texture, and request their textures - each image is imported on a
+    // worker, and the materials switch to their textures once all images are done.
+    void CreateMaterials();
+    // Create the textures of the model's materials from their imported images, once all of them are done.
+    void FinishMaterialTextures();
+    // Destroy the textures of the model's materials, the materials are left with the default texture.
+    void DestroyMaterialTextures();
+    // Destroy the model's materials and their textures, waiting for the imports still in progress.
+    void DestroyMaterials();
 
     // Create vertex buffer.
     void CreateVertexBuffers();
     // Create index buffer.
     void CreateIndexBuffers();
-    // Create uniform buffer.
+    // Create the frame's uniform buffer and the object buffer.
     void CreateUniformBuffers();
 
     // Create the descriptor pool.
     void CreateDescriptorPool();
-    // Create the descriptor set.
-    void CreateDescriptorSet();
+    // Create the descriptor sets, one for each material.
+    void CreateDescriptorSets();
+
+    // Set up culling of the model's meshlets on the GPU, if the model has meshlets and culling is enabled.
+    void InitializeMeshletCulling();
+    // Create the buffers the culling pass reads from and writes to.
+    void CreateMeshletBuffers();
+    // Create the descriptor set layout for the culling pass.
+    void CreateCullDescriptorSetLayout();
+    // Create the compute pipeline that culls meshlets.
+    void CreateCullPipeline();
+    // Create the descriptor set for the culling pass.
+    void CreateCullDescriptorSet();
+    // Point the culling descriptor set to the current buffers.
+    void WriteCullDescriptorSet();
+    // Record the culling pass - must be recorded outside of a render pass.
+    void RecordMeshletCulling(VkCommandBuffer vkhCommandBuffer);
+    // Destroy all resources used by meshlet culling.
+    void DestroyMeshletCulling();
+    // Destroy the buffers the culling pass reads from and writes to.
+    void DestroyMeshletBuffers();
 
     // Get the graphics memory type with the desired properties.
     uint32_t FindMemoryType(uint32_t flgTypeFilter, VkMemoryPropertyFlags flgProperties);
 
     // Create a buffer - vertex, transfer, index...
     void CreateBuffer(VkDeviceSize ctSize, VkBufferUsageFlags flgBufferUsage, VkMemoryPropertyFlags flagMemoryProperties, VkBuffer &vkhBuffer, VkDeviceMemory &vkhMemory);
+    // Create a device local buffer and fill it with data through a staging buffer.
+    void CreateBufferWithData(const void *pData, VkDeviceSize ctSize, VkBufferUsageFlags flgBufferUsage, VkBuffer &vkhBuffer, VkDeviceMemory &vkhMemory);
     // Copy memory from one buffer to the other.
     void CopyBuffer(VkBuffer vkhSourceBuffer, VkBuffer vkhDestinationBuffer, VkDeviceSize ctSize);
+    // Allocate room for a load in the staging ring. The ring is created on first use, and made larger when it is empty
+    // and the load doesn't fit it. Returns false if there is no room until earlier loads are freed.
+    bool AllocateStaging(VkDeviceSize ctBytes, VkDeviceSize &iOffset);
+    // Destroy the staging ring, all its loads must be freed.
+    void DestroyStagingRing();
     // Start one time command recording.
     VkCommandBuffer BeginOneTimeCommand();
     // Finish one time command recording.
     void EndOneTimeCommand(VkCommandBuffer vkhCommandBuffer);
+    // Get the command buffer of the frame's uploads, recording starts on first use. The uploads are submitted with the
+    // frame, ahead of its drawing commands.
+    VkCommandBuffer GetFrameUploadCommandBuffer();
+    // Run the frame's uploads now and wait for them, for when they can't wait for the frame.
+    void FlushFrameUploads();
+    // Free the frame's upload commands and their room in the staging ring, once the device is done with them.
+    void FinishFrameUploads();
 
 private:
     // Handle to the vulkan instance.
     VkInstance vkhAPIInstance;
 
+    // Package the assets are loaded from, mapped for the lifetime of the API.
+    AssetPackage pkgAssets;
+    // Assets loading in the background, updated at the start of each frame.
+    AssetManager amAssets;
+    // Watches the loose files of the assets for changes.
+    FileWatcher fwAssetFiles;
+    // Assets reloaded from their loose files, used instead of the ones in the package, by name.
+    std::map<std::string, std::vector<char>> mapReloadedAssets;
+    // Assets that reload changed files, by the file's name.
+    std::map<std::string, AssetHandle> mapReloadHandles;
+
     // Handle to the window surface that the render buffers will be presented to.
     VkSurfaceKHR sfcSurface;
     // Capabilities of the drawing surface.
@@ -281,6 +640,17 @@ private:
     // Logical device used.
     VkDevice vkhLogicalDevice;
 
+    // Cache of compiled pipelines, shared by all pipelines and kept on disk between runs.
+    VkPipelineCache vkhPipelineCache = VK_NULL_HANDLE;
+    // Was the cache created with data saved by a previous run?
+    bool bPipelineCacheLoaded = false;
+    // Size of the cache data when it was last saved, the cache is only saved again once it grew.
+    size_t ctSavedPipelineCacheBytes = 0;
+    // When the cache was last saved, it is saved every now and then so a crash doesn't lose it.
+    std::chrono::steady_clock::time_point tmPipelineCacheSaved;
+    // Ready when the last save on a worker is done.
+    std::future<void> futPipelineCacheSaved;
+
     // Index of a queue family that supports graphics commands.
     int iGraphicsQueueFamily = { -1 };
     // Handle to the queue to submit graphics commands to.
@@ -291,18 +661,38 @@ private:
     // Handle to the queue to use for presentation.
     VkQueue vkhPresentationQueue;
 
-	// Render pass applied to render objects.
-	VkRenderPass vkhRenderPass;
+	// Render pass applied to render objects. Null with dynamic rendering.
+	VkRenderPass vkhRenderPass = VK_NULL_HANDLE;
 	
-    // Descriptor set layout for uniform buffers.
+    // Descriptor set layout of the materials, and the bindings it was reflected with, the bindless texture array given
+    // its size; the materials' descriptor sets are allocated with it, so the layout stays for the whole run.
     VkDescriptorSetLayout vkhDescriptorSetLayout;
-
-    // Layout of the graphics pipeline.
-	VkPipelineLayout vkhPipelineLayout;
-    // Graphics pipeline.
-    VkPipeline vkhPipeline;
-
-    // Framebuffers used to draw.
+    std::vector<VkDescriptorSetLayoutBinding> abndMaterialBindings;
+    // Descriptor set and pipeline layouts by the hash of what they are made of, shared by all the shaders that have the
+    // same interface.
+    std::unordered_map<uint64_t, VkDescriptorSetLayout> mapDescriptorSetLayouts;
+    std::unordered_map<uint64_t, VkPipelineLayout> mapPipelineLayouts;
+
+    // Layout of the graphics pipeline, and the range of the material constants pushed for each draw.
+	VkPipelineLayout vkhPipelineLayout = VK_NULL_HANDLE;
+	VkPushConstantRange rngMaterialPushConstants = {};
+    // States of the graphics pipelines, their pipelines and the id of each state's pipeline; pipelines are created
+    // once per unique state, so materials that describe the same state share one.
+    std::vector<PipelineState> apsPipelineStates;
+    std::vector<VkPipeline> avkhPipelines;
+    // Did the pipeline of a state fail to compile? Its materials use the ubershader instead.
+    std::vector<bool> abFailedPipelines;
+    std::unordered_map<PipelineState, uint32_t, PipelineStateHash> mapPipelineIds;
+    // Id of the pipeline of the default state. It is always compiled, and stands in while a material's ubershader
+    // pipeline compiles.
+    uint32_t idDefaultPipeline = 0;
+    // Libraries of each pipeline part, by the state of the part. Only used if bPipelineLibraries.
+    std::array<std::unordered_map<PipelineState, std::shared_ptr<PipelineLibrary>, PipelineStateHash>, CT_PIPELINE_LIBRARY_PARTS> amapPipelineLibraries;
+    // Graphics pipelines being compiled on workers, and when the first of them was requested.
+    std::vector<PipelineCompile> acmpPipelineCompiles;
+    std::chrono::steady_clock::time_point tmPipelineCompilesStarted;
+
+    // Framebuffers used to draw. Empty with dynamic rendering, which draws to the image views directly.
     std::vector<VkFramebuffer> avkhFramebuffers;
 
     // Command pool that will hold command buffers.
@@ -326,8 +716,90 @@ private:
     VkDeviceMemory vkhImageMemory;
     // Image view describing how to access the image.
     VkImageView vkhImageView;
+    // Number of mip levels and format of the image.
+    uint32_t ctImageMipLevels;
+    VkFormat fmtImageFormat;
     // Sampler used in the fragment shader to read from the texture.
     VkSampler vkhImageSampler;
+    // Most mip levels any texture has, the sampler's level range covers them all.
+    uint32_t ctMaxTextureMipLevels = 1;
+    // Are the smaller mip levels of textures sampled?
+    bool bTextureMipmapsEnabled = true;
+    // Was the block compressed texture feature enabled on the device?
+    bool bTextureCompressionBC = false;
+    // Were the extended physical device queries enabled on the instance? Pipeline library support is queried with them.
+    bool bPhysicalDeviceProperties2 = false;
+    // Were pipeline libraries enabled on the device? Pipelines are linked from precompiled parts if they were, and
+    // created whole otherwise.
+    bool bPipelineLibraries = false;
+    // Was dynamic rendering enabled on the device? Frames are drawn without render pass and framebuffer objects if it
+    // was, and pipelines are created for the formats of the attachments.
+    bool bDynamicRendering = false;
+    // Were descriptor indexing features enabled on the device? The textures of all materials are bound through one
+    // descriptor set if they were, each material picks its own by index; each texture owner has a set of its own
+    // otherwise.
+    bool bBindlessTextures = false;
+#ifdef VK_KHR_dynamic_rendering
+    // Commands that begin and end dynamic rendering, looked up as the extension isn't core in Vulkan 1.0.
+    PFN_vkCmdBeginRenderingKHR pfnCmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR pfnCmdEndRendering = nullptr;
+#endif
+    // Formats textures are compressed to, for images without and with transparency. Both are RGBA8 when textures
+    // aren't compressed.
+    VkFormat fmtOpaqueTexture = VK_FORMAT_R8G8B8A8_UNORM;
+    VkFormat fmtTranslucentTexture = VK_FORMAT_R8G8B8A8_UNORM;
+    // Are textures loaded from texture files, because they are compressed or streamed?
+    bool bUseTextureFiles = false;
+
+    // Residency of the streamed textures, the materials they belong to, by texture id, their levels being loaded and
+    // the textures whose levels wait for room in the staging ring.
+    TextureStreamer stmTextures;
+    std::vector<uint32_t> aiStreamedMaterials;
+    std::vector<TextureLevelLoad> aloadTextureLevels;
+    std::vector<uint32_t> aidWaitingTextureLevels;
+
+    // Slots of the tile cache of virtual textures, the materials they belong to, by texture id, their tiles being
+    // loaded and the tiles that wait for room in the staging ring.
+    VirtualTextureCache vtcVirtualTextures;
+    std::vector<uint32_t> aiVirtualMaterials;
+    std::vector<VirtualTileLoad> aloadVirtualTiles;
+    std::vector<VirtualTextureCache::TileLoad> aloadWaitingVirtualTiles;
+    // Texture all virtual textures' tiles are cached in, in the format of their files.
+    VkImage vkhTileCacheImage;
+    VkDeviceMemory vkhTileCacheMemory;
+    VkImageView vkhTileCacheView;
+    VkFormat fmtTileCache;
+    // Page table mapping each tile to the slot of the finest resident tile covering it.
+    VkBuffer vkhPageTableBuffer;
+    VkDeviceMemory vkhPageTableMemory;
+    // One bit per page table entry, set by the fragment shader when it samples the tile.
+    VkBuffer vkhFeedbackBuffer;
+    VkDeviceMemory vkhFeedbackMemory;
+    VkDeviceSize ctFeedbackBytes;
+
+    // Staging buffer that streamed texture levels and virtual texture tiles are copied into, sub-allocated as a ring
+    // and mapped for as long as it exists, and the books of the loads in it.
+    StagingRing srStaging;
+    VkBuffer vkhStagingRingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vkhStagingRingMemory = VK_NULL_HANDLE;
+    char *pchStagingRingMemory = nullptr;
+    // Commands that upload streamed texture levels and virtual texture tiles for the current frame, null until there is
+    // something to upload, and the room in the staging ring they copy from.
+    VkCommandBuffer vkhFrameUploadCommandBuffer = VK_NULL_HANDLE;
+    std::vector<VkDeviceSize> aiFrameUploadStaging;
+
+    // Descriptor set layout, pipeline layout and pipeline of the downsampling shader, created on first use.
+    VkDescriptorSetLayout vkhMipDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout vkhMipPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline vkhMipPipeline = VK_NULL_HANDLE;
+
+    // Timestamps written at the start and the end of each command buffer, null if the queue doesn't support them.
+    VkQueryPool vkhFrameTimeQueryPool = VK_NULL_HANDLE;
+    // Nanoseconds per timestamp tick, and the bits of a timestamp that are valid.
+    float fTimestampPeriod;
+    uint64_t flgTimestampMask;
+    // GPU time of the last frame in milliseconds.
+    double tmLastFrame = 0.0;
 
     // Depth image that fragment depth will be written to and tested with.
     VkImage vkhDepthImageData;
@@ -341,14 +813,48 @@ private:
     // Memory used by the index buffer.
     VkDeviceMemory vkhIndexBufferMemory;
 
-    // Uniform buffer holding the order of vertices in triangles.
+    // Uniform buffer holding the camera of the frame.
     VkBuffer vkhUniformBuffer;
     // Memory used by the uniform buffer.
     VkDeviceMemory vkhUniformBufferMemory;
+    // Storage buffer holding the model transform of each object, written once per frame; draws never write it.
+    VkBuffer vkhObjectBuffer;
+    VkDeviceMemory vkhObjectBufferMemory;
 
     // Descriptor pool used to allocate descriptor sets.
     VkDescriptorPool vkhDescriptorPool;
-    // Descriptor set that will hold the uniform buffer.
-    VkDescriptorSet vkhDescriptorSet;
+    // Textures and descriptor sets of the model's materials.
+    std::vector<MaterialResources> aresMaterials;
+    // One descriptor set for each material, only those of texture owners are bound.
+    std::vector<VkDescriptorSet> avkhMaterialDescriptorSets;
+    // Id of the specialized graphics pipeline each material is drawn with, and of its ubershader pipeline, which is
+    // used until the specialized one is compiled.
+    std::vector<uint32_t> aidMaterialPipelines;
+    std::vector<uint32_t> aidMaterialFallbackPipelines;
+    // Image files of the materials' textures being imported, and the asset that creates the textures once they are.
+    std::vector<std::shared_ptr<TextureImport>> aimpTextureImports;
+    AssetHandle hMaterialTextures;
+
+    // Is the model drawn through the meshlet culling pass?
+    bool bCullMeshlets = false;
+    // Buffer holding the meshlet descriptions.
+    VkBuffer vkhMeshletBuffer;
+    VkDeviceMemory vkhMeshletBufferMemory;
+    // Index buffer the culling pass writes the triangles of visible meshlets to.
+    VkBuffer vkhCulledIndexBuffer;
+    VkDeviceMemory vkhCulledIndexBufferMemory;
+    // Indirect draw commands, one per submesh, the culling pass writes the number of visible indices into them.
+    VkBuffer vkhDrawCommandBuffer;
+    VkDeviceMemory vkhDrawCommandBufferMemory;
+    // Draw commands with no visible indices, the commands of the drawn level of detail are reset to them each frame.
+    std::vector<VkDrawIndexedIndirectCommand> acmdEmptyDraws;
+    // Uniform buffer holding the culling parameters.
+    VkBuffer vkhCullUniformBuffer;
+    VkDeviceMemory vkhCullUniformBufferMemory;
+    // Descriptor set layout, set, pipeline layout and pipeline of the culling pass.
+    VkDescriptorSetLayout vkhCullDescriptorSetLayout;
+    VkDescriptorSet vkhCullDescriptorSet;
+    VkPipelineLayout vkhCullPipelineLayout;
+    VkPipeline vkhCullPipeline;
 };
 
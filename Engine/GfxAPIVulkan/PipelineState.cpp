@@ -0,0 +1,109 @@
+#include "../PrecompiledHeader.h"
+#include "PipelineState.h"
+
+
+// Mix a value into an FNV-1a hash, a byte at a time.
+static void HashBytes(uint64_t &idHash, const void *pData, size_t ctBytes) {
+    const uint8_t *pbData = static_cast<const uint8_t *>(pData);
+    for (size_t iByte = 0; iByte < ctBytes; iByte++) {
+        idHash ^= pbData[iByte];
+        idHash *= 0x100000001B3ULL;
+    }
+}
+
+// Mix a fixed size field into the hash.
+template<typename Type>
+static void HashField(uint64_t &idHash, const Type &tValue) {
+    HashBytes(idHash, &tValue, sizeof(tValue));
+}
+
+
+bool PipelineState::operator == (const PipelineState &psOther) const {
+    return strVertexShader == psOther.strVertexShader && strFragmentShader == psOther.strFragmentShader
+        && idTexturing == psOther.idTexturing && bVertexColor == psOther.bVertexColor && bAlphaTest == psOther.bAlphaTest
+        && idVertexLayout == psOther.idVertexLayout && topTopology == psOther.topTopology
+        && pmPolygonMode == psOther.pmPolygonMode && flgCullMode == psOther.flgCullMode && ffFrontFace == psOther.ffFrontFace
+        && bDepthTest == psOther.bDepthTest && bDepthWrite == psOther.bDepthWrite && opDepthCompare == psOther.opDepthCompare
+        && bBlend == psOther.bBlend && bfSourceColor == psOther.bfSourceColor && bfDestinationColor == psOther.bfDestinationColor
+        && opColorBlend == psOther.opColorBlend && bfSourceAlpha == psOther.bfSourceAlpha && bfDestinationAlpha == psOther.bfDestinationAlpha
+        && opAlphaBlend == psOther.opAlphaBlend
+        && fmtColor == psOther.fmtColor && fmtDepth == psOther.fmtDepth && ctSamples == psOther.ctSamples;
+}
+
+
+// Hash of the whole state, field by field as the struct has padding and strings.
+uint64_t PipelineState::GetHash() const {
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    // the names are hashed with their terminating zeros, so their boundary counts
+    HashBytes(idHash, strVertexShader.c_str(), strVertexShader.size() + 1);
+    HashBytes(idHash, strFragmentShader.c_str(), strFragmentShader.size() + 1);
+    HashField(idHash, idTexturing);
+    HashField(idHash, bVertexColor);
+    HashField(idHash, bAlphaTest);
+    HashField(idHash, idVertexLayout);
+    HashField(idHash, topTopology);
+    HashField(idHash, pmPolygonMode);
+    HashField(idHash, flgCullMode);
+    HashField(idHash, ffFrontFace);
+    HashField(idHash, bDepthTest);
+    HashField(idHash, bDepthWrite);
+    HashField(idHash, opDepthCompare);
+    HashField(idHash, bBlend);
+    HashField(idHash, bfSourceColor);
+    HashField(idHash, bfDestinationColor);
+    HashField(idHash, opColorBlend);
+    HashField(idHash, bfSourceAlpha);
+    HashField(idHash, bfDestinationAlpha);
+    HashField(idHash, opAlphaBlend);
+    HashField(idHash, fmtColor);
+    HashField(idHash, fmtDepth);
+    HashField(idHash, ctSamples);
+    return idHash;
+}
+
+
+// Get the state with only the fields of a part.
+PipelineState PipelineState::GetPart(PipelineLibraryPart idPart) const {
+    PipelineState psPart = {};
+    // every part but the vertex input is compiled against the render pass' attachments
+    if (idPart != PIPELINE_PART_VERTEX_INPUT) {
+        psPart.fmtColor = fmtColor;
+        psPart.fmtDepth = fmtDepth;
+        psPart.ctSamples = ctSamples;
+    }
+    switch (idPart) {
+    case PIPELINE_PART_VERTEX_INPUT:
+        psPart.strVertexShader = strVertexShader;
+        psPart.idVertexLayout = idVertexLayout;
+        psPart.topTopology = topTopology;
+        break;
+    case PIPELINE_PART_PRE_RASTERIZATION:
+        psPart.strVertexShader = strVertexShader;
+        psPart.pmPolygonMode = pmPolygonMode;
+        psPart.flgCullMode = flgCullMode;
+        psPart.ffFrontFace = ffFrontFace;
+        break;
+    case PIPELINE_PART_FRAGMENT_SHADER:
+        psPart.strFragmentShader = strFragmentShader;
+        psPart.idTexturing = idTexturing;
+        psPart.bVertexColor = bVertexColor;
+        psPart.bAlphaTest = bAlphaTest;
+        psPart.bDepthTest = bDepthTest;
+        psPart.bDepthWrite = bDepthWrite;
+        psPart.opDepthCompare = opDepthCompare;
+        break;
+    case PIPELINE_PART_FRAGMENT_OUTPUT:
+        psPart.bBlend = bBlend;
+        psPart.bfSourceColor = bfSourceColor;
+        psPart.bfDestinationColor = bfDestinationColor;
+        psPart.opColorBlend = opColorBlend;
+        psPart.bfSourceAlpha = bfSourceAlpha;
+        psPart.bfDestinationAlpha = bfDestinationAlpha;
+        psPart.opAlphaBlend = opAlphaBlend;
+        break;
+    default:
+        // the whole pipeline
+        return *this;
+    }
+    return psPart;
+}
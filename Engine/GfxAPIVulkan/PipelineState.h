@@ -0,0 +1,86 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+// Layouts of the vertex buffers pipelines read from.
+enum VertexLayout {
+    // Vertex, the layout of meshes.
+    VERTEX_LAYOUT_MESH,
+};
+
+// How a fragment shader variant samples the material's texture. The values match the TEXTURING constant in shader.frag.
+enum MaterialTexturing {
+    // Either way, picked for each draw from the push constants. This is the ubershader.
+    MATERIAL_TEXTURING_ANY = 0,
+    // From a layer of the texture array.
+    MATERIAL_TEXTURING_ARRAY = 1,
+    // Through the page table of virtual textures.
+    MATERIAL_TEXTURING_VIRTUAL = 2,
+    // Not textured, the color comes from the vertices.
+    MATERIAL_TEXTURING_NONE = 3,
+};
+
+// Parts a graphics pipeline is linked from when it is built from pipeline libraries. The values are the bits of
+// VkGraphicsPipelineLibraryFlagBitsEXT, so a set of parts passes to Vulkan as it is.
+enum PipelineLibraryPart {
+    // Vertex layout and topology, with the vertex shader whose inputs the attributes are described from.
+    PIPELINE_PART_VERTEX_INPUT = 0x1,
+    // Vertex shader, viewport and rasterization.
+    PIPELINE_PART_PRE_RASTERIZATION = 0x2,
+    // Fragment shader with its specialization constants, and depth test.
+    PIPELINE_PART_FRAGMENT_SHADER = 0x4,
+    // Blending with the attachments.
+    PIPELINE_PART_FRAGMENT_OUTPUT = 0x8,
+    // The whole pipeline, created in one piece.
+    PIPELINE_PARTS_ALL = 0xF,
+};
+// Number of parts a pipeline is linked from.
+static const uint32_t CT_PIPELINE_LIBRARY_PARTS = 4;
+
+// Everything that tells graphics pipelines apart. A pipeline is created once for each unique state, and whatever
+// draws with the same state shares it. Viewport and scissor aren't part of it, all pipelines cover the swap chain.
+struct PipelineState {
+    // Assets of the compiled vertex and fragment shaders.
+    std::string strVertexShader;
+    std::string strFragmentShader;
+    // Values of the fragment shader's specialization constants. A variant of the shader is compiled for each set, with
+    // the features it doesn't use left out.
+    MaterialTexturing idTexturing;
+    VkBool32 bVertexColor;
+    VkBool32 bAlphaTest;
+    // Layout of the vertices and the primitives they make up.
+    VertexLayout idVertexLayout;
+    VkPrimitiveTopology topTopology;
+    // How primitives are rasterized.
+    VkPolygonMode pmPolygonMode;
+    VkCullModeFlags flgCullMode;
+    VkFrontFace ffFrontFace;
+    // Depth test and write.
+    VkBool32 bDepthTest;
+    VkBool32 bDepthWrite;
+    VkCompareOp opDepthCompare;
+    // How the color output is blended with the framebuffer.
+    VkBool32 bBlend;
+    VkBlendFactor bfSourceColor;
+    VkBlendFactor bfDestinationColor;
+    VkBlendOp opColorBlend;
+    VkBlendFactor bfSourceAlpha;
+    VkBlendFactor bfDestinationAlpha;
+    VkBlendOp opAlphaBlend;
+    // Attachments of the render pass. A pipeline works with every render pass that has the same attachments.
+    VkFormat fmtColor;
+    VkFormat fmtDepth;
+    VkSampleCountFlagBits ctSamples;
+
+    bool operator == (const PipelineState &psOther) const;
+    bool operator != (const PipelineState &psOther) const { return !(*this == psOther); }
+    // Hash of the whole state, equal states have equal hashes.
+    uint64_t GetHash() const;
+    // Get the state with only the fields that go into a part of the pipeline, the others zeroed. Pipelines whose parts
+    // have equal states share the library of that part.
+    PipelineState GetPart(PipelineLibraryPart idPart) const;
+};
+
+// Hashes pipeline states for unordered containers.
+struct PipelineStateHash {
+    size_t operator () (const PipelineState &psState) const { return static_cast<size_t>(psState.GetHash()); }
+};
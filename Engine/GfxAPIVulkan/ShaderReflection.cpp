@@ -0,0 +1,481 @@
+#include "../PrecompiledHeader.h"
+#include "ShaderReflection.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+
+// First word of every SPIR-V module, and the number of words in its header.
+static const uint32_t ID_SPIRV_MAGIC = 0x07230203;
+static const uint32_t CT_SPIRV_HEADER_WORDS = 5;
+
+// The SPIR-V opcodes, decorations, storage classes and execution models that are read, from the SPIR-V specification.
+enum SpirvOp {
+    SPIRV_OP_ENTRY_POINT = 15,
+    SPIRV_OP_TYPE_BOOL = 20,
+    SPIRV_OP_TYPE_INT = 21,
+    SPIRV_OP_TYPE_FLOAT = 22,
+    SPIRV_OP_TYPE_VECTOR = 23,
+    SPIRV_OP_TYPE_MATRIX = 24,
+    SPIRV_OP_TYPE_IMAGE = 25,
+    SPIRV_OP_TYPE_SAMPLER = 26,
+    SPIRV_OP_TYPE_SAMPLED_IMAGE = 27,
+    SPIRV_OP_TYPE_ARRAY = 28,
+    SPIRV_OP_TYPE_RUNTIME_ARRAY = 29,
+    SPIRV_OP_TYPE_STRUCT = 30,
+    SPIRV_OP_TYPE_POINTER = 32,
+    SPIRV_OP_CONSTANT = 43,
+    SPIRV_OP_SPEC_CONSTANT = 50,
+    SPIRV_OP_VARIABLE = 59,
+    SPIRV_OP_DECORATE = 71,
+    SPIRV_OP_MEMBER_DECORATE = 72,
+};
+enum SpirvDecoration {
+    SPIRV_DECORATION_BUFFER_BLOCK = 3,
+    SPIRV_DECORATION_ARRAY_STRIDE = 6,
+    SPIRV_DECORATION_MATRIX_STRIDE = 7,
+    SPIRV_DECORATION_BUILT_IN = 11,
+    SPIRV_DECORATION_LOCATION = 30,
+    SPIRV_DECORATION_BINDING = 33,
+    SPIRV_DECORATION_DESCRIPTOR_SET = 34,
+    SPIRV_DECORATION_OFFSET = 35,
+};
+enum SpirvStorageClass {
+    SPIRV_STORAGE_UNIFORM_CONSTANT = 0,
+    SPIRV_STORAGE_INPUT = 1,
+    SPIRV_STORAGE_UNIFORM = 2,
+    SPIRV_STORAGE_PUSH_CONSTANT = 9,
+    SPIRV_STORAGE_STORAGE_BUFFER = 12,
+};
+enum SpirvExecutionModel {
+    SPIRV_EXECUTION_VERTEX = 0,
+    SPIRV_EXECUTION_FRAGMENT = 4,
+    SPIRV_EXECUTION_GL_COMPUTE = 5,
+};
+// Dimensionality of buffer images, which are texel buffers.
+static const uint32_t ID_SPIRV_DIM_BUFFER = 5;
+// Value of the sampled operand of images that are used without a sampler, which are storage images.
+static const uint32_t ID_SPIRV_IMAGE_STORAGE = 2;
+
+
+// Everything the reflection needs about one id of the module.
+struct SpirvId {
+    // Instruction that declared the id, with its operands after the result id.
+    uint32_t idOpcode = 0;
+    std::vector<uint32_t> aidOperands;
+    // Decorations of the id.
+    bool bBufferBlock = false;
+    bool bBuiltIn = false;
+    uint32_t iLocation = UINT32_MAX;
+    uint32_t iBinding = UINT32_MAX;
+    uint32_t iSet = 0;
+    uint32_t ctArrayStride = 0;
+    // Offsets and matrix strides of the members of a struct.
+    std::vector<uint32_t> actMemberOffsets;
+    std::vector<uint32_t> actMemberMatrixStrides;
+};
+
+
+// Get a member decoration's slot in a struct, growing the list to fit.
+static uint32_t &GetMemberSlot(std::vector<uint32_t> &actMembers, uint32_t iMember) {
+    if (iMember >= actMembers.size()) {
+        actMembers.resize(iMember + 1, 0);
+    }
+    return actMembers[iMember];
+}
+
+
+// Get the value of a constant, such as the length of an array.
+static uint32_t GetConstantValue(const std::unordered_map<uint32_t, SpirvId> &mapIds, uint32_t idConstant) {
+    auto itConstant = mapIds.find(idConstant);
+    if (itConstant == mapIds.end() || (itConstant->second.idOpcode != SPIRV_OP_CONSTANT && itConstant->second.idOpcode != SPIRV_OP_SPEC_CONSTANT)
+        || itConstant->second.aidOperands.size() < 2) {
+        throw std::runtime_error("Shader array length isn't a constant");
+    }
+    // the operands are the result type and the value, 32 bit lengths fit the first word
+    return itConstant->second.aidOperands[1];
+}
+
+
+// Get the declaration of a type id.
+static const SpirvId &GetType(const std::unordered_map<uint32_t, SpirvId> &mapIds, uint32_t idType) {
+    auto itType = mapIds.find(idType);
+    if (itType == mapIds.end()) {
+        throw std::runtime_error("Shader references an undeclared type");
+    }
+    return itType->second;
+}
+
+
+// Get the size of a type in a buffer block, in bytes.
+static uint32_t GetTypeSize(const std::unordered_map<uint32_t, SpirvId> &mapIds, uint32_t idType, uint32_t ctMatrixStride) {
+    const SpirvId &idDeclaration = GetType(mapIds, idType);
+    switch (idDeclaration.idOpcode) {
+    case SPIRV_OP_TYPE_BOOL:
+        return 4;
+    case SPIRV_OP_TYPE_INT:
+    case SPIRV_OP_TYPE_FLOAT:
+        return idDeclaration.aidOperands[0] / 8;
+    case SPIRV_OP_TYPE_VECTOR:
+        return GetTypeSize(mapIds, idDeclaration.aidOperands[0], 0) * idDeclaration.aidOperands[1];
+    case SPIRV_OP_TYPE_MATRIX:
+        // columns are apart by the stride the member was decorated with
+        if (ctMatrixStride == 0) {
+            ctMatrixStride = GetTypeSize(mapIds, idDeclaration.aidOperands[0], 0);
+        }
+        return ctMatrixStride * idDeclaration.aidOperands[1];
+    case SPIRV_OP_TYPE_ARRAY:
+        return idDeclaration.ctArrayStride * GetConstantValue(mapIds, idDeclaration.aidOperands[1]);
+    case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+        // the unsized array at the end of a buffer takes no room of its own
+        return 0;
+    case SPIRV_OP_TYPE_STRUCT: {
+        // the struct ends with the member that ends last
+        uint32_t ctBytes = 0;
+        for (uint32_t iMember = 0; iMember < idDeclaration.aidOperands.size(); iMember++) {
+            const uint32_t ctOffset = iMember < idDeclaration.actMemberOffsets.size() ? idDeclaration.actMemberOffsets[iMember] : 0;
+            const uint32_t ctStride = iMember < idDeclaration.actMemberMatrixStrides.size() ? idDeclaration.actMemberMatrixStrides[iMember] : 0;
+            ctBytes = std::max(ctBytes, ctOffset + GetTypeSize(mapIds, idDeclaration.aidOperands[iMember], ctStride));
+        }
+        return ctBytes;
+    }
+    default:
+        throw std::runtime_error("Shader buffer has a member of an unknown type");
+    }
+}
+
+
+// Get the vertex attribute format that feeds an input of a type.
+static VkFormat GetVertexInputFormat(const std::unordered_map<uint32_t, SpirvId> &mapIds, uint32_t idType) {
+    const SpirvId &idDeclaration = GetType(mapIds, idType);
+    uint32_t ctComponents = 1;
+    const SpirvId *pidComponent = &idDeclaration;
+    if (idDeclaration.idOpcode == SPIRV_OP_TYPE_VECTOR) {
+        ctComponents = idDeclaration.aidOperands[1];
+        pidComponent = &GetType(mapIds, idDeclaration.aidOperands[0]);
+    }
+    if ((pidComponent->idOpcode != SPIRV_OP_TYPE_FLOAT && pidComponent->idOpcode != SPIRV_OP_TYPE_INT) || pidComponent->aidOperands[0] != 32
+        || ctComponents < 1 || ctComponents > 4) {
+        throw std::runtime_error("Vertex shader input isn't a 32 bit scalar or vector");
+    }
+
+    static const VkFormat afmtFloat[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat afmtSigned[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat afmtUnsigned[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+    if (pidComponent->idOpcode == SPIRV_OP_TYPE_FLOAT) {
+        return afmtFloat[ctComponents - 1];
+    }
+    return pidComponent->aidOperands[1] != 0 ? afmtSigned[ctComponents - 1] : afmtUnsigned[ctComponents - 1];
+}
+
+
+// Get the type of descriptor that holds a variable, and the number of descriptors.
+static VkDescriptorType GetDescriptorType(const std::unordered_map<uint32_t, SpirvId> &mapIds, uint32_t idStorageClass, uint32_t idType, uint32_t &ctDescriptors) {
+    // arrays of resources take a descriptor for each element, unsized arrays are counted as 0 and get the size of the
+    // set layout they are bound with
+    const SpirvId *pidType = &GetType(mapIds, idType);
+    ctDescriptors = 1;
+    if (pidType->idOpcode == SPIRV_OP_TYPE_ARRAY) {
+        ctDescriptors = GetConstantValue(mapIds, pidType->aidOperands[1]);
+        pidType = &GetType(mapIds, pidType->aidOperands[0]);
+    } else if (pidType->idOpcode == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+        ctDescriptors = 0;
+        pidType = &GetType(mapIds, pidType->aidOperands[0]);
+    }
+
+    // buffers are told apart by their storage class, and by the decoration of the block in older SPIR-V
+    if (idStorageClass == SPIRV_STORAGE_STORAGE_BUFFER) {
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    if (idStorageClass == SPIRV_STORAGE_UNIFORM) {
+        return pidType->bBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+    switch (pidType->idOpcode) {
+    case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case SPIRV_OP_TYPE_SAMPLER:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case SPIRV_OP_TYPE_IMAGE: {
+        // the operands are the sampled type, the dimensionality, depth, arrayed, multisampled, sampled and format
+        const bool bStorage = pidType->aidOperands[5] == ID_SPIRV_IMAGE_STORAGE;
+        if (pidType->aidOperands[1] == ID_SPIRV_DIM_BUFFER) {
+            return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+    default:
+        throw std::runtime_error("Shader declares a resource of an unknown type");
+    }
+}
+
+
+// Read the interface of a shader's entry point.
+ShaderInterface ShaderReflection::Reflect(const char *pchCode, uint64_t ctBytes) {
+    // the code is a stream of words, copied as the data isn't necessarily aligned
+    if (ctBytes % 4 != 0 || ctBytes < CT_SPIRV_HEADER_WORDS * 4) {
+        throw std::runtime_error("Shader code isn't SPIR-V");
+    }
+    std::vector<uint32_t> aidWords(static_cast<size_t>(ctBytes / 4));
+    memcpy(aidWords.data(), pchCode, static_cast<size_t>(ctBytes));
+    if (aidWords[0] != ID_SPIRV_MAGIC) {
+        throw std::runtime_error("Shader code isn't SPIR-V");
+    }
+
+    // collect the declarations and decorations of all ids; the reflection only needs the types, constants and global
+    // variables, which all come before the functions
+    std::unordered_map<uint32_t, SpirvId> mapIds;
+    std::vector<uint32_t> aidVariables;
+    uint32_t idExecutionModel = UINT32_MAX;
+    for (size_t iWord = CT_SPIRV_HEADER_WORDS; iWord < aidWords.size(); ) {
+        const uint32_t idOpcode = aidWords[iWord] & 0xFFFF;
+        const uint32_t ctWords = aidWords[iWord] >> 16;
+        if (ctWords == 0 || iWord + ctWords > aidWords.size()) {
+            throw std::runtime_error("Shader code is damaged");
+        }
+        const uint32_t *pidOperands = &aidWords[iWord + 1];
+        const uint32_t ctOperands = ctWords - 1;
+
+        switch (idOpcode) {
+        case SPIRV_OP_ENTRY_POINT:
+            // the shaders have a single entry point
+            if (idExecutionModel == UINT32_MAX && ctOperands > 0) {
+                idExecutionModel = pidOperands[0];
+            }
+            break;
+        case SPIRV_OP_DECORATE: {
+            if (ctOperands < 2) {
+                break;
+            }
+            SpirvId &idTarget = mapIds[pidOperands[0]];
+            const uint32_t idLiteral = ctOperands > 2 ? pidOperands[2] : 0;
+            switch (pidOperands[1]) {
+            case SPIRV_DECORATION_BUFFER_BLOCK: idTarget.bBufferBlock = true; break;
+            case SPIRV_DECORATION_BUILT_IN: idTarget.bBuiltIn = true; break;
+            case SPIRV_DECORATION_LOCATION: idTarget.iLocation = idLiteral; break;
+            case SPIRV_DECORATION_BINDING: idTarget.iBinding = idLiteral; break;
+            case SPIRV_DECORATION_DESCRIPTOR_SET: idTarget.iSet = idLiteral; break;
+            case SPIRV_DECORATION_ARRAY_STRIDE: idTarget.ctArrayStride = idLiteral; break;
+            }
+            break;
+        }
+        case SPIRV_OP_MEMBER_DECORATE: {
+            if (ctOperands < 4) {
+                break;
+            }
+            SpirvId &idTarget = mapIds[pidOperands[0]];
+            if (pidOperands[2] == SPIRV_DECORATION_OFFSET) {
+                GetMemberSlot(idTarget.actMemberOffsets, pidOperands[1]) = pidOperands[3];
+            } else if (pidOperands[2] == SPIRV_DECORATION_MATRIX_STRIDE) {
+                GetMemberSlot(idTarget.actMemberMatrixStrides, pidOperands[1]) = pidOperands[3];
+            }
+            break;
+        }
+        case SPIRV_OP_TYPE_BOOL:
+        case SPIRV_OP_TYPE_INT:
+        case SPIRV_OP_TYPE_FLOAT:
+        case SPIRV_OP_TYPE_VECTOR:
+        case SPIRV_OP_TYPE_MATRIX:
+        case SPIRV_OP_TYPE_IMAGE:
+        case SPIRV_OP_TYPE_SAMPLER:
+        case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+        case SPIRV_OP_TYPE_ARRAY:
+        case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+        case SPIRV_OP_TYPE_STRUCT:
+        case SPIRV_OP_TYPE_POINTER: {
+            // types declare their result id first
+            if (ctOperands < 1) {
+                throw std::runtime_error("Shader code is damaged");
+            }
+            SpirvId &idType = mapIds[pidOperands[0]];
+            idType.idOpcode = idOpcode;
+            idType.aidOperands.assign(pidOperands + 1, pidOperands + ctOperands);
+            break;
+        }
+        case SPIRV_OP_CONSTANT:
+        case SPIRV_OP_SPEC_CONSTANT:
+        case SPIRV_OP_VARIABLE: {
+            // constants and variables declare their type first, then their result id
+            if (ctOperands < 3) {
+                throw std::runtime_error("Shader code is damaged");
+            }
+            SpirvId &idValue = mapIds[pidOperands[1]];
+            idValue.idOpcode = idOpcode;
+            idValue.aidOperands.assign(pidOperands, pidOperands + ctOperands);
+            idValue.aidOperands.erase(idValue.aidOperands.begin() + 1);
+            if (idOpcode == SPIRV_OP_VARIABLE) {
+                aidVariables.push_back(pidOperands[1]);
+            }
+            break;
+        }
+        }
+        iWord += ctWords;
+    }
+
+    ShaderInterface ifcShader;
+    ifcShader.ctPushConstantBytes = 0;
+    switch (idExecutionModel) {
+    case SPIRV_EXECUTION_VERTEX: ifcShader.flgStage = VK_SHADER_STAGE_VERTEX_BIT; break;
+    case SPIRV_EXECUTION_FRAGMENT: ifcShader.flgStage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+    case SPIRV_EXECUTION_GL_COMPUTE: ifcShader.flgStage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+    default: throw std::runtime_error("Shader has no entry point of a known stage");
+    }
+
+    // global variables are the shader's interface, each is a pointer to the type of what it holds
+    for (uint32_t idVariable : aidVariables) {
+        const SpirvId &idDeclaration = mapIds[idVariable];
+        const uint32_t idStorageClass = idDeclaration.aidOperands[1];
+        const SpirvId &idPointer = GetType(mapIds, idDeclaration.aidOperands[0]);
+        if (idPointer.idOpcode != SPIRV_OP_TYPE_POINTER) {
+            throw std::runtime_error("Shader variable isn't a pointer");
+        }
+        const uint32_t idType = idPointer.aidOperands[1];
+
+        switch (idStorageClass) {
+        case SPIRV_STORAGE_INPUT:
+            // built-ins such as the vertex index aren't read from buffers
+            if (ifcShader.flgStage == VK_SHADER_STAGE_VERTEX_BIT && !idDeclaration.bBuiltIn && !GetType(mapIds, idType).bBuiltIn) {
+                if (idDeclaration.iLocation == UINT32_MAX) {
+                    throw std::runtime_error("Vertex shader input has no location");
+                }
+                ifcShader.ainVertexInputs.push_back({ idDeclaration.iLocation, GetVertexInputFormat(mapIds, idType) });
+            }
+            break;
+        case SPIRV_STORAGE_PUSH_CONSTANT:
+            ifcShader.ctPushConstantBytes = std::max(ifcShader.ctPushConstantBytes, GetTypeSize(mapIds, idType, 0));
+            break;
+        case SPIRV_STORAGE_UNIFORM_CONSTANT:
+        case SPIRV_STORAGE_UNIFORM:
+        case SPIRV_STORAGE_STORAGE_BUFFER: {
+            if (idDeclaration.iBinding == UINT32_MAX) {
+                throw std::runtime_error("Shader resource has no binding");
+            }
+            ShaderBinding bndResource = {};
+            bndResource.iSet = idDeclaration.iSet;
+            bndResource.bndBinding.binding = idDeclaration.iBinding;
+            bndResource.bndBinding.descriptorType = GetDescriptorType(mapIds, idStorageClass, idType, bndResource.bndBinding.descriptorCount);
+            bndResource.bndBinding.stageFlags = ifcShader.flgStage;
+            bndResource.bndBinding.pImmutableSamplers = nullptr;
+            ifcShader.abndBindings.push_back(bndResource);
+            break;
+        }
+        }
+    }
+
+    // the order of declarations is up to the compiler, the interface is sorted so equal interfaces compare equal
+    std::sort(ifcShader.abndBindings.begin(), ifcShader.abndBindings.end(), [](const ShaderBinding &bndA, const ShaderBinding &bndB) {
+        return bndA.iSet != bndB.iSet ? bndA.iSet < bndB.iSet : bndA.bndBinding.binding < bndB.bndBinding.binding;
+    });
+    std::sort(ifcShader.ainVertexInputs.begin(), ifcShader.ainVertexInputs.end(), [](const ShaderVertexInput &inA, const ShaderVertexInput &inB) {
+        return inA.iLocation < inB.iLocation;
+    });
+    return ifcShader;
+}
+
+
+// Get the bindings of a descriptor set that all the shaders read.
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::GetSetBindings(const std::vector<ShaderInterface> &aifcShaders, uint32_t iSet) {
+    std::vector<VkDescriptorSetLayoutBinding> abndBindings;
+    for (const ShaderInterface &ifcShader : aifcShaders) {
+        for (const ShaderBinding &bndResource : ifcShader.abndBindings) {
+            if (bndResource.iSet != iSet) {
+                continue;
+            }
+            auto itBinding = std::find_if(abndBindings.begin(), abndBindings.end(), [&bndResource](const VkDescriptorSetLayoutBinding &bndBinding) {
+                return bndBinding.binding == bndResource.bndBinding.binding;
+            });
+            if (itBinding == abndBindings.end()) {
+                abndBindings.push_back(bndResource.bndBinding);
+                continue;
+            }
+            // a descriptor shared between stages is read by all of them
+            if (itBinding->descriptorType != bndResource.bndBinding.descriptorType || itBinding->descriptorCount != bndResource.bndBinding.descriptorCount) {
+                throw std::runtime_error("Shaders declare different resources at the same binding");
+            }
+            itBinding->stageFlags |= bndResource.bndBinding.stageFlags;
+        }
+    }
+    std::sort(abndBindings.begin(), abndBindings.end(), [](const VkDescriptorSetLayoutBinding &bndA, const VkDescriptorSetLayoutBinding &bndB) {
+        return bndA.binding < bndB.binding;
+    });
+    return abndBindings;
+}
+
+
+// Get the push constant range of the shaders.
+std::vector<VkPushConstantRange> ShaderReflection::GetPushConstantRanges(const std::vector<ShaderInterface> &aifcShaders) {
+    // a single range from the start covers the blocks of all stages, they all declare the same constants
+    VkPushConstantRange rngPushConstants = {};
+    for (const ShaderInterface &ifcShader : aifcShaders) {
+        if (ifcShader.ctPushConstantBytes > 0) {
+            rngPushConstants.stageFlags |= ifcShader.flgStage;
+            rngPushConstants.size = std::max(rngPushConstants.size, ifcShader.ctPushConstantBytes);
+        }
+    }
+    if (rngPushConstants.size == 0) {
+        return {};
+    }
+    return { rngPushConstants };
+}
+
+
+// Does a shader declare only descriptors that are in the set layout bindings?
+bool ShaderReflection::IsCompatible(const ShaderInterface &ifcShader, uint32_t iSet, const std::vector<VkDescriptorSetLayoutBinding> &abndBindings) {
+    for (const ShaderBinding &bndResource : ifcShader.abndBindings) {
+        if (bndResource.iSet != iSet) {
+            return false;
+        }
+        auto itBinding = std::find_if(abndBindings.begin(), abndBindings.end(), [&bndResource](const VkDescriptorSetLayoutBinding &bndBinding) {
+            return bndBinding.binding == bndResource.bndBinding.binding;
+        });
+        // an unsized array fits a binding of any size
+        const uint32_t ctDescriptors = bndResource.bndBinding.descriptorCount;
+        if (itBinding == abndBindings.end() || itBinding->descriptorType != bndResource.bndBinding.descriptorType
+            || (ctDescriptors != 0 ? itBinding->descriptorCount != ctDescriptors : itBinding->descriptorCount == 0)
+            || (itBinding->stageFlags & ifcShader.flgStage) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Mix a value into an FNV-1a hash, a byte at a time.
+static void HashBytes(uint64_t &idHash, const void *pData, size_t ctBytes) {
+    const uint8_t *pbData = static_cast<const uint8_t *>(pData);
+    for (size_t iByte = 0; iByte < ctBytes; iByte++) {
+        idHash ^= pbData[iByte];
+        idHash *= 0x100000001B3ULL;
+    }
+}
+
+
+// Hash of the bindings of a set layout, field by field as the struct has padding.
+uint64_t ShaderReflection::HashSetBindings(const std::vector<VkDescriptorSetLayoutBinding> &abndBindings) {
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    for (const VkDescriptorSetLayoutBinding &bndBinding : abndBindings) {
+        HashBytes(idHash, &bndBinding.binding, sizeof(bndBinding.binding));
+        HashBytes(idHash, &bndBinding.descriptorType, sizeof(bndBinding.descriptorType));
+        HashBytes(idHash, &bndBinding.descriptorCount, sizeof(bndBinding.descriptorCount));
+        HashBytes(idHash, &bndBinding.stageFlags, sizeof(bndBinding.stageFlags));
+    }
+    return idHash;
+}
+
+
+// Hash of a pipeline layout's set layouts and push constant ranges.
+uint64_t ShaderReflection::HashPipelineLayout(const std::vector<VkDescriptorSetLayout> &avkhSetLayouts, const std::vector<VkPushConstantRange> &arngPushConstants) {
+    // the set layouts are deduplicated, so their handles tell them apart; the count keeps sets and ranges apart
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    const size_t ctSetLayouts = avkhSetLayouts.size();
+    HashBytes(idHash, &ctSetLayouts, sizeof(ctSetLayouts));
+    for (VkDescriptorSetLayout vkhSetLayout : avkhSetLayouts) {
+        HashBytes(idHash, &vkhSetLayout, sizeof(vkhSetLayout));
+    }
+    for (const VkPushConstantRange &rngPushConstants : arngPushConstants) {
+        HashBytes(idHash, &rngPushConstants.stageFlags, sizeof(rngPushConstants.stageFlags));
+        HashBytes(idHash, &rngPushConstants.offset, sizeof(rngPushConstants.offset));
+        HashBytes(idHash, &rngPushConstants.size, sizeof(rngPushConstants.size));
+    }
+    return idHash;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+// Descriptor a shader reads, with the set it is in.
+struct ShaderBinding {
+    uint32_t iSet;
+    // Binding, type and count of the descriptor, and the stages that read it. The count of an unsized array is 0.
+    VkDescriptorSetLayoutBinding bndBinding;
+};
+
+// Input a vertex shader reads from the vertex buffers.
+struct ShaderVertexInput {
+    uint32_t iLocation;
+    VkFormat fmtFormat;
+};
+
+// What a shader expects the pipeline to provide, read from its SPIR-V code.
+struct ShaderInterface {
+    // Stage of the shader's entry point.
+    VkShaderStageFlagBits flgStage;
+    // Descriptors the shader declares, by set and binding.
+    std::vector<ShaderBinding> abndBindings;
+    // Inputs of a vertex shader by location, without built-ins. Empty for other stages.
+    std::vector<ShaderVertexInput> ainVertexInputs;
+    // Size of the shader's push constant block, 0 if it has none.
+    uint32_t ctPushConstantBytes;
+};
+
+// Reads the interface of shaders from their SPIR-V code, so descriptor set layouts, pipeline layouts and vertex inputs
+// are built from the shaders instead of being written to match them. Only what the engine's shaders use is understood:
+// buffers, images and samplers, push constant blocks and vertex inputs of scalars and vectors.
+class ShaderReflection {
+public:
+    // Read the interface of a shader's entry point. Throws if the code isn't SPIR-V, or declares a resource the engine
+    // can't describe.
+    static ShaderInterface Reflect(const char *pchCode, uint64_t ctBytes);
+
+    // Get the bindings of a descriptor set that all the shaders read, with the stages of the shaders that read each
+    // one. Throws if shaders declare different descriptors at the same binding.
+    static std::vector<VkDescriptorSetLayoutBinding> GetSetBindings(const std::vector<ShaderInterface> &aifcShaders, uint32_t iSet);
+    // Get the push constant range of the shaders, covering the largest block with the stages of all shaders that have
+    // one. Empty if none of them has push constants.
+    static std::vector<VkPushConstantRange> GetPushConstantRanges(const std::vector<ShaderInterface> &aifcShaders);
+    // Does a shader declare only descriptors that are in the set layout bindings, with the same type and count, and
+    // read in its stage? Unsized arrays match bindings of any count.
+    static bool IsCompatible(const ShaderInterface &ifcShader, uint32_t iSet, const std::vector<VkDescriptorSetLayoutBinding> &abndBindings);
+
+    // Hash of the bindings of a set layout, equal bindings have equal hashes.
+    static uint64_t HashSetBindings(const std::vector<VkDescriptorSetLayoutBinding> &abndBindings);
+    // Hash of a pipeline layout's set layouts and push constant ranges.
+    static uint64_t HashPipelineLayout(const std::vector<VkDescriptorSetLayout> &avkhSetLayouts, const std::vector<VkPushConstantRange> &arngPushConstants);
+};
@@ -0,0 +1,36 @@
+#include "../PrecompiledHeader.h"
+#include "AssetPackager.h"
+
+#include "../Platform/FileSystem.h"
+#include "../Platform/MappedFile.h"
+#include "../Resources/AssetPackage.h"
+
+
+// Pack the files that exist into a package.
+void AssetPackager::PackFiles(const std::vector<std::string> &astrFilenames, const std::string &strPackageFilename) {
+    AssetPackageWriter pkwPackage;
+    pkwPackage.Open(strPackageFilename);
+    for (const std::string &strFilename : astrFilenames) {
+        if (!FileSystem::FileExists(strFilename)) {
+            continue;
+        }
+        // assets are named by their filename, the directory is where the package is
+        const std::string strName = strFilename.substr(FileSystem::GetDirectory(strFilename).size());
+        MappedFile mfFile;
+        mfFile.Open(strFilename);
+        pkwPackage.AddAsset(strName, mfFile.GetData(), mfFile.GetSize());
+    }
+    pkwPackage.Close();
+}
+
+
+// Pack the files only if the package is missing, invalid or older than one of the files that exist.
+void AssetPackager::PackFilesIfOutOfDate(const std::vector<std::string> &astrFilenames, const std::string &strPackageFilename) {
+    bool bOutOfDate = !AssetPackage::IsValid(strPackageFilename);
+    for (size_t iFile = 0; iFile < astrFilenames.size() && !bOutOfDate; iFile++) {
+        bOutOfDate = FileSystem::IsOutOfDate(strPackageFilename, astrFilenames[iFile]);
+    }
+    if (bOutOfDate) {
+        PackFiles(astrFilenames, strPackageFilename);
+    }
+}
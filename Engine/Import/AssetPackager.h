@@ -0,0 +1,12 @@
+#pragma once
+
+// Packs loose asset files into an asset package, each under its filename without the directory. Files that don't
+// exist are left out, so optional assets can be missing, and a package can be used without the loose files it was
+// built from.
+class AssetPackager {
+public:
+    // Pack the files that exist into a package. Throws if a file can't be read or the package can't be written.
+    static void PackFiles(const std::vector<std::string> &astrFilenames, const std::string &strPackageFilename);
+    // Pack the files only if the package is missing, invalid or older than one of the files that exist.
+    static void PackFilesIfOutOfDate(const std::vector<std::string> &astrFilenames, const std::string &strPackageFilename);
+};
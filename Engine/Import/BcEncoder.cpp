@@ -0,0 +1,421 @@
+#include "../PrecompiledHeader.h"
+#include "BcEncoder.h"
+
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <stdexcept>
+
+#include "../Platform/ThreadPool.h"
+
+
+// Number of texels in a block.
+static const uint32_t CT_BLOCK_TEXELS = CT_TEXTURE_BLOCK_SIZE * CT_TEXTURE_BLOCK_SIZE;
+// Interpolation weights of BC7 four bit indices, out of 64.
+static const uint32_t AI_BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+// Writes a compressed block bit by bit, starting with the least significant bit of the first byte.
+class BlockBitWriter {
+public:
+    BlockBitWriter(uint8_t *pbBlock, uint32_t ctBytes) : _pbBlock(pbBlock), _iBit(0) {
+        memset(pbBlock, 0, ctBytes);
+    }
+    void Write(uint32_t iValue, uint32_t ctBits) {
+        for (uint32_t iBit = 0; iBit < ctBits; iBit++, _iBit++) {
+            _pbBlock[_iBit / 8] |= ((iValue >> iBit) & 1) << (_iBit % 8);
+        }
+    }
+
+private:
+    uint8_t *_pbBlock;
+    uint32_t _iBit;
+};
+
+
+// Find the line that best fits the texels - through their mean along the principal axis - and the extent of the
+// texels along it. The first ctChannels channels of each texel are used.
+static void FindPrincipalEndpoints(const float afTexels[CT_BLOCK_TEXELS][4], uint32_t ctChannels, float afEndpoint0[4], float afEndpoint1[4]) {
+    float afMean[4] = {};
+    float afMin[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+    float afMax[4] = {};
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+            afMean[iChannel] += afTexels[iTexel][iChannel] / CT_BLOCK_TEXELS;
+            afMin[iChannel] = std::min(afMin[iChannel], afTexels[iTexel][iChannel]);
+            afMax[iChannel] = std::max(afMax[iChannel], afTexels[iTexel][iChannel]);
+        }
+    }
+
+    // covariance of the texels
+    float aafCovariance[4][4] = {};
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        for (uint32_t iRow = 0; iRow < ctChannels; iRow++) {
+            for (uint32_t iColumn = 0; iColumn < ctChannels; iColumn++) {
+                aafCovariance[iRow][iColumn] += (afTexels[iTexel][iRow] - afMean[iRow]) * (afTexels[iTexel][iColumn] - afMean[iColumn]);
+            }
+        }
+    }
+
+    // the principal axis is the dominant eigenvector of the covariance, found with a few steps of power iteration
+    // starting from the diagonal of the bounding box
+    float afAxis[4] = {};
+    for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+        afAxis[iChannel] = afMax[iChannel] - afMin[iChannel];
+    }
+    for (uint32_t iIteration = 0; iIteration < 8; iIteration++) {
+        float afNext[4] = {};
+        float fLength = 0.0f;
+        for (uint32_t iRow = 0; iRow < ctChannels; iRow++) {
+            for (uint32_t iColumn = 0; iColumn < ctChannels; iColumn++) {
+                afNext[iRow] += aafCovariance[iRow][iColumn] * afAxis[iColumn];
+            }
+            fLength = std::max(fLength, std::abs(afNext[iRow]));
+        }
+        if (fLength == 0.0f) {
+            break;
+        }
+        for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+            afAxis[iChannel] = afNext[iChannel] / fLength;
+        }
+    }
+    float fAxisLength = 0.0f;
+    for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+        fAxisLength += afAxis[iChannel] * afAxis[iChannel];
+    }
+
+    // a block of a single color has no axis, both endpoints are that color
+    float fMinProjection = 0.0f;
+    float fMaxProjection = 0.0f;
+    if (fAxisLength > 0.0f) {
+        fAxisLength = std::sqrt(fAxisLength);
+        for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+            afAxis[iChannel] /= fAxisLength;
+        }
+        fMinProjection = FLT_MAX;
+        fMaxProjection = -FLT_MAX;
+        for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+            float fProjection = 0.0f;
+            for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+                fProjection += (afTexels[iTexel][iChannel] - afMean[iChannel]) * afAxis[iChannel];
+            }
+            fMinProjection = std::min(fMinProjection, fProjection);
+            fMaxProjection = std::max(fMaxProjection, fProjection);
+        }
+    }
+    for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+        afEndpoint0[iChannel] = std::min(std::max(afMean[iChannel] + afAxis[iChannel] * fMaxProjection, 0.0f), 255.0f);
+        afEndpoint1[iChannel] = std::min(std::max(afMean[iChannel] + afAxis[iChannel] * fMinProjection, 0.0f), 255.0f);
+    }
+}
+
+
+// Refit the endpoints by least squares, given the weight of the second endpoint in each texel. Returns false if all
+// texels use the same weight and the endpoints can't be solved for.
+static bool RefineEndpoints(const float afTexels[CT_BLOCK_TEXELS][4], uint32_t ctChannels, const float afWeights[CT_BLOCK_TEXELS],
+    float afEndpoint0[4], float afEndpoint1[4]) {
+
+    float fAA = 0.0f, fAB = 0.0f, fBB = 0.0f;
+    float afAX[4] = {}, afBX[4] = {};
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        const float fB = afWeights[iTexel];
+        const float fA = 1.0f - fB;
+        fAA += fA * fA;
+        fAB += fA * fB;
+        fBB += fB * fB;
+        for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+            afAX[iChannel] += fA * afTexels[iTexel][iChannel];
+            afBX[iChannel] += fB * afTexels[iTexel][iChannel];
+        }
+    }
+    const float fDeterminant = fAA * fBB - fAB * fAB;
+    if (std::abs(fDeterminant) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+        afEndpoint0[iChannel] = std::min(std::max((afAX[iChannel] * fBB - afBX[iChannel] * fAB) / fDeterminant, 0.0f), 255.0f);
+        afEndpoint1[iChannel] = std::min(std::max((afBX[iChannel] * fAA - afAX[iChannel] * fAB) / fDeterminant, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+
+// Pick the nearest palette entry for each texel. Returns the total squared error.
+static float SelectIndices(const float afTexels[CT_BLOCK_TEXELS][4], uint32_t ctChannels, const float aafPalette[][4], uint32_t ctPalette,
+    uint32_t aiIndices[CT_BLOCK_TEXELS]) {
+
+    float fTotalError = 0.0f;
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        float fBestError = FLT_MAX;
+        for (uint32_t iEntry = 0; iEntry < ctPalette; iEntry++) {
+            float fError = 0.0f;
+            for (uint32_t iChannel = 0; iChannel < ctChannels; iChannel++) {
+                const float fDelta = afTexels[iTexel][iChannel] - aafPalette[iEntry][iChannel];
+                fError += fDelta * fDelta;
+            }
+            if (fError < fBestError) {
+                fBestError = fError;
+                aiIndices[iTexel] = iEntry;
+            }
+        }
+        fTotalError += fBestError;
+    }
+    return fTotalError;
+}
+
+
+// Quantize a color to 5:6:5.
+static uint16_t PackColor565(const float afColor[4]) {
+    const uint32_t iRed = static_cast<uint32_t>(afColor[0] * 31.0f / 255.0f + 0.5f);
+    const uint32_t iGreen = static_cast<uint32_t>(afColor[1] * 63.0f / 255.0f + 0.5f);
+    const uint32_t iBlue = static_cast<uint32_t>(afColor[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((iRed << 11) | (iGreen << 5) | iBlue);
+}
+
+
+// Expand a 5:6:5 color to 8 bits per channel, the way the hardware does.
+static void UnpackColor565(uint16_t iColor, float afColor[4]) {
+    const uint32_t iRed = (iColor >> 11) & 31;
+    const uint32_t iGreen = (iColor >> 5) & 63;
+    const uint32_t iBlue = iColor & 31;
+    afColor[0] = static_cast<float>((iRed << 3) | (iRed >> 2));
+    afColor[1] = static_cast<float>((iGreen << 2) | (iGreen >> 4));
+    afColor[2] = static_cast<float>((iBlue << 3) | (iBlue >> 2));
+    afColor[3] = 255.0f;
+}
+
+
+// Quantize the endpoints to 5:6:5 and pick the four color indices. Returns the total squared error.
+static float QuantizeColorBlock(const float afTexels[CT_BLOCK_TEXELS][4], const float afEndpoint0[4], const float afEndpoint1[4],
+    uint16_t &iColor0, uint16_t &iColor1, uint32_t aiIndices[CT_BLOCK_TEXELS]) {
+
+    iColor0 = PackColor565(afEndpoint0);
+    iColor1 = PackColor565(afEndpoint1);
+    // the first color must be the larger one to select the four color mode, with equal colors the block is flat
+    if (iColor0 < iColor1) {
+        std::swap(iColor0, iColor1);
+    }
+    float aafPalette[4][4];
+    UnpackColor565(iColor0, aafPalette[0]);
+    UnpackColor565(iColor1, aafPalette[1]);
+    for (uint32_t iChannel = 0; iChannel < 3; iChannel++) {
+        aafPalette[2][iChannel] = (2.0f * aafPalette[0][iChannel] + aafPalette[1][iChannel]) / 3.0f;
+        aafPalette[3][iChannel] = (aafPalette[0][iChannel] + 2.0f * aafPalette[1][iChannel]) / 3.0f;
+    }
+    return SelectIndices(afTexels, 3, aafPalette, iColor0 == iColor1 ? 1 : 4, aiIndices);
+}
+
+
+// Encode the color of a block as BC1 in four color mode, 8 bytes.
+static void EncodeColorBlock(const float afTexels[CT_BLOCK_TEXELS][4], uint8_t *pbBlock) {
+    float afEndpoint0[4], afEndpoint1[4];
+    FindPrincipalEndpoints(afTexels, 3, afEndpoint0, afEndpoint1);
+    uint16_t iColor0, iColor1;
+    uint32_t aiIndices[CT_BLOCK_TEXELS];
+    float fError = QuantizeColorBlock(afTexels, afEndpoint0, afEndpoint1, iColor0, iColor1, aiIndices);
+
+    // refit the endpoints to the chosen indices and keep the result if it's better
+    static const float AF_INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float afWeights[CT_BLOCK_TEXELS];
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        afWeights[iTexel] = AF_INDEX_WEIGHTS[aiIndices[iTexel]];
+    }
+    if (RefineEndpoints(afTexels, 3, afWeights, afEndpoint0, afEndpoint1)) {
+        uint16_t iRefinedColor0, iRefinedColor1;
+        uint32_t aiRefinedIndices[CT_BLOCK_TEXELS];
+        const float fRefinedError = QuantizeColorBlock(afTexels, afEndpoint0, afEndpoint1, iRefinedColor0, iRefinedColor1, aiRefinedIndices);
+        if (fRefinedError < fError) {
+            iColor0 = iRefinedColor0;
+            iColor1 = iRefinedColor1;
+            memcpy(aiIndices, aiRefinedIndices, sizeof(aiIndices));
+        }
+    }
+
+    BlockBitWriter bwWriter(pbBlock, 8);
+    bwWriter.Write(iColor0, 16);
+    bwWriter.Write(iColor1, 16);
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        bwWriter.Write(aiIndices[iTexel], 2);
+    }
+}
+
+
+// Encode one channel of a block as BC4 in eight value mode, 8 bytes.
+static void EncodeChannelBlock(const float afTexels[CT_BLOCK_TEXELS][4], uint32_t iChannel, uint8_t *pbBlock) {
+    float fMin = 255.0f, fMax = 0.0f;
+    float afValues[CT_BLOCK_TEXELS][4];
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        afValues[iTexel][0] = afTexels[iTexel][iChannel];
+        fMin = std::min(fMin, afValues[iTexel][0]);
+        fMax = std::max(fMax, afValues[iTexel][0]);
+    }
+
+    // the first value must be the larger one to select the eight value mode, with equal values the block is flat
+    const uint32_t iValue0 = static_cast<uint32_t>(fMax + 0.5f);
+    const uint32_t iValue1 = static_cast<uint32_t>(fMin + 0.5f);
+    float aafPalette[8][4];
+    aafPalette[0][0] = static_cast<float>(iValue0);
+    aafPalette[1][0] = static_cast<float>(iValue1);
+    for (uint32_t iEntry = 2; iEntry < 8; iEntry++) {
+        aafPalette[iEntry][0] = ((8 - iEntry) * aafPalette[0][0] + (iEntry - 1) * aafPalette[1][0]) / 7.0f;
+    }
+    uint32_t aiIndices[CT_BLOCK_TEXELS];
+    SelectIndices(afValues, 1, aafPalette, iValue0 == iValue1 ? 1 : 8, aiIndices);
+
+    BlockBitWriter bwWriter(pbBlock, 8);
+    bwWriter.Write(iValue0, 8);
+    bwWriter.Write(iValue1, 8);
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        bwWriter.Write(aiIndices[iTexel], 3);
+    }
+}
+
+
+// Quantize a BC7 mode 6 endpoint to seven bits per channel plus a shared lowest bit, picking the lowest bit that fits
+// the endpoint better.
+static void QuantizeBc7Endpoint(const float afEndpoint[4], uint32_t aiQuantized[4], uint32_t &iParity) {
+    float fBestError = FLT_MAX;
+    for (uint32_t iCandidate = 0; iCandidate < 2; iCandidate++) {
+        float fError = 0.0f;
+        uint32_t aiCandidate[4];
+        for (uint32_t iChannel = 0; iChannel < 4; iChannel++) {
+            const float fQuantized = std::floor((afEndpoint[iChannel] - iCandidate) / 2.0f + 0.5f);
+            aiCandidate[iChannel] = static_cast<uint32_t>(std::min(std::max(fQuantized, 0.0f), 127.0f));
+            const float fDelta = afEndpoint[iChannel] - ((aiCandidate[iChannel] << 1) | iCandidate);
+            fError += fDelta * fDelta;
+        }
+        if (fError < fBestError) {
+            fBestError = fError;
+            iParity = iCandidate;
+            memcpy(aiQuantized, aiCandidate, sizeof(aiCandidate));
+        }
+    }
+}
+
+
+// Quantize the endpoints for BC7 mode 6 and pick the sixteen indices. Returns the total squared error.
+static float QuantizeBc7Block(const float afTexels[CT_BLOCK_TEXELS][4], const float afEndpoint0[4], const float afEndpoint1[4],
+    uint32_t aaiQuantized[2][4], uint32_t aiParity[2], uint32_t aiIndices[CT_BLOCK_TEXELS]) {
+
+    QuantizeBc7Endpoint(afEndpoint0, aaiQuantized[0], aiParity[0]);
+    QuantizeBc7Endpoint(afEndpoint1, aaiQuantized[1], aiParity[1]);
+    float aafPalette[16][4];
+    for (uint32_t iEntry = 0; iEntry < 16; iEntry++) {
+        for (uint32_t iChannel = 0; iChannel < 4; iChannel++) {
+            const uint32_t iValue0 = (aaiQuantized[0][iChannel] << 1) | aiParity[0];
+            const uint32_t iValue1 = (aaiQuantized[1][iChannel] << 1) | aiParity[1];
+            aafPalette[iEntry][iChannel] = static_cast<float>(((64 - AI_BC7_WEIGHTS[iEntry]) * iValue0 + AI_BC7_WEIGHTS[iEntry] * iValue1 + 32) >> 6);
+        }
+    }
+    return SelectIndices(afTexels, 4, aafPalette, 16, aiIndices);
+}
+
+
+// Encode a block as BC7 mode 6, 16 bytes.
+static void EncodeBc7Block(const float afTexels[CT_BLOCK_TEXELS][4], uint8_t *pbBlock) {
+    float afEndpoint0[4], afEndpoint1[4];
+    FindPrincipalEndpoints(afTexels, 4, afEndpoint0, afEndpoint1);
+    uint32_t aaiQuantized[2][4];
+    uint32_t aiParity[2];
+    uint32_t aiIndices[CT_BLOCK_TEXELS];
+    float fError = QuantizeBc7Block(afTexels, afEndpoint0, afEndpoint1, aaiQuantized, aiParity, aiIndices);
+
+    // refit the endpoints to the chosen indices and keep the result if it's better
+    float afWeights[CT_BLOCK_TEXELS];
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        afWeights[iTexel] = AI_BC7_WEIGHTS[aiIndices[iTexel]] / 64.0f;
+    }
+    if (RefineEndpoints(afTexels, 4, afWeights, afEndpoint0, afEndpoint1)) {
+        uint32_t aaiRefinedQuantized[2][4];
+        uint32_t aiRefinedParity[2];
+        uint32_t aiRefinedIndices[CT_BLOCK_TEXELS];
+        const float fRefinedError = QuantizeBc7Block(afTexels, afEndpoint0, afEndpoint1, aaiRefinedQuantized, aiRefinedParity, aiRefinedIndices);
+        if (fRefinedError < fError) {
+            memcpy(aaiQuantized, aaiRefinedQuantized, sizeof(aaiQuantized));
+            memcpy(aiParity, aiRefinedParity, sizeof(aiParity));
+            memcpy(aiIndices, aiRefinedIndices, sizeof(aiIndices));
+        }
+    }
+
+    // the top bit of the first texel's index is implied to be zero, swap the endpoints if it isn't
+    if (aiIndices[0] >= 8) {
+        std::swap(aaiQuantized[0], aaiQuantized[1]);
+        std::swap(aiParity[0], aiParity[1]);
+        for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+            aiIndices[iTexel] = 15 - aiIndices[iTexel];
+        }
+    }
+
+    BlockBitWriter bwWriter(pbBlock, 16);
+    // mode 6 is selected by six zero bits followed by a one
+    bwWriter.Write(1 << 6, 7);
+    for (uint32_t iChannel = 0; iChannel < 4; iChannel++) {
+        bwWriter.Write(aaiQuantized[0][iChannel], 7);
+        bwWriter.Write(aaiQuantized[1][iChannel], 7);
+    }
+    bwWriter.Write(aiParity[0], 1);
+    bwWriter.Write(aiParity[1], 1);
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        bwWriter.Write(aiIndices[iTexel], iTexel == 0 ? 3 : 4);
+    }
+}
+
+
+// Encode a block of 4x4 RGBA8 texels into one block of the format.
+void BcEncoder::EncodeBlock(enum TextureFormat idFormat, const uint8_t *pbTexels, uint8_t *pbBlock) {
+    float afTexels[CT_BLOCK_TEXELS][4];
+    for (uint32_t iTexel = 0; iTexel < CT_BLOCK_TEXELS; iTexel++) {
+        for (uint32_t iChannel = 0; iChannel < 4; iChannel++) {
+            afTexels[iTexel][iChannel] = pbTexels[iTexel * 4 + iChannel];
+        }
+    }
+
+    switch (idFormat) {
+        case TEXTURE_FORMAT_BC1_RGB:
+            EncodeColorBlock(afTexels, pbBlock);
+            break;
+        case TEXTURE_FORMAT_BC3:
+            EncodeChannelBlock(afTexels, 3, pbBlock);
+            EncodeColorBlock(afTexels, pbBlock + 8);
+            break;
+        case TEXTURE_FORMAT_BC5:
+            EncodeChannelBlock(afTexels, 0, pbBlock);
+            EncodeChannelBlock(afTexels, 1, pbBlock + 8);
+            break;
+        case TEXTURE_FORMAT_BC7:
+            EncodeBc7Block(afTexels, pbBlock);
+            break;
+        default:
+            throw std::runtime_error("Texture format is not block compressed!");
+    }
+}
+
+
+// Encode a whole RGBA8 image.
+void BcEncoder::EncodeImage(enum TextureFormat idFormat, const uint8_t *pbTexels, uint32_t dimWidth, uint32_t dimHeight,
+    std::vector<uint8_t> &abBlocks) {
+
+    abBlocks.resize(static_cast<size_t>(GetTextureImageBytes(idFormat, dimWidth, dimHeight)));
+    if (!IsBlockCompressed(idFormat)) {
+        memcpy(abBlocks.data(), pbTexels, abBlocks.size());
+        return;
+    }
+
+    const uint32_t ctBlocksX = (dimWidth + CT_TEXTURE_BLOCK_SIZE - 1) / CT_TEXTURE_BLOCK_SIZE;
+    const uint32_t ctBlocksY = (dimHeight + CT_TEXTURE_BLOCK_SIZE - 1) / CT_TEXTURE_BLOCK_SIZE;
+    const uint32_t ctBlockBytes = GetTextureBlockBytes(idFormat);
+    ThreadPool::Get().ParallelFor(ctBlocksY, [&](uint32_t iBlockY) {
+        uint8_t abBlockTexels[CT_BLOCK_TEXELS * 4];
+        for (uint32_t iBlockX = 0; iBlockX < ctBlocksX; iBlockX++) {
+            // gather the block, clamping to the edges of the image
+            for (uint32_t iRow = 0; iRow < CT_TEXTURE_BLOCK_SIZE; iRow++) {
+                const uint32_t iY = std::min(iBlockY * CT_TEXTURE_BLOCK_SIZE + iRow, dimHeight - 1);
+                for (uint32_t iColumn = 0; iColumn < CT_TEXTURE_BLOCK_SIZE; iColumn++) {
+                    const uint32_t iX = std::min(iBlockX * CT_TEXTURE_BLOCK_SIZE + iColumn, dimWidth - 1);
+                    memcpy(abBlockTexels + (iRow * CT_TEXTURE_BLOCK_SIZE + iColumn) * 4, pbTexels + (size_t(iY) * dimWidth + iX) * 4, 4);
+                }
+            }
+            EncodeBlock(idFormat, abBlockTexels, abBlocks.data() + (size_t(iBlockY) * ctBlocksX + iBlockX) * ctBlockBytes);
+        }
+    });
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "../Resources/TextureFormat.h"
+
+// Encodes RGBA8 images into the BCn block compressed formats. Endpoints are fitted along the principal axis of each
+// block's colors and refined with a least squares pass over the chosen indices. BC7 uses only mode 6 - one subset
+// with RGBA endpoints - which is fast to search and good enough for typical color textures.
+class BcEncoder {
+public:
+    // Encode a block of 4x4 RGBA8 texels, row by row, into one block of the format.
+    static void EncodeBlock(enum TextureFormat idFormat, const uint8_t *pbTexels, uint8_t *pbBlock);
+    // Encode a whole RGBA8 image. Blocks that stick out over the right and bottom edges repeat the edge texels.
+    // Rows of blocks are encoded in parallel on the thread pool. RGBA8 as the target format just copies the image.
+    static void EncodeImage(enum TextureFormat idFormat, const uint8_t *pbTexels, uint32_t dimWidth, uint32_t dimHeight,
+        std::vector<uint8_t> &abBlocks);
+};
@@ -0,0 +1,154 @@
+#include "../PrecompiledHeader.h"
+#include "ImageDecoder.h"
+
+#include <stdexcept>
+#include <cstring>
+
+#include "../Platform/MappedFile.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define IMAGE_DECODER_X86
+    #include <tmmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define SSSE3_FUNCTION
+    #else
+        #include <cpuid.h>
+        #define SSSE3_FUNCTION __attribute__((target("ssse3")))
+    #endif
+#endif
+
+
+#ifdef IMAGE_DECODER_X86
+// Does the processor have SSSE3? Checked once.
+static bool HasSsse3() {
+    static const bool bHasSsse3 = []() {
+        #if defined(_MSC_VER)
+            int aiRegisters[4];
+            __cpuid(aiRegisters, 1);
+            return (aiRegisters[2] & (1 << 9)) != 0;
+        #else
+            unsigned int iEax, iEbx, iEcx, iEdx;
+            return __get_cpuid(1, &iEax, &iEbx, &iEcx, &iEdx) && (iEcx & (1 << 9)) != 0;
+        #endif
+    }();
+    return bHasSsse3;
+}
+
+
+// Expand RGB texels to RGBA sixteen at a time with byte shuffles, returns the number of texels done. Each 16 byte load
+// holds four texels and some of the next ones, so the loop stops early enough for the last load to stay in the source.
+SSSE3_FUNCTION static size_t ExpandRgbToRgbaSsse3(const uint8_t *pbSource, uint8_t *pbTarget, size_t ctTexels) {
+    const __m128i vShuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i vAlpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    size_t iTexel = 0;
+    for (; iTexel + 18 <= ctTexels; iTexel += 16) {
+        const uint8_t *pbIn = pbSource + iTexel * 3;
+        uint8_t *pbOut = pbTarget + iTexel * 4;
+        for (int iQuad = 0; iQuad < 4; iQuad++) {
+            const __m128i vIn = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pbIn + iQuad * 12));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pbOut + iQuad * 16), _mm_or_si128(_mm_shuffle_epi8(vIn, vShuffle), vAlpha));
+        }
+    }
+    return iTexel;
+}
+#endif
+
+
+// Read the size of an image from its header without decoding it.
+void ImageDecoder::GetImageSize(const std::string &strFilename, uint32_t &dimWidth, uint32_t &dimHeight) {
+    int iWidth, iHeight, ctChannels;
+    if (!stbi_info(strFilename.c_str(), &iWidth, &iHeight, &ctChannels)) {
+        throw std::runtime_error("Failed to load the texture: " + strFilename);
+    }
+    dimWidth = static_cast<uint32_t>(iWidth);
+    dimHeight = static_cast<uint32_t>(iHeight);
+}
+
+
+// Decode an image into RGBA8 texels.
+void ImageDecoder::DecodeRgba(const std::string &strFilename, uint32_t dimWidth, uint32_t dimHeight, uint8_t *pbTarget) {
+    // the file is decoded in place from its mapping rather than read through a buffered stream
+    MappedFile mfFile;
+    mfFile.Open(strFilename);
+    DecodeRgba(mfFile.GetData(), mfFile.GetSize(), strFilename, dimWidth, dimHeight, pbTarget);
+}
+
+
+// Read the size of an image that is already in memory.
+void ImageDecoder::GetImageSize(const char *pchData, uint64_t ctBytes, const std::string &strName, uint32_t &dimWidth, uint32_t &dimHeight) {
+    int iWidth, iHeight, ctChannels;
+    if (!stbi_info_from_memory(reinterpret_cast<const stbi_uc *>(pchData), static_cast<int>(ctBytes), &iWidth, &iHeight, &ctChannels)) {
+        throw std::runtime_error("Failed to load the texture: " + strName);
+    }
+    dimWidth = static_cast<uint32_t>(iWidth);
+    dimHeight = static_cast<uint32_t>(iHeight);
+}
+
+
+// Decode an image that is already in memory into RGBA8 texels.
+void ImageDecoder::DecodeRgba(const char *pchData, uint64_t ctBytes, const std::string &strName, uint32_t dimWidth, uint32_t dimHeight, uint8_t *pbTarget) {
+    const stbi_uc *pbFile = reinterpret_cast<const stbi_uc *>(pchData);
+    const int ctFileBytes = static_cast<int>(ctBytes);
+
+    // JPEG color conversion writes any channel count in its SIMD loop, so stb can produce RGBA directly; other formats
+    // are converted in a separate scalar pass over another image sized buffer, so they're decoded in their own channel
+    // count and expanded here
+    const bool bIsJpeg = ctFileBytes >= 2 && pbFile[0] == 0xFF && pbFile[1] == 0xD8;
+    int iWidth, iHeight, ctChannels;
+    stbi_uc *imgRawData = stbi_load_from_memory(pbFile, ctFileBytes, &iWidth, &iHeight, &ctChannels, bIsJpeg ? STBI_rgb_alpha : 0);
+    if (!imgRawData) {
+        throw std::runtime_error("Failed to load the texture: " + strName);
+    }
+    if (static_cast<uint32_t>(iWidth) != dimWidth || static_cast<uint32_t>(iHeight) != dimHeight) {
+        stbi_image_free(imgRawData);
+        throw std::runtime_error("Texture changed size while loading: " + strName);
+    }
+    if (bIsJpeg) {
+        ctChannels = 4;
+    }
+
+    const size_t ctTexels = size_t(dimWidth) * dimHeight;
+    switch (ctChannels) {
+        case 4:
+            memcpy(pbTarget, imgRawData, ctTexels * 4);
+            break;
+        case 3:
+            ExpandRgbToRgba(imgRawData, pbTarget, ctTexels);
+            break;
+        default:
+            // grey, with or without alpha
+            for (size_t iTexel = 0; iTexel < ctTexels; iTexel++) {
+                const stbi_uc *pbTexel = imgRawData + iTexel * ctChannels;
+                pbTarget[iTexel * 4 + 0] = pbTexel[0];
+                pbTarget[iTexel * 4 + 1] = pbTexel[0];
+                pbTarget[iTexel * 4 + 2] = pbTexel[0];
+                pbTarget[iTexel * 4 + 3] = ctChannels == 2 ? pbTexel[1] : 255;
+            }
+            break;
+    }
+    stbi_image_free(imgRawData);
+}
+
+
+// Expand RGB texels to RGBA with opaque alpha.
+void ImageDecoder::ExpandRgbToRgba(const uint8_t *pbSource, uint8_t *pbTarget, size_t ctTexels) {
+    size_t ctDone = 0;
+#ifdef IMAGE_DECODER_X86
+    if (HasSsse3()) {
+        ctDone = ExpandRgbToRgbaSsse3(pbSource, pbTarget, ctTexels);
+    }
+#endif
+    ExpandRgbToRgbaScalar(pbSource + ctDone * 3, pbTarget + ctDone * 4, ctTexels - ctDone);
+}
+
+
+// Expand RGB texels to RGBA one texel at a time.
+void ImageDecoder::ExpandRgbToRgbaScalar(const uint8_t *pbSource, uint8_t *pbTarget, size_t ctTexels) {
+    for (size_t iTexel = 0; iTexel < ctTexels; iTexel++) {
+        pbTarget[iTexel * 4 + 0] = pbSource[iTexel * 3 + 0];
+        pbTarget[iTexel * 4 + 1] = pbSource[iTexel * 3 + 1];
+        pbTarget[iTexel * 4 + 2] = pbSource[iTexel * 3 + 2];
+        pbTarget[iTexel * 4 + 3] = 255;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Decodes images into RGBA8 texels in memory the caller provides, typically a mapped staging buffer, so an image goes
+// from the file to upload memory without extra copies. Decoding is thread safe, many images can be decoded at once on
+// the thread pool.
+class ImageDecoder {
+public:
+    // Read the size of an image from its header without decoding it. Throws if the file isn't a readable image.
+    static void GetImageSize(const std::string &strFilename, uint32_t &dimWidth, uint32_t &dimHeight);
+    // Decode an image into RGBA8 texels. The target must hold dimWidth * dimHeight * 4 bytes. Throws if the image can't
+    // be decoded or isn't of the expected size.
+    static void DecodeRgba(const std::string &strFilename, uint32_t dimWidth, uint32_t dimHeight, uint8_t *pbTarget);
+    // Read the size of an image that is already in memory, e.g. in a mapped asset package. The name is for errors.
+    static void GetImageSize(const char *pchData, uint64_t ctBytes, const std::string &strName, uint32_t &dimWidth, uint32_t &dimHeight);
+    // Decode an image that is already in memory into RGBA8 texels.
+    static void DecodeRgba(const char *pchData, uint64_t ctBytes, const std::string &strName, uint32_t dimWidth, uint32_t dimHeight, uint8_t *pbTarget);
+
+    // Expand RGB texels to RGBA with opaque alpha. Uses SSSE3 shuffles when the processor has them.
+    static void ExpandRgbToRgba(const uint8_t *pbSource, uint8_t *pbTarget, size_t ctTexels);
+    // Expand RGB texels to RGBA one texel at a time, the fallback of the SSSE3 path.
+    static void ExpandRgbToRgbaScalar(const uint8_t *pbSource, uint8_t *pbTarget, size_t ctTexels);
+};
@@ -0,0 +1,240 @@
+#include "../PrecompiledHeader.h"
+#include "ImportBenchmark.h"
+
+#include <stdexcept>
+#include <cstdio>
+#include <cmath>
+#include <unordered_map>
+
+#include "ImageDecoder.h"
+#include "ObjParser.h"
+#include "../Platform/FileSystem.h"
+#include "../Platform/ThreadPool.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "../ThirdParty/tiny_obj_loader.h"
+#include "../ThirdParty/stb_image.h"
+
+// Number of times each loader runs on each file, the best time is reported.
+static const int CT_BENCHMARK_RUNS = 3;
+// Number of copies of an image decoded at once, as when a model with many textures is loaded.
+static const uint32_t CT_BENCHMARK_CONCURRENT_IMAGES = 8;
+
+
+// Load a model through tinyobj, converting it to vertices and indices the way the engine used to. If welding, corners
+// that share a position and texture coordinates become one vertex, the same output the parallel parser produces.
+static void LoadObjThroughTinyObj(const std::string &strFilename, bool bWeld, std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices) {
+    tinyobj::attrib_t vatrVertexAttributes;
+    std::vector<tinyobj::shape_t> ameshMeshes;
+    std::vector<tinyobj::material_t> amatMaterials;
+    std::string strError;
+
+    if (!tinyobj::LoadObj(&vatrVertexAttributes, &ameshMeshes, &amatMaterials, &strError, strFilename.c_str())) {
+        throw std::runtime_error("Failed to load the model:  " + strError);
+    }
+
+    // vertex of each position and texture coordinate pair seen so far
+    std::unordered_map<uint64_t, uint32_t> mapCorners;
+    for (const auto &meshMesh : ameshMeshes) {
+        for (const auto iVertex : meshMesh.mesh.indices) {
+            if (bWeld) {
+                const uint64_t iKey = (static_cast<uint64_t>(static_cast<uint32_t>(iVertex.vertex_index)) << 32) | static_cast<uint32_t>(iVertex.texcoord_index);
+                auto itCorner = mapCorners.emplace(iKey, static_cast<uint32_t>(avVertices.size()));
+                if (!itCorner.second) {
+                    aiIndices.push_back(itCorner.first->second);
+                    continue;
+                }
+            }
+
+            Vertex vVertex = {};
+            vVertex.vecPosition = {
+                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 0],
+                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 1],
+                vatrVertexAttributes.vertices[iVertex.vertex_index * 3 + 2],
+            };
+            if (iVertex.texcoord_index >= 0) {
+                vVertex.vecTexCoords = {
+                    vatrVertexAttributes.texcoords[iVertex.texcoord_index * 2 + 0],
+                    1.0f - vatrVertexAttributes.texcoords[iVertex.texcoord_index * 2 + 1],
+                };
+            }
+            vVertex.colColor = { 1.0f, 1.0f, 1.0f };
+
+            aiIndices.push_back(static_cast<uint32_t>(avVertices.size()));
+            avVertices.push_back(vVertex);
+        }
+    }
+}
+
+
+// Run a loader a few times and return the best time in milliseconds.
+template<class LoaderFunction>
+static double TimeLoader(const LoaderFunction &fnLoad, size_t &ctVertices, size_t &ctIndices) {
+    double tmBest = std::numeric_limits<double>::max();
+    for (int iRun = 0; iRun < CT_BENCHMARK_RUNS; iRun++) {
+        std::vector<Vertex> avVertices;
+        std::vector<uint32_t> aiIndices;
+
+        auto tmStart = std::chrono::high_resolution_clock::now();
+        fnLoad(avVertices, aiIndices);
+        auto tmEnd = std::chrono::high_resolution_clock::now();
+
+        tmBest = std::min(tmBest, std::chrono::duration<double, std::milli>(tmEnd - tmStart).count());
+        ctVertices = avVertices.size();
+        ctIndices = aiIndices.size();
+    }
+    return tmBest;
+}
+
+
+// Compare OBJ loading through tinyobj with the parallel parser, for each of the given files.
+void ImportBenchmark::RunObjBenchmark(const std::vector<std::string> &astrFilenames) {
+    std::cout << "OBJ import benchmark, " << ThreadPool::Get().GetWorkerCount() << " worker threads, best of " << CT_BENCHMARK_RUNS << " runs" << std::endl;
+
+    for (const std::string &strFilename : astrFilenames) {
+        const double ctMegabytes = FileSystem::GetFileSize(strFilename) / (1024.0 * 1024.0);
+        std::cout << strFilename << " (" << ctMegabytes << " MB)" << std::endl;
+
+        size_t ctVertices = 0;
+        size_t ctIndices = 0;
+        // without welding, as the engine used to load models, to show what the welding step costs
+        double tmTinyObjUnwelded = TimeLoader([&strFilename](std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices) {
+            LoadObjThroughTinyObj(strFilename, false, avVertices, aiIndices);
+        }, ctVertices, ctIndices);
+        std::cout << "    tinyobj:    " << tmTinyObjUnwelded << " ms, " << ctMegabytes / tmTinyObjUnwelded * 1000.0 << " MB/s, "
+            << ctVertices << " vertices, " << ctIndices << " indices, not welded" << std::endl;
+
+        // welded, the same output as the parser produces
+        double tmTinyObj = TimeLoader([&strFilename](std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices) {
+            LoadObjThroughTinyObj(strFilename, true, avVertices, aiIndices);
+        }, ctVertices, ctIndices);
+        std::cout << "    tinyobj:    " << tmTinyObj << " ms, " << ctMegabytes / tmTinyObj * 1000.0 << " MB/s, "
+            << ctVertices << " vertices, " << ctIndices << " indices, welded" << std::endl;
+
+        double tmObjParser = TimeLoader([&strFilename](std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices) {
+            ObjFaceGroups groups;
+            ObjParser::ParseFile(strFilename, avVertices, aiIndices, groups);
+        }, ctVertices, ctIndices);
+        std::cout << "    ObjParser:  " << tmObjParser << " ms, " << ctMegabytes / tmObjParser * 1000.0 << " MB/s, "
+            << ctVertices << " vertices, " << ctIndices << " indices" << std::endl;
+
+        std::cout << "    speedup:    " << tmTinyObj / tmObjParser << "x over welded tinyobj" << std::endl;
+    }
+}
+
+
+// Write a synthetic OBJ file of roughly the given size - a textured, tessellated grid - to benchmark with.
+void ImportBenchmark::GenerateObj(const std::string &strFilename, uint64_t ctTargetSize) {
+    std::ofstream fsFile(strFilename, std::ios::binary | std::ios::trunc);
+    if (!fsFile.is_open()) {
+        throw std::runtime_error("Failed to create file: " + strFilename);
+    }
+
+    // every grid point takes about 100 bytes - a position, texture coordinates and two triangles
+    const unsigned long long ctGridSize = std::max<unsigned long long>(2, static_cast<unsigned long long>(std::sqrt(ctTargetSize / 100.0)));
+
+    // lines are formatted into a small buffer and written in one go
+    char achLine[256];
+    int ctLength = snprintf(achLine, sizeof(achLine), "# synthetic %llux%llu grid\n", ctGridSize, ctGridSize);
+    fsFile.write(achLine, ctLength);
+
+    for (unsigned long long iY = 0; iY < ctGridSize; iY++) {
+        for (unsigned long long iX = 0; iX < ctGridSize; iX++) {
+            const float fU = iX / float(ctGridSize - 1);
+            const float fV = iY / float(ctGridSize - 1);
+            ctLength = snprintf(achLine, sizeof(achLine), "v %f %f %f\nvt %f %f\n",
+                fU * 2.0f - 1.0f, fV * 2.0f - 1.0f, 0.1f * std::sin(fU * 40.0f) * std::cos(fV * 40.0f), fU, fV);
+            fsFile.write(achLine, ctLength);
+        }
+    }
+    for (unsigned long long iY = 0; iY + 1 < ctGridSize; iY++) {
+        for (unsigned long long iX = 0; iX + 1 < ctGridSize; iX++) {
+            const unsigned long long iCorner = iY * ctGridSize + iX + 1;
+            const unsigned long long iRight = iCorner + 1;
+            const unsigned long long iUp = iCorner + ctGridSize;
+            const unsigned long long iUpRight = iUp + 1;
+            ctLength = snprintf(achLine, sizeof(achLine), "f %llu/%llu %llu/%llu %llu/%llu\nf %llu/%llu %llu/%llu %llu/%llu\n",
+                iCorner, iCorner, iRight, iRight, iUpRight, iUpRight, iCorner, iCorner, iUpRight, iUpRight, iUp, iUp);
+            fsFile.write(achLine, ctLength);
+        }
+    }
+}
+
+
+// Run a function a few times and return the best time in milliseconds.
+template<class Function>
+static double TimeBest(const Function &fnRun) {
+    double tmBest = std::numeric_limits<double>::max();
+    for (int iRun = 0; iRun < CT_BENCHMARK_RUNS; iRun++) {
+        auto tmStart = std::chrono::high_resolution_clock::now();
+        fnRun();
+        auto tmEnd = std::chrono::high_resolution_clock::now();
+        tmBest = std::min(tmBest, std::chrono::duration<double, std::milli>(tmEnd - tmStart).count());
+    }
+    return tmBest;
+}
+
+
+// Decode an image the way the engine used to - stb converts it to RGBA in its own buffer, which is then copied over.
+static void DecodeThroughStb(const std::string &strFilename, uint8_t *pbTarget) {
+    int dimWidth, dimHeight, ctChannels;
+    stbi_uc *pbImage = stbi_load(strFilename.c_str(), &dimWidth, &dimHeight, &ctChannels, STBI_rgb_alpha);
+    if (pbImage == nullptr) {
+        throw std::runtime_error("Failed to load the image: " + strFilename);
+    }
+    memcpy(pbTarget, pbImage, size_t(dimWidth) * dimHeight * 4);
+    stbi_image_free(pbImage);
+}
+
+
+// Compare decoding images through stb with a conversion copy against decoding them straight into the target.
+void ImportBenchmark::RunImageBenchmark(const std::vector<std::string> &astrFilenames) {
+    std::cout << "Image decode benchmark, " << ThreadPool::Get().GetWorkerCount() << " worker threads, best of " << CT_BENCHMARK_RUNS << " runs" << std::endl;
+
+    for (const std::string &strFilename : astrFilenames) {
+        uint32_t dimWidth, dimHeight;
+        ImageDecoder::GetImageSize(strFilename, dimWidth, dimHeight);
+        const size_t ctTexels = size_t(dimWidth) * dimHeight;
+        const double ctMegatexels = ctTexels / 1000000.0;
+        std::cout << strFilename << " (" << dimWidth << "x" << dimHeight << ")" << std::endl;
+
+        // the targets stand in for mapped staging buffers, one per concurrently decoded image
+        std::vector<std::vector<uint8_t>> aabTargets(CT_BENCHMARK_CONCURRENT_IMAGES, std::vector<uint8_t>(ctTexels * 4));
+
+        const double tmStb = TimeBest([&]() {
+            DecodeThroughStb(strFilename, aabTargets[0].data());
+        });
+        std::cout << "    stb + copy:     " << tmStb << " ms, " << ctMegatexels / tmStb * 1000.0 << " Mtexels/s" << std::endl;
+
+        const double tmDecoder = TimeBest([&]() {
+            ImageDecoder::DecodeRgba(strFilename, dimWidth, dimHeight, aabTargets[0].data());
+        });
+        std::cout << "    ImageDecoder:   " << tmDecoder << " ms, " << ctMegatexels / tmDecoder * 1000.0 << " Mtexels/s" << std::endl;
+
+        const double tmStbSerial = TimeBest([&]() {
+            for (std::vector<uint8_t> &abTarget : aabTargets) {
+                DecodeThroughStb(strFilename, abTarget.data());
+            }
+        });
+        const double tmDecoderParallel = TimeBest([&]() {
+            ThreadPool::Get().ParallelFor(CT_BENCHMARK_CONCURRENT_IMAGES, [&](uint32_t iImage) {
+                ImageDecoder::DecodeRgba(strFilename, dimWidth, dimHeight, aabTargets[iImage].data());
+            });
+        });
+        std::cout << "    " << CT_BENCHMARK_CONCURRENT_IMAGES << " images, stb + copy one by one: " << tmStbSerial << " ms, ImageDecoder in parallel: "
+            << tmDecoderParallel << " ms, speedup " << tmStbSerial / tmDecoderParallel << "x" << std::endl;
+
+        // the expansion alone, on a synthetic RGB image of the same size
+        std::vector<uint8_t> abRgb(ctTexels * 3);
+        for (size_t iByte = 0; iByte < abRgb.size(); iByte++) {
+            abRgb[iByte] = static_cast<uint8_t>(iByte * 7);
+        }
+        const double tmScalar = TimeBest([&]() {
+            ImageDecoder::ExpandRgbToRgbaScalar(abRgb.data(), aabTargets[0].data(), ctTexels);
+        });
+        const double tmSimd = TimeBest([&]() {
+            ImageDecoder::ExpandRgbToRgba(abRgb.data(), aabTargets[0].data(), ctTexels);
+        });
+        std::cout << "    RGB to RGBA, scalar: " << tmScalar << " ms, SIMD: " << tmSimd << " ms, speedup " << tmScalar / tmSimd << "x" << std::endl;
+    }
+}
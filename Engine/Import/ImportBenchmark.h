@@ -0,0 +1,13 @@
+#pragma once
+
+// Benchmarks for the asset import code. Run from the command line, outside of the regular application loop.
+class ImportBenchmark {
+public:
+    // Compare OBJ loading through tinyobj with the parallel parser, for each of the given files.
+    static void RunObjBenchmark(const std::vector<std::string> &astrFilenames);
+    // Write a synthetic OBJ file of roughly the given size - a textured, tessellated grid - to benchmark with.
+    static void GenerateObj(const std::string &strFilename, uint64_t ctTargetSize);
+    // Compare decoding images through stb with a conversion copy against decoding them straight into the target, one
+    // at a time and many at once, for each of the given files.
+    static void RunImageBenchmark(const std::vector<std::string> &astrFilenames);
+};
@@ -0,0 +1,209 @@
+#include "../PrecompiledHeader.h"
+#include "MeshImporter.h"
+
+#include <cstring>
+
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "MtlParser.h"
+#include "ObjParser.h"
+#include "ObjStreamImporter.h"
+#include "../Config/Options.h"
+#include "../Platform/FileSystem.h"
+#include "../Resources/MeshFile.h"
+#include "../Resources/MeshMaterial.h"
+
+// The in-memory parser peaks at roughly this many times the size of the OBJ text.
+static const uint64_t CT_IN_MEMORY_EXPANSION = 6;
+
+
+// Sort the triangles by material and group, and describe each combination of the two as a submesh. Only the
+// materials that are used are kept, in the order of their first use in the file.
+static void BuildSubmeshes(const ObjFaceGroups &groups, std::vector<uint32_t> &aiIndices,
+    std::vector<MeshSubmesh> &asubSubmeshes, std::vector<std::string> &astrMaterials) {
+    const uint32_t ctTriangles = static_cast<uint32_t>(aiIndices.size() / 3);
+
+    // number the used materials, runs are in file order so the numbering follows the first use
+    std::vector<uint32_t> aidMaterials(groups.astrMaterials.size(), 0xFFFFFFFF);
+    astrMaterials.clear();
+    for (size_t iRun = 0; iRun < groups.arunRuns.size(); iRun++) {
+        const ObjFaceRun &runRun = groups.arunRuns[iRun];
+        const uint32_t iRunEnd = iRun + 1 < groups.arunRuns.size() ? groups.arunRuns[iRun + 1].iFirstTriangle : ctTriangles;
+        if (iRunEnd > runRun.iFirstTriangle && aidMaterials[runRun.iMaterial] == 0xFFFFFFFF) {
+            aidMaterials[runRun.iMaterial] = static_cast<uint32_t>(astrMaterials.size());
+            astrMaterials.push_back(groups.astrMaterials[runRun.iMaterial]);
+        }
+    }
+
+    // count the triangles of each submesh, the map keeps them sorted by material first
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> mapTriangles;
+    for (size_t iRun = 0; iRun < groups.arunRuns.size(); iRun++) {
+        const ObjFaceRun &runRun = groups.arunRuns[iRun];
+        const uint32_t iRunEnd = iRun + 1 < groups.arunRuns.size() ? groups.arunRuns[iRun + 1].iFirstTriangle : ctTriangles;
+        if (iRunEnd > runRun.iFirstTriangle) {
+            mapTriangles[std::make_pair(aidMaterials[runRun.iMaterial], runRun.iGroup)] += iRunEnd - runRun.iFirstTriangle;
+        }
+    }
+
+    // lay the submeshes out one after another, turning the counts into write positions
+    asubSubmeshes.clear();
+    for (auto &itSubmesh : mapTriangles) {
+        MeshSubmesh subSubmesh = {};
+        subSubmesh.iFirstIndex = asubSubmeshes.empty() ? 0 : asubSubmeshes.back().iFirstIndex + asubSubmeshes.back().ctIndices;
+        subSubmesh.ctIndices = itSubmesh.second * 3;
+        subSubmesh.idMaterial = itSubmesh.first.first;
+        itSubmesh.second = subSubmesh.iFirstIndex;
+        asubSubmeshes.push_back(subSubmesh);
+    }
+
+    // move the triangles to their submeshes, keeping their order within each
+    std::vector<uint32_t> aiSorted(aiIndices.size());
+    for (size_t iRun = 0; iRun < groups.arunRuns.size(); iRun++) {
+        const ObjFaceRun &runRun = groups.arunRuns[iRun];
+        const uint32_t iRunEnd = iRun + 1 < groups.arunRuns.size() ? groups.arunRuns[iRun + 1].iFirstTriangle : ctTriangles;
+        if (iRunEnd <= runRun.iFirstTriangle) {
+            continue;
+        }
+        uint32_t &iOutput = mapTriangles[std::make_pair(aidMaterials[runRun.iMaterial], runRun.iGroup)];
+        std::copy(aiIndices.begin() + runRun.iFirstTriangle * 3, aiIndices.begin() + iRunEnd * 3, aiSorted.begin() + iOutput);
+        iOutput += (iRunEnd - runRun.iFirstTriangle) * 3;
+    }
+    aiIndices.swap(aiSorted);
+}
+
+
+// Copy a string into a fixed size field, returns false if it doesn't fit.
+static bool CopyName(char *strTarget, uint32_t ctLength, const std::string &strSource) {
+    if (strSource.size() >= ctLength) {
+        return false;
+    }
+    memcpy(strTarget, strSource.c_str(), strSource.size() + 1);
+    return true;
+}
+
+
+// Look up the used materials in the OBJ's material libraries. Materials that can't be found, or whose textures can't
+// be referenced from the mesh file, fall back to the default texture.
+static void LoadMaterials(const std::string &strObjFilename, const std::string &strMeshFilename, const ObjFaceGroups &groups,
+    const std::vector<std::string> &astrMaterials, std::vector<MeshMaterial> &amatMaterials) {
+    const std::string strObjDirectory = FileSystem::GetDirectory(strObjFilename);
+    const std::string strMeshDirectory = FileSystem::GetDirectory(strMeshFilename);
+
+    // texture paths in a library are relative to the library, make them relative to the OBJ
+    std::vector<MtlMaterial> amtlMaterials;
+    for (const std::string &strLibrary : groups.astrLibraries) {
+        const std::string strLibraryFilename = strObjDirectory + strLibrary;
+        if (!FileSystem::FileExists(strLibraryFilename)) {
+            std::cerr << "Material library not found: " << strLibraryFilename << std::endl;
+            continue;
+        }
+        const size_t iFirstMaterial = amtlMaterials.size();
+        MtlParser::ParseFile(strLibraryFilename, amtlMaterials);
+        for (size_t iMaterial = iFirstMaterial; iMaterial < amtlMaterials.size(); iMaterial++) {
+            if (!amtlMaterials[iMaterial].strDiffuseTexture.empty()) {
+                amtlMaterials[iMaterial].strDiffuseTexture = strObjDirectory + FileSystem::GetDirectory(strLibrary) + amtlMaterials[iMaterial].strDiffuseTexture;
+            }
+        }
+    }
+
+    amatMaterials.assign(astrMaterials.size(), MeshMaterial());
+    for (size_t iMaterial = 0; iMaterial < astrMaterials.size(); iMaterial++) {
+        MeshMaterial &matMaterial = amatMaterials[iMaterial];
+        const std::string &strName = astrMaterials[iMaterial];
+        if (strName.empty()) {
+            continue;
+        }
+        if (!CopyName(matMaterial.strName, CT_MATERIAL_NAME_LENGTH, strName)) {
+            std::cerr << "Material name too long, it is truncated: " << strName << std::endl;
+            memcpy(matMaterial.strName, strName.c_str(), CT_MATERIAL_NAME_LENGTH - 1);
+        }
+
+        // the last definition of a material wins, as with most OBJ readers
+        auto itMaterial = std::find_if(amtlMaterials.rbegin(), amtlMaterials.rend(), [&strName](const MtlMaterial &mtlMaterial) {
+            return mtlMaterial.strName == strName;
+        });
+        if (itMaterial == amtlMaterials.rend()) {
+            std::cerr << "Material not found in the material libraries: " << strName << std::endl;
+            continue;
+        }
+        const std::string &strTexture = itMaterial->strDiffuseTexture;
+        if (strTexture.empty()) {
+            continue;
+        }
+        if (strTexture.compare(0, strMeshDirectory.size(), strMeshDirectory) != 0
+            || !CopyName(matMaterial.strDiffuseTexture, CT_MATERIAL_PATH_LENGTH, strTexture.substr(strMeshDirectory.size()))) {
+            std::cerr << "Texture can't be referenced from the mesh, the default texture is used: " << strTexture << std::endl;
+        }
+    }
+}
+
+
+// Split the submeshes of each level of detail into meshlets. The index range of each submesh is reordered in place.
+static void BuildLodMeshlets(const std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices, std::vector<MeshLod> &alodLods,
+    std::vector<MeshSubmesh> &asubSubmeshes, std::vector<Meshlet> &ameshMeshlets) {
+    std::vector<uint32_t> aiSubmesh;
+    for (MeshLod &lodLevel : alodLods) {
+        lodLevel.iFirstMeshlet = static_cast<uint32_t>(ameshMeshlets.size());
+        for (uint32_t iSubmesh = lodLevel.iFirstSubmesh; iSubmesh < lodLevel.iFirstSubmesh + lodLevel.ctSubmeshes; iSubmesh++) {
+            MeshSubmesh &subSubmesh = asubSubmeshes[iSubmesh];
+            aiSubmesh.assign(aiIndices.begin() + subSubmesh.iFirstIndex, aiIndices.begin() + subSubmesh.iFirstIndex + subSubmesh.ctIndices);
+            subSubmesh.iFirstMeshlet = static_cast<uint32_t>(ameshMeshlets.size());
+            MeshletBuilder::Build(avVertices, 0, aiSubmesh, subSubmesh.iFirstIndex, ameshMeshlets);
+            subSubmesh.ctMeshlets = static_cast<uint32_t>(ameshMeshlets.size()) - subSubmesh.iFirstMeshlet;
+            for (uint32_t iMeshlet = subSubmesh.iFirstMeshlet; iMeshlet < ameshMeshlets.size(); iMeshlet++) {
+                ameshMeshlets[iMeshlet].iSubmesh = iSubmesh;
+            }
+            std::copy(aiSubmesh.begin(), aiSubmesh.end(), aiIndices.begin() + subSubmesh.iFirstIndex);
+        }
+        lodLevel.ctMeshlets = static_cast<uint32_t>(ameshMeshlets.size()) - lodLevel.iFirstMeshlet;
+    }
+}
+
+
+// Import an OBJ file into a mesh file.
+void MeshImporter::ImportObj(const std::string &strObjFilename, const std::string &strMeshFilename) {
+    const uint64_t ctMemoryLimit = Options::Get().GetImportMemoryLimit();
+
+    // models that fit into the memory limit are parsed in memory, which is a lot faster
+    if (FileSystem::GetFileSize(strObjFilename) * CT_IN_MEMORY_EXPANSION <= ctMemoryLimit) {
+        std::vector<Vertex> avVertices;
+        std::vector<uint32_t> aiIndices;
+        ObjFaceGroups groups;
+        ObjParser::ParseFile(strObjFilename, avVertices, aiIndices, groups);
+        // split the mesh into submeshes by material and group
+        std::vector<MeshSubmesh> asubSubmeshes;
+        std::vector<std::string> astrMaterials;
+        BuildSubmeshes(groups, aiIndices, asubSubmeshes, astrMaterials);
+        std::vector<MeshMaterial> amatMaterials;
+        LoadMaterials(strObjFilename, strMeshFilename, groups, astrMaterials, amatMaterials);
+        // simplify the mesh into levels of detail, and split each level into meshlets for culling
+        std::vector<MeshLod> alodLods;
+        MeshSimplifier::BuildLodChain(avVertices, aiIndices, asubSubmeshes, alodLods);
+        std::vector<Meshlet> ameshMeshlets;
+        BuildLodMeshlets(avVertices, aiIndices, alodLods, asubSubmeshes, ameshMeshlets);
+
+        MeshFileWriter mfwWriter;
+        mfwWriter.Open(strMeshFilename);
+        mfwWriter.WriteSection(MESH_SECTION_VERTICES, avVertices);
+        mfwWriter.WriteSection(MESH_SECTION_INDICES, aiIndices);
+        mfwWriter.WriteSection(MESH_SECTION_MESHLETS, ameshMeshlets);
+        mfwWriter.WriteSection(MESH_SECTION_LODS, alodLods);
+        mfwWriter.WriteSection(MESH_SECTION_SUBMESHES, asubSubmeshes);
+        mfwWriter.WriteSection(MESH_SECTION_MATERIALS, amatMaterials);
+        mfwWriter.Close();
+        return;
+    }
+
+    // larger models are streamed through temporary files, and are only imported at full resolution and as a single
+    // submesh with the default material
+    ObjStreamImporter osiImporter(ctMemoryLimit);
+    osiImporter.Import(strObjFilename, strMeshFilename);
+}
+
+
+// Import an OBJ file only if the mesh file is missing, older than the OBJ or of an outdated format.
+void MeshImporter::ImportObjIfOutOfDate(const std::string &strObjFilename, const std::string &strMeshFilename) {
+    if (FileSystem::IsOutOfDate(strMeshFilename, strObjFilename) || !MeshFile::IsValid(strMeshFilename)) {
+        ImportObj(strObjFilename, strMeshFilename);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// Converts source models into the engine mesh format. Small models are parsed in memory on all threads, models too
+// large for the import memory limit are streamed through temporary files instead.
+class MeshImporter {
+public:
+    // Import an OBJ file into a mesh file. Throws if the import fails.
+    static void ImportObj(const std::string &strObjFilename, const std::string &strMeshFilename);
+    // Import an OBJ file only if the mesh file is missing, older than the OBJ or of an outdated format.
+    static void ImportObjIfOutOfDate(const std::string &strObjFilename, const std::string &strMeshFilename);
+};
@@ -0,0 +1,328 @@
+#include "../PrecompiledHeader.h"
+#include "MeshSimplifier.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Most levels in a chain, including the full resolution one.
+static const size_t CT_MAX_LODS = 6;
+// Levels with fewer triangles than this are not generated.
+static const size_t CT_MIN_LOD_TRIANGLES = 32;
+// A level that doesn't get below this fraction of the previous one ends the chain, the mesh is as simple as it gets.
+static const float F_MIN_LOD_REDUCTION = 0.85f;
+// Smallest cosine between a triangle's normal before and after a collapse, collapses that fold triangles are skipped.
+static const float F_MIN_FLIP_COSINE = 0.25f;
+
+
+// Quadric error metric - the sum of squared distances to a set of planes, weighted by the planes' triangle areas.
+// Stored as the upper half of the symmetric 4x4 matrix.
+struct Quadric {
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    // Total area of the planes.
+    double fWeight;
+};
+
+// Add a plane with the given unit normal and distance, weighted by area.
+static void AddPlane(Quadric &qQuadric, const glm::vec3 &vecNormal, float fDistance, float fArea) {
+    const double a = vecNormal.x, b = vecNormal.y, c = vecNormal.z, d = fDistance, w = fArea;
+    qQuadric.a00 += w * a * a; qQuadric.a01 += w * a * b; qQuadric.a02 += w * a * c; qQuadric.a03 += w * a * d;
+    qQuadric.a11 += w * b * b; qQuadric.a12 += w * b * c; qQuadric.a13 += w * b * d;
+    qQuadric.a22 += w * c * c; qQuadric.a23 += w * c * d;
+    qQuadric.a33 += w * d * d;
+    qQuadric.fWeight += w;
+}
+
+// Add one quadric to another.
+static void AddQuadric(Quadric &qTarget, const Quadric &qSource) {
+    qTarget.a00 += qSource.a00; qTarget.a01 += qSource.a01; qTarget.a02 += qSource.a02; qTarget.a03 += qSource.a03;
+    qTarget.a11 += qSource.a11; qTarget.a12 += qSource.a12; qTarget.a13 += qSource.a13;
+    qTarget.a22 += qSource.a22; qTarget.a23 += qSource.a23;
+    qTarget.a33 += qSource.a33;
+    qTarget.fWeight += qSource.fWeight;
+}
+
+// Weighted sum of squared distances of a point from the quadric's planes.
+static double EvaluateQuadric(const Quadric &qQuadric, const glm::vec3 &vecPoint) {
+    const double x = vecPoint.x, y = vecPoint.y, z = vecPoint.z;
+    const double fResult =
+        qQuadric.a00 * x * x + 2 * qQuadric.a01 * x * y + 2 * qQuadric.a02 * x * z + 2 * qQuadric.a03 * x +
+        qQuadric.a11 * y * y + 2 * qQuadric.a12 * y * z + 2 * qQuadric.a13 * y +
+        qQuadric.a22 * z * z + 2 * qQuadric.a23 * z +
+        qQuadric.a33;
+    // rounding can make the sum slightly negative
+    return std::max(fResult, 0.0);
+}
+
+
+// Hash of a position, so vertices that differ only in attributes can be found.
+struct PositionHash {
+    size_t operator()(const glm::vec3 &vecPosition) const {
+        uint32_t aiBits[3];
+        memcpy(aiBits, &vecPosition, sizeof(aiBits));
+        return (aiBits[0] * 73856093u) ^ (aiBits[1] * 19349663u) ^ (aiBits[2] * 83492791u);
+    }
+};
+
+// Candidate collapse of one vertex onto another.
+struct Collapse {
+    uint32_t iSource;
+    uint32_t iTarget;
+    // Average squared distance of the target position from the planes of both vertices.
+    float fCost;
+};
+
+
+// Simplify a triangle list to about ctTargetIndices indices, or as close as it gets.
+float MeshSimplifier::Simplify(const std::vector<Vertex> &avVertices, const std::vector<uint32_t> &aiIndices,
+    size_t ctTargetIndices, std::vector<uint32_t> &aiSimplified)
+{
+    aiSimplified = aiIndices;
+    const size_t ctVertices = avVertices.size();
+
+    // give all vertices at the same position one id, vertices that share a position with others lie on a seam
+    std::vector<uint32_t> aiPositionIds(ctVertices);
+    std::vector<bool> abLocked(ctVertices, false);
+    {
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> mapPositions;
+        std::vector<uint32_t> actWedges;
+        for (uint32_t iVertex = 0; iVertex < ctVertices; iVertex++) {
+            auto itPosition = mapPositions.emplace(avVertices[iVertex].vecPosition, static_cast<uint32_t>(actWedges.size())).first;
+            if (itPosition->second == actWedges.size()) {
+                actWedges.push_back(0);
+            }
+            aiPositionIds[iVertex] = itPosition->second;
+            actWedges[itPosition->second]++;
+        }
+        for (uint32_t iVertex = 0; iVertex < ctVertices; iVertex++) {
+            abLocked[iVertex] = actWedges[aiPositionIds[iVertex]] > 1;
+        }
+    }
+
+    // edges used by one triangle are on a border, and edges used by more than two are not manifold, lock both ends
+    {
+        std::unordered_map<uint64_t, uint32_t> mapEdges;
+        for (size_t iIndex = 0; iIndex < aiSimplified.size(); iIndex += 3) {
+            for (int iEdge = 0; iEdge < 3; iEdge++) {
+                const uint64_t iFirst = aiPositionIds[aiSimplified[iIndex + iEdge]];
+                const uint64_t iSecond = aiPositionIds[aiSimplified[iIndex + (iEdge + 1) % 3]];
+                mapEdges[std::min(iFirst, iSecond) << 32 | std::max(iFirst, iSecond)]++;
+            }
+        }
+        std::vector<bool> abPositionLocked(ctVertices, false);
+        for (const auto &pairEdge : mapEdges) {
+            if (pairEdge.second != 2) {
+                abPositionLocked[pairEdge.first >> 32] = true;
+                abPositionLocked[pairEdge.first & 0xFFFFFFFF] = true;
+            }
+        }
+        for (uint32_t iVertex = 0; iVertex < ctVertices; iVertex++) {
+            abLocked[iVertex] = abLocked[iVertex] || abPositionLocked[aiPositionIds[iVertex]];
+        }
+    }
+
+    // accumulate the planes of all triangles around each vertex
+    std::vector<Quadric> aqQuadrics(ctVertices, Quadric());
+    for (size_t iIndex = 0; iIndex < aiSimplified.size(); iIndex += 3) {
+        const glm::vec3 &vecA = avVertices[aiSimplified[iIndex + 0]].vecPosition;
+        const glm::vec3 &vecB = avVertices[aiSimplified[iIndex + 1]].vecPosition;
+        const glm::vec3 &vecC = avVertices[aiSimplified[iIndex + 2]].vecPosition;
+        glm::vec3 vecNormal = glm::cross(vecB - vecA, vecC - vecA);
+        const float fLength = glm::length(vecNormal);
+        if (fLength <= 0.0f) {
+            continue;
+        }
+        vecNormal /= fLength;
+        for (int iCorner = 0; iCorner < 3; iCorner++) {
+            AddPlane(aqQuadrics[aiSimplified[iIndex + iCorner]], vecNormal, -glm::dot(vecNormal, vecA), fLength * 0.5f);
+        }
+    }
+
+    float fMaxCost = 0.0f;
+    std::vector<uint32_t> actTriangles(ctVertices + 1);
+    std::vector<uint32_t> aiVertexTriangles;
+    std::vector<Collapse> acolCollapses;
+    std::vector<uint32_t> aiRemap(ctVertices);
+    std::vector<bool> abTouched(ctVertices);
+
+    // collapse in passes, each pass collapses the cheapest edges that don't share triangles
+    while (aiSimplified.size() > ctTargetIndices) {
+        const size_t ctTriangles = aiSimplified.size() / 3;
+
+        // list the triangles around each vertex
+        std::fill(actTriangles.begin(), actTriangles.end(), 0);
+        for (uint32_t iVertex : aiSimplified) {
+            actTriangles[iVertex + 1]++;
+        }
+        for (size_t iVertex = 0; iVertex < ctVertices; iVertex++) {
+            actTriangles[iVertex + 1] += actTriangles[iVertex];
+        }
+        aiVertexTriangles.resize(aiSimplified.size());
+        {
+            std::vector<uint32_t> aiFill(actTriangles.begin(), actTriangles.end() - 1);
+            for (size_t iIndex = 0; iIndex < aiSimplified.size(); iIndex++) {
+                aiVertexTriangles[aiFill[aiSimplified[iIndex]]++] = static_cast<uint32_t>(iIndex / 3);
+            }
+        }
+
+        // find the cheaper direction of each edge, each edge of a closed mesh is seen once in each direction
+        acolCollapses.clear();
+        for (size_t iIndex = 0; iIndex < aiSimplified.size(); iIndex += 3) {
+            for (int iEdge = 0; iEdge < 3; iEdge++) {
+                const uint32_t iFirst = aiSimplified[iIndex + iEdge];
+                const uint32_t iSecond = aiSimplified[iIndex + (iEdge + 1) % 3];
+                if (iFirst > iSecond || (abLocked[iFirst] && abLocked[iSecond])) {
+                    continue;
+                }
+                Quadric qEdge = aqQuadrics[iFirst];
+                AddQuadric(qEdge, aqQuadrics[iSecond]);
+                const double fWeight = std::max(qEdge.fWeight, 1e-12);
+                const float fFirstCost = abLocked[iFirst] ? FLT_MAX : static_cast<float>(EvaluateQuadric(qEdge, avVertices[iSecond].vecPosition) / fWeight);
+                const float fSecondCost = abLocked[iSecond] ? FLT_MAX : static_cast<float>(EvaluateQuadric(qEdge, avVertices[iFirst].vecPosition) / fWeight);
+                if (fFirstCost <= fSecondCost) {
+                    acolCollapses.push_back({ iFirst, iSecond, fFirstCost });
+                } else {
+                    acolCollapses.push_back({ iSecond, iFirst, fSecondCost });
+                }
+            }
+        }
+        std::sort(acolCollapses.begin(), acolCollapses.end(), [](const Collapse &colA, const Collapse &colB) { return colA.fCost < colB.fCost; });
+
+        // collapse until enough triangles are gone, each collapse of a manifold edge removes two
+        const size_t ctTrianglesToRemove = ctTriangles - ctTargetIndices / 3;
+        size_t ctRemoved = 0;
+        for (uint32_t iVertex = 0; iVertex < ctVertices; iVertex++) {
+            aiRemap[iVertex] = iVertex;
+        }
+        std::fill(abTouched.begin(), abTouched.end(), false);
+
+        for (const Collapse &colCollapse : acolCollapses) {
+            if (ctRemoved >= ctTrianglesToRemove) {
+                break;
+            }
+            const uint32_t iSource = colCollapse.iSource;
+            const uint32_t iTarget = colCollapse.iTarget;
+            if (abTouched[iSource] || abTouched[iTarget]) {
+                continue;
+            }
+
+            // the triangles that stay must not fold over
+            const glm::vec3 &vecTarget = avVertices[iTarget].vecPosition;
+            bool bFlips = false;
+            for (uint32_t iSlot = actTriangles[iSource]; iSlot < actTriangles[iSource + 1] && !bFlips; iSlot++) {
+                const uint32_t *piTriangle = &aiSimplified[aiVertexTriangles[iSlot] * 3];
+                int iCorner = 0;
+                bool bRemoved = false;
+                for (int iOther = 0; iOther < 3; iOther++) {
+                    if (piTriangle[iOther] == iSource) {
+                        iCorner = iOther;
+                    } else if (aiPositionIds[piTriangle[iOther]] == aiPositionIds[iTarget]) {
+                        bRemoved = true;
+                    }
+                }
+                if (bRemoved) {
+                    continue;
+                }
+                const glm::vec3 &vecA = avVertices[piTriangle[(iCorner + 1) % 3]].vecPosition;
+                const glm::vec3 &vecB = avVertices[piTriangle[(iCorner + 2) % 3]].vecPosition;
+                const glm::vec3 vecBefore = glm::cross(vecA - avVertices[iSource].vecPosition, vecB - avVertices[iSource].vecPosition);
+                const glm::vec3 vecAfter = glm::cross(vecA - vecTarget, vecB - vecTarget);
+                bFlips = glm::dot(vecBefore, vecAfter) < F_MIN_FLIP_COSINE * glm::length(vecBefore) * glm::length(vecAfter);
+            }
+            if (bFlips) {
+                continue;
+            }
+
+            // move the vertex, and keep the neighbourhood unchanged for the rest of the pass
+            aiRemap[iSource] = iTarget;
+            AddQuadric(aqQuadrics[iTarget], aqQuadrics[iSource]);
+            fMaxCost = std::max(fMaxCost, colCollapse.fCost);
+            for (uint32_t iSlot = actTriangles[iSource]; iSlot < actTriangles[iSource + 1]; iSlot++) {
+                const uint32_t *piTriangle = &aiSimplified[aiVertexTriangles[iSlot] * 3];
+                abTouched[piTriangle[0]] = abTouched[piTriangle[1]] = abTouched[piTriangle[2]] = true;
+            }
+            abTouched[iTarget] = true;
+            ctRemoved += 2;
+        }
+
+        // nothing could be collapsed, the mesh is as simple as it gets
+        if (ctRemoved == 0) {
+            break;
+        }
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t ctKept = 0;
+        for (size_t iIndex = 0; iIndex < aiSimplified.size(); iIndex += 3) {
+            const uint32_t iA = aiRemap[aiSimplified[iIndex + 0]];
+            const uint32_t iB = aiRemap[aiSimplified[iIndex + 1]];
+            const uint32_t iC = aiRemap[aiSimplified[iIndex + 2]];
+            if (aiPositionIds[iA] == aiPositionIds[iB] || aiPositionIds[iB] == aiPositionIds[iC] || aiPositionIds[iC] == aiPositionIds[iA]) {
+                continue;
+            }
+            aiSimplified[ctKept++] = iA;
+            aiSimplified[ctKept++] = iB;
+            aiSimplified[ctKept++] = iC;
+        }
+        aiSimplified.resize(ctKept);
+    }
+
+    return std::sqrt(fMaxCost);
+}
+
+
+// Append simplified levels to the index buffer and the submesh array, which hold the full resolution mesh on input.
+void MeshSimplifier::BuildLodChain(const std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices,
+    std::vector<MeshSubmesh> &asubSubmeshes, std::vector<MeshLod> &alodLods) {
+    alodLods.clear();
+    MeshLod lodFull = {};
+    lodFull.ctIndices = static_cast<uint32_t>(aiIndices.size());
+    lodFull.ctSubmeshes = static_cast<uint32_t>(asubSubmeshes.size());
+    alodLods.push_back(lodFull);
+
+    std::vector<uint32_t> aiPrevious;
+    std::vector<uint32_t> aiSimplified;
+    std::vector<uint32_t> aiLevel;
+    std::vector<MeshSubmesh> asubLevel;
+    while (alodLods.size() < CT_MAX_LODS) {
+        const MeshLod lodPrevious = alodLods.back();
+        if (lodPrevious.ctIndices / 6 < CT_MIN_LOD_TRIANGLES) {
+            break;
+        }
+
+        // submeshes are simplified separately, which keeps the borders between materials in place; each level is
+        // simplified from the previous one, so the errors add up
+        aiLevel.clear();
+        asubLevel.clear();
+        float fError = 0.0f;
+        for (uint32_t iSubmesh = 0; iSubmesh < lodPrevious.ctSubmeshes; iSubmesh++) {
+            MeshSubmesh subLevel = asubSubmeshes[lodPrevious.iFirstSubmesh + iSubmesh];
+            aiPrevious.assign(aiIndices.begin() + subLevel.iFirstIndex, aiIndices.begin() + subLevel.iFirstIndex + subLevel.ctIndices);
+            // submeshes that are already small are kept as they are
+            if (subLevel.ctIndices / 6 >= CT_MIN_LOD_TRIANGLES) {
+                fError = std::max(fError, MeshSimplifier::Simplify(avVertices, aiPrevious, subLevel.ctIndices / 6 * 3, aiSimplified));
+                aiPrevious.swap(aiSimplified);
+            }
+            subLevel.iFirstIndex = static_cast<uint32_t>(aiIndices.size() + aiLevel.size());
+            subLevel.ctIndices = static_cast<uint32_t>(aiPrevious.size());
+            aiLevel.insert(aiLevel.end(), aiPrevious.begin(), aiPrevious.end());
+            asubLevel.push_back(subLevel);
+        }
+        if (aiLevel.size() > lodPrevious.ctIndices * F_MIN_LOD_REDUCTION) {
+            break;
+        }
+
+        MeshLod lodLevel = {};
+        lodLevel.iFirstIndex = static_cast<uint32_t>(aiIndices.size());
+        lodLevel.ctIndices = static_cast<uint32_t>(aiLevel.size());
+        lodLevel.iFirstSubmesh = static_cast<uint32_t>(asubSubmeshes.size());
+        lodLevel.ctSubmeshes = static_cast<uint32_t>(asubLevel.size());
+        lodLevel.fError = lodPrevious.fError + fError;
+        alodLods.push_back(lodLevel);
+        aiIndices.insert(aiIndices.end(), aiLevel.begin(), aiLevel.end());
+        asubSubmeshes.insert(asubSubmeshes.end(), asubLevel.begin(), asubLevel.end());
+    }
+}
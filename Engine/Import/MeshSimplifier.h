@@ -0,0 +1,21 @@
+#pragma once
+#include "../Resources/MeshLod.h"
+#include "../Resources/MeshSubmesh.h"
+#include "../Resources/Vertex.h"
+
+// Generates levels of detail by quadric edge collapse. Each collapse moves one vertex onto a neighbour, so simplified
+// levels reuse the original vertices and only need new indices. Vertices on open borders and on texture seams are
+// never moved, which keeps the silhouette of open meshes and the texture mapping intact.
+class MeshSimplifier {
+public:
+    // Simplify a triangle list to about ctTargetIndices indices, or as close as it gets. Returns the bound on the
+    // distance of the simplified surface from the source, in model units.
+    static float Simplify(const std::vector<Vertex> &avVertices, const std::vector<uint32_t> &aiIndices,
+        size_t ctTargetIndices, std::vector<uint32_t> &aiSimplified);
+
+    // Append simplified levels to the index buffer and the submesh array, which hold the full resolution mesh on input.
+    // Each level has about half the triangles of the previous one, and the same submeshes. The levels are described in
+    // alodLods, and neither they nor the submeshes have their meshlet ranges set.
+    static void BuildLodChain(const std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices,
+        std::vector<MeshSubmesh> &asubSubmeshes, std::vector<MeshLod> &alodLods);
+};
@@ -0,0 +1,259 @@
+#include "../PrecompiledHeader.h"
+#include "MeshletBuilder.h"
+
+#include <stdexcept>
+#include <cmath>
+
+#include "../Platform/ThreadPool.h"
+
+// Triangles processed by one job. Meshlets never span two runs.
+static const size_t CT_RUN_TRIANGLES = 1 << 16;
+// Marks a vertex that is not in the current meshlet.
+static const uint32_t NO_MESHLET = 0xFFFFFFFF;
+
+// Triangles of one run and the meshlets built from them.
+struct MeshletRun {
+    // First triangle of the run and the number of triangles in it.
+    size_t iFirstTriangle;
+    size_t ctTriangles;
+    // Meshlets of the run, with index ranges relative to the start of the run.
+    std::vector<Meshlet> ameshMeshlets;
+};
+
+
+// Compute the bounding sphere and the normal cone of a meshlet from its triangles.
+static void ComputeBounds(const std::vector<Vertex> &avVertices, uint32_t iVertexBase, const uint32_t *piIndices, Meshlet &meshMeshlet) {
+    const size_t ctTriangles = meshMeshlet.ctIndices / 3;
+
+    // the sphere is centered on the bounding box, which is close enough for culling
+    glm::vec3 vecMin = avVertices[piIndices[0] - iVertexBase].vecPosition;
+    glm::vec3 vecMax = vecMin;
+    for (size_t iIndex = 0; iIndex < meshMeshlet.ctIndices; iIndex++) {
+        const glm::vec3 &vecPosition = avVertices[piIndices[iIndex] - iVertexBase].vecPosition;
+        vecMin = glm::min(vecMin, vecPosition);
+        vecMax = glm::max(vecMax, vecPosition);
+    }
+    const glm::vec3 vecCenter = (vecMin + vecMax) * 0.5f;
+    float fRadius = 0.0f;
+    for (size_t iIndex = 0; iIndex < meshMeshlet.ctIndices; iIndex++) {
+        fRadius = std::max(fRadius, glm::length(avVertices[piIndices[iIndex] - iVertexBase].vecPosition - vecCenter));
+    }
+    meshMeshlet.sphBounds = glm::vec4(vecCenter, fRadius);
+
+    // the cone axis is the area weighted average of triangle normals
+    std::vector<glm::vec3> avecNormals(ctTriangles);
+    glm::vec3 vecAxis(0.0f);
+    for (size_t iTriangle = 0; iTriangle < ctTriangles; iTriangle++) {
+        const glm::vec3 &vec0 = avVertices[piIndices[iTriangle * 3 + 0] - iVertexBase].vecPosition;
+        const glm::vec3 &vec1 = avVertices[piIndices[iTriangle * 3 + 1] - iVertexBase].vecPosition;
+        const glm::vec3 &vec2 = avVertices[piIndices[iTriangle * 3 + 2] - iVertexBase].vecPosition;
+        avecNormals[iTriangle] = glm::cross(vec1 - vec0, vec2 - vec0);
+        vecAxis += avecNormals[iTriangle];
+    }
+
+    // normals that cancel out don't form a usable cone
+    meshMeshlet.vecConeAxisCutoff = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const float fAxisLength = glm::length(vecAxis);
+    if (fAxisLength < 1e-12f) {
+        return;
+    }
+    vecAxis /= fAxisLength;
+
+    // the cone half angle is set by the normal that deviates most from the axis, degenerate triangles don't count
+    float fMinDot = 1.0f;
+    for (const glm::vec3 &vecNormal : avecNormals) {
+        const float fNormalLength = glm::length(vecNormal);
+        if (fNormalLength > 1e-20f) {
+            fMinDot = std::min(fMinDot, glm::dot(vecNormal, vecAxis) / fNormalLength);
+        }
+    }
+    // cones of 90 degrees or wider can be seen into from any direction
+    if (fMinDot <= 0.0f) {
+        return;
+    }
+    meshMeshlet.vecConeAxisCutoff = glm::vec4(vecAxis, std::sqrt(1.0f - fMinDot * fMinDot));
+}
+
+
+// Build the meshlets of one run of triangles, reordering its indices in place.
+static void BuildRun(const std::vector<Vertex> &avVertices, uint32_t iVertexBase, uint32_t *piIndices, MeshletRun &runRun) {
+    const size_t ctTriangles = runRun.ctTriangles;
+    const size_t ctCorners = ctTriangles * 3;
+
+    // give the vertices of the run compact local numbers through an open addressing table
+    size_t ctCapacity = 16;
+    uint32_t ctCapacityBits = 4;
+    while (ctCapacity < ctCorners * 2) {
+        ctCapacity <<= 1;
+        ctCapacityBits++;
+    }
+    std::vector<uint32_t> aiKeys(ctCapacity, NO_MESHLET);
+    std::vector<uint32_t> aiValues(ctCapacity);
+    std::vector<uint32_t> aiLocalCorners(ctCorners);
+    uint32_t ctLocalVertices = 0;
+    for (size_t iCorner = 0; iCorner < ctCorners; iCorner++) {
+        const uint32_t iVertex = piIndices[iCorner];
+        if (iVertex < iVertexBase || iVertex - iVertexBase >= avVertices.size()) {
+            throw std::runtime_error("Mesh index out of range");
+        }
+        size_t iSlot = static_cast<size_t>((iVertex * 0x9E3779B97F4A7C15ULL) >> (64 - ctCapacityBits));
+        while (aiKeys[iSlot] != NO_MESHLET && aiKeys[iSlot] != iVertex) {
+            iSlot = (iSlot + 1) & (ctCapacity - 1);
+        }
+        if (aiKeys[iSlot] == NO_MESHLET) {
+            aiKeys[iSlot] = iVertex;
+            aiValues[iSlot] = ctLocalVertices++;
+        }
+        aiLocalCorners[iCorner] = aiValues[iSlot];
+    }
+
+    // list the triangles around each vertex
+    std::vector<uint32_t> aiAdjacencyOffsets(ctLocalVertices + 1, 0);
+    for (uint32_t iLocal : aiLocalCorners) {
+        aiAdjacencyOffsets[iLocal + 1]++;
+    }
+    for (uint32_t iLocal = 0; iLocal < ctLocalVertices; iLocal++) {
+        aiAdjacencyOffsets[iLocal + 1] += aiAdjacencyOffsets[iLocal];
+    }
+    std::vector<uint32_t> aiAdjacentTriangles(ctCorners);
+    std::vector<uint32_t> aiFill(aiAdjacencyOffsets.begin(), aiAdjacencyOffsets.end() - 1);
+    for (size_t iCorner = 0; iCorner < ctCorners; iCorner++) {
+        aiAdjacentTriangles[aiFill[aiLocalCorners[iCorner]]++] = static_cast<uint32_t>(iCorner / 3);
+    }
+
+    // meshlet each vertex currently belongs to, and whether each triangle is already taken
+    std::vector<uint32_t> aiVertexMeshlet(ctLocalVertices, NO_MESHLET);
+    std::vector<bool> abTaken(ctTriangles, false);
+    // triangles next to the current meshlet, the only ones considered for growing it
+    std::vector<uint32_t> aiCandidates;
+    // triangles in the new order
+    std::vector<uint32_t> aiOrdered;
+    aiOrdered.reserve(ctTriangles);
+
+    uint32_t ctMeshletVertices = 0;
+    uint32_t ctMeshletTriangles = 0;
+    const uint32_t iNoMeshlet = NO_MESHLET;
+    uint32_t iMeshlet = 0;
+
+    // number of vertices a triangle would add to the current meshlet
+    auto CountNewVertices = [&](uint32_t iTriangle) {
+        uint32_t ctNew = 0;
+        for (int iCorner = 0; iCorner < 3; iCorner++) {
+            ctNew += aiVertexMeshlet[aiLocalCorners[iTriangle * 3 + iCorner]] != iMeshlet ? 1 : 0;
+        }
+        return ctNew;
+    };
+
+    // add a triangle to the current meshlet and make its untaken neighbours candidates
+    auto AddTriangle = [&](uint32_t iTriangle) {
+        abTaken[iTriangle] = true;
+        aiOrdered.push_back(iTriangle);
+        ctMeshletTriangles++;
+        for (int iCorner = 0; iCorner < 3; iCorner++) {
+            const uint32_t iLocal = aiLocalCorners[iTriangle * 3 + iCorner];
+            if (aiVertexMeshlet[iLocal] == iMeshlet) {
+                continue;
+            }
+            aiVertexMeshlet[iLocal] = iMeshlet;
+            ctMeshletVertices++;
+            for (uint32_t iAdjacent = aiAdjacencyOffsets[iLocal]; iAdjacent < aiAdjacencyOffsets[iLocal + 1]; iAdjacent++) {
+                if (!abTaken[aiAdjacentTriangles[iAdjacent]]) {
+                    aiCandidates.push_back(aiAdjacentTriangles[iAdjacent]);
+                }
+            }
+        }
+    };
+
+    // close the current meshlet and start the next one
+    auto FinishMeshlet = [&]() {
+        Meshlet meshMeshlet = {};
+        meshMeshlet.iFirstIndex = static_cast<uint32_t>((aiOrdered.size() - ctMeshletTriangles) * 3);
+        meshMeshlet.ctIndices = ctMeshletTriangles * 3;
+        meshMeshlet.ctVertices = ctMeshletVertices;
+        runRun.ameshMeshlets.push_back(meshMeshlet);
+
+        iMeshlet++;
+        ctMeshletVertices = 0;
+        ctMeshletTriangles = 0;
+        aiCandidates.clear();
+    };
+
+    // seeds are taken in the original order, which keeps meshlets in a cache friendly order too
+    for (uint32_t iSeed = 0; iSeed < ctTriangles; iSeed++) {
+        if (abTaken[iSeed]) {
+            continue;
+        }
+        AddTriangle(iSeed);
+
+        // grow the meshlet while a neighbouring triangle fits
+        while (ctMeshletTriangles < CT_MESHLET_MAX_TRIANGLES) {
+            // pick the candidate that adds the fewest vertices, dropping taken ones on the way
+            uint32_t iBest = iNoMeshlet;
+            uint32_t ctBestNew = 4;
+            size_t ctKept = 0;
+            for (size_t iCandidate = 0; iCandidate < aiCandidates.size(); iCandidate++) {
+                const uint32_t iTriangle = aiCandidates[iCandidate];
+                if (abTaken[iTriangle]) {
+                    continue;
+                }
+                aiCandidates[ctKept++] = iTriangle;
+                const uint32_t ctNew = CountNewVertices(iTriangle);
+                if (ctNew < ctBestNew && ctMeshletVertices + ctNew <= CT_MESHLET_MAX_VERTICES) {
+                    iBest = iTriangle;
+                    ctBestNew = ctNew;
+                }
+            }
+            aiCandidates.resize(ctKept);
+
+            if (iBest == iNoMeshlet) {
+                break;
+            }
+            AddTriangle(iBest);
+        }
+        FinishMeshlet();
+    }
+
+    // write the triangles back in meshlet order
+    std::vector<uint32_t> aiOriginal(piIndices, piIndices + ctCorners);
+    for (size_t iTriangle = 0; iTriangle < ctTriangles; iTriangle++) {
+        for (int iCorner = 0; iCorner < 3; iCorner++) {
+            piIndices[iTriangle * 3 + iCorner] = aiOriginal[aiOrdered[iTriangle] * 3 + iCorner];
+        }
+    }
+
+    for (Meshlet &meshMeshlet : runRun.ameshMeshlets) {
+        ComputeBounds(avVertices, iVertexBase, piIndices + meshMeshlet.iFirstIndex, meshMeshlet);
+    }
+}
+
+
+// Reorder the triangles of a mesh so that each meshlet is a contiguous index range and append the meshlets.
+void MeshletBuilder::Build(const std::vector<Vertex> &avVertices, uint32_t iVertexBase, std::vector<uint32_t> &aiIndices,
+    uint32_t iIndexBase, std::vector<Meshlet> &ameshMeshlets)
+{
+    if (aiIndices.size() % 3 != 0) {
+        throw std::runtime_error("Mesh index count is not a multiple of three");
+    }
+
+    // split the triangles into runs
+    const size_t ctTriangles = aiIndices.size() / 3;
+    std::vector<MeshletRun> arunRuns((ctTriangles + CT_RUN_TRIANGLES - 1) / CT_RUN_TRIANGLES);
+    for (size_t iRun = 0; iRun < arunRuns.size(); iRun++) {
+        arunRuns[iRun].iFirstTriangle = iRun * CT_RUN_TRIANGLES;
+        arunRuns[iRun].ctTriangles = std::min(CT_RUN_TRIANGLES, ctTriangles - iRun * CT_RUN_TRIANGLES);
+    }
+
+    // build the meshlets of all runs in parallel
+    ThreadPool::Get().ParallelFor(static_cast<uint32_t>(arunRuns.size()), [&](uint32_t iRun) {
+        MeshletRun &runRun = arunRuns[iRun];
+        BuildRun(avVertices, iVertexBase, aiIndices.data() + runRun.iFirstTriangle * 3, runRun);
+    });
+
+    // append the meshlets, with index ranges relative to the whole index buffer
+    for (const MeshletRun &runRun : arunRuns) {
+        for (Meshlet meshMeshlet : runRun.ameshMeshlets) {
+            meshMeshlet.iFirstIndex += static_cast<uint32_t>(iIndexBase + runRun.iFirstTriangle * 3);
+            ameshMeshlets.push_back(meshMeshlet);
+        }
+    }
+}
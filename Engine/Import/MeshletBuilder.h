@@ -0,0 +1,15 @@
+#pragma once
+#include "../Resources/Meshlet.h"
+#include "../Resources/Vertex.h"
+
+// Splits indexed triangle meshes into meshlets. Triangles are grown greedily from a seed over shared vertices,
+// preferring triangles that add the fewest new vertices, which keeps meshlets compact and their normal cones narrow.
+// Large meshes are split into runs of triangles that are processed in parallel on the thread pool.
+class MeshletBuilder {
+public:
+    // Reorder the triangles of a mesh so that each meshlet is a contiguous index range and append the meshlets.
+    // Indices refer to avVertices offset by iVertexBase, and meshlet index ranges are offset by iIndexBase, so a mesh
+    // can be built piece by piece into shared vertex and index buffers.
+    static void Build(const std::vector<Vertex> &avVertices, uint32_t iVertexBase, std::vector<uint32_t> &aiIndices,
+        uint32_t iIndexBase, std::vector<Meshlet> &ameshMeshlets);
+};
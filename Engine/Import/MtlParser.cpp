@@ -0,0 +1,45 @@
+#include "../PrecompiledHeader.h"
+#include "MtlParser.h"
+
+#include <sstream>
+#include <stdexcept>
+
+// Trim blanks from both ends of a string.
+static std::string Trim(const std::string &str) {
+    const size_t iFirst = str.find_first_not_of(" \t\r");
+    if (iFirst == std::string::npos) {
+        return std::string();
+    }
+    return str.substr(iFirst, str.find_last_not_of(" \t\r") - iFirst + 1);
+}
+
+
+// Append the materials of an MTL file.
+void MtlParser::ParseFile(const std::string &strFilename, std::vector<MtlMaterial> &amtlMaterials) {
+    std::ifstream fsFile(strFilename);
+    if (!fsFile.is_open()) {
+        throw std::runtime_error("Failed to open file: " + strFilename);
+    }
+
+    std::string strLine;
+    MtlMaterial *pmtlCurrent = nullptr;
+    while (std::getline(fsFile, strLine)) {
+        std::istringstream ssLine(strLine);
+        std::string strKeyword;
+        ssLine >> strKeyword;
+
+        if (strKeyword == "newmtl") {
+            std::string strName;
+            std::getline(ssLine, strName);
+            amtlMaterials.push_back({ Trim(strName), std::string() });
+            pmtlCurrent = &amtlMaterials.back();
+
+        // the texture file is the last token, options like -s or -o come before it
+        } else if (strKeyword == "map_Kd" && pmtlCurrent != nullptr) {
+            std::string strToken;
+            while (ssLine >> strToken) {
+                pmtlCurrent->strDiffuseTexture = strToken;
+            }
+        }
+    }
+}
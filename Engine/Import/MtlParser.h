@@ -0,0 +1,15 @@
+#pragma once
+
+// A material read from a Wavefront MTL library.
+struct MtlMaterial {
+    std::string strName;
+    // Path of the diffuse texture as written in the library, relative to the library's directory. Empty if none.
+    std::string strDiffuseTexture;
+};
+
+// Parser for the material libraries OBJ files reference. Only material names and diffuse textures are read.
+class MtlParser {
+public:
+    // Append the materials of an MTL file. Throws if the file can't be read.
+    static void ParseFile(const std::string &strFilename, std::vector<MtlMaterial> &amtlMaterials);
+};
@@ -0,0 +1,629 @@
+#include "../PrecompiledHeader.h"
+#include "ObjParser.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <unordered_map>
+
+#include "../Platform/MappedFile.h"
+#include "../Platform/ThreadPool.h"
+
+// Marks a corner that has no texture coordinates.
+static const uint32_t NO_INDEX = 0xFFFFFFFF;
+// Marks an unused slot in a corner table.
+static const uint64_t EMPTY_KEY = ~0ULL;
+// Chunks smaller than this aren't worth handing to another thread.
+static const size_t CT_MIN_CHUNK_SIZE = 1 << 20;
+
+// Exactly representable powers of 10, used to scale parsed mantissas.
+static const double adPowersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// A corner index that used a negative (relative) OBJ index. It can only be resolved after the number of
+// elements in all preceding chunks is known.
+struct ObjFixup {
+    // Slot in the chunk's corner array.
+    size_t iSlot;
+    // Index relative to the start of the chunk, can be negative when referring to an earlier chunk.
+    int64_t iLocalIndex;
+};
+
+// Kinds of statements that apply to the faces that follow them.
+enum ObjStatementType {
+    OBJ_STATEMENT_GROUP,
+    OBJ_STATEMENT_MATERIAL,
+    OBJ_STATEMENT_LIBRARY,
+};
+
+// A group, object, material or material library statement.
+struct ObjStatement {
+    // Number of triangles in the chunk before the statement.
+    size_t ctTriangles;
+    enum ObjStatementType idType;
+    std::string strName;
+};
+
+// A part of the file parsed by one job, and the results of parsing it.
+struct ObjChunk {
+    // Text of the chunk, starts at a line start and ends after a line end.
+    const char *pchBegin;
+    const char *pchEnd;
+
+    // Positions and texture coordinates declared in the chunk.
+    std::vector<glm::vec3> avecPositions;
+    std::vector<glm::vec2> avecTexCoords;
+    // Global position and texture coordinate index pairs, one pair per triangle corner.
+    std::vector<uint32_t> aiCorners;
+    // Pair slots that use relative indices.
+    std::vector<ObjFixup> afixPositions;
+    std::vector<ObjFixup> afixTexCoords;
+    // Statements, in the order they appear.
+    std::vector<ObjStatement> astStatements;
+
+    // Number of positions and texture coordinates declared before this chunk.
+    uint64_t ctPositionBase;
+    uint64_t ctTexCoordBase;
+
+    // Position and texture coordinate keys of the chunk's distinct corners, in the order they first appear, and the
+    // chunk local indices into them.
+    std::vector<uint64_t> aiVertexKeys;
+    std::vector<uint32_t> aiIndices;
+    // Merged vertex of each of the chunk's distinct corners.
+    std::vector<uint32_t> aiMergedVertices;
+    // Where this chunk's indices go in the merged buffer.
+    uint64_t ctIndexBase;
+};
+
+
+// Open addressing hash table from corner keys to vertex indices.
+class ObjCornerTable {
+public:
+    // Size the table for a number of distinct keys.
+    explicit ObjCornerTable(size_t ctKeys) {
+        // capacity is a power of two at least twice the number of keys
+        size_t ctCapacity = 16;
+        ctCapacityBits = 4;
+        while (ctCapacity < ctKeys * 2) {
+            ctCapacity <<= 1;
+            ctCapacityBits++;
+        }
+        aiKeys.assign(ctCapacity, EMPTY_KEY);
+        aiValues.resize(ctCapacity);
+    }
+
+    // Find the vertex of a key, adding the key with the given vertex if it is new. Returns the key's vertex.
+    inline uint32_t FindOrAdd(uint64_t iKey, uint32_t iNewValue, bool &bAdded) {
+        const size_t ctMask = aiKeys.size() - 1;
+        size_t iSlot = static_cast<size_t>((iKey * 0x9E3779B97F4A7C15ULL) >> (64 - ctCapacityBits));
+        while (aiKeys[iSlot] != EMPTY_KEY && aiKeys[iSlot] != iKey) {
+            iSlot = (iSlot + 1) & ctMask;
+        }
+        bAdded = aiKeys[iSlot] == EMPTY_KEY;
+        if (bAdded) {
+            aiKeys[iSlot] = iKey;
+            aiValues[iSlot] = iNewValue;
+        }
+        return aiValues[iSlot];
+    }
+
+private:
+    std::vector<uint64_t> aiKeys;
+    std::vector<uint32_t> aiValues;
+    uint32_t ctCapacityBits;
+};
+
+
+static inline bool IsBlank(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+// Does the line start with the keyword, followed by a blank?
+static inline bool IsKeyword(const char *pch, const char *pchEnd, const char *strKeyword) {
+    const size_t ctLength = strlen(strKeyword);
+    return static_cast<size_t>(pchEnd - pch) > ctLength && memcmp(pch, strKeyword, ctLength) == 0 && IsBlank(pch[ctLength]);
+}
+
+// Store a statement, with the rest of the line without surrounding blanks as its name.
+static void StoreStatement(ObjChunk &chunk, enum ObjStatementType idType, const char *pch, const char *pchEnd) {
+    while (pch < pchEnd && IsBlank(*pch)) {
+        pch++;
+    }
+    while (pchEnd > pch && IsBlank(pchEnd[-1])) {
+        pchEnd--;
+    }
+    chunk.astStatements.push_back({ chunk.aiCorners.size() / 6, idType, std::string(pch, pchEnd) });
+}
+
+
+static inline bool IsDigit(char ch) {
+    return static_cast<unsigned char>(ch - '0') < 10;
+}
+
+
+// Parse a floating point number, skipping leading blanks. Returns the position after the number.
+// Malformed numbers read as zero and are skipped, the same way tinyobj treats them.
+const char *ObjParser::ParseFloat(const char *pchText, const char *pchEnd, float &fValue) {
+    const char *pch = pchText;
+    while (pch < pchEnd && IsBlank(*pch)) {
+        pch++;
+    }
+
+    // read the sign
+    bool bNegative = false;
+    if (pch < pchEnd && (*pch == '-' || *pch == '+')) {
+        bNegative = *pch == '-';
+        pch++;
+    }
+
+    // accumulate up to 18 significant digits into an integer mantissa, the rest only moves the exponent
+    uint64_t ctMantissa = 0;
+    int iExponent = 0;
+    bool bHasDigits = false;
+    while (pch < pchEnd && IsDigit(*pch)) {
+        if (ctMantissa < 100000000000000000ULL) {
+            ctMantissa = ctMantissa * 10 + (*pch - '0');
+        } else {
+            iExponent++;
+        }
+        bHasDigits = true;
+        pch++;
+    }
+    if (pch < pchEnd && *pch == '.') {
+        pch++;
+        while (pch < pchEnd && IsDigit(*pch)) {
+            if (ctMantissa < 100000000000000000ULL) {
+                ctMantissa = ctMantissa * 10 + (*pch - '0');
+                iExponent--;
+            }
+            bHasDigits = true;
+            pch++;
+        }
+    }
+
+    // not a number, skip the token
+    if (!bHasDigits) {
+        while (pch < pchEnd && !IsBlank(*pch) && *pch != '\n') {
+            pch++;
+        }
+        fValue = 0.0f;
+        return pch;
+    }
+
+    // read the exponent
+    if (pch < pchEnd && (*pch == 'e' || *pch == 'E')) {
+        pch++;
+        int64_t iExplicitExponent = 0;
+        const char *pchExponent = ParseInteger(pch, pchEnd, iExplicitExponent);
+        if (pchExponent != pch) {
+            iExponent += static_cast<int>(std::max<int64_t>(-400, std::min<int64_t>(400, iExplicitExponent)));
+            pch = pchExponent;
+        }
+    }
+
+    // scale the mantissa, with exact powers of ten in the common case
+    double dValue = static_cast<double>(ctMantissa);
+    if (iExponent < 0 && iExponent >= -22) {
+        dValue /= adPowersOf10[-iExponent];
+    } else if (iExponent > 0 && iExponent <= 22) {
+        dValue *= adPowersOf10[iExponent];
+    } else if (iExponent != 0) {
+        dValue *= std::pow(10.0, iExponent);
+    }
+
+    fValue = static_cast<float>(bNegative ? -dValue : dValue);
+    return pch;
+}
+
+
+// Parse a signed integer. Returns the position after the number, or the start position if there is no number.
+const char *ObjParser::ParseInteger(const char *pchText, const char *pchEnd, int64_t &iValue) {
+    const char *pch = pchText;
+    bool bNegative = false;
+    if (pch < pchEnd && (*pch == '-' || *pch == '+')) {
+        bNegative = *pch == '-';
+        pch++;
+    }
+    if (pch >= pchEnd || !IsDigit(*pch)) {
+        iValue = 0;
+        return pchText;
+    }
+
+    int64_t iResult = 0;
+    while (pch < pchEnd && IsDigit(*pch)) {
+        iResult = iResult * 10 + (*pch - '0');
+        pch++;
+    }
+    iValue = bNegative ? -iResult : iResult;
+    return pch;
+}
+
+
+// Store an OBJ index into a corner slot. Positive indices are global and 1-based, negative ones are relative
+// to the number of elements declared so far and are resolved later.
+static inline void StoreIndex(int64_t iObjIndex, uint64_t ctDeclared, std::vector<uint32_t> &aiCorners, std::vector<ObjFixup> &afixFixups) {
+    if (iObjIndex > 0) {
+        if (iObjIndex > NO_INDEX) {
+            throw std::runtime_error("OBJ index out of range");
+        }
+        aiCorners.push_back(static_cast<uint32_t>(iObjIndex - 1));
+    } else if (iObjIndex < 0) {
+        afixFixups.push_back({ aiCorners.size(), static_cast<int64_t>(ctDeclared) + iObjIndex });
+        aiCorners.push_back(0);
+    } else {
+        throw std::runtime_error("Invalid OBJ index 0");
+    }
+}
+
+
+// Parse the lines of one chunk. Collects positions, texture coordinates and triangulated face corners.
+static void ParseChunk(ObjChunk &chunk) {
+    // corners of the current polygon, reused between faces
+    std::vector<int64_t> aiPolygon;
+
+    const char *pchLine = chunk.pchBegin;
+    while (pchLine < chunk.pchEnd) {
+        // find the end of the line
+        const char *pchEnd = static_cast<const char *>(memchr(pchLine, '\n', chunk.pchEnd - pchLine));
+        if (pchEnd == nullptr) {
+            pchEnd = chunk.pchEnd;
+        }
+
+        // skip leading blanks
+        const char *pch = pchLine;
+        while (pch < pchEnd && IsBlank(*pch)) {
+            pch++;
+        }
+
+        // position
+        if (pchEnd - pch > 1 && pch[0] == 'v' && IsBlank(pch[1])) {
+            glm::vec3 vecPosition;
+            pch = ObjParser::ParseFloat(pch + 2, pchEnd, vecPosition.x);
+            pch = ObjParser::ParseFloat(pch, pchEnd, vecPosition.y);
+            pch = ObjParser::ParseFloat(pch, pchEnd, vecPosition.z);
+            chunk.avecPositions.push_back(vecPosition);
+
+        // texture coordinates
+        } else if (pchEnd - pch > 2 && pch[0] == 'v' && pch[1] == 't' && IsBlank(pch[2])) {
+            glm::vec2 vecTexCoords;
+            pch = ObjParser::ParseFloat(pch + 3, pchEnd, vecTexCoords.x);
+            pch = ObjParser::ParseFloat(pch, pchEnd, vecTexCoords.y);
+            chunk.avecTexCoords.push_back(vecTexCoords);
+
+        // face
+        } else if (pchEnd - pch > 1 && pch[0] == 'f' && IsBlank(pch[1])) {
+            aiPolygon.clear();
+            pch++;
+            while (true) {
+                while (pch < pchEnd && IsBlank(*pch)) {
+                    pch++;
+                }
+                if (pch >= pchEnd) {
+                    break;
+                }
+
+                // corners are given as v, v/vt, v//vn or v/vt/vn, normals are not used
+                int64_t iPosition = 0;
+                int64_t iTexCoords = 0;
+                const char *pchNext = ObjParser::ParseInteger(pch, pchEnd, iPosition);
+                if (pchNext == pch) {
+                    throw std::runtime_error("Malformed OBJ face");
+                }
+                pch = pchNext;
+                if (pch < pchEnd && *pch == '/') {
+                    pch = ObjParser::ParseInteger(pch + 1, pchEnd, iTexCoords);
+                }
+                // skip the normal index
+                while (pch < pchEnd && !IsBlank(*pch)) {
+                    pch++;
+                }
+
+                aiPolygon.push_back(iPosition);
+                aiPolygon.push_back(iTexCoords);
+            }
+
+            // triangulate the polygon as a fan around the first corner
+            const size_t ctCorners = aiPolygon.size() / 2;
+            for (size_t iCorner = 1; iCorner + 1 < ctCorners; iCorner++) {
+                const size_t aiTriangle[] = { 0, iCorner, iCorner + 1 };
+                for (size_t iTriangleCorner : aiTriangle) {
+                    StoreIndex(aiPolygon[iTriangleCorner * 2 + 0], chunk.avecPositions.size(), chunk.aiCorners, chunk.afixPositions);
+                    // corners without texture coordinates are marked as such
+                    if (aiPolygon[iTriangleCorner * 2 + 1] == 0) {
+                        chunk.aiCorners.push_back(NO_INDEX);
+                    } else {
+                        StoreIndex(aiPolygon[iTriangleCorner * 2 + 1], chunk.avecTexCoords.size(), chunk.aiCorners, chunk.afixTexCoords);
+                    }
+                }
+            }
+
+        // groups, objects, materials and material libraries, resolved once all chunks are parsed
+        } else if (IsKeyword(pch, pchEnd, "g") || IsKeyword(pch, pchEnd, "o")) {
+            StoreStatement(chunk, OBJ_STATEMENT_GROUP, pch + 2, pchEnd);
+        } else if (IsKeyword(pch, pchEnd, "usemtl")) {
+            StoreStatement(chunk, OBJ_STATEMENT_MATERIAL, pch + 7, pchEnd);
+        } else if (IsKeyword(pch, pchEnd, "mtllib")) {
+            StoreStatement(chunk, OBJ_STATEMENT_LIBRARY, pch + 7, pchEnd);
+        }
+        // everything else (normals, comments...) is ignored
+
+        pchLine = pchEnd + 1;
+    }
+}
+
+
+// Resolve the relative indices of a chunk once the global element counts are known.
+static void ResolveFixups(ObjChunk &chunk) {
+    for (const ObjFixup &fixFixup : chunk.afixPositions) {
+        int64_t iIndex = static_cast<int64_t>(chunk.ctPositionBase) + fixFixup.iLocalIndex;
+        if (iIndex < 0) {
+            throw std::runtime_error("OBJ index out of range");
+        }
+        chunk.aiCorners[fixFixup.iSlot] = static_cast<uint32_t>(iIndex);
+    }
+    for (const ObjFixup &fixFixup : chunk.afixTexCoords) {
+        int64_t iIndex = static_cast<int64_t>(chunk.ctTexCoordBase) + fixFixup.iLocalIndex;
+        if (iIndex < 0) {
+            throw std::runtime_error("OBJ index out of range");
+        }
+        chunk.aiCorners[fixFixup.iSlot] = static_cast<uint32_t>(iIndex);
+    }
+}
+
+
+// Find the distinct corners of one chunk. Corners with the same position and texture coordinates get the same chunk
+// local index. Distinct corners are kept in the order they first appear, so that merging the chunks in order numbers
+// the vertices the same way regardless of how the file was split.
+static void WeldChunk(ObjChunk &chunk, uint64_t ctPositions, uint64_t ctTexCoords) {
+    const size_t ctCorners = chunk.aiCorners.size() / 2;
+    ObjCornerTable tblCorners(ctCorners);
+
+    chunk.aiIndices.reserve(ctCorners);
+    for (size_t iCorner = 0; iCorner < ctCorners; iCorner++) {
+        const uint32_t iPosition = chunk.aiCorners[iCorner * 2 + 0];
+        const uint32_t iTexCoords = chunk.aiCorners[iCorner * 2 + 1];
+        if (iPosition >= ctPositions || (iTexCoords != NO_INDEX && iTexCoords >= ctTexCoords)) {
+            throw std::runtime_error("OBJ index out of range");
+        }
+
+        const uint64_t iKey = (static_cast<uint64_t>(iPosition) << 32) | iTexCoords;
+        bool bAdded;
+        chunk.aiIndices.push_back(tblCorners.FindOrAdd(iKey, static_cast<uint32_t>(chunk.aiVertexKeys.size()), bAdded));
+        if (bAdded) {
+            chunk.aiVertexKeys.push_back(iKey);
+        }
+    }
+
+    // corners are not needed anymore, release them before the merge allocates the output
+    std::vector<uint32_t>().swap(chunk.aiCorners);
+}
+
+
+// Weld the distinct corners of all chunks into one set of vertices. Chunks are visited in file order, so a vertex
+// gets the number of the first corner in the file that uses it, and corners shared between chunks become one vertex.
+// Returns the keys of the merged vertices.
+static void WeldChunks(std::vector<ObjChunk> &achChunks, std::vector<uint64_t> &aiVertexKeys) {
+    size_t ctChunkVertices = 0;
+    for (const ObjChunk &chunk : achChunks) {
+        ctChunkVertices += chunk.aiVertexKeys.size();
+    }
+    ObjCornerTable tblVertices(ctChunkVertices);
+
+    aiVertexKeys.clear();
+    aiVertexKeys.reserve(ctChunkVertices);
+    for (ObjChunk &chunk : achChunks) {
+        chunk.aiMergedVertices.resize(chunk.aiVertexKeys.size());
+        for (size_t iVertex = 0; iVertex < chunk.aiVertexKeys.size(); iVertex++) {
+            const uint64_t iKey = chunk.aiVertexKeys[iVertex];
+            bool bAdded;
+            chunk.aiMergedVertices[iVertex] = tblVertices.FindOrAdd(iKey, static_cast<uint32_t>(aiVertexKeys.size()), bAdded);
+            if (bAdded) {
+                aiVertexKeys.push_back(iKey);
+            }
+        }
+        std::vector<uint64_t>().swap(chunk.aiVertexKeys);
+    }
+}
+
+
+// Turn the statements of all chunks into runs of triangles with the same group and material.
+static void MergeStatements(const std::vector<ObjChunk> &achChunks, ObjFaceGroups &groups) {
+    groups = ObjFaceGroups();
+    groups.astrGroups.push_back(std::string());
+    groups.astrMaterials.push_back(std::string());
+    std::unordered_map<std::string, uint32_t> mapGroups = { { std::string(), 0 } };
+    std::unordered_map<std::string, uint32_t> mapMaterials = { { std::string(), 0 } };
+    groups.arunRuns.push_back({ 0, 0, 0 });
+
+    for (const ObjChunk &chunk : achChunks) {
+        for (const ObjStatement &stStatement : chunk.astStatements) {
+            if (stStatement.idType == OBJ_STATEMENT_LIBRARY) {
+                groups.astrLibraries.push_back(stStatement.strName);
+                continue;
+            }
+
+            // find the index of the group or material, adding it if it is new
+            const bool bGroup = stStatement.idType == OBJ_STATEMENT_GROUP;
+            std::unordered_map<std::string, uint32_t> &mapNames = bGroup ? mapGroups : mapMaterials;
+            std::vector<std::string> &astrNames = bGroup ? groups.astrGroups : groups.astrMaterials;
+            auto itName = mapNames.emplace(stStatement.strName, static_cast<uint32_t>(astrNames.size()));
+            if (itName.second) {
+                astrNames.push_back(stStatement.strName);
+            }
+
+            // start a new run, or change the last one if it has no triangles yet
+            ObjFaceRun runNext = groups.arunRuns.back();
+            runNext.iFirstTriangle = static_cast<uint32_t>(chunk.ctIndexBase / 3 + stStatement.ctTriangles);
+            (bGroup ? runNext.iGroup : runNext.iMaterial) = itName.first->second;
+            ObjFaceRun &runLast = groups.arunRuns.back();
+            if (runNext.iGroup == runLast.iGroup && runNext.iMaterial == runLast.iMaterial) {
+                continue;
+            }
+            if (runNext.iFirstTriangle == runLast.iFirstTriangle) {
+                runLast = runNext;
+            } else {
+                groups.arunRuns.push_back(runNext);
+            }
+        }
+    }
+}
+
+
+// Parse an OBJ file into a vertex and an index buffer, and the groups and materials of its triangles.
+void ObjParser::ParseFile(const std::string &strFilename, std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices, ObjFaceGroups &groups) {
+    MappedFile fileObj;
+    fileObj.Open(strFilename);
+    ParseMemory(fileObj.GetData(), static_cast<size_t>(fileObj.GetSize()), avVertices, aiIndices, groups);
+}
+
+
+// Split OBJ text into chunks at line boundaries and parse them in parallel. Element indices in the chunks are counted
+// from the given bases, the number of elements declared before the text.
+static void ParseChunks(const char *pchData, size_t ctSize, uint64_t ctPositionBase, uint64_t ctTexCoordBase, std::vector<ObjChunk> &achChunks) {
+    ThreadPool &tpPool = ThreadPool::Get();
+
+    // split the text into a few chunks per worker so that uneven chunks still balance out
+    size_t ctChunks = std::max<size_t>(1, std::min<size_t>(ctSize / CT_MIN_CHUNK_SIZE, tpPool.GetWorkerCount() * 4));
+    achChunks.resize(ctChunks);
+
+    // chunk boundaries are moved forward to the next line start
+    const char *pchDataEnd = pchData + ctSize;
+    const char *pchChunkStart = pchData;
+    for (size_t iChunk = 0; iChunk < ctChunks; iChunk++) {
+        const char *pchChunkEnd = pchDataEnd;
+        if (iChunk + 1 < ctChunks) {
+            pchChunkEnd = std::max(pchChunkStart, pchData + ctSize / ctChunks * (iChunk + 1));
+            const char *pchNewLine = static_cast<const char *>(memchr(pchChunkEnd, '\n', pchDataEnd - pchChunkEnd));
+            pchChunkEnd = pchNewLine != nullptr ? pchNewLine + 1 : pchDataEnd;
+        }
+        achChunks[iChunk].pchBegin = pchChunkStart;
+        achChunks[iChunk].pchEnd = pchChunkEnd;
+        pchChunkStart = pchChunkEnd;
+    }
+
+    // parse all chunks in parallel
+    tpPool.ParallelFor(static_cast<uint32_t>(ctChunks), [&achChunks](uint32_t iChunk) {
+        ParseChunk(achChunks[iChunk]);
+    });
+
+    // count the elements that precede each chunk
+    uint64_t ctPositions = ctPositionBase;
+    uint64_t ctTexCoords = ctTexCoordBase;
+    for (ObjChunk &chunk : achChunks) {
+        chunk.ctPositionBase = ctPositions;
+        chunk.ctTexCoordBase = ctTexCoords;
+        ctPositions += chunk.avecPositions.size();
+        ctTexCoords += chunk.avecTexCoords.size();
+    }
+    if (ctPositions > NO_INDEX || ctTexCoords > NO_INDEX) {
+        throw std::runtime_error("OBJ file has too many vertices");
+    }
+}
+
+
+// Parse OBJ text that is already in memory.
+void ObjParser::ParseMemory(const char *pchData, size_t ctSize, std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices, ObjFaceGroups &groups) {
+    ThreadPool &tpPool = ThreadPool::Get();
+
+    std::vector<ObjChunk> achChunks;
+    ParseChunks(pchData, ctSize, 0, 0, achChunks);
+    const size_t ctChunks = achChunks.size();
+    const uint64_t ctPositions = achChunks.back().ctPositionBase + achChunks.back().avecPositions.size();
+    const uint64_t ctTexCoords = achChunks.back().ctTexCoordBase + achChunks.back().avecTexCoords.size();
+
+    // gather positions and texture coordinates into global arrays and resolve relative indices
+    std::vector<glm::vec3> avecPositions(static_cast<size_t>(ctPositions));
+    std::vector<glm::vec2> avecTexCoords(static_cast<size_t>(ctTexCoords));
+    tpPool.ParallelFor(static_cast<uint32_t>(ctChunks), [&](uint32_t iChunk) {
+        ObjChunk &chunk = achChunks[iChunk];
+        std::copy(chunk.avecPositions.begin(), chunk.avecPositions.end(), avecPositions.begin() + static_cast<size_t>(chunk.ctPositionBase));
+        std::copy(chunk.avecTexCoords.begin(), chunk.avecTexCoords.end(), avecTexCoords.begin() + static_cast<size_t>(chunk.ctTexCoordBase));
+        std::vector<glm::vec3>().swap(chunk.avecPositions);
+        std::vector<glm::vec2>().swap(chunk.avecTexCoords);
+        ResolveFixups(chunk);
+    });
+
+    // find the distinct corners of each chunk, then weld them across chunks
+    tpPool.ParallelFor(static_cast<uint32_t>(ctChunks), [&](uint32_t iChunk) {
+        WeldChunk(achChunks[iChunk], ctPositions, ctTexCoords);
+    });
+    std::vector<uint64_t> aiVertexKeys;
+    WeldChunks(achChunks, aiVertexKeys);
+    if (aiVertexKeys.size() > NO_INDEX) {
+        throw std::runtime_error("OBJ file has too many vertices");
+    }
+
+    // find where each chunk's indices go in the merged buffer
+    uint64_t ctIndices = 0;
+    for (ObjChunk &chunk : achChunks) {
+        chunk.ctIndexBase = ctIndices;
+        ctIndices += chunk.aiIndices.size();
+    }
+    MergeStatements(achChunks, groups);
+
+    // create the vertices, in slices of the merged buffer
+    avVertices.resize(aiVertexKeys.size());
+    const size_t ctSliceVertices = (aiVertexKeys.size() + ctChunks - 1) / ctChunks;
+    tpPool.ParallelFor(static_cast<uint32_t>(ctChunks), [&](uint32_t iSlice) {
+        const size_t iEnd = std::min(aiVertexKeys.size(), (iSlice + 1) * ctSliceVertices);
+        for (size_t iVertex = iSlice * ctSliceVertices; iVertex < iEnd; iVertex++) {
+            const uint32_t iPosition = static_cast<uint32_t>(aiVertexKeys[iVertex] >> 32);
+            const uint32_t iTexCoords = static_cast<uint32_t>(aiVertexKeys[iVertex]);
+            Vertex &vVertex = avVertices[iVertex];
+            vVertex = {};
+            vVertex.vecPosition = avecPositions[iPosition];
+            // OBJ has the origin of texture coordinates at the bottom, Vulkan at the top
+            if (iTexCoords != NO_INDEX) {
+                vVertex.vecTexCoords = { avecTexCoords[iTexCoords].x, 1.0f - avecTexCoords[iTexCoords].y };
+            }
+            // use constant color, white
+            vVertex.colColor = { 1.0f, 1.0f, 1.0f };
+        }
+    });
+    std::vector<uint64_t>().swap(aiVertexKeys);
+    std::vector<glm::vec3>().swap(avecPositions);
+    std::vector<glm::vec2>().swap(avecTexCoords);
+
+    // merge the indices, mapping chunk local indices to the merged vertices
+    aiIndices.resize(static_cast<size_t>(ctIndices));
+    tpPool.ParallelFor(static_cast<uint32_t>(ctChunks), [&](uint32_t iChunk) {
+        ObjChunk &chunk = achChunks[iChunk];
+        uint32_t *piIndices = aiIndices.data() + chunk.ctIndexBase;
+        for (size_t iIndex = 0; iIndex < chunk.aiIndices.size(); iIndex++) {
+            piIndices[iIndex] = chunk.aiMergedVertices[chunk.aiIndices[iIndex]];
+        }
+    });
+}
+
+
+// Parse a piece of OBJ text into raw elements, without welding.
+void ObjParser::ParseElements(const char *pchData, size_t ctSize, uint64_t ctPositionBase, uint64_t ctTexCoordBase, ObjElements &elements) {
+    std::vector<ObjChunk> achChunks;
+    ParseChunks(pchData, ctSize, ctPositionBase, ctTexCoordBase, achChunks);
+
+    // find where each chunk's elements go in the output
+    size_t ctPositions = 0;
+    size_t ctTexCoords = 0;
+    size_t ctCorners = 0;
+    std::vector<size_t> aiCornerBases;
+    for (ObjChunk &chunk : achChunks) {
+        aiCornerBases.push_back(ctCorners);
+        ctPositions += chunk.avecPositions.size();
+        ctTexCoords += chunk.avecTexCoords.size();
+        ctCorners += chunk.aiCorners.size();
+    }
+    elements.avecPositions.resize(ctPositions);
+    elements.avecTexCoords.resize(ctTexCoords);
+    elements.aiCorners.resize(ctCorners);
+
+    // resolve relative indices and gather the chunks
+    ThreadPool::Get().ParallelFor(static_cast<uint32_t>(achChunks.size()), [&](uint32_t iChunk) {
+        ObjChunk &chunk = achChunks[iChunk];
+        ResolveFixups(chunk);
+        std::copy(chunk.avecPositions.begin(), chunk.avecPositions.end(), elements.avecPositions.begin() + static_cast<size_t>(chunk.ctPositionBase - ctPositionBase));
+        std::copy(chunk.avecTexCoords.begin(), chunk.avecTexCoords.end(), elements.avecTexCoords.begin() + static_cast<size_t>(chunk.ctTexCoordBase - ctTexCoordBase));
+        std::copy(chunk.aiCorners.begin(), chunk.aiCorners.end(), elements.aiCorners.begin() + aiCornerBases[iChunk]);
+    });
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "../Resources/Vertex.h"
+
+// Elements declared in a piece of OBJ text, before welding.
+struct ObjElements {
+    std::vector<glm::vec3> avecPositions;
+    std::vector<glm::vec2> avecTexCoords;
+    // Pairs of zero-based global position and texture coordinate indices, one pair per triangle corner. Corners
+    // without texture coordinates use 0xFFFFFFFF. Indices are not validated against the element counts.
+    std::vector<uint32_t> aiCorners;
+};
+
+// Run of consecutive triangles that are in the same group and use the same material.
+struct ObjFaceRun {
+    uint32_t iFirstTriangle;
+    uint32_t iGroup;
+    uint32_t iMaterial;
+};
+
+// Groups and materials of the faces in an OBJ file.
+struct ObjFaceGroups {
+    // Material libraries referenced by the file, in the order they appear.
+    std::vector<std::string> astrLibraries;
+    // Names of the groups and objects, the first one is the unnamed group of faces that precede all group statements.
+    std::vector<std::string> astrGroups;
+    // Names of the materials used, the first one is the unnamed material of faces that precede all material statements.
+    std::vector<std::string> astrMaterials;
+    // Runs that cover all triangles, in order.
+    std::vector<ObjFaceRun> arunRuns;
+};
+
+// Parser for Wavefront OBJ files, built for very large files. The file is memory mapped and split at line boundaries
+// into chunks that are parsed in parallel on the thread pool, then the per-chunk results are merged into a single
+// vertex and index buffer. Corners that share a position and texture coordinates are welded into one vertex, across
+// the whole file, and vertices are numbered in the order they first appear so the output doesn't depend on the chunks.
+// Positions, texture coordinates, faces, groups and materials are read, polygons are triangulated as fans.
+class ObjParser {
+public:
+    // Parse an OBJ file into a vertex and an index buffer, and the groups and materials of its triangles. Throws if the
+    // file can't be read or is malformed.
+    static void ParseFile(const std::string &strFilename, std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices, ObjFaceGroups &groups);
+    // Parse OBJ text that is already in memory.
+    static void ParseMemory(const char *pchData, size_t ctSize, std::vector<Vertex> &avVertices, std::vector<uint32_t> &aiIndices, ObjFaceGroups &groups);
+    // Parse a piece of OBJ text into raw elements, without welding. Groups and materials are skipped. The text must start and end at line boundaries,
+    // the bases are the numbers of positions and texture coordinates declared before it.
+    static void ParseElements(const char *pchData, size_t ctSize, uint64_t ctPositionBase, uint64_t ctTexCoordBase, ObjElements &elements);
+
+public:
+    // Parse a floating point number, skipping leading blanks. Returns the position after the number.
+    static const char *ParseFloat(const char *pchText, const char *pchEnd, float &fValue);
+    // Parse a signed integer. Returns the position after the number, or the start position if there is no number.
+    static const char *ParseInteger(const char *pchText, const char *pchEnd, int64_t &iValue);
+};
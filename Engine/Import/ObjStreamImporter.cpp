@@ -0,0 +1,405 @@
+#include "../PrecompiledHeader.h"
+#include "ObjStreamImporter.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshletBuilder.h"
+#include "ObjParser.h"
+#include "../Platform/FileSystem.h"
+#include "../Platform/MappedFile.h"
+#include "../Resources/MeshFile.h"
+#include "../Resources/MeshLod.h"
+#include "../Resources/MeshMaterial.h"
+#include "../Resources/MeshSubmesh.h"
+
+// Marks a corner that has no texture coordinates.
+static const uint32_t NO_INDEX = 0xFFFFFFFF;
+// The importer never uses less memory than this, smaller limits are raised to it.
+static const uint64_t CT_MIN_MEMORY_LIMIT = 64ULL << 20;
+// Size of the write buffer of each temporary file.
+static const size_t CT_SPILL_BUFFER_SIZE = 1 << 20;
+// Approximate size of a page in the position and texture coordinate caches.
+static const size_t CT_CACHE_PAGE_SIZE = 64 << 10;
+// Memory used per welded corner: the corner itself, two hash table slots, a vertex and an index, plus the
+// adjacency and remapping tables used while building meshlets.
+static const uint64_t CT_BYTES_PER_BATCH_CORNER = 2 * sizeof(uint32_t) + 2 * (sizeof(uint64_t) + sizeof(uint32_t)) + sizeof(Vertex) + sizeof(uint32_t) + 48;
+// Parsing expands the text by up to this factor - a short face line turns into several corner pairs, which exist
+// both in the per-chunk and in the gathered arrays.
+static const uint64_t CT_PARSE_EXPANSION = 16;
+
+
+// Buffered, append only temporary file.
+class SpillWriter {
+public:
+    explicit SpillWriter(const std::string &strFilename) {
+        _fsFile.open(strFilename, std::ios::binary | std::ios::trunc);
+        if (!_fsFile.is_open()) {
+            throw std::runtime_error("Failed to create file: " + strFilename);
+        }
+        _achBuffer.reserve(CT_SPILL_BUFFER_SIZE);
+    }
+
+    // Append data to the file.
+    void Write(const void *pData, size_t ctBytes) {
+        const char *pchData = static_cast<const char *>(pData);
+        while (ctBytes > 0) {
+            if (_achBuffer.size() == CT_SPILL_BUFFER_SIZE) {
+                Flush();
+            }
+            const size_t ctCopy = std::min(ctBytes, CT_SPILL_BUFFER_SIZE - _achBuffer.size());
+            _achBuffer.insert(_achBuffer.end(), pchData, pchData + ctCopy);
+            pchData += ctCopy;
+            ctBytes -= ctCopy;
+        }
+    }
+
+    // Write out the buffered data and close the file.
+    void Close() {
+        Flush();
+        _fsFile.close();
+        if (_fsFile.fail()) {
+            throw std::runtime_error("Failed to write a temporary import file");
+        }
+    }
+
+private:
+    void Flush() {
+        _fsFile.write(_achBuffer.data(), static_cast<std::streamsize>(_achBuffer.size()));
+        _achBuffer.clear();
+    }
+
+private:
+    std::ofstream _fsFile;
+    std::vector<char> _achBuffer;
+};
+
+
+// Random access reader for a temporary file of fixed size elements. Recently used pages are kept in memory and the
+// least recently used one is dropped when the cache is full. Faces mostly refer to elements declared shortly before
+// them, so almost all reads hit the cache.
+class SpillCache {
+public:
+    SpillCache(const std::string &strFilename, size_t ctElementSize, uint64_t ctCacheSize) :
+        _ctElementSize(ctElementSize), _ctPageElements(std::max<size_t>(1, CT_CACHE_PAGE_SIZE / ctElementSize)), _tmUse(0)
+    {
+        _fsFile.open(strFilename, std::ios::binary);
+        if (!_fsFile.is_open()) {
+            throw std::runtime_error("Failed to open file: " + strFilename);
+        }
+        const size_t ctPages = std::max<size_t>(1, static_cast<size_t>(ctCacheSize / (_ctPageElements * _ctElementSize)));
+        _apgPages.resize(ctPages);
+        _mapPages.reserve(ctPages * 2);
+    }
+
+    // Copy one element out of the file.
+    void Read(uint64_t iElement, void *pElement) {
+        const uint64_t iPage = iElement / _ctPageElements;
+        const size_t iOffset = static_cast<size_t>(iElement % _ctPageElements) * _ctElementSize;
+
+        CachePage *ppgPage = nullptr;
+        auto itPage = _mapPages.find(iPage);
+        if (itPage != _mapPages.end()) {
+            ppgPage = &_apgPages[itPage->second];
+        } else {
+            ppgPage = &LoadPage(iPage);
+        }
+        ppgPage->tmLastUse = ++_tmUse;
+        memcpy(pElement, ppgPage->achData.data() + iOffset, _ctElementSize);
+    }
+
+private:
+    // Page of elements held in memory.
+    struct CachePage {
+        bool bLoaded = false;
+        uint64_t iPage = 0;
+        uint64_t tmLastUse = 0;
+        std::vector<char> achData;
+    };
+
+    // Read a page into the least recently used slot.
+    CachePage &LoadPage(uint64_t iPage) {
+        size_t iSlot = 0;
+        for (size_t iCandidate = 1; iCandidate < _apgPages.size(); iCandidate++) {
+            if (_apgPages[iCandidate].tmLastUse < _apgPages[iSlot].tmLastUse) {
+                iSlot = iCandidate;
+            }
+        }
+
+        CachePage &pgPage = _apgPages[iSlot];
+        if (pgPage.bLoaded) {
+            _mapPages.erase(pgPage.iPage);
+        }
+        pgPage.achData.resize(_ctPageElements * _ctElementSize);
+
+        // the last page of the file can be short, the read fails but what was read is valid
+        _fsFile.clear();
+        _fsFile.seekg(static_cast<std::streamoff>(iPage * _ctPageElements * _ctElementSize));
+        _fsFile.read(pgPage.achData.data(), static_cast<std::streamsize>(pgPage.achData.size()));
+
+        pgPage.bLoaded = true;
+        pgPage.iPage = iPage;
+        _mapPages[iPage] = iSlot;
+        return pgPage;
+    }
+
+private:
+    std::ifstream _fsFile;
+    size_t _ctElementSize;
+    size_t _ctPageElements;
+    std::vector<CachePage> _apgPages;
+    // Maps the index of each loaded page to its slot.
+    std::unordered_map<uint64_t, size_t> _mapPages;
+    // Counter that orders page uses.
+    uint64_t _tmUse;
+};
+
+
+// Read as many elements as fit into the buffer from a sequentially read file. Returns the number of elements read.
+template<class Element>
+static size_t ReadElements(std::ifstream &fsFile, std::vector<Element> &aElements) {
+    fsFile.read(reinterpret_cast<char *>(aElements.data()), static_cast<std::streamsize>(aElements.size() * sizeof(Element)));
+    return static_cast<size_t>(fsFile.gcount()) / sizeof(Element);
+}
+
+
+ObjStreamImporter::ObjStreamImporter(uint64_t ctMemoryLimit) :
+    _ctPositions(0), _ctTexCoords(0), _ctCorners(0), _ctVertices(0), _ctIndices(0), _ctMeshlets(0)
+{
+    // the phases don't overlap, so each can use a large part of the budget, with some kept in reserve for the
+    // fixed size buffers and the allocator overhead
+    ctMemoryLimit = std::max(ctMemoryLimit, CT_MIN_MEMORY_LIMIT);
+    _ctWindowSize = ctMemoryLimit / 2 / CT_PARSE_EXPANSION;
+    _ctBatchCorners = ctMemoryLimit / 4 / CT_BYTES_PER_BATCH_CORNER;
+    _ctCacheSize = ctMemoryLimit / 8;
+}
+
+
+// Import an OBJ file into a mesh file.
+void ObjStreamImporter::Import(const std::string &strObjFilename, const std::string &strMeshFilename) {
+    _strPositionsFilename = strMeshFilename + ".positions.tmp";
+    _strTexCoordsFilename = strMeshFilename + ".texcoords.tmp";
+    _strCornersFilename = strMeshFilename + ".corners.tmp";
+    _strIndicesFilename = strMeshFilename + ".indices.tmp";
+    _strMeshletsFilename = strMeshFilename + ".meshlets.tmp";
+    _ctPositions = 0;
+    _ctTexCoords = 0;
+    _ctCorners = 0;
+    _ctVertices = 0;
+    _ctIndices = 0;
+    _ctMeshlets = 0;
+
+    try {
+        SpillElements(strObjFilename);
+
+        MeshFileWriter mfwWriter;
+        mfwWriter.Open(strMeshFilename);
+        WeldVertices(mfwWriter);
+        CopySection(mfwWriter, _strIndicesFilename, MESH_SECTION_INDICES, sizeof(uint32_t));
+        CopySection(mfwWriter, _strMeshletsFilename, MESH_SECTION_MESHLETS, sizeof(Meshlet));
+
+        // the full resolution mesh is the only level of detail, drawn as one submesh with the default material
+        std::vector<MeshLod> alodLods(1, MeshLod());
+        alodLods[0].ctIndices = static_cast<uint32_t>(_ctIndices);
+        alodLods[0].ctMeshlets = static_cast<uint32_t>(_ctMeshlets);
+        alodLods[0].ctSubmeshes = 1;
+        mfwWriter.WriteSection(MESH_SECTION_LODS, alodLods);
+        std::vector<MeshSubmesh> asubSubmeshes(1, MeshSubmesh());
+        asubSubmeshes[0].ctIndices = static_cast<uint32_t>(_ctIndices);
+        asubSubmeshes[0].ctMeshlets = static_cast<uint32_t>(_ctMeshlets);
+        mfwWriter.WriteSection(MESH_SECTION_SUBMESHES, asubSubmeshes);
+        mfwWriter.WriteSection(MESH_SECTION_MATERIALS, std::vector<MeshMaterial>(1, MeshMaterial()));
+        mfwWriter.Close();
+    }
+    catch (...) {
+        RemoveSpillFiles();
+        throw;
+    }
+    RemoveSpillFiles();
+}
+
+
+// Parse the OBJ window by window, spilling its elements to the temporary files.
+void ObjStreamImporter::SpillElements(const std::string &strObjFilename) {
+    SpillWriter swPositions(_strPositionsFilename);
+    SpillWriter swTexCoords(_strTexCoordsFilename);
+    SpillWriter swCorners(_strCornersFilename);
+
+    // element arrays are reused between windows
+    ObjElements elements;
+
+    MappedFile mfWindow;
+    uint64_t offWindow = 0;
+    while (true) {
+        mfWindow.Open(strObjFilename, offWindow, _ctWindowSize);
+        const uint64_t ctFileSize = mfWindow.GetFileSize();
+        if (mfWindow.GetSize() == 0) {
+            break;
+        }
+
+        // windows end after the last complete line, the rest is parsed with the next window
+        const char *pchData = mfWindow.GetData();
+        size_t ctSize = static_cast<size_t>(mfWindow.GetSize());
+        const bool bLastWindow = offWindow + ctSize == ctFileSize;
+        if (!bLastWindow) {
+            while (ctSize > 0 && pchData[ctSize - 1] != '\n') {
+                ctSize--;
+            }
+            if (ctSize == 0) {
+                throw std::runtime_error("OBJ line is longer than the import window: " + strObjFilename);
+            }
+        }
+
+        ObjParser::ParseElements(pchData, ctSize, _ctPositions, _ctTexCoords, elements);
+        mfWindow.Close();
+
+        swPositions.Write(elements.avecPositions.data(), elements.avecPositions.size() * sizeof(glm::vec3));
+        swTexCoords.Write(elements.avecTexCoords.data(), elements.avecTexCoords.size() * sizeof(glm::vec2));
+        swCorners.Write(elements.aiCorners.data(), elements.aiCorners.size() * sizeof(uint32_t));
+        _ctPositions += elements.avecPositions.size();
+        _ctTexCoords += elements.avecTexCoords.size();
+        _ctCorners += elements.aiCorners.size() / 2;
+
+        offWindow += ctSize;
+        if (bLastWindow) {
+            break;
+        }
+    }
+
+    if (_ctPositions > NO_INDEX || _ctTexCoords > NO_INDEX) {
+        throw std::runtime_error("OBJ file has too many vertices: " + strObjFilename);
+    }
+
+    swPositions.Close();
+    swTexCoords.Close();
+    swCorners.Close();
+}
+
+
+// Weld the spilled corners into vertices batch by batch.
+void ObjStreamImporter::WeldVertices(MeshFileWriter &mfwWriter) {
+    SpillCache scPositions(_strPositionsFilename, sizeof(glm::vec3), _ctCacheSize);
+    SpillCache scTexCoords(_strTexCoordsFilename, sizeof(glm::vec2), _ctCacheSize);
+    SpillWriter swIndices(_strIndicesFilename);
+    SpillWriter swMeshlets(_strMeshletsFilename);
+    std::ifstream fsCorners(_strCornersFilename, std::ios::binary);
+    if (!fsCorners.is_open()) {
+        throw std::runtime_error("Failed to open file: " + _strCornersFilename);
+    }
+
+    // batches never need to be larger than the whole mesh, and hold whole triangles so they can be split into meshlets
+    const size_t ctBatchCorners = static_cast<size_t>(std::max<uint64_t>(3, std::min(_ctBatchCorners, _ctCorners) / 3 * 3));
+
+    // hash table capacity is a power of two at least twice the batch size, the same as in the in-memory parser
+    size_t ctCapacity = 16;
+    uint32_t ctCapacityBits = 4;
+    while (ctCapacity < ctBatchCorners * 2) {
+        ctCapacity <<= 1;
+        ctCapacityBits++;
+    }
+    const uint64_t EMPTY_KEY = ~0ULL;
+    std::vector<uint64_t> aiKeys(ctCapacity);
+    std::vector<uint32_t> aiValues(ctCapacity);
+
+    std::vector<uint32_t> aiCorners(ctBatchCorners * 2);
+    std::vector<Vertex> avVertices;
+    std::vector<uint32_t> aiIndices;
+    std::vector<Meshlet> ameshMeshlets;
+    avVertices.reserve(ctBatchCorners);
+    aiIndices.reserve(ctBatchCorners);
+
+    mfwWriter.BeginSection(MESH_SECTION_VERTICES, sizeof(Vertex));
+    while (true) {
+        const size_t ctCorners = ReadElements(fsCorners, aiCorners) / 2;
+        if (ctCorners == 0) {
+            break;
+        }
+
+        std::fill(aiKeys.begin(), aiKeys.end(), EMPTY_KEY);
+        avVertices.clear();
+        aiIndices.clear();
+
+        for (size_t iCorner = 0; iCorner < ctCorners; iCorner++) {
+            const uint32_t iPosition = aiCorners[iCorner * 2 + 0];
+            const uint32_t iTexCoords = aiCorners[iCorner * 2 + 1];
+            if (iPosition >= _ctPositions || (iTexCoords != NO_INDEX && iTexCoords >= _ctTexCoords)) {
+                throw std::runtime_error("OBJ index out of range");
+            }
+
+            // find the corner in the table
+            const uint64_t iKey = (static_cast<uint64_t>(iPosition) << 32) | iTexCoords;
+            size_t iSlot = static_cast<size_t>((iKey * 0x9E3779B97F4A7C15ULL) >> (64 - ctCapacityBits));
+            while (aiKeys[iSlot] != EMPTY_KEY && aiKeys[iSlot] != iKey) {
+                iSlot = (iSlot + 1) & (ctCapacity - 1);
+            }
+
+            // if this is a new combination, create the vertex
+            if (aiKeys[iSlot] == EMPTY_KEY) {
+                Vertex vVertex = {};
+                scPositions.Read(iPosition, &vVertex.vecPosition);
+                // OBJ has the origin of texture coordinates at the bottom, Vulkan at the top
+                if (iTexCoords != NO_INDEX) {
+                    scTexCoords.Read(iTexCoords, &vVertex.vecTexCoords);
+                    vVertex.vecTexCoords.y = 1.0f - vVertex.vecTexCoords.y;
+                }
+                // use constant color, white
+                vVertex.colColor = { 1.0f, 1.0f, 1.0f };
+
+                aiKeys[iSlot] = iKey;
+                aiValues[iSlot] = static_cast<uint32_t>(_ctVertices + avVertices.size());
+                avVertices.push_back(vVertex);
+            }
+            aiIndices.push_back(aiValues[iSlot]);
+        }
+
+        if (_ctVertices + avVertices.size() > NO_INDEX || _ctIndices + aiIndices.size() > NO_INDEX) {
+            throw std::runtime_error("OBJ file has too many vertices");
+        }
+
+        // the batch references only its own vertices, so it can be split into meshlets on its own
+        ameshMeshlets.clear();
+        MeshletBuilder::Build(avVertices, static_cast<uint32_t>(_ctVertices), aiIndices, static_cast<uint32_t>(_ctIndices), ameshMeshlets);
+
+        mfwWriter.Write(avVertices.data(), avVertices.size());
+        swIndices.Write(aiIndices.data(), aiIndices.size() * sizeof(uint32_t));
+        swMeshlets.Write(ameshMeshlets.data(), ameshMeshlets.size() * sizeof(Meshlet));
+        _ctVertices += avVertices.size();
+        _ctIndices += aiIndices.size();
+        _ctMeshlets += ameshMeshlets.size();
+    }
+
+    swIndices.Close();
+    swMeshlets.Close();
+}
+
+
+// Copy a temporary file into a section of the mesh.
+void ObjStreamImporter::CopySection(MeshFileWriter &mfwWriter, const std::string &strFilename, enum MeshSectionType idType, uint32_t ctElementSize) {
+    std::ifstream fsFile(strFilename, std::ios::binary);
+    if (!fsFile.is_open()) {
+        throw std::runtime_error("Failed to open file: " + strFilename);
+    }
+
+    // copy in blocks of whole elements
+    std::vector<char> achBuffer(CT_SPILL_BUFFER_SIZE / ctElementSize * ctElementSize);
+    mfwWriter.BeginSection(idType, ctElementSize);
+    while (true) {
+        fsFile.read(achBuffer.data(), static_cast<std::streamsize>(achBuffer.size()));
+        const size_t ctElements = static_cast<size_t>(fsFile.gcount()) / ctElementSize;
+        if (ctElements == 0) {
+            break;
+        }
+        mfwWriter.Write(achBuffer.data(), ctElements);
+    }
+}
+
+
+// Delete all temporary files.
+void ObjStreamImporter::RemoveSpillFiles() {
+    FileSystem::RemoveFile(_strPositionsFilename);
+    FileSystem::RemoveFile(_strTexCoordsFilename);
+    FileSystem::RemoveFile(_strCornersFilename);
+    FileSystem::RemoveFile(_strIndicesFilename);
+    FileSystem::RemoveFile(_strMeshletsFilename);
+}
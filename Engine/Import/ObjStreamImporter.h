@@ -0,0 +1,51 @@
+#pragma once
+#include "../Resources/MeshFile.h"
+
+// Imports OBJ files of any size into the engine mesh format while keeping memory use under a fixed limit.
+// The OBJ is read in mapped windows that are parsed in parallel, and the parsed positions, texture coordinates and
+// face corners are spilled to temporary files next to the output. Corners are then welded into vertices in batches,
+// fetching positions and texture coordinates through a small page cache, and the vertices are written straight into
+// the mesh file. Each batch is split into meshlets on its own. Corners are only welded within a batch, so vertices on
+// batch seams can be duplicated. The mesh gets a single level of detail, simplification needs the whole mesh in memory.
+class ObjStreamImporter {
+public:
+    // The limit covers all buffers the importer allocates, in bytes.
+    explicit ObjStreamImporter(uint64_t ctMemoryLimit);
+
+    // Import an OBJ file into a mesh file. Throws if the OBJ can't be read or is malformed, or the mesh can't be written.
+    void Import(const std::string &strObjFilename, const std::string &strMeshFilename);
+
+private:
+    // Parse the OBJ window by window, spilling its elements to the temporary files.
+    void SpillElements(const std::string &strObjFilename);
+    // Weld the spilled corners into vertices and meshlets batch by batch, writing the vertices into the mesh and the
+    // indices and meshlets to temporary files.
+    void WeldVertices(MeshFileWriter &mfwWriter);
+    // Copy a temporary file into a section of the mesh.
+    void CopySection(MeshFileWriter &mfwWriter, const std::string &strFilename, enum MeshSectionType idType, uint32_t ctElementSize);
+    // Delete all temporary files.
+    void RemoveSpillFiles();
+
+private:
+    // Size of the OBJ window parsed at once.
+    uint64_t _ctWindowSize;
+    // Number of corners welded at once.
+    uint64_t _ctBatchCorners;
+    // Memory for each of the position and texture coordinate page caches.
+    uint64_t _ctCacheSize;
+
+    // Temporary files for positions, texture coordinates, corners, indices and meshlets.
+    std::string _strPositionsFilename;
+    std::string _strTexCoordsFilename;
+    std::string _strCornersFilename;
+    std::string _strIndicesFilename;
+    std::string _strMeshletsFilename;
+
+    // Number of elements found in the OBJ, and produced by welding.
+    uint64_t _ctPositions;
+    uint64_t _ctTexCoords;
+    uint64_t _ctCorners;
+    uint64_t _ctVertices;
+    uint64_t _ctIndices;
+    uint64_t _ctMeshlets;
+};
@@ -0,0 +1,169 @@
+#include "../PrecompiledHeader.h"
+#include "ShaderCompiler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "../Platform/FileSystem.h"
+
+#ifdef _WIN32
+    #define popen _popen
+    #define pclose _pclose
+#endif
+
+
+// Get the command line path of a tool of the Vulkan SDK, quoted.
+static std::string GetToolPath(const std::string &strTool) {
+    const char *strSdkDirectory = std::getenv("VULKAN_SDK");
+    if (strSdkDirectory == nullptr) {
+        return "\"" + strTool + "\"";
+    }
+#ifdef _WIN32
+    return "\"" + std::string(strSdkDirectory) + "\\Bin\\" + strTool + ".exe\"";
+#else
+    return "\"" + std::string(strSdkDirectory) + "/bin/" + strTool + "\"";
+#endif
+}
+
+
+// Run a command, with its output and errors. Returns the command's exit code.
+static int RunCommand(const std::string &strCommand, std::string &strOutput) {
+#ifdef _WIN32
+    // cmd strips the outer quotes of a command that starts with one, so the whole command is quoted once more
+    const std::string strShellCommand = "\"" + strCommand + " 2>&1\"";
+#else
+    const std::string strShellCommand = strCommand + " 2>&1";
+#endif
+    FILE *pfOutput = popen(strShellCommand.c_str(), "r");
+    if (pfOutput == nullptr) {
+        return -1;
+    }
+    char achBuffer[256];
+    size_t ctRead;
+    while ((ctRead = fread(achBuffer, 1, sizeof(achBuffer), pfOutput)) > 0) {
+        strOutput.append(achBuffer, ctRead);
+    }
+    return pclose(pfOutput);
+}
+
+
+// Get the versions of the tools, empty if they can't be run. Queried once, as each query starts a process.
+static const std::string &GetToolVersions() {
+    static const std::string strVersions = []() {
+        std::string strOutput;
+        if (RunCommand(GetToolPath("glslangValidator") + " --version", strOutput) != 0
+            || RunCommand(GetToolPath("spirv-opt") + " --version", strOutput) != 0) {
+            return std::string();
+        }
+        return strOutput;
+    }();
+    return strVersions;
+}
+
+
+// Read a whole file. Returns false if it can't be read.
+static bool ReadFile(const std::string &strFilename, std::string &strData) {
+    std::ifstream fsFile(strFilename, std::ios::binary);
+    if (!fsFile.is_open()) {
+        return false;
+    }
+    strData.assign(std::istreambuf_iterator<char>(fsFile), std::istreambuf_iterator<char>());
+    return !fsFile.bad();
+}
+
+
+// Write a whole file, replacing the old one in a single step.
+static void WriteFile(const std::string &strFilename, const std::string &strData) {
+    const std::string strTempFilename = strFilename + ".tmp";
+    {
+        std::ofstream fsFile(strTempFilename, std::ios::binary | std::ios::trunc);
+        if (!fsFile.is_open()) {
+            throw std::runtime_error("Failed to create file: " + strTempFilename);
+        }
+        fsFile.write(strData.data(), static_cast<std::streamsize>(strData.size()));
+        fsFile.close();
+        if (!fsFile) {
+            throw std::runtime_error("Failed to write file: " + strTempFilename);
+        }
+    }
+    FileSystem::ReplaceFile(strTempFilename, strFilename);
+}
+
+
+// Mix a string into an FNV-1a hash, with its terminating zero so the boundaries between strings count.
+static void HashString(uint64_t &idHash, const std::string &strData) {
+    for (size_t iByte = 0; iByte <= strData.size(); iByte++) {
+        idHash ^= static_cast<uint8_t>(strData.c_str()[iByte]);
+        idHash *= 0x100000001B3ULL;
+    }
+}
+
+
+// Compile a shader into a SPIR-V file, through the cache.
+void ShaderCompiler::CompileGlsl(const std::string &strSourceFilename, const std::vector<std::string> &astrDefines, bool bOptimize,
+    const std::string &strSpirvFilename, const std::string &strCacheDirectory) {
+
+    std::string strSource;
+    if (!ReadFile(strSourceFilename, strSource)) {
+        throw std::runtime_error("Failed to read shader: " + strSourceFilename);
+    }
+    if (!IsAvailable()) {
+        throw std::runtime_error("Can't compile " + strSourceFilename + ", the Vulkan SDK's tools weren't found");
+    }
+
+    // the stage is told by the source's extension, so the name is part of what is hashed
+    std::string strDefines;
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    HashString(idHash, strSourceFilename.substr(FileSystem::GetDirectory(strSourceFilename).size()));
+    HashString(idHash, strSource);
+    for (const std::string &strDefine : astrDefines) {
+        HashString(idHash, strDefine);
+        strDefines += " \"-D" + strDefine + "\"";
+    }
+    HashString(idHash, GetToolVersions());
+    HashString(idHash, bOptimize ? "optimized" : "");
+    char strHash[17];
+    snprintf(strHash, sizeof(strHash), "%016llx", static_cast<unsigned long long>(idHash));
+    const std::string strCacheFilename = strCacheDirectory + strHash + ".spv";
+
+    // compile into the cache unless it is there already; the cached file is written last, under its final name
+    std::string strSpirv;
+    if (!ReadFile(strCacheFilename, strSpirv)) {
+        FileSystem::MakeDirectory(strCacheDirectory);
+        const std::string strCompiledFilename = strCacheDirectory + strHash + ".compiled.tmp";
+        const std::string strOptimizedFilename = strCacheDirectory + strHash + ".optimized.tmp";
+        std::string strOutput;
+        if (RunCommand(GetToolPath("glslangValidator") + " -V" + strDefines + " \"" + strSourceFilename + "\" -o \"" + strCompiledFilename + "\"", strOutput) != 0) {
+            FileSystem::RemoveFile(strCompiledFilename);
+            throw std::runtime_error("Failed to compile " + strSourceFilename + ":\n" + strOutput);
+        }
+        // the optimizer keeps the interface and the specialization constants, only the code inside changes
+        if (bOptimize) {
+            const int iResult = RunCommand(GetToolPath("spirv-opt") + " -O \"" + strCompiledFilename + "\" -o \"" + strOptimizedFilename + "\"", strOutput);
+            FileSystem::RemoveFile(strCompiledFilename);
+            if (iResult != 0) {
+                FileSystem::RemoveFile(strOptimizedFilename);
+                throw std::runtime_error("Failed to optimize " + strSourceFilename + ":\n" + strOutput);
+            }
+        } else {
+            FileSystem::ReplaceFile(strCompiledFilename, strOptimizedFilename);
+        }
+        if (!ReadFile(strOptimizedFilename, strSpirv)) {
+            throw std::runtime_error("Failed to read compiled shader: " + strOptimizedFilename);
+        }
+        FileSystem::ReplaceFile(strOptimizedFilename, strCacheFilename);
+        std::cout << "Compiled " << strSourceFilename << std::endl;
+    }
+
+    std::string strCurrent;
+    if (!ReadFile(strSpirvFilename, strCurrent) || strCurrent != strSpirv) {
+        WriteFile(strSpirvFilename, strSpirv);
+    }
+}
+
+
+// Are the SDK's tools available?
+bool ShaderCompiler::IsAvailable() {
+    return !GetToolVersions().empty();
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Compiles GLSL shaders into SPIR-V with the tools of the Vulkan SDK, glslangValidator and the spirv-opt optimizer.
+// Compiled code is cached by a hash of the source, the defines, the versions of the tools and the optimization, so each
+// combination is compiled only once and starting again just finds it in the cache.
+class ShaderCompiler {
+public:
+    // Compile a shader into a SPIR-V file, through the cache in a directory. The SPIR-V file is only written when its
+    // code changes, so what is built from it isn't rebuilt. Throws if the shader doesn't compile, with the compiler's
+    // messages.
+    static void CompileGlsl(const std::string &strSourceFilename, const std::vector<std::string> &astrDefines, bool bOptimize,
+        const std::string &strSpirvFilename, const std::string &strCacheDirectory);
+    // Are the SDK's tools available? Found in the SDK's directory, or on the path if it isn't set.
+    static bool IsAvailable();
+};
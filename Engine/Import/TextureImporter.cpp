@@ -0,0 +1,158 @@
+#include "../PrecompiledHeader.h"
+#include "TextureImporter.h"
+
+#include <cstring>
+
+#include "BcEncoder.h"
+#include "ImageDecoder.h"
+#include "../Platform/FileSystem.h"
+#include "../Platform/ThreadPool.h"
+#include "../Resources/KtxFile.h"
+#include "../Resources/VirtualTextureFile.h"
+
+
+// Halve an RGBA8 image with a box filter. Odd sizes repeat the last row or column.
+static void DownsampleImage(const std::vector<uint8_t> &abSource, uint32_t dimSourceWidth, uint32_t dimSourceHeight,
+    std::vector<uint8_t> &abTarget, uint32_t dimTargetWidth, uint32_t dimTargetHeight) {
+
+    abTarget.resize(size_t(dimTargetWidth) * dimTargetHeight * 4);
+    for (uint32_t iY = 0; iY < dimTargetHeight; iY++) {
+        const uint32_t iY0 = std::min(iY * 2, dimSourceHeight - 1);
+        const uint32_t iY1 = std::min(iY * 2 + 1, dimSourceHeight - 1);
+        for (uint32_t iX = 0; iX < dimTargetWidth; iX++) {
+            const uint32_t iX0 = std::min(iX * 2, dimSourceWidth - 1);
+            const uint32_t iX1 = std::min(iX * 2 + 1, dimSourceWidth - 1);
+            for (uint32_t iChannel = 0; iChannel < 4; iChannel++) {
+                const uint32_t iSum =
+                    abSource[(size_t(iY0) * dimSourceWidth + iX0) * 4 + iChannel] + abSource[(size_t(iY0) * dimSourceWidth + iX1) * 4 + iChannel] +
+                    abSource[(size_t(iY1) * dimSourceWidth + iX0) * 4 + iChannel] + abSource[(size_t(iY1) * dimSourceWidth + iX1) * 4 + iChannel];
+                abTarget[(size_t(iY) * dimTargetWidth + iX) * 4 + iChannel] = static_cast<uint8_t>((iSum + 2) / 4);
+            }
+        }
+    }
+}
+
+
+// Import an image into a texture file.
+void TextureImporter::ImportImage(const std::string &strImageFilename, const std::string &strTextureFilename,
+    enum TextureFormat fmtOpaque, enum TextureFormat fmtTranslucent) {
+
+    uint32_t dimWidth, dimHeight;
+    ImageDecoder::GetImageSize(strImageFilename, dimWidth, dimHeight);
+    std::vector<uint8_t> abLevel(size_t(dimWidth) * dimHeight * 4);
+    ImageDecoder::DecodeRgba(strImageFilename, dimWidth, dimHeight, abLevel.data());
+
+    // images that are fully opaque can use a format without alpha
+    bool bTranslucent = false;
+    for (size_t iTexel = 0; iTexel < abLevel.size() && !bTranslucent; iTexel += 4) {
+        bTranslucent = abLevel[iTexel + 3] != 255;
+    }
+    const enum TextureFormat idFormat = bTranslucent ? fmtTranslucent : fmtOpaque;
+
+    // downsample each level from the previous one and encode it
+    uint32_t dimLevelWidth = dimWidth;
+    uint32_t dimLevelHeight = dimHeight;
+    std::vector<std::vector<uint8_t>> aabLevels;
+    std::vector<uint8_t> abNextLevel;
+    for (;;) {
+        aabLevels.push_back(std::vector<uint8_t>());
+        BcEncoder::EncodeImage(idFormat, abLevel.data(), dimLevelWidth, dimLevelHeight, aabLevels.back());
+        if (dimLevelWidth == 1 && dimLevelHeight == 1) {
+            break;
+        }
+        const uint32_t dimNextWidth = std::max(dimLevelWidth / 2, 1u);
+        const uint32_t dimNextHeight = std::max(dimLevelHeight / 2, 1u);
+        DownsampleImage(abLevel, dimLevelWidth, dimLevelHeight, abNextLevel, dimNextWidth, dimNextHeight);
+        abLevel.swap(abNextLevel);
+        dimLevelWidth = dimNextWidth;
+        dimLevelHeight = dimNextHeight;
+    }
+
+    KtxFileWriter::Write(strTextureFilename, idFormat, dimWidth, dimHeight, aabLevels);
+}
+
+
+// Import an image only if the texture file is missing, older than the image, invalid, or in neither of the formats.
+void TextureImporter::ImportImageIfOutOfDate(const std::string &strImageFilename, const std::string &strTextureFilename,
+    enum TextureFormat fmtOpaque, enum TextureFormat fmtTranslucent) {
+
+    if (!FileSystem::IsOutOfDate(strTextureFilename, strImageFilename) && KtxFile::IsValid(strTextureFilename)) {
+        // a texture encoded for another device can only be kept if this one supports its format
+        KtxFile ktxTexture;
+        ktxTexture.Open(strTextureFilename);
+        const enum TextureFormat idFormat = ktxTexture.GetFormat();
+        ktxTexture.Close();
+        if (idFormat == fmtOpaque || idFormat == fmtTranslucent) {
+            return;
+        }
+    }
+    ImportImage(strImageFilename, strTextureFilename, fmtOpaque, fmtTranslucent);
+}
+
+
+// Import an image into a virtual texture file, split into bordered tiles on every level.
+void TextureImporter::ImportVirtualTexture(const std::string &strImageFilename, const std::string &strTextureFilename, enum TextureFormat idFormat) {
+    uint32_t dimWidth, dimHeight;
+    ImageDecoder::GetImageSize(strImageFilename, dimWidth, dimHeight);
+    std::vector<uint8_t> abLevel(size_t(dimWidth) * dimHeight * 4);
+    ImageDecoder::DecodeRgba(strImageFilename, dimWidth, dimHeight, abLevel.data());
+
+    VirtualTextureFileWriter vtfWriter;
+    vtfWriter.Open(strTextureFilename, idFormat, dimWidth, dimHeight);
+
+    // each level is half of the previous one rounded up, which keeps the parent of a tile at half its coordinates
+    uint32_t dimLevelWidth = dimWidth;
+    uint32_t dimLevelHeight = dimHeight;
+    std::vector<uint8_t> abNextLevel;
+    const uint32_t ctLevels = GetVirtualLevelCount(dimWidth, dimHeight);
+    for (uint32_t iLevel = 0; iLevel < ctLevels; iLevel++) {
+        const uint32_t ctTilesX = GetVirtualTileCount(dimWidth, iLevel);
+        const uint32_t ctTilesY = GetVirtualTileCount(dimHeight, iLevel);
+
+        // the tiles of a row are encoded in parallel and written in order; texels outside the level, in the borders
+        // and past the edge of the last tiles, wrap around as the texture repeats
+        std::vector<std::vector<uint8_t>> aabTiles(ctTilesX);
+        for (uint32_t iTileY = 0; iTileY < ctTilesY; iTileY++) {
+            ThreadPool::Get().ParallelFor(ctTilesX, [&](uint32_t iTileX) {
+                std::vector<uint8_t> abTexels(CT_VIRTUAL_TILE_STRIDE * CT_VIRTUAL_TILE_STRIDE * 4);
+                for (uint32_t iY = 0; iY < CT_VIRTUAL_TILE_STRIDE; iY++) {
+                    const int64_t iSourceY = int64_t(iTileY) * CT_VIRTUAL_TILE_SIZE + iY - CT_VIRTUAL_TILE_BORDER;
+                    const size_t iRow = static_cast<size_t>((iSourceY % dimLevelHeight + dimLevelHeight) % dimLevelHeight);
+                    for (uint32_t iX = 0; iX < CT_VIRTUAL_TILE_STRIDE; iX++) {
+                        const int64_t iSourceX = int64_t(iTileX) * CT_VIRTUAL_TILE_SIZE + iX - CT_VIRTUAL_TILE_BORDER;
+                        const size_t iColumn = static_cast<size_t>((iSourceX % dimLevelWidth + dimLevelWidth) % dimLevelWidth);
+                        memcpy(&abTexels[(iY * CT_VIRTUAL_TILE_STRIDE + iX) * 4], &abLevel[(iRow * dimLevelWidth + iColumn) * 4], 4);
+                    }
+                }
+                BcEncoder::EncodeImage(idFormat, abTexels.data(), CT_VIRTUAL_TILE_STRIDE, CT_VIRTUAL_TILE_STRIDE, aabTiles[iTileX]);
+            });
+            for (const std::vector<uint8_t> &abTile : aabTiles) {
+                vtfWriter.WriteTile(abTile.data());
+            }
+        }
+
+        const uint32_t dimNextWidth = (dimLevelWidth + 1) / 2;
+        const uint32_t dimNextHeight = (dimLevelHeight + 1) / 2;
+        DownsampleImage(abLevel, dimLevelWidth, dimLevelHeight, abNextLevel, dimNextWidth, dimNextHeight);
+        abLevel.swap(abNextLevel);
+        dimLevelWidth = dimNextWidth;
+        dimLevelHeight = dimNextHeight;
+    }
+
+    vtfWriter.Close();
+}
+
+
+// Import a virtual texture only if the file is missing, older than the image, invalid, or in another format.
+void TextureImporter::ImportVirtualTextureIfOutOfDate(const std::string &strImageFilename, const std::string &strTextureFilename, enum TextureFormat idFormat) {
+    if (!FileSystem::IsOutOfDate(strTextureFilename, strImageFilename) && VirtualTextureFile::IsValid(strTextureFilename)) {
+        VirtualTextureFile vtfTexture;
+        vtfTexture.Open(strTextureFilename);
+        const enum TextureFormat idFileFormat = vtfTexture.GetFormat();
+        vtfTexture.Close();
+        if (idFileFormat == idFormat) {
+            return;
+        }
+    }
+    ImportVirtualTexture(strImageFilename, strTextureFilename, idFormat);
+}
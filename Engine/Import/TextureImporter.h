@@ -0,0 +1,22 @@
+#pragma once
+#include "../Resources/TextureFormat.h"
+
+// Converts source images into KTX2 textures with a precomputed mip chain, block compressed so they can be uploaded
+// to the GPU as they are. The renderer passes the formats the device supports, one for opaque images and one for
+// images with transparency.
+class TextureImporter {
+public:
+    // Import an image into a texture file. Throws if the image can't be loaded or the texture can't be written.
+    static void ImportImage(const std::string &strImageFilename, const std::string &strTextureFilename,
+        enum TextureFormat fmtOpaque, enum TextureFormat fmtTranslucent);
+    // Import an image only if the texture file is missing, older than the image, invalid, or in neither of the formats.
+    static void ImportImageIfOutOfDate(const std::string &strImageFilename, const std::string &strTextureFilename,
+        enum TextureFormat fmtOpaque, enum TextureFormat fmtTranslucent);
+
+    // Import an image into a virtual texture file, split into bordered tiles on every level. All virtual textures
+    // share one tile cache, so they all use the format of the cache. Throws if the image can't be loaded or the
+    // texture can't be written.
+    static void ImportVirtualTexture(const std::string &strImageFilename, const std::string &strTextureFilename, enum TextureFormat idFormat);
+    // Import a virtual texture only if the file is missing, older than the image, invalid, or in another format.
+    static void ImportVirtualTextureIfOutOfDate(const std::string &strImageFilename, const std::string &strTextureFilename, enum TextureFormat idFormat);
+};
@@ -0,0 +1,110 @@
+#include "../PrecompiledHeader.h"
+#include "FileSystem.h"
+
+#include <stdexcept>
+#include <cstdio>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/stat.h>
+    #include <cerrno>
+#endif
+
+
+// Does the file exist?
+bool FileSystem::FileExists(const std::string &strFilename) {
+#ifdef _WIN32
+    return GetFileAttributesA(strFilename.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat statFile;
+    return stat(strFilename.c_str(), &statFile) == 0;
+#endif
+}
+
+
+// Get the size of a file. Returns 0 if the file doesn't exist.
+uint64_t FileSystem::GetFileSize(const std::string &strFilename) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA infoAttributes;
+    if (!GetFileAttributesExA(strFilename.c_str(), GetFileExInfoStandard, &infoAttributes)) {
+        return 0;
+    }
+    return (static_cast<uint64_t>(infoAttributes.nFileSizeHigh) << 32) | infoAttributes.nFileSizeLow;
+#else
+    struct stat statFile;
+    if (stat(strFilename.c_str(), &statFile) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(statFile.st_size);
+#endif
+}
+
+
+// Get the time the file was last modified, in an OS specific unit. Returns 0 if the file doesn't exist.
+uint64_t FileSystem::GetModificationTime(const std::string &strFilename) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA infoAttributes;
+    if (!GetFileAttributesExA(strFilename.c_str(), GetFileExInfoStandard, &infoAttributes)) {
+        return 0;
+    }
+    return (static_cast<uint64_t>(infoAttributes.ftLastWriteTime.dwHighDateTime) << 32) | infoAttributes.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat statFile;
+    if (stat(strFilename.c_str(), &statFile) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(statFile.st_mtim.tv_sec) * 1000000000ULL + statFile.st_mtim.tv_nsec;
+#endif
+}
+
+
+// Is the target file missing or older than the source it was produced from?
+bool FileSystem::IsOutOfDate(const std::string &strTarget, const std::string &strSource) {
+    const uint64_t tmTarget = GetModificationTime(strTarget);
+    return tmTarget == 0 || tmTarget < GetModificationTime(strSource);
+}
+
+
+// Create a directory, if it doesn't exist.
+void FileSystem::MakeDirectory(const std::string &strDirectory) {
+#ifdef _WIN32
+    const bool bSuccess = CreateDirectoryA(strDirectory.c_str(), nullptr) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    const bool bSuccess = mkdir(strDirectory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+    if (!bSuccess) {
+        throw std::runtime_error("Failed to create directory: " + strDirectory);
+    }
+}
+
+
+// Delete a file, if it exists.
+void FileSystem::RemoveFile(const std::string &strFilename) {
+    std::remove(strFilename.c_str());
+}
+
+
+// Move a file over another one in a single step, readers see either the old or the new file.
+void FileSystem::ReplaceFile(const std::string &strSource, const std::string &strTarget) {
+#ifdef _WIN32
+    const bool bSuccess = MoveFileExA(strSource.c_str(), strTarget.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    const bool bSuccess = std::rename(strSource.c_str(), strTarget.c_str()) == 0;
+#endif
+    if (!bSuccess) {
+        throw std::runtime_error("Failed to replace file: " + strTarget);
+    }
+}
+
+
+// Get the directory part of a path, including the trailing separator.
+std::string FileSystem::GetDirectory(const std::string &strPath) {
+    const size_t iSeparator = strPath.find_last_of("/\\");
+    if (iSeparator == std::string::npos) {
+        return std::string();
+    }
+    return strPath.substr(0, iSeparator + 1);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// Thin wrappers around the file system functions of the operating system.
+class FileSystem {
+public:
+    // Does the file exist?
+    static bool FileExists(const std::string &strFilename);
+    // Get the size of a file. Returns 0 if the file doesn't exist.
+    static uint64_t GetFileSize(const std::string &strFilename);
+    // Get the time the file was last modified, in an OS specific unit. Returns 0 if the file doesn't exist.
+    static uint64_t GetModificationTime(const std::string &strFilename);
+    // Is the target file missing or older than the source it was produced from?
+    static bool IsOutOfDate(const std::string &strTarget, const std::string &strSource);
+
+    // Create a directory, if it doesn't exist. Its parent must exist. Throws on failure.
+    static void MakeDirectory(const std::string &strDirectory);
+    // Delete a file, if it exists.
+    static void RemoveFile(const std::string &strFilename);
+    // Move a file over another one in a single step, readers see either the old or the new file. Throws on failure.
+    static void ReplaceFile(const std::string &strSource, const std::string &strTarget);
+
+    // Get the directory part of a path, including the trailing separator. Empty if the path has no directory.
+    static std::string GetDirectory(const std::string &strPath);
+};
@@ -0,0 +1,150 @@
+#include "../PrecompiledHeader.h"
+#include "FileWatcher.h"
+
+#include <stdexcept>
+
+#include "FileSystem.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+
+FileWatcher::FileWatcher() :
+    _hInotify(-1)
+{
+}
+
+
+FileWatcher::~FileWatcher() {
+    Clear();
+}
+
+
+// Start watching a file.
+void FileWatcher::Watch(const std::string &strFilename) {
+    std::string strDirectory = FileSystem::GetDirectory(strFilename);
+    if (strDirectory.empty()) {
+        strDirectory = "./";
+    }
+
+    // files in one directory share its notifications
+    WatchedDirectory *pdirDirectory = nullptr;
+    for (WatchedDirectory &dirWatched : _adirDirectories) {
+        if (dirWatched.strDirectory == strDirectory) {
+            pdirDirectory = &dirWatched;
+        }
+    }
+    if (pdirDirectory == nullptr) {
+        WatchedDirectory dirNew;
+        dirNew.strDirectory = strDirectory;
+#ifdef _WIN32
+        // files being written and files being renamed over, which is how many editors save
+        HANDLE hNotification = FindFirstChangeNotificationA(strDirectory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+        if (hNotification == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to watch directory: " + strDirectory);
+        }
+        dirNew.hNotification = reinterpret_cast<intptr_t>(hNotification);
+#else
+        // a single instance serves all directories, it is read without blocking
+        if (_hInotify < 0) {
+            _hInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (_hInotify < 0) {
+                throw std::runtime_error("Failed to initialize inotify");
+            }
+        }
+        // files that were written and closed, and files moved in, which is how many editors save; not every write,
+        // so files aren't reported half written
+        dirNew.hNotification = inotify_add_watch(static_cast<int>(_hInotify), strDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (dirNew.hNotification < 0) {
+            throw std::runtime_error("Failed to watch directory: " + strDirectory);
+        }
+#endif
+        _adirDirectories.push_back(dirNew);
+        pdirDirectory = &_adirDirectories.back();
+    }
+
+    for (const std::string &strWatched : pdirDirectory->astrFiles) {
+        if (strWatched == strFilename) {
+            return;
+        }
+    }
+    pdirDirectory->astrFiles.push_back(strFilename);
+    pdirDirectory->atmModified.push_back(FileSystem::GetModificationTime(strFilename));
+}
+
+
+// Stop watching all files.
+void FileWatcher::Clear() {
+#ifdef _WIN32
+    for (const WatchedDirectory &dirWatched : _adirDirectories) {
+        FindCloseChangeNotification(reinterpret_cast<HANDLE>(dirWatched.hNotification));
+    }
+#else
+    // closing the instance removes its watches
+    if (_hInotify >= 0) {
+        close(static_cast<int>(_hInotify));
+        _hInotify = -1;
+    }
+#endif
+    _adirDirectories.clear();
+}
+
+
+// Get the watched files that changed since the last poll.
+void FileWatcher::Poll(std::vector<std::string> &astrChanged) {
+    astrChanged.clear();
+
+    // find the directories something changed in
+    std::vector<bool> abChanged(_adirDirectories.size(), false);
+#ifdef _WIN32
+    for (size_t iDirectory = 0; iDirectory < _adirDirectories.size(); iDirectory++) {
+        HANDLE hNotification = reinterpret_cast<HANDLE>(_adirDirectories[iDirectory].hNotification);
+        if (WaitForSingleObject(hNotification, 0) == WAIT_OBJECT_0) {
+            abChanged[iDirectory] = true;
+            FindNextChangeNotification(hNotification);
+        }
+    }
+#else
+    if (_hInotify >= 0) {
+        // the events of several changes may be queued, they are all read
+        alignas(inotify_event) char achEvents[4096];
+        for (;;) {
+            const ssize_t ctRead = read(static_cast<int>(_hInotify), achEvents, sizeof(achEvents));
+            if (ctRead <= 0) {
+                break;
+            }
+            for (ssize_t offEvent = 0; offEvent < ctRead; ) {
+                const inotify_event *pevEvent = reinterpret_cast<const inotify_event *>(achEvents + offEvent);
+                for (size_t iDirectory = 0; iDirectory < _adirDirectories.size(); iDirectory++) {
+                    if (_adirDirectories[iDirectory].hNotification == pevEvent->wd) {
+                        abChanged[iDirectory] = true;
+                    }
+                }
+                offEvent += sizeof(inotify_event) + pevEvent->len;
+            }
+        }
+    }
+#endif
+
+    // a notification may be about any file in the directory, only the watched files that were modified are reported
+    for (size_t iDirectory = 0; iDirectory < _adirDirectories.size(); iDirectory++) {
+        if (!abChanged[iDirectory]) {
+            continue;
+        }
+        WatchedDirectory &dirWatched = _adirDirectories[iDirectory];
+        for (size_t iFile = 0; iFile < dirWatched.astrFiles.size(); iFile++) {
+            const uint64_t tmModified = FileSystem::GetModificationTime(dirWatched.astrFiles[iFile]);
+            if (tmModified != 0 && tmModified != dirWatched.atmModified[iFile]) {
+                dirWatched.atmModified[iFile] = tmModified;
+                astrChanged.push_back(dirWatched.astrFiles[iFile]);
+            }
+        }
+    }
+}
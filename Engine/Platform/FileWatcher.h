@@ -0,0 +1,39 @@
+#pragma once
+
+// Watches files for changes made by other programs, like editors and shader compilers. The operating system notifies
+// the watcher of changes in the directories of the watched files - through inotify on Linux, and change notifications
+// on Windows - and files in a changed directory are reported if their modification time moved. Polling never blocks,
+// so it can be done every frame.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // Start watching a file. The file doesn't have to exist yet. Throws if its directory can't be watched.
+    void Watch(const std::string &strFilename);
+    // Stop watching all files.
+    void Clear();
+    // Get the watched files that changed since the last poll.
+    void Poll(std::vector<std::string> &astrChanged);
+
+public:
+    // Forbid copying, the watcher owns the notification handles.
+    FileWatcher(FileWatcher const &) = delete;
+    void operator = (FileWatcher const &) = delete;
+
+private:
+    // A directory of watched files.
+    struct WatchedDirectory {
+        std::string strDirectory;
+        // Platform specific notification handle of the directory.
+        intptr_t hNotification;
+        // Watched files in the directory, and their modification times when they were last reported.
+        std::vector<std::string> astrFiles;
+        std::vector<uint64_t> atmModified;
+    };
+
+private:
+    std::vector<WatchedDirectory> _adirDirectories;
+    // Platform specific handle of the inotify instance, unused on Windows.
+    intptr_t _hInotify;
+};
@@ -0,0 +1,149 @@
+#include "../PrecompiledHeader.h"
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile() :
+    _bOpen(false), _pchData(nullptr), _ctSize(0), _ctFileSize(0), _pView(nullptr), _ctViewSize(0), _hFile(-1), _hMapping(-1)
+{
+}
+
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+
+// Map a file, or a window of it, into memory. Size of 0 maps everything from the offset to the end of the file.
+void MappedFile::Open(const std::string &strFilename, uint64_t ctOffset, uint64_t ctSize) {
+    // only one file can be mapped at a time
+    Close();
+
+#ifdef _WIN32
+    // open the file for reading, hinting that it will mostly be read front to back
+    HANDLE hFile = CreateFileA(strFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file: " + strFilename);
+    }
+    _hFile = reinterpret_cast<intptr_t>(hFile);
+
+    // get the file size
+    LARGE_INTEGER liFileSize;
+    GetFileSizeEx(hFile, &liFileSize);
+    _ctFileSize = static_cast<uint64_t>(liFileSize.QuadPart);
+
+    // get the granularity view offsets must be aligned to
+    SYSTEM_INFO infoSystem;
+    GetSystemInfo(&infoSystem);
+    const uint64_t ctGranularity = infoSystem.dwAllocationGranularity;
+#else
+    // open the file for reading
+    int hFile = open(strFilename.c_str(), O_RDONLY);
+    if (hFile < 0) {
+        throw std::runtime_error("Failed to open file: " + strFilename);
+    }
+    _hFile = hFile;
+
+    // get the file size
+    struct stat statFile;
+    fstat(hFile, &statFile);
+    _ctFileSize = static_cast<uint64_t>(statFile.st_size);
+
+    // view offsets must be aligned to the page size
+    const uint64_t ctGranularity = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+    // clamp the requested window to the file
+    if (ctOffset > _ctFileSize) {
+        Close();
+        throw std::runtime_error("Mapping offset is past the end of file: " + strFilename);
+    }
+    if (ctSize == 0 || ctOffset + ctSize > _ctFileSize) {
+        ctSize = _ctFileSize - ctOffset;
+    }
+    _ctSize = ctSize;
+    _bOpen = true;
+
+    // empty files (or windows) can't be mapped, but they are still valid
+    if (ctSize == 0) {
+        return;
+    }
+
+    // the view has to start at an aligned offset, so it is extended to the front as needed
+    const uint64_t ctViewOffset = ctOffset - ctOffset % ctGranularity;
+    _ctViewSize = ctSize + (ctOffset - ctViewOffset);
+
+#ifdef _WIN32
+    // create the mapping object for the whole file
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr) {
+        Close();
+        throw std::runtime_error("Failed to create the file mapping: " + strFilename);
+    }
+    _hMapping = reinterpret_cast<intptr_t>(hMapping);
+
+    // map the requested view
+    _pView = MapViewOfFile(hMapping, FILE_MAP_READ, static_cast<DWORD>(ctViewOffset >> 32), static_cast<DWORD>(ctViewOffset & 0xFFFFFFFF), static_cast<SIZE_T>(_ctViewSize));
+    if (_pView == nullptr) {
+        Close();
+        throw std::runtime_error("Failed to map the file: " + strFilename);
+    }
+#else
+    // map the requested view
+    _pView = mmap(nullptr, static_cast<size_t>(_ctViewSize), PROT_READ, MAP_PRIVATE, hFile, static_cast<off_t>(ctViewOffset));
+    if (_pView == MAP_FAILED) {
+        _pView = nullptr;
+        Close();
+        throw std::runtime_error("Failed to map the file: " + strFilename);
+    }
+    // the data is almost always read front to back, let the kernel read ahead aggressively
+    madvise(_pView, static_cast<size_t>(_ctViewSize), MADV_SEQUENTIAL);
+#endif
+
+    _pchData = static_cast<const char *>(_pView) + (ctOffset - ctViewOffset);
+}
+
+
+// Unmap the file and close it.
+void MappedFile::Close() {
+#ifdef _WIN32
+    if (_pView != nullptr) {
+        UnmapViewOfFile(_pView);
+    }
+    if (_hMapping != -1) {
+        CloseHandle(reinterpret_cast<HANDLE>(_hMapping));
+    }
+    if (_hFile != -1) {
+        CloseHandle(reinterpret_cast<HANDLE>(_hFile));
+    }
+#else
+    if (_pView != nullptr) {
+        munmap(_pView, static_cast<size_t>(_ctViewSize));
+    }
+    if (_hFile != -1) {
+        close(static_cast<int>(_hFile));
+    }
+#endif
+
+    _bOpen = false;
+    _pchData = nullptr;
+    _ctSize = 0;
+    _ctFileSize = 0;
+    _pView = nullptr;
+    _ctViewSize = 0;
+    _hFile = -1;
+    _hMapping = -1;
+}
+
@@ -0,0 +1,47 @@
+#pragma once
+
+// Read-only view of a file mapped into the address space of the process. The operating system pages the contents in
+// on demand, so mapping even very large files is cheap and no copy of the data is ever made by the application.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Map a file, or a window of it, into memory. Size of 0 maps everything from the offset to the end of the file.
+    // Throws if the file can't be opened or mapped.
+    void Open(const std::string &strFilename, uint64_t ctOffset = 0, uint64_t ctSize = 0);
+    // Unmap the file and close it.
+    void Close();
+
+    // Is a file currently mapped?
+    bool IsOpen() const { return _bOpen; }
+    // Get the pointer to the start of the mapped data.
+    const char *GetData() const { return _pchData; }
+    // Get the size of the mapped data, in bytes.
+    uint64_t GetSize() const { return _ctSize; }
+    // Get the size of the whole file, in bytes.
+    uint64_t GetFileSize() const { return _ctFileSize; }
+
+public:
+    // Forbid copying, the mapping is owned by exactly one object.
+    MappedFile(MappedFile const &) = delete;
+    void operator = (MappedFile const &) = delete;
+
+private:
+    // Is the file open and mapped?
+    bool _bOpen;
+    // Pointer to the requested data, inside the mapped view.
+    const char *_pchData;
+    // Size of the requested data.
+    uint64_t _ctSize;
+    // Size of the whole file.
+    uint64_t _ctFileSize;
+
+    // Start and size of the actual view - the view starts at an offset aligned to the allocation granularity.
+    void *_pView;
+    uint64_t _ctViewSize;
+
+    // Platform specific handles to the file and the mapping.
+    intptr_t _hFile;
+    intptr_t _hMapping;
+};
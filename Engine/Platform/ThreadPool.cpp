@@ -0,0 +1,117 @@
+#include "../PrecompiledHeader.h"
+#include "ThreadPool.h"
+
+
+// Start one worker per hardware thread.
+ThreadPool::ThreadPool() : _bShutdown(false) {
+    // hardware_concurrency can return 0 if it can't determine the number of threads
+    uint32_t ctWorkers = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t iWorker = 0; iWorker < ctWorkers; iWorker++) {
+        _athrWorkers.emplace_back(&ThreadPool::WorkerMain, this);
+    }
+}
+
+
+// Stop the workers and wait for them to exit. Jobs still in the queue are abandoned.
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mtxQueue);
+        _bShutdown = true;
+    }
+    _cvQueue.notify_all();
+
+    for (std::thread &thrWorker : _athrWorkers) {
+        thrWorker.join();
+    }
+}
+
+
+// Queue a job for execution on a worker.
+std::future<void> ThreadPool::Submit(std::function<void()> fnJob) {
+    auto pjobJob = std::make_shared<std::packaged_task<void()>>(std::move(fnJob));
+    std::future<void> futDone = pjobJob->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(_mtxQueue);
+        _ajobQueue.push_back(std::move(pjobJob));
+    }
+    _cvQueue.notify_one();
+
+    return futDone;
+}
+
+
+// Run the job for each index in [0, ctJobs) on the workers and wait for all of them to finish.
+void ThreadPool::ParallelFor(uint32_t ctJobs, const std::function<void(uint32_t)> &fnJob) {
+    // a single job is run directly, there is nothing to gain from waking a worker
+    if (ctJobs == 1) {
+        fnJob(0);
+        return;
+    }
+
+    // the workers help by claiming indices from the batch; a helper that starts after all indices are claimed, e.g.
+    // behind a long job in the queue, finds nothing left and never touches the caller's job
+    std::shared_ptr<ParallelBatch> pbatJobs = std::make_shared<ParallelBatch>();
+    pbatJobs->pfnJob = &fnJob;
+    pbatJobs->ctJobs = ctJobs;
+    pbatJobs->iNextJob = 0;
+    pbatJobs->ctDone = 0;
+    const uint32_t ctHelpers = std::min(ctJobs - 1, GetWorkerCount());
+    for (uint32_t iHelper = 0; iHelper < ctHelpers; iHelper++) {
+        Submit([pbatJobs]() { RunBatchJobs(*pbatJobs); });
+    }
+
+    // the caller runs this call's jobs too, which also keeps nested calls from workers from deadlocking; it then waits
+    // for the jobs the helpers claimed before rethrowing, as the jobs reference the caller's stack
+    RunBatchJobs(*pbatJobs);
+    std::unique_lock<std::mutex> lock(pbatJobs->mtxDone);
+    pbatJobs->cvDone.wait(lock, [&pbatJobs]() { return pbatJobs->ctDone == pbatJobs->ctJobs; });
+    if (pbatJobs->excFirst) {
+        std::rethrow_exception(pbatJobs->excFirst);
+    }
+}
+
+
+// Run the batch's jobs until all of them are claimed.
+void ThreadPool::RunBatchJobs(ParallelBatch &batJobs) {
+    while (true) {
+        const uint32_t iJob = batJobs.iNextJob++;
+        if (iJob >= batJobs.ctJobs) {
+            return;
+        }
+        std::exception_ptr excJob;
+        try {
+            (*batJobs.pfnJob)(iJob);
+        }
+        catch (...) {
+            excJob = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(batJobs.mtxDone);
+        if (excJob && !batJobs.excFirst) {
+            batJobs.excFirst = excJob;
+        }
+        if (++batJobs.ctDone == batJobs.ctJobs) {
+            batJobs.cvDone.notify_all();
+        }
+    }
+}
+
+
+// Main function of a worker thread - takes jobs from the queue until the pool is destroyed.
+void ThreadPool::WorkerMain() {
+    while (true) {
+        std::shared_ptr<std::packaged_task<void()>> pjobJob;
+        {
+            std::unique_lock<std::mutex> lock(_mtxQueue);
+            _cvQueue.wait(lock, [this]() { return _bShutdown || !_ajobQueue.empty(); });
+            if (_bShutdown) {
+                return;
+            }
+            pjobJob = std::move(_ajobQueue.front());
+            _ajobQueue.pop_front();
+        }
+
+        // exceptions are captured by the packaged task and rethrown from the future
+        (*pjobJob)();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <exception>
+
+// Pool of worker threads that execute jobs in the background. Implemented as a singleton, one worker is
+// started per hardware thread the first time the pool is used.
+class ThreadPool {
+public:
+    // Singleton getter for the thread pool.
+    static ThreadPool &Get() {
+        static ThreadPool singThreadPool;
+        return singThreadPool;
+    }
+
+public:
+    // Get the number of worker threads.
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(_athrWorkers.size()); }
+
+    // Queue a job for execution on a worker. The returned future is ready when the job is done, and
+    // rethrows the exception if the job threw one.
+    std::future<void> Submit(std::function<void()> fnJob);
+    // Run the job for each index in [0, ctJobs) on the workers and wait for all of them to finish. The calling thread
+    // takes part, but only in this call's jobs, so it never ends up running an unrelated long job.
+    void ParallelFor(uint32_t ctJobs, const std::function<void(uint32_t)> &fnJob);
+
+private:
+    // Thread pool objects shouldn't be created or destroyed from the outside.
+    ThreadPool();
+    ~ThreadPool();
+
+    // Indices of one ParallelFor call, claimed one at a time by the caller and the workers that help it.
+    struct ParallelBatch {
+        const std::function<void(uint32_t)> *pfnJob;
+        uint32_t ctJobs;
+        std::atomic<uint32_t> iNextJob;
+        // Number of finished jobs and the first exception a job threw, guarded by the mutex.
+        uint32_t ctDone;
+        std::exception_ptr excFirst;
+        std::mutex mtxDone;
+        std::condition_variable cvDone;
+    };
+
+    // Run the batch's jobs until all of them are claimed.
+    static void RunBatchJobs(ParallelBatch &batJobs);
+    // Main function of a worker thread - takes jobs from the queue until the pool is destroyed.
+    void WorkerMain();
+
+public:
+    // Forbid copying.
+    ThreadPool(ThreadPool const &) = delete;
+    void operator = (ThreadPool const &) = delete;
+
+private:
+    // Worker threads.
+    std::vector<std::thread> _athrWorkers;
+    // Jobs waiting to be executed.
+    std::deque<std::shared_ptr<std::packaged_task<void()>>> _ajobQueue;
+    // Guards the job queue.
+    std::mutex _mtxQueue;
+    // Signalled when a job is queued or the pool is shutting down.
+    std::condition_variable _cvQueue;
+    // Set when the workers should exit.
+    bool _bShutdown;
+};
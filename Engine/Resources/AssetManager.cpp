@@ -0,0 +1,270 @@
+#include "../PrecompiledHeader.h"
+#include "AssetManager.h"
+
+#include <iostream>
+
+#include "../Platform/ThreadPool.h"
+
+
+AssetHandle::AssetHandle(AssetManager *pamManager, uint32_t idAsset) :
+    _pamManager(pamManager),
+    _idAsset(idAsset)
+{
+    _pamManager->AddReference(_idAsset);
+}
+
+
+AssetHandle::AssetHandle(const AssetHandle &hAsset) :
+    _pamManager(hAsset._pamManager),
+    _idAsset(hAsset._idAsset)
+{
+    if (_pamManager != nullptr) {
+        _pamManager->AddReference(_idAsset);
+    }
+}
+
+
+AssetHandle::AssetHandle(AssetHandle &&hAsset) :
+    _pamManager(hAsset._pamManager),
+    _idAsset(hAsset._idAsset)
+{
+    hAsset._pamManager = nullptr;
+}
+
+
+AssetHandle &AssetHandle::operator = (AssetHandle hAsset) {
+    // the argument is a copy, swapping with it leaves the old reference to be released with it
+    std::swap(_pamManager, hAsset._pamManager);
+    std::swap(_idAsset, hAsset._idAsset);
+    return *this;
+}
+
+
+// Drop the reference, the handle no longer references an asset.
+void AssetHandle::Release() {
+    if (_pamManager != nullptr) {
+        _pamManager->RemoveReference(_idAsset);
+        _pamManager = nullptr;
+    }
+}
+
+
+// Request an asset.
+AssetHandle AssetManager::Request(const std::string &strName, const std::vector<AssetHandle> &ahDependencies, const AssetLoader &ldrLoader) {
+    auto itAsset = _mapAssetIds.find(strName);
+    if (itAsset != _mapAssetIds.end()) {
+        return AssetHandle(this, itAsset->second);
+    }
+
+    uint32_t idAsset;
+    if (!_aidFreeSlots.empty()) {
+        idAsset = _aidFreeSlots.back();
+        _aidFreeSlots.pop_back();
+    } else {
+        idAsset = static_cast<uint32_t>(_aassAssets.size());
+        _aassAssets.emplace_back();
+    }
+    Asset &assAsset = _aassAssets[idAsset];
+    assAsset.strName = strName;
+    assAsset.idState = ASSET_WAITING;
+    assAsset.ctReferences = 0;
+    assAsset.ahDependencies = ahDependencies;
+    assAsset.ldrLoader = ldrLoader;
+    assAsset.bStarted = false;
+    assAsset.bReload = false;
+    assAsset.bUsed = true;
+    _mapAssetIds[strName] = idAsset;
+    return AssetHandle(this, idAsset);
+}
+
+
+// Are any assets not ready or failed yet?
+bool AssetManager::IsBusy() const {
+    for (const Asset &assAsset : _aassAssets) {
+        if (assAsset.bUsed && assAsset.idState != ASSET_READY && assAsset.idState != ASSET_FAILED) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Advance the assets, called on the main thread once per frame.
+uint32_t AssetManager::Update(uint32_t ctMaxFinishes) {
+    // start the loads of assets whose dependencies are done
+    for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+        Asset &assAsset = _aassAssets[idAsset];
+        if (!assAsset.bUsed || assAsset.idState != ASSET_WAITING) {
+            continue;
+        }
+        bool bDependenciesDone = true;
+        for (const AssetHandle &hDependency : assAsset.ahDependencies) {
+            bDependenciesDone = bDependenciesDone && IsDone(hDependency._idAsset);
+        }
+        if (!bDependenciesDone) {
+            continue;
+        }
+        // assets without a load are finished right away
+        assAsset.bStarted = true;
+        if (assAsset.ldrLoader.fnLoad) {
+            assAsset.futLoaded = ThreadPool::Get().Submit(assAsset.ldrLoader.fnLoad);
+            assAsset.idState = ASSET_LOADING;
+        } else {
+            assAsset.idState = ASSET_LOADED;
+        }
+    }
+
+    // collect the loads that are done without waiting for the rest
+    for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+        Asset &assAsset = _aassAssets[idAsset];
+        if (assAsset.bUsed && assAsset.idState == ASSET_LOADING && assAsset.futLoaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            CompleteLoad(idAsset);
+        }
+    }
+
+    // finishing may be expensive, only a few assets are finished each frame
+    uint32_t ctReady = 0;
+    for (uint32_t idAsset = 0; idAsset < _aassAssets.size() && ctReady < ctMaxFinishes; idAsset++) {
+        if (!_aassAssets[idAsset].bUsed || _aassAssets[idAsset].idState != ASSET_LOADED) {
+            continue;
+        }
+        // the finish may request more assets, so the slot is looked up again after it
+        const std::function<void()> fnFinish = _aassAssets[idAsset].ldrLoader.fnFinish;
+        try {
+            if (fnFinish) {
+                fnFinish();
+            }
+            _aassAssets[idAsset].idState = ASSET_READY;
+            ctReady++;
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Failed to finish asset " << _aassAssets[idAsset].strName << ": " << e.what() << std::endl;
+            _aassAssets[idAsset].idState = ASSET_FAILED;
+        }
+    }
+
+    // freeing an asset releases its dependencies, which may leave them unreferenced in turn
+    bool bFreed = true;
+    while (bFreed) {
+        bFreed = false;
+        for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+            const Asset &assAsset = _aassAssets[idAsset];
+            if (assAsset.bUsed && assAsset.ctReferences == 0 && assAsset.idState != ASSET_LOADING) {
+                FreeAsset(idAsset);
+                bFreed = true;
+            }
+        }
+    }
+    return ctReady;
+}
+
+
+// Wait for the loads in progress and free all assets.
+void AssetManager::Clear() {
+    for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+        if (_aassAssets[idAsset].bUsed && _aassAssets[idAsset].idState == ASSET_LOADING) {
+            CompleteLoad(idAsset);
+        }
+    }
+
+    // free the unreferenced assets first, so dependents go before what they depend on
+    bool bFreed = true;
+    while (bFreed) {
+        bFreed = false;
+        for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+            if (_aassAssets[idAsset].bUsed && _aassAssets[idAsset].ctReferences == 0) {
+                FreeAsset(idAsset);
+                bFreed = true;
+            }
+        }
+    }
+
+    // whatever is left is still referenced from the outside
+    _bClearing = true;
+    for (uint32_t idAsset = 0; idAsset < _aassAssets.size(); idAsset++) {
+        if (_aassAssets[idAsset].bUsed) {
+            FreeAsset(idAsset);
+        }
+    }
+    _aassAssets.clear();
+    _mapAssetIds.clear();
+    _aidFreeSlots.clear();
+    _bClearing = false;
+}
+
+
+void AssetManager::RemoveReference(uint32_t idAsset) {
+    if (!_bClearing) {
+        _aassAssets[idAsset].ctReferences--;
+    }
+}
+
+
+// Is the asset's dependency done, either ready or failed?
+bool AssetManager::IsDone(uint32_t idAsset) const {
+    return _aassAssets[idAsset].idState == ASSET_READY || _aassAssets[idAsset].idState == ASSET_FAILED;
+}
+
+
+// Wait for the asset's load and record its outcome.
+void AssetManager::CompleteLoad(uint32_t idAsset) {
+    Asset &assAsset = _aassAssets[idAsset];
+    try {
+        assAsset.futLoaded.get();
+        assAsset.idState = ASSET_LOADED;
+    }
+    catch (const std::exception &e) {
+        if (!assAsset.bReload) {
+            std::cerr << "Failed to load asset " << assAsset.strName << ": " << e.what() << std::endl;
+        }
+        assAsset.idState = ASSET_FAILED;
+    }
+
+    // a stale load is thrown away, whatever its outcome
+    if (assAsset.bReload) {
+        assAsset.bReload = false;
+        assAsset.idState = ASSET_WAITING;
+    }
+}
+
+
+// Free the asset and release its dependencies.
+void AssetManager::FreeAsset(uint32_t idAsset) {
+    Asset &assAsset = _aassAssets[idAsset];
+    if (assAsset.bStarted && assAsset.ldrLoader.fnFree) {
+        assAsset.ldrLoader.fnFree();
+    }
+
+    // the dependencies are released after the slot is reset, as releasing them touches other slots
+    std::vector<AssetHandle> ahDependencies;
+    ahDependencies.swap(assAsset.ahDependencies);
+    _mapAssetIds.erase(assAsset.strName);
+    assAsset.strName.clear();
+    assAsset.ldrLoader = AssetLoader();
+    assAsset.bUsed = false;
+    _aidFreeSlots.push_back(idAsset);
+}
+
+
+// Make the asset and the assets that depend on it wait to be loaded again.
+void AssetManager::ResetAsset(uint32_t idAsset) {
+    Asset &assAsset = _aassAssets[idAsset];
+    if (assAsset.idState == ASSET_LOADING) {
+        assAsset.bReload = true;
+    } else {
+        assAsset.idState = ASSET_WAITING;
+    }
+
+    // dependents are always requested after their dependencies, so there are no cycles
+    for (uint32_t idDependent = 0; idDependent < _aassAssets.size(); idDependent++) {
+        if (!_aassAssets[idDependent].bUsed) {
+            continue;
+        }
+        for (const AssetHandle &hDependency : _aassAssets[idDependent].ahDependencies) {
+            if (hDependency._idAsset == idAsset) {
+                ResetAsset(idDependent);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <functional>
+#include <future>
+#include <map>
+
+class AssetManager;
+
+// Reference to an asset of an asset manager. Every copy counts as a reference, and the asset is freed once the last
+// one is gone. Handles are only used on the main thread, and must not outlive their manager.
+class AssetHandle {
+public:
+    AssetHandle() : _pamManager(nullptr), _idAsset(0) {}
+    AssetHandle(const AssetHandle &hAsset);
+    AssetHandle(AssetHandle &&hAsset);
+    ~AssetHandle() { Release(); }
+    AssetHandle &operator = (AssetHandle hAsset);
+
+    // Does the handle reference an asset?
+    bool IsValid() const { return _pamManager != nullptr; }
+    // Drop the reference, the handle no longer references an asset.
+    void Release();
+
+private:
+    friend class AssetManager;
+    AssetHandle(AssetManager *pamManager, uint32_t idAsset);
+
+private:
+    AssetManager *_pamManager;
+    uint32_t _idAsset;
+};
+
+
+// Loads assets in the background. A request returns a handle right away, and the asset is loaded on a worker once
+// the assets it depends on are done, then finished on the main thread - the load does the slow work like decoding
+// and importing, the finish creates what has to be created on the main thread, like GPU resources. Until an asset is
+// ready, its user keeps using a fallback. Assets are reference counted through their handles, and an asset that is no
+// longer referenced is freed on the next update. Assets are known by name, requesting a known asset again returns
+// the same one.
+class AssetManager {
+public:
+    // Lifetime of an asset.
+    enum AssetState {
+        // Waiting for its dependencies.
+        ASSET_WAITING,
+        // Loading on a worker.
+        ASSET_LOADING,
+        // Loaded, waiting to be finished on the main thread.
+        ASSET_LOADED,
+        // Finished and ready to use.
+        ASSET_READY,
+        // The load or the finish threw.
+        ASSET_FAILED,
+    };
+
+    // How an asset is loaded and freed. Any of the functions can be empty.
+    struct AssetLoader {
+        // Runs on a worker once the dependencies are ready or failed. May throw, which fails the asset.
+        std::function<void()> fnLoad;
+        // Runs on the main thread after the load. May throw, which fails the asset. When the asset is reloaded, it
+        // replaces what the previous finish created.
+        std::function<void()> fnFinish;
+        // Runs on the main thread once the asset is no longer referenced, if its load ran.
+        std::function<void()> fnFree;
+    };
+
+    ~AssetManager() { Clear(); }
+
+    // Request an asset. The asset holds references to its dependencies until it is freed, and only starts loading
+    // once every dependency is ready or failed, so its load has to check which of them failed. If an asset with the
+    // name is already known, it is returned and the loader is ignored.
+    AssetHandle Request(const std::string &strName, const std::vector<AssetHandle> &ahDependencies, const AssetLoader &ldrLoader);
+    // Get the state of an asset.
+    AssetState GetState(const AssetHandle &hAsset) const { return _aassAssets[hAsset._idAsset].idState; }
+    // Is the asset finished and ready to use?
+    bool IsReady(const AssetHandle &hAsset) const { return GetState(hAsset) == ASSET_READY; }
+    // Are any assets not ready or failed yet?
+    bool IsBusy() const;
+    // Load and finish the asset again, e.g. after its file changed, and then the assets that depend on it. The asset
+    // keeps what its previous finish created until the new finish replaces it. A load in progress is thrown away.
+    void Reload(const AssetHandle &hAsset) { ResetAsset(hAsset._idAsset); }
+
+    // Called on the main thread once per frame. Starts the loads of assets whose dependencies are done, finishes up to
+    // ctMaxFinishes loaded assets and frees the assets that are no longer referenced. Returns the number of assets
+    // that became ready.
+    uint32_t Update(uint32_t ctMaxFinishes);
+    // Wait for the loads in progress and free all assets, handles that still reference them become dangling.
+    void Clear();
+
+public:
+    AssetManager() {}
+    // Forbid copying, handles point to the manager.
+    AssetManager(AssetManager const &) = delete;
+    void operator = (AssetManager const &) = delete;
+
+private:
+    friend class AssetHandle;
+    void AddReference(uint32_t idAsset) { _aassAssets[idAsset].ctReferences++; }
+    void RemoveReference(uint32_t idAsset);
+
+    // Is the asset's dependency done, either ready or failed?
+    bool IsDone(uint32_t idAsset) const;
+    // Wait for the asset's load and record its outcome.
+    void CompleteLoad(uint32_t idAsset);
+    // Free the asset and release its dependencies, its slot can be reused.
+    void FreeAsset(uint32_t idAsset);
+    // Make the asset and the assets that depend on it wait to be loaded again.
+    void ResetAsset(uint32_t idAsset);
+
+private:
+    // An asset and its bookkeeping.
+    struct Asset {
+        std::string strName;
+        AssetState idState;
+        uint32_t ctReferences;
+        std::vector<AssetHandle> ahDependencies;
+        AssetLoader ldrLoader;
+        // Ready when the load on the worker is done.
+        std::future<void> futLoaded;
+        // Did the load ever start? The asset is only freed if it did.
+        bool bStarted;
+        // Is the load in progress stale, the asset loads again once it is done?
+        bool bReload;
+        // Is the slot in use?
+        bool bUsed;
+    };
+
+    std::vector<Asset> _aassAssets;
+    // Id of each known asset by name.
+    std::map<std::string, uint32_t> _mapAssetIds;
+    // Slots of freed assets, reused by new ones.
+    std::vector<uint32_t> _aidFreeSlots;
+    // Set while the manager is being cleared, references of the assets being freed are no longer counted.
+    bool _bClearing = false;
+};
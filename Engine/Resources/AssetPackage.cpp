@@ -0,0 +1,186 @@
+#include "../PrecompiledHeader.h"
+#include "AssetPackage.h"
+
+#include <stdexcept>
+
+#include "../Platform/FileSystem.h"
+
+
+AssetPackageWriter::AssetPackageWriter() :
+    _offCurrent(0)
+{
+}
+
+
+AssetPackageWriter::~AssetPackageWriter() {
+    // a writer that wasn't closed didn't produce a complete package, throw the partial one away
+    if (_fsFile.is_open()) {
+        _fsFile.close();
+        FileSystem::RemoveFile(_strTempFilename);
+    }
+}
+
+
+// Start writing a package.
+void AssetPackageWriter::Open(const std::string &strFilename) {
+    _strFilename = strFilename;
+    _strTempFilename = strFilename + ".tmp";
+    _fsFile.open(_strTempFilename, std::ios::binary | std::ios::trunc);
+    if (!_fsFile.is_open()) {
+        throw std::runtime_error("Failed to create file: " + _strTempFilename);
+    }
+
+    // reserve the space for the header, it is filled in when the package is closed
+    _aentAssets.clear();
+    _offCurrent = 0;
+    const AssetPackageHeader hdrEmpty = {};
+    _fsFile.write(reinterpret_cast<const char *>(&hdrEmpty), sizeof(hdrEmpty));
+    _offCurrent += sizeof(hdrEmpty);
+}
+
+
+// Append an asset.
+void AssetPackageWriter::AddAsset(const std::string &strName, const void *pData, uint64_t ctBytes) {
+    // assets are only known by the hash of their name, two names with one hash couldn't be told apart
+    const uint64_t idNameHash = AssetPackage::HashName(strName);
+    for (const AssetPackageEntry &entAsset : _aentAssets) {
+        if (entAsset.idNameHash == idNameHash) {
+            throw std::runtime_error("Asset is already in the package, or its name hash collides with another: " + strName);
+        }
+    }
+
+    Align(CT_ASSET_PACKAGE_ALIGNMENT);
+    _aentAssets.push_back({ idNameHash, _offCurrent, ctBytes });
+    _fsFile.write(static_cast<const char *>(pData), static_cast<std::streamsize>(ctBytes));
+    _offCurrent += ctBytes;
+}
+
+
+// Finish the package and move it over the target.
+void AssetPackageWriter::Close() {
+    // the table of contents is an open addressing hash table at most half full, so lookups probe only a slot or two
+    uint32_t ctSlots = 1;
+    while (ctSlots < 2 * _aentAssets.size()) {
+        ctSlots *= 2;
+    }
+    std::vector<AssetPackageEntry> aentTable(ctSlots, AssetPackageEntry{ 0, 0, 0 });
+    for (const AssetPackageEntry &entAsset : _aentAssets) {
+        uint32_t iSlot = static_cast<uint32_t>(entAsset.idNameHash) & (ctSlots - 1);
+        while (aentTable[iSlot].idNameHash != 0) {
+            iSlot = (iSlot + 1) & (ctSlots - 1);
+        }
+        aentTable[iSlot] = entAsset;
+    }
+
+    Align(sizeof(AssetPackageEntry));
+    AssetPackageHeader hdrHeader = {};
+    hdrHeader.idMagic = ID_ASSET_PACKAGE_MAGIC;
+    hdrHeader.idVersion = ID_ASSET_PACKAGE_VERSION;
+    hdrHeader.ctSlots = ctSlots;
+    hdrHeader.ctAssets = static_cast<uint32_t>(_aentAssets.size());
+    hdrHeader.offTable = _offCurrent;
+    _fsFile.write(reinterpret_cast<const char *>(aentTable.data()), static_cast<std::streamsize>(aentTable.size() * sizeof(AssetPackageEntry)));
+
+    // write the final header over the placeholder
+    _fsFile.seekp(0);
+    _fsFile.write(reinterpret_cast<const char *>(&hdrHeader), sizeof(hdrHeader));
+    _fsFile.close();
+    if (_fsFile.fail()) {
+        FileSystem::RemoveFile(_strTempFilename);
+        throw std::runtime_error("Failed to write file: " + _strTempFilename);
+    }
+
+    FileSystem::ReplaceFile(_strTempFilename, _strFilename);
+}
+
+
+// Pad the file with zeros up to the alignment.
+void AssetPackageWriter::Align(uint64_t ctAlignment) {
+    static const char achZeros[CT_ASSET_PACKAGE_ALIGNMENT] = {};
+    const uint64_t ctPadding = (ctAlignment - _offCurrent % ctAlignment) % ctAlignment;
+    _fsFile.write(achZeros, static_cast<std::streamsize>(ctPadding));
+    _offCurrent += ctPadding;
+}
+
+
+// Map the package and check its header.
+void AssetPackage::Open(const std::string &strFilename) {
+    _mfFile.Open(strFilename);
+
+    const AssetPackageHeader *phdrHeader = reinterpret_cast<const AssetPackageHeader *>(_mfFile.GetData());
+    if (_mfFile.GetSize() < sizeof(AssetPackageHeader) || phdrHeader->idMagic != ID_ASSET_PACKAGE_MAGIC) {
+        _mfFile.Close();
+        throw std::runtime_error("Not an asset package: " + strFilename);
+    }
+    if (phdrHeader->idVersion != ID_ASSET_PACKAGE_VERSION || phdrHeader->ctSlots == 0 || (phdrHeader->ctSlots & (phdrHeader->ctSlots - 1)) != 0) {
+        _mfFile.Close();
+        throw std::runtime_error("Unsupported asset package version: " + strFilename);
+    }
+
+    // check that the table and all assets are inside the file
+    const uint64_t ctTableBytes = uint64_t(phdrHeader->ctSlots) * sizeof(AssetPackageEntry);
+    if (phdrHeader->offTable > _mfFile.GetSize() || ctTableBytes > _mfFile.GetSize() - phdrHeader->offTable) {
+        _mfFile.Close();
+        throw std::runtime_error("Asset package is truncated: " + strFilename);
+    }
+    const AssetPackageEntry *aentTable = reinterpret_cast<const AssetPackageEntry *>(_mfFile.GetData() + phdrHeader->offTable);
+    for (uint32_t iSlot = 0; iSlot < phdrHeader->ctSlots; iSlot++) {
+        const AssetPackageEntry &entAsset = aentTable[iSlot];
+        if (entAsset.idNameHash != 0 && (entAsset.offData > _mfFile.GetSize() || entAsset.ctBytes > _mfFile.GetSize() - entAsset.offData)) {
+            _mfFile.Close();
+            throw std::runtime_error("Asset package is truncated: " + strFilename);
+        }
+    }
+}
+
+
+// Get the data of an asset, nullptr if the package doesn't have it.
+const char *AssetPackage::FindAsset(const std::string &strName, uint64_t &ctBytes) const {
+    ctBytes = 0;
+    const AssetPackageHeader &hdrHeader = GetHeader();
+    const AssetPackageEntry *aentTable = reinterpret_cast<const AssetPackageEntry *>(_mfFile.GetData() + hdrHeader.offTable);
+
+    // probe from the name's slot until the asset or an empty slot, the table always has empty slots
+    const uint64_t idNameHash = HashName(strName);
+    for (uint32_t iSlot = static_cast<uint32_t>(idNameHash) & (hdrHeader.ctSlots - 1); aentTable[iSlot].idNameHash != 0; iSlot = (iSlot + 1) & (hdrHeader.ctSlots - 1)) {
+        if (aentTable[iSlot].idNameHash == idNameHash) {
+            ctBytes = aentTable[iSlot].ctBytes;
+            return _mfFile.GetData() + aentTable[iSlot].offData;
+        }
+    }
+    return nullptr;
+}
+
+
+// Get the data of an asset.
+const char *AssetPackage::GetAsset(const std::string &strName, uint64_t &ctBytes) const {
+    const char *pchData = FindAsset(strName, ctBytes);
+    if (pchData == nullptr) {
+        throw std::runtime_error("Asset not found in the package: " + strName);
+    }
+    return pchData;
+}
+
+
+// Hash an asset name, 64 bit FNV-1a.
+uint64_t AssetPackage::HashName(const std::string &strName) {
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    for (char chName : strName) {
+        idHash ^= static_cast<uint8_t>(chName);
+        idHash *= 0x100000001B3ULL;
+    }
+    return idHash != 0 ? idHash : 1;
+}
+
+
+// Is the file a valid package of the current version?
+bool AssetPackage::IsValid(const std::string &strFilename) {
+    try {
+        AssetPackage pkgPackage;
+        pkgPackage.Open(strFilename);
+        return true;
+    }
+    catch (const std::runtime_error &) {
+        return false;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "../Platform/MappedFile.h"
+
+// Identifies the file as an engine asset package, 'GPAK'.
+static const uint32_t ID_ASSET_PACKAGE_MAGIC = 0x4B415047;
+// Version of the asset package format, packages with other versions are rebuilt.
+static const uint32_t ID_ASSET_PACKAGE_VERSION = 1;
+// Alignment of asset data inside the package - a page, so every asset starts on its own page of the mapping and
+// can be handed to APIs that want aligned data.
+static const uint64_t CT_ASSET_PACKAGE_ALIGNMENT = 4096;
+
+// Entry in the table of contents of an asset package.
+struct AssetPackageEntry {
+    // Hash of the asset's name, 0 marks an empty slot.
+    uint64_t idNameHash;
+    // Offset of the asset's data from the start of the package, aligned to CT_ASSET_PACKAGE_ALIGNMENT.
+    uint64_t offData;
+    // Size of the asset's data, in bytes.
+    uint64_t ctBytes;
+};
+
+// Header at the start of every asset package.
+struct AssetPackageHeader {
+    uint32_t idMagic;
+    uint32_t idVersion;
+    // Number of slots in the table of contents, a power of two, and the number of assets in them.
+    uint32_t ctSlots;
+    uint32_t ctAssets;
+    // Offset of the table of contents from the start of the package.
+    uint64_t offTable;
+};
+
+
+// Writes an asset package. Assets are appended one after another, each on its own page, and the table of contents
+// goes at the end. The data goes to a temporary file that replaces the target only when the writer is closed.
+class AssetPackageWriter {
+public:
+    AssetPackageWriter();
+    ~AssetPackageWriter();
+
+    // Start writing a package. Throws if the file can't be created.
+    void Open(const std::string &strFilename);
+    // Append an asset. Throws if another asset's name has the same hash.
+    void AddAsset(const std::string &strName, const void *pData, uint64_t ctBytes);
+    // Finish the package and move it over the target. Throws if the file can't be written.
+    void Close();
+
+public:
+    // Forbid copying, the writer owns its file.
+    AssetPackageWriter(AssetPackageWriter const &) = delete;
+    void operator = (AssetPackageWriter const &) = delete;
+
+private:
+    // Pad the file with zeros up to the alignment.
+    void Align(uint64_t ctAlignment);
+
+private:
+    // Name of the target file, and of the temporary file that is being written.
+    std::string _strFilename;
+    std::string _strTempFilename;
+    std::ofstream _fsFile;
+    // Assets written so far, the table of contents is built from them on close.
+    std::vector<AssetPackageEntry> _aentAssets;
+    // Current write position in the file.
+    uint64_t _offCurrent;
+};
+
+
+// Read-only access to an asset package. The package is memory mapped once and assets are found by the hash of their
+// name and used in place, without copies.
+class AssetPackage {
+public:
+    // Map the package and check its header. Throws if the file is not a valid package of the current version.
+    void Open(const std::string &strFilename);
+    // Unmap the package.
+    void Close() { _mfFile.Close(); }
+    // Is a package open?
+    bool IsOpen() const { return _mfFile.IsOpen(); }
+
+    // Get the data of an asset, nullptr if the package doesn't have it.
+    const char *FindAsset(const std::string &strName, uint64_t &ctBytes) const;
+    // Get the data of an asset. Throws if the package doesn't have it.
+    const char *GetAsset(const std::string &strName, uint64_t &ctBytes) const;
+    // Does the package have the asset?
+    bool HasAsset(const std::string &strName) const {
+        uint64_t ctBytes;
+        return FindAsset(strName, ctBytes) != nullptr;
+    }
+
+    // Hash an asset name, never 0 as that marks empty slots in the table of contents.
+    static uint64_t HashName(const std::string &strName);
+    // Is the file a valid package of the current version? Doesn't throw.
+    static bool IsValid(const std::string &strFilename);
+
+private:
+    const AssetPackageHeader &GetHeader() const { return *reinterpret_cast<const AssetPackageHeader *>(_mfFile.GetData()); }
+
+private:
+    MappedFile _mfFile;
+};
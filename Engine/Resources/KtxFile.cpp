@@ -0,0 +1,205 @@
+#include "../PrecompiledHeader.h"
+#include "KtxFile.h"
+
+#include <stdexcept>
+#include <cstring>
+
+#include "../Platform/FileSystem.h"
+
+
+// Identifier that starts every KTX2 file, '«KTX 20»\r\n\x1A\n'.
+static const uint8_t AB_KTX_IDENTIFIER[CT_KTX_IDENTIFIER_SIZE] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// Color models, channel types and transfer function of the Khronos data format descriptor.
+static const uint32_t ID_KTX_MODEL_RGBSDA = 1;
+static const uint32_t ID_KTX_MODEL_BC1A = 128;
+static const uint32_t ID_KTX_MODEL_BC3 = 130;
+static const uint32_t ID_KTX_MODEL_BC5 = 132;
+static const uint32_t ID_KTX_MODEL_BC7 = 134;
+static const uint32_t ID_KTX_CHANNEL_RED = 0;
+static const uint32_t ID_KTX_CHANNEL_GREEN = 1;
+static const uint32_t ID_KTX_CHANNEL_BLUE = 2;
+static const uint32_t ID_KTX_CHANNEL_ALPHA = 15;
+static const uint32_t ID_KTX_PRIMARIES_BT709 = 1;
+static const uint32_t ID_KTX_TRANSFER_LINEAR = 1;
+
+
+// Append one sample of a basic data format descriptor - which bits of a texel block hold which channel.
+static void AddDescriptorSample(std::vector<uint32_t> &aiDescriptor, uint32_t iBitOffset, uint32_t ctBits, uint32_t idChannel, uint32_t iUpper) {
+    aiDescriptor.push_back(iBitOffset | ((ctBits - 1) << 16) | (idChannel << 24));
+    aiDescriptor.push_back(0);
+    aiDescriptor.push_back(0);
+    aiDescriptor.push_back(iUpper);
+}
+
+
+// Build the data format descriptor of a format, including its leading total size.
+static std::vector<uint32_t> BuildDataFormatDescriptor(enum TextureFormat idFormat) {
+    const bool bCompressed = IsBlockCompressed(idFormat);
+    uint32_t idModel = ID_KTX_MODEL_RGBSDA;
+    switch (idFormat) {
+        case TEXTURE_FORMAT_BC1_RGB: idModel = ID_KTX_MODEL_BC1A; break;
+        case TEXTURE_FORMAT_BC3: idModel = ID_KTX_MODEL_BC3; break;
+        case TEXTURE_FORMAT_BC5: idModel = ID_KTX_MODEL_BC5; break;
+        case TEXTURE_FORMAT_BC7: idModel = ID_KTX_MODEL_BC7; break;
+        default: break;
+    }
+
+    std::vector<uint32_t> aiDescriptor;
+    // total size and block size are filled in at the end
+    aiDescriptor.push_back(0);
+    // vendor and descriptor type are both 0 - Khronos, basic
+    aiDescriptor.push_back(0);
+    aiDescriptor.push_back(2);
+    aiDescriptor.push_back(idModel | (ID_KTX_PRIMARIES_BT709 << 8) | (ID_KTX_TRANSFER_LINEAR << 16));
+    // block dimensions are stored minus one
+    const uint32_t dimBlock = bCompressed ? CT_TEXTURE_BLOCK_SIZE - 1 : 0;
+    aiDescriptor.push_back(dimBlock | (dimBlock << 8));
+    aiDescriptor.push_back(GetTextureBlockBytes(idFormat));
+    aiDescriptor.push_back(0);
+
+    switch (idFormat) {
+        case TEXTURE_FORMAT_BC1_RGB:
+        case TEXTURE_FORMAT_BC7:
+            AddDescriptorSample(aiDescriptor, 0, GetTextureBlockBytes(idFormat) * 8, ID_KTX_CHANNEL_RED, 0xFFFFFFFF);
+            break;
+        case TEXTURE_FORMAT_BC3:
+            AddDescriptorSample(aiDescriptor, 0, 64, ID_KTX_CHANNEL_ALPHA, 0xFFFFFFFF);
+            AddDescriptorSample(aiDescriptor, 64, 64, ID_KTX_CHANNEL_RED, 0xFFFFFFFF);
+            break;
+        case TEXTURE_FORMAT_BC5:
+            AddDescriptorSample(aiDescriptor, 0, 64, ID_KTX_CHANNEL_RED, 0xFFFFFFFF);
+            AddDescriptorSample(aiDescriptor, 64, 64, ID_KTX_CHANNEL_GREEN, 0xFFFFFFFF);
+            break;
+        default:
+            AddDescriptorSample(aiDescriptor, 0, 8, ID_KTX_CHANNEL_RED, 255);
+            AddDescriptorSample(aiDescriptor, 8, 8, ID_KTX_CHANNEL_GREEN, 255);
+            AddDescriptorSample(aiDescriptor, 16, 8, ID_KTX_CHANNEL_BLUE, 255);
+            AddDescriptorSample(aiDescriptor, 24, 8, ID_KTX_CHANNEL_ALPHA, 255);
+            break;
+    }
+
+    const uint32_t ctBytes = static_cast<uint32_t>(aiDescriptor.size() * sizeof(uint32_t));
+    aiDescriptor[0] = ctBytes;
+    aiDescriptor[2] |= (ctBytes - sizeof(uint32_t)) << 16;
+    return aiDescriptor;
+}
+
+
+// Round the offset up to the alignment.
+static uint64_t AlignOffset(uint64_t offOffset, uint64_t ctAlignment) {
+    return (offOffset + ctAlignment - 1) / ctAlignment * ctAlignment;
+}
+
+
+// Write a texture with all its mip levels.
+void KtxFileWriter::Write(const std::string &strFilename, enum TextureFormat idFormat, uint32_t dimWidth, uint32_t dimHeight,
+    const std::vector<std::vector<uint8_t>> &aabLevels) {
+
+    const uint32_t ctLevels = static_cast<uint32_t>(aabLevels.size());
+    const std::vector<uint32_t> aiDescriptor = BuildDataFormatDescriptor(idFormat);
+
+    KtxFileHeader hdrHeader = {};
+    hdrHeader.idFormat = idFormat;
+    hdrHeader.ctTypeSize = 1;
+    hdrHeader.dimWidth = dimWidth;
+    hdrHeader.dimHeight = dimHeight;
+    hdrHeader.ctFaces = 1;
+    hdrHeader.ctLevels = ctLevels;
+    hdrHeader.offDataFormatDescriptor = static_cast<uint32_t>(CT_KTX_IDENTIFIER_SIZE + sizeof(KtxFileHeader) + ctLevels * sizeof(KtxFileLevel));
+    hdrHeader.ctDataFormatDescriptorBytes = static_cast<uint32_t>(aiDescriptor.size() * sizeof(uint32_t));
+
+    // levels are stored from the smallest to the largest, so a reader that streams the file gets the low
+    // resolution levels first
+    std::vector<KtxFileLevel> alvlLevels(ctLevels);
+    uint64_t offCurrent = hdrHeader.offDataFormatDescriptor + hdrHeader.ctDataFormatDescriptorBytes;
+    for (uint32_t iLevel = ctLevels; iLevel-- > 0;) {
+        offCurrent = AlignOffset(offCurrent, CT_KTX_LEVEL_ALIGNMENT);
+        alvlLevels[iLevel].offData = offCurrent;
+        alvlLevels[iLevel].ctBytes = aabLevels[iLevel].size();
+        alvlLevels[iLevel].ctUncompressedBytes = aabLevels[iLevel].size();
+        offCurrent += aabLevels[iLevel].size();
+    }
+
+    const std::string strTempFilename = strFilename + ".tmp";
+    std::ofstream fsFile(strTempFilename, std::ios::binary | std::ios::trunc);
+    if (!fsFile.is_open()) {
+        throw std::runtime_error("Failed to create file: " + strTempFilename);
+    }
+    fsFile.write(reinterpret_cast<const char *>(AB_KTX_IDENTIFIER), sizeof(AB_KTX_IDENTIFIER));
+    fsFile.write(reinterpret_cast<const char *>(&hdrHeader), sizeof(hdrHeader));
+    fsFile.write(reinterpret_cast<const char *>(alvlLevels.data()), static_cast<std::streamsize>(alvlLevels.size() * sizeof(KtxFileLevel)));
+    fsFile.write(reinterpret_cast<const char *>(aiDescriptor.data()), static_cast<std::streamsize>(aiDescriptor.size() * sizeof(uint32_t)));
+    offCurrent = hdrHeader.offDataFormatDescriptor + hdrHeader.ctDataFormatDescriptorBytes;
+    for (uint32_t iLevel = ctLevels; iLevel-- > 0;) {
+        static const char achZeros[CT_KTX_LEVEL_ALIGNMENT] = {};
+        fsFile.write(achZeros, static_cast<std::streamsize>(alvlLevels[iLevel].offData - offCurrent));
+        fsFile.write(reinterpret_cast<const char *>(aabLevels[iLevel].data()), static_cast<std::streamsize>(aabLevels[iLevel].size()));
+        offCurrent = alvlLevels[iLevel].offData + alvlLevels[iLevel].ctBytes;
+    }
+    fsFile.close();
+    if (fsFile.fail()) {
+        FileSystem::RemoveFile(strTempFilename);
+        throw std::runtime_error("Failed to write file: " + strTempFilename);
+    }
+
+    FileSystem::ReplaceFile(strTempFilename, strFilename);
+}
+
+
+// Map the texture file and check its header.
+void KtxFile::Open(const std::string &strFilename) {
+    _mfFile.Open(strFilename);
+
+    // check the identifier and the header
+    if (_mfFile.GetSize() < CT_KTX_IDENTIFIER_SIZE + sizeof(KtxFileHeader) || memcmp(_mfFile.GetData(), AB_KTX_IDENTIFIER, CT_KTX_IDENTIFIER_SIZE) != 0) {
+        _mfFile.Close();
+        throw std::runtime_error("Not a KTX2 file: " + strFilename);
+    }
+    const KtxFileHeader &hdrHeader = GetHeader();
+    const enum TextureFormat idFormat = static_cast<enum TextureFormat>(hdrHeader.idFormat);
+    if (GetTextureBlockBytes(idFormat) == 0 || hdrHeader.dimWidth == 0 || hdrHeader.dimHeight == 0 || hdrHeader.dimDepth != 0 ||
+        hdrHeader.ctLayers != 0 || hdrHeader.ctFaces != 1 || hdrHeader.ctLevels == 0 || hdrHeader.ctLevels > 32 ||
+        hdrHeader.idSupercompression != 0) {
+        _mfFile.Close();
+        throw std::runtime_error("Unsupported KTX2 texture: " + strFilename);
+    }
+
+    // check that all levels are inside the file and have the size their format requires
+    const uint64_t offLevelsEnd = CT_KTX_IDENTIFIER_SIZE + sizeof(KtxFileHeader) + hdrHeader.ctLevels * sizeof(KtxFileLevel);
+    if (offLevelsEnd > _mfFile.GetSize()) {
+        _mfFile.Close();
+        throw std::runtime_error("KTX2 file is truncated: " + strFilename);
+    }
+    for (uint32_t iLevel = 0; iLevel < hdrHeader.ctLevels; iLevel++) {
+        const KtxFileLevel &lvlLevel = GetLevelEntry(iLevel);
+        const uint32_t dimLevelWidth = std::max(hdrHeader.dimWidth >> iLevel, 1u);
+        const uint32_t dimLevelHeight = std::max(hdrHeader.dimHeight >> iLevel, 1u);
+        if (lvlLevel.offData > _mfFile.GetSize() || lvlLevel.ctBytes > _mfFile.GetSize() - lvlLevel.offData ||
+            lvlLevel.ctBytes != GetTextureImageBytes(idFormat, dimLevelWidth, dimLevelHeight)) {
+            _mfFile.Close();
+            throw std::runtime_error("KTX2 file is truncated: " + strFilename);
+        }
+    }
+}
+
+
+// Get the data of a mip level and its size in bytes.
+const uint8_t *KtxFile::GetLevel(uint32_t iLevel, uint64_t &ctBytes) const {
+    const KtxFileLevel &lvlLevel = GetLevelEntry(iLevel);
+    ctBytes = lvlLevel.ctBytes;
+    return reinterpret_cast<const uint8_t *>(_mfFile.GetData() + lvlLevel.offData);
+}
+
+
+// Is the file a texture the engine can load?
+bool KtxFile::IsValid(const std::string &strFilename) {
+    try {
+        KtxFile ktxFile;
+        ktxFile.Open(strFilename);
+        return true;
+    }
+    catch (const std::runtime_error &) {
+        return false;
+    }
+}
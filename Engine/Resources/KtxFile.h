@@ -0,0 +1,86 @@
+#pragma once
+#include "../Platform/MappedFile.h"
+#include "TextureFormat.h"
+
+// Header of a KTX2 file, follows the 12 byte file identifier.
+struct KtxFileHeader {
+    // Format of the texel data, a VkFormat value.
+    uint32_t idFormat;
+    // Size of the data type for endianness conversion, 1 for block compressed and byte formats.
+    uint32_t ctTypeSize;
+    uint32_t dimWidth;
+    uint32_t dimHeight;
+    // Depth, layers and faces - engine textures are always plain 2D, so 0, 0 and 1.
+    uint32_t dimDepth;
+    uint32_t ctLayers;
+    uint32_t ctFaces;
+    uint32_t ctLevels;
+    // Supercompression applied to the levels, the engine only uses 0 - none.
+    uint32_t idSupercompression;
+
+    // Location of the data format descriptor and the key/value data.
+    uint32_t offDataFormatDescriptor;
+    uint32_t ctDataFormatDescriptorBytes;
+    uint32_t offKeyValueData;
+    uint32_t ctKeyValueDataBytes;
+    // 64 bit offset and size of the supercompression data, unused. Stored as halves because the header follows the
+    // identifier and isn't 8 byte aligned.
+    uint32_t aiSupercompressionData[4];
+};
+static_assert(sizeof(KtxFileHeader) == 68, "KtxFileHeader must match the KTX2 header layout");
+
+// Entry in the level index of a KTX2 file, one per mip level starting with the full resolution level.
+struct KtxFileLevel {
+    uint64_t offData;
+    uint64_t ctBytes;
+    uint64_t ctUncompressedBytes;
+};
+
+// Size of the identifier that starts every KTX2 file.
+static const uint32_t CT_KTX_IDENTIFIER_SIZE = 12;
+// Alignment of level data inside the file, a multiple of every block size the engine writes.
+static const uint64_t CT_KTX_LEVEL_ALIGNMENT = 16;
+
+
+// Writes textures as KTX2 files. The file is written to a temporary file that replaces the target only when it is
+// complete, so a failed import never leaves a half written texture.
+class KtxFileWriter {
+public:
+    // Write a texture with all its mip levels, the full resolution level first. Throws if the file can't be written.
+    static void Write(const std::string &strFilename, enum TextureFormat idFormat, uint32_t dimWidth, uint32_t dimHeight,
+        const std::vector<std::vector<uint8_t>> &aabLevels);
+};
+
+
+// Read-only access to a KTX2 file written by the engine. The file is memory mapped and levels are used in place.
+class KtxFile {
+public:
+    // Map the texture file and check its header. Throws if the file is not a texture the engine can load.
+    void Open(const std::string &strFilename);
+    // Unmap the file.
+    void Close() { _mfFile.Close(); }
+
+    // Get the format of the texture.
+    enum TextureFormat GetFormat() const { return static_cast<enum TextureFormat>(GetHeader().idFormat); }
+    // Get the size of the full resolution level.
+    uint32_t GetWidth() const { return GetHeader().dimWidth; }
+    uint32_t GetHeight() const { return GetHeader().dimHeight; }
+    // Get the number of mip levels in the file.
+    uint32_t GetLevelCount() const { return GetHeader().ctLevels; }
+    // Get the data of a mip level and its size in bytes.
+    const uint8_t *GetLevel(uint32_t iLevel, uint64_t &ctBytes) const;
+
+    // Is the file a texture the engine can load? Doesn't throw.
+    static bool IsValid(const std::string &strFilename);
+
+private:
+    const KtxFileHeader &GetHeader() const {
+        return *reinterpret_cast<const KtxFileHeader *>(_mfFile.GetData() + CT_KTX_IDENTIFIER_SIZE);
+    }
+    const KtxFileLevel &GetLevelEntry(uint32_t iLevel) const {
+        return reinterpret_cast<const KtxFileLevel *>(_mfFile.GetData() + CT_KTX_IDENTIFIER_SIZE + sizeof(KtxFileHeader))[iLevel];
+    }
+
+private:
+    MappedFile _mfFile;
+};
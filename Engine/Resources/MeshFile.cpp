@@ -0,0 +1,171 @@
+#include "../PrecompiledHeader.h"
+#include "MeshFile.h"
+
+#include <stdexcept>
+#include <cstring>
+
+#include "../Platform/FileSystem.h"
+
+
+MeshFileWriter::MeshFileWriter() :
+    _hdrHeader(), _offCurrent(0)
+{
+}
+
+
+MeshFileWriter::~MeshFileWriter() {
+    // a writer that wasn't closed didn't produce a complete file, throw the partial one away
+    if (_fsFile.is_open()) {
+        _fsFile.close();
+        FileSystem::RemoveFile(_strTempFilename);
+    }
+}
+
+
+// Start writing a mesh file.
+void MeshFileWriter::Open(const std::string &strFilename) {
+    _strFilename = strFilename;
+    _strTempFilename = strFilename + ".tmp";
+    _fsFile.open(_strTempFilename, std::ios::binary | std::ios::trunc);
+    if (!_fsFile.is_open()) {
+        throw std::runtime_error("Failed to create file: " + _strTempFilename);
+    }
+
+    // reserve the space for the header, it is filled in when the file is closed
+    _hdrHeader = {};
+    _hdrHeader.idMagic = ID_MESH_FILE_MAGIC;
+    _hdrHeader.idVersion = ID_MESH_FILE_VERSION;
+    _offCurrent = 0;
+    const MeshFileHeader hdrEmpty = {};
+    _fsFile.write(reinterpret_cast<const char *>(&hdrEmpty), sizeof(hdrEmpty));
+    _offCurrent += sizeof(hdrEmpty);
+}
+
+
+// Start a new section.
+void MeshFileWriter::BeginSection(enum MeshSectionType idType, uint32_t ctElementSize) {
+    if (_hdrHeader.ctSections == CT_MESH_MAX_SECTIONS) {
+        throw std::runtime_error("Too many sections in mesh file: " + _strFilename);
+    }
+
+    Align(CT_MESH_SECTION_ALIGNMENT);
+    MeshFileSection &secSection = _hdrHeader.asecSections[_hdrHeader.ctSections++];
+    secSection.idType = idType;
+    secSection.ctElementSize = ctElementSize;
+    secSection.offData = _offCurrent;
+    secSection.ctElements = 0;
+}
+
+
+// Append elements to the current section.
+void MeshFileWriter::Write(const void *pData, uint64_t ctElements) {
+    if (_hdrHeader.ctSections == 0) {
+        throw std::runtime_error("Mesh data written outside of a section: " + _strFilename);
+    }
+    MeshFileSection &secSection = _hdrHeader.asecSections[_hdrHeader.ctSections - 1];
+    const uint64_t ctBytes = ctElements * secSection.ctElementSize;
+    _fsFile.write(static_cast<const char *>(pData), static_cast<std::streamsize>(ctBytes));
+    secSection.ctElements += ctElements;
+    _offCurrent += ctBytes;
+}
+
+
+// Finish the file and move it over the target.
+void MeshFileWriter::Close() {
+    // write the final header over the placeholder
+    _fsFile.seekp(0);
+    _fsFile.write(reinterpret_cast<const char *>(&_hdrHeader), sizeof(_hdrHeader));
+    _fsFile.close();
+    if (_fsFile.fail()) {
+        FileSystem::RemoveFile(_strTempFilename);
+        throw std::runtime_error("Failed to write file: " + _strTempFilename);
+    }
+
+    FileSystem::ReplaceFile(_strTempFilename, _strFilename);
+}
+
+
+// Pad the file with zeros up to the alignment.
+void MeshFileWriter::Align(uint64_t ctAlignment) {
+    static const char achZeros[CT_MESH_SECTION_ALIGNMENT] = {};
+    const uint64_t ctPadding = (ctAlignment - _offCurrent % ctAlignment) % ctAlignment;
+    _fsFile.write(achZeros, static_cast<std::streamsize>(ctPadding));
+    _offCurrent += ctPadding;
+}
+
+
+// Map the mesh file and check its header.
+void MeshFile::Open(const std::string &strFilename) {
+    _mfFile.Open(strFilename);
+    try {
+        Open(_mfFile.GetData(), _mfFile.GetSize(), strFilename);
+    }
+    catch (const std::runtime_error &) {
+        _mfFile.Close();
+        throw;
+    }
+}
+
+
+// Use a mesh that is already in memory and check its header.
+void MeshFile::Open(const char *pchData, uint64_t ctBytes, const std::string &strName) {
+    // check the header
+    const MeshFileHeader *phdrHeader = reinterpret_cast<const MeshFileHeader *>(pchData);
+    if (ctBytes < sizeof(MeshFileHeader) || phdrHeader->idMagic != ID_MESH_FILE_MAGIC) {
+        throw std::runtime_error("Not a mesh file: " + strName);
+    }
+    if (phdrHeader->idVersion != ID_MESH_FILE_VERSION || phdrHeader->ctSections > CT_MESH_MAX_SECTIONS) {
+        throw std::runtime_error("Unsupported mesh file version: " + strName);
+    }
+
+    // check that all sections are inside the file
+    for (uint32_t iSection = 0; iSection < phdrHeader->ctSections; iSection++) {
+        const MeshFileSection &secSection = phdrHeader->asecSections[iSection];
+        const uint64_t ctSectionBytes = secSection.ctElements * secSection.ctElementSize;
+        if (secSection.offData > ctBytes || ctSectionBytes > ctBytes - secSection.offData) {
+            throw std::runtime_error("Mesh file is truncated: " + strName);
+        }
+    }
+    _pchData = pchData;
+    _ctBytes = ctBytes;
+}
+
+
+// Stop using the mesh, and unmap the file if it was mapped.
+void MeshFile::Close() {
+    _mfFile.Close();
+    _pchData = nullptr;
+    _ctBytes = 0;
+}
+
+
+// Get a section of the given type, nullptr if the file doesn't have one.
+const void *MeshFile::GetSection(enum MeshSectionType idType, uint32_t ctElementSize, uint64_t &ctElements) const {
+    ctElements = 0;
+    const MeshFileHeader *phdrHeader = reinterpret_cast<const MeshFileHeader *>(_pchData);
+    for (uint32_t iSection = 0; iSection < phdrHeader->ctSections; iSection++) {
+        const MeshFileSection &secSection = phdrHeader->asecSections[iSection];
+        if (secSection.idType != static_cast<uint32_t>(idType)) {
+            continue;
+        }
+        if (secSection.ctElementSize != ctElementSize) {
+            throw std::runtime_error("Mesh file section has unexpected element size");
+        }
+        ctElements = secSection.ctElements;
+        return _pchData + secSection.offData;
+    }
+    return nullptr;
+}
+
+
+// Is the file a valid mesh of the current version?
+bool MeshFile::IsValid(const std::string &strFilename) {
+    try {
+        MeshFile meshFile;
+        meshFile.Open(strFilename);
+        return true;
+    }
+    catch (const std::runtime_error &) {
+        return false;
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "../Platform/MappedFile.h"
+
+// Types of data sections a mesh file can hold.
+enum MeshSectionType {
+    MESH_SECTION_INVALID = 0,
+    // Array of Vertex structures.
+    MESH_SECTION_VERTICES = 1,
+    // Array of 32 bit indices into the vertex array, three per triangle.
+    MESH_SECTION_INDICES = 2,
+    // Array of Meshlet structures, each covering a range of the index array.
+    MESH_SECTION_MESHLETS = 3,
+    // Array of MeshLod structures, from the full resolution level to the coarsest.
+    MESH_SECTION_LODS = 4,
+    // Array of MeshSubmesh structures, the submeshes of each level of detail one after another.
+    MESH_SECTION_SUBMESHES = 5,
+    // Array of MeshMaterial structures.
+    MESH_SECTION_MATERIALS = 6,
+};
+
+// Entry in the section table of a mesh file.
+struct MeshFileSection {
+    // Type of data in the section, one of MeshSectionType.
+    uint32_t idType;
+    // Size of one element, so readers can check they agree on the layout.
+    uint32_t ctElementSize;
+    // Offset of the section data from the start of the file, aligned to CT_MESH_SECTION_ALIGNMENT.
+    uint64_t offData;
+    // Number of elements in the section.
+    uint64_t ctElements;
+};
+
+// Identifies the file as an engine mesh, 'GMSH'.
+static const uint32_t ID_MESH_FILE_MAGIC = 0x48534D47;
+// Version of the mesh file format, files with other versions are reimported.
+static const uint32_t ID_MESH_FILE_VERSION = 4;
+// Most sections a mesh file can have.
+static const uint32_t CT_MESH_MAX_SECTIONS = 16;
+// Alignment of section data inside the file.
+static const uint64_t CT_MESH_SECTION_ALIGNMENT = 16;
+
+// Header at the start of every mesh file.
+struct MeshFileHeader {
+    uint32_t idMagic;
+    uint32_t idVersion;
+    uint32_t ctSections;
+    uint32_t iReserved;
+    MeshFileSection asecSections[CT_MESH_MAX_SECTIONS];
+};
+
+
+// Writes the engine mesh format incrementally. Sections are written one after another and each section can be
+// appended to in pieces, so a mesh never has to be held in memory as a whole. The data goes to a temporary file
+// that replaces the target only when the writer is closed, so a failed import never leaves a half written mesh.
+class MeshFileWriter {
+public:
+    MeshFileWriter();
+    ~MeshFileWriter();
+
+    // Start writing a mesh file. Throws if the file can't be created.
+    void Open(const std::string &strFilename);
+    // Start a new section. The previous section, if any, is finished.
+    void BeginSection(enum MeshSectionType idType, uint32_t ctElementSize);
+    // Append elements to the current section.
+    void Write(const void *pData, uint64_t ctElements);
+    // Finish the file and move it over the target. Throws if the file can't be written.
+    void Close();
+
+    // Write a whole section from a vector, convenience for meshes that are in memory.
+    template<class Element>
+    void WriteSection(enum MeshSectionType idType, const std::vector<Element> &aElements) {
+        BeginSection(idType, sizeof(Element));
+        Write(aElements.data(), aElements.size());
+    }
+
+public:
+    // Forbid copying, the writer owns its file.
+    MeshFileWriter(MeshFileWriter const &) = delete;
+    void operator = (MeshFileWriter const &) = delete;
+
+private:
+    // Pad the file with zeros up to the alignment.
+    void Align(uint64_t ctAlignment);
+
+private:
+    // Name of the target file, and of the temporary file that is being written.
+    std::string _strFilename;
+    std::string _strTempFilename;
+    std::ofstream _fsFile;
+    // Header with the section table, written at the start of the file on close.
+    MeshFileHeader _hdrHeader;
+    // Current write position in the file.
+    uint64_t _offCurrent;
+};
+
+
+// Read-only access to an engine mesh file. The file is memory mapped and sections are used in place.
+class MeshFile {
+public:
+    // Map the mesh file and check its header. Throws if the file is not a valid mesh of the current version.
+    void Open(const std::string &strFilename);
+    // Use a mesh that is already in memory, e.g. in a mapped asset package, and check its header. The memory must
+    // outlive the mesh file. Throws if it is not a valid mesh of the current version.
+    void Open(const char *pchData, uint64_t ctBytes, const std::string &strName);
+    // Stop using the mesh, and unmap the file if it was mapped.
+    void Close();
+
+    // Get a section of the given type, nullptr if the file doesn't have one. Throws if the element size doesn't match.
+    const void *GetSection(enum MeshSectionType idType, uint32_t ctElementSize, uint64_t &ctElements) const;
+
+    // Copy a whole section into a vector. The section is left empty if the file doesn't have one.
+    template<class Element>
+    void ReadSection(enum MeshSectionType idType, std::vector<Element> &aElements) const {
+        uint64_t ctElements = 0;
+        const Element *pElements = static_cast<const Element *>(GetSection(idType, sizeof(Element), ctElements));
+        aElements.assign(pElements, pElements + ctElements);
+    }
+
+    // Is the file a valid mesh of the current version? Doesn't throw.
+    static bool IsValid(const std::string &strFilename);
+
+private:
+    MappedFile _mfFile;
+    // The mesh, in the mapped file or in memory the caller owns.
+    const char *_pchData = nullptr;
+    uint64_t _ctBytes = 0;
+};
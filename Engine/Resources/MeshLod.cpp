@@ -0,0 +1,32 @@
+#include "../PrecompiledHeader.h"
+#include "MeshLod.h"
+
+#include "../Config/Options.h"
+
+// Closest distance used when projecting errors, so instances around the camera don't divide by zero.
+static const float F_MIN_LOD_DISTANCE = 0.01f;
+
+
+// Select the level for the instance and return it.
+uint32_t LodSelector::Select(const std::vector<MeshLod> &alodLods, float fDistance, float fScale, float fPixelsPerUnit) {
+    if (alodLods.empty()) {
+        _iLod = 0;
+        return _iLod;
+    }
+    _iLod = std::min(_iLod, static_cast<uint32_t>(alodLods.size() - 1));
+
+    // size of the error of a level on screen, in pixels
+    const float fPixelsPerError = fScale * fPixelsPerUnit / std::max(fDistance, F_MIN_LOD_DISTANCE);
+    const float fThreshold = Options::Get().GetLodErrorThreshold();
+    const float fCoarserThreshold = fThreshold * (1.0f - Options::Get().GetLodHysteresis());
+
+    // move to finer levels while the current one is visibly wrong
+    while (_iLod > 0 && alodLods[_iLod].fError * fPixelsPerError > fThreshold) {
+        _iLod--;
+    }
+    // move to coarser levels only while the next one is well below the threshold
+    while (_iLod + 1 < alodLods.size() && alodLods[_iLod + 1].fError * fPixelsPerError <= fCoarserThreshold) {
+        _iLod++;
+    }
+    return _iLod;
+}
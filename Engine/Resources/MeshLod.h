@@ -0,0 +1,36 @@
+#pragma once
+
+// One level of detail of a mesh. All levels share the vertex buffer, each has its own range of the index buffer, of
+// the submeshes and of the meshlets. Level 0 is the full resolution mesh and each following level has about half the
+// triangles.
+struct MeshLod {
+    // Range of the level's triangles in the mesh index buffer.
+    uint32_t iFirstIndex;
+    uint32_t ctIndices;
+    // Range of the level's meshlets in the mesh meshlet array.
+    uint32_t iFirstMeshlet;
+    uint32_t ctMeshlets;
+    // Range of the level's submeshes in the mesh submesh array.
+    uint32_t iFirstSubmesh;
+    uint32_t ctSubmeshes;
+    // Bound on the distance of the level's surface from the full resolution surface, in model units.
+    float fError;
+    uint32_t iReserved;
+};
+
+
+// Selects the level of detail of one mesh instance from the size its error would have on screen. The selected level
+// is kept between frames, and it moves to a coarser level only once that level's error is clearly below the
+// threshold, so an instance hovering around a switching distance doesn't keep popping between two levels.
+class LodSelector {
+public:
+    // Select the level for the instance and return it. fDistance is the distance from the camera to the instance's
+    // bounds, fScale the largest scale of the instance transform and fPixelsPerUnit the height in pixels of one unit
+    // seen at the distance of one unit.
+    uint32_t Select(const std::vector<MeshLod> &alodLods, float fDistance, float fScale, float fPixelsPerUnit);
+    // Get the currently selected level.
+    uint32_t GetLod() const { return _iLod; }
+
+private:
+    uint32_t _iLod = 0;
+};
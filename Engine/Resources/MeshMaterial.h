@@ -0,0 +1,14 @@
+#pragma once
+
+// Longest material name and texture path a mesh file can hold, including the terminating zero.
+static const uint32_t CT_MATERIAL_NAME_LENGTH = 64;
+static const uint32_t CT_MATERIAL_PATH_LENGTH = 192;
+
+// A material used by a mesh, as stored in the mesh file.
+struct MeshMaterial {
+    // Name of the material in the source file, empty for the default material.
+    char strName[CT_MATERIAL_NAME_LENGTH];
+    // Path of the diffuse texture, relative to the directory of the mesh file. Empty if the material has no texture,
+    // the default texture is used then.
+    char strDiffuseTexture[CT_MATERIAL_PATH_LENGTH];
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+// A part of a mesh drawn with one material. Submeshes share the mesh's vertex and index buffers and each one covers a
+// range of the indices. The submeshes of a level of detail are sorted by material, so the parts that use the same
+// material can be drawn one after another without rebinding it.
+struct MeshSubmesh {
+    // Range of the submesh's triangles in the mesh index buffer.
+    uint32_t iFirstIndex;
+    uint32_t ctIndices;
+    // Added to the indices when drawing. Indices of imported meshes refer to the whole vertex buffer, so it is 0 for them.
+    int32_t iVertexOffset;
+    // Index of the submesh's material in the mesh's material array.
+    uint32_t idMaterial;
+    // Range of the submesh's meshlets in the mesh meshlet array.
+    uint32_t iFirstMeshlet;
+    uint32_t ctMeshlets;
+    uint32_t aiReserved[2];
+};
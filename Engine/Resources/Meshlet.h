@@ -0,0 +1,23 @@
+#pragma once
+
+// Most vertices a meshlet can reference.
+static const uint32_t CT_MESHLET_MAX_VERTICES = 64;
+// Most triangles a meshlet can hold.
+static const uint32_t CT_MESHLET_MAX_TRIANGLES = 124;
+
+// A small cluster of neighbouring triangles that is culled as a unit. Its triangles are a contiguous range of the
+// mesh index buffer. The layout matches the meshlet buffer in cull.comp, so it is uploaded as is.
+struct Meshlet {
+    // Bounding sphere, center in xyz and radius in w.
+    glm::vec4 sphBounds;
+    // Cone that contains the normals of all triangles, axis in xyz and the sine of its half angle in w.
+    // All triangles face away from viewers that see the meshlet from inside the cone. A cutoff of 1 disables the test.
+    glm::vec4 vecConeAxisCutoff;
+    // Range of the meshlet's triangles in the mesh index buffer.
+    uint32_t iFirstIndex;
+    uint32_t ctIndices;
+    // Number of distinct vertices the triangles use.
+    uint32_t ctVertices;
+    // Index of the submesh the meshlet belongs to.
+    uint32_t iSubmesh;
+};
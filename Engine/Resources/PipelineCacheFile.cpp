@@ -0,0 +1,84 @@
+#include "../PrecompiledHeader.h"
+#include "PipelineCacheFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "../Platform/FileSystem.h"
+#include "../Platform/MappedFile.h"
+
+
+// Read the cache data saved for the device.
+bool PipelineCacheFile::Read(const std::string &strFilename, const PipelineCacheFileHeader &hdrDevice, std::vector<char> &achData) {
+    achData.clear();
+    if (!FileSystem::FileExists(strFilename)) {
+        return false;
+    }
+
+    MappedFile mfFile;
+    try {
+        mfFile.Open(strFilename);
+    }
+    catch (const std::runtime_error &) {
+        return false;
+    }
+    if (mfFile.GetSize() < sizeof(PipelineCacheFileHeader)) {
+        return false;
+    }
+
+    PipelineCacheFileHeader hdrHeader;
+    memcpy(&hdrHeader, mfFile.GetData(), sizeof(hdrHeader));
+    if (hdrHeader.idMagic != ID_PIPELINE_CACHE_FILE_MAGIC || hdrHeader.idVersion != ID_PIPELINE_CACHE_FILE_VERSION) {
+        return false;
+    }
+    // data from another device or driver would be rejected or, with some drivers, misused
+    if (hdrHeader.idVendor != hdrDevice.idVendor || hdrHeader.idDevice != hdrDevice.idDevice || hdrHeader.idDriverVersion != hdrDevice.idDriverVersion
+        || memcmp(hdrHeader.auuidPipelineCache, hdrDevice.auuidPipelineCache, CT_PIPELINE_CACHE_UUID_SIZE) != 0) {
+        return false;
+    }
+    const char *pchData = mfFile.GetData() + sizeof(PipelineCacheFileHeader);
+    if (hdrHeader.ctDataBytes != mfFile.GetSize() - sizeof(PipelineCacheFileHeader) || hdrHeader.idDataHash != HashData(pchData, hdrHeader.ctDataBytes)) {
+        return false;
+    }
+
+    achData.assign(pchData, pchData + hdrHeader.ctDataBytes);
+    return true;
+}
+
+
+// Save the cache data for the device.
+void PipelineCacheFile::Write(const std::string &strFilename, const PipelineCacheFileHeader &hdrDevice, const std::vector<char> &achData) {
+    PipelineCacheFileHeader hdrHeader = hdrDevice;
+    hdrHeader.idMagic = ID_PIPELINE_CACHE_FILE_MAGIC;
+    hdrHeader.idVersion = ID_PIPELINE_CACHE_FILE_VERSION;
+    hdrHeader.ctDataBytes = achData.size();
+    hdrHeader.idDataHash = HashData(achData.data(), achData.size());
+
+    const std::string strTempFilename = strFilename + ".tmp";
+    {
+        std::ofstream fsFile(strTempFilename, std::ios::binary | std::ios::trunc);
+        if (!fsFile.is_open()) {
+            throw std::runtime_error("Failed to create file: " + strTempFilename);
+        }
+        fsFile.write(reinterpret_cast<const char *>(&hdrHeader), sizeof(hdrHeader));
+        fsFile.write(achData.data(), static_cast<std::streamsize>(achData.size()));
+        fsFile.close();
+        if (!fsFile) {
+            throw std::runtime_error("Failed to write file: " + strTempFilename);
+        }
+    }
+
+    FileSystem::ReplaceFile(strTempFilename, strFilename);
+}
+
+
+// Hash the cache data, FNV-1a.
+uint64_t PipelineCacheFile::HashData(const char *pchData, uint64_t ctBytes) {
+    uint64_t idHash = 0xCBF29CE484222325ULL;
+    for (uint64_t iByte = 0; iByte < ctBytes; iByte++) {
+        idHash ^= static_cast<uint8_t>(pchData[iByte]);
+        idHash *= 0x100000001B3ULL;
+    }
+    return idHash;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Identifies the file as a pipeline cache saved by the engine, 'GPCC'.
+static const uint32_t ID_PIPELINE_CACHE_FILE_MAGIC = 0x43435047;
+// Version of the pipeline cache file format, files with other versions are thrown away.
+static const uint32_t ID_PIPELINE_CACHE_FILE_VERSION = 1;
+// Size of the pipeline cache UUID of a device, VK_UUID_SIZE.
+static const uint32_t CT_PIPELINE_CACHE_UUID_SIZE = 16;
+
+// Header at the start of every pipeline cache file, followed by the data the driver returned for the cache. The
+// driver's own header inside the data identifies the device, but not the driver version, so the engine keeps its own.
+struct PipelineCacheFileHeader {
+    uint32_t idMagic;
+    uint32_t idVersion;
+    // Device and driver the data was created with.
+    uint32_t idVendor;
+    uint32_t idDevice;
+    uint32_t idDriverVersion;
+    uint8_t auuidPipelineCache[CT_PIPELINE_CACHE_UUID_SIZE];
+    // Size and hash of the data, a truncated or damaged file is thrown away.
+    uint64_t ctDataBytes;
+    uint64_t idDataHash;
+};
+
+
+// Reads and writes the pipeline cache of a device, so pipelines aren't compiled from scratch on every start. Doesn't
+// know about Vulkan, the caller fills in the identity of the device and passes the data around.
+class PipelineCacheFile {
+public:
+    // Read the cache data saved for the device whose identity is in the header. Returns false and leaves the data
+    // empty if the file is missing, damaged or was saved with another device, driver or format version.
+    static bool Read(const std::string &strFilename, const PipelineCacheFileHeader &hdrDevice, std::vector<char> &achData);
+    // Save the cache data for the device whose identity is in the header. The data goes to a temporary file that
+    // replaces the target in a single step, so a crash never leaves a half written cache. Throws on failure.
+    static void Write(const std::string &strFilename, const PipelineCacheFileHeader &hdrDevice, const std::vector<char> &achData);
+
+private:
+    // Hash the cache data.
+    static uint64_t HashData(const char *pchData, uint64_t ctBytes);
+};
@@ -0,0 +1,60 @@
+#include "../PrecompiledHeader.h"
+#include "StagingRing.h"
+
+
+// Set the size of the buffer, in bytes.
+void StagingRing::Initialize(uint64_t ctSize) {
+    _ctSize = ctSize;
+    _aallocAllocations.clear();
+}
+
+
+// Allocate a range of bytes at an offset that is a multiple of the alignment.
+bool StagingRing::Allocate(uint64_t ctBytes, uint64_t ctAlignment, uint64_t &iOffset) {
+    if (ctBytes > _ctSize) {
+        return false;
+    }
+
+    // an empty ring starts over from the start of the buffer
+    if (_aallocAllocations.empty()) {
+        iOffset = 0;
+        _aallocAllocations.push_back({ 0, ctBytes, false });
+        return true;
+    }
+
+    // the used room goes from the start of the oldest allocation to the end of the newest one, it has wrapped around
+    // if the newest one ends before the oldest one starts
+    const uint64_t iTail = _aallocAllocations.front().iOffset;
+    const uint64_t iHead = _aallocAllocations.back().iEnd;
+    uint64_t iStart = (iHead + ctAlignment - 1) & ~(ctAlignment - 1);
+    if (iHead > iTail) {
+        // try after the newest allocation, then from the start of the buffer
+        if (iStart + ctBytes > _ctSize) {
+            iStart = 0;
+            if (ctBytes > iTail) {
+                return false;
+            }
+        }
+    } else if (iStart + ctBytes > iTail) {
+        return false;
+    }
+
+    iOffset = iStart;
+    _aallocAllocations.push_back({ iStart, iStart + ctBytes, false });
+    return true;
+}
+
+
+// Free the allocation at the offset.
+void StagingRing::Free(uint64_t iOffset) {
+    auto itAllocation = std::find_if(_aallocAllocations.begin(), _aallocAllocations.end(), [iOffset](const Allocation &allocAllocation) {
+        return allocAllocation.iOffset == iOffset && !allocAllocation.bFreed;
+    });
+    assert(itAllocation != _aallocAllocations.end());
+    itAllocation->bFreed = true;
+
+    // the room comes back from the oldest allocation on, up to the first one still in use
+    while (!_aallocAllocations.empty() && _aallocAllocations.front().bFreed) {
+        _aallocAllocations.pop_front();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <deque>
+
+// Sub-allocates one staging buffer as a ring. Allocations are taken after the newest one, wrapping around to the start
+// of the buffer, and their room comes back once they are freed, oldest first - an allocation freed early waits for the
+// ones made before it. The ring only keeps the books - the renderer owns the buffer and frees an allocation once the
+// GPU has copied out of it.
+class StagingRing {
+public:
+    // Set the size of the buffer, in bytes. Forgets all allocations.
+    void Initialize(uint64_t ctSize);
+    // Allocate a range of bytes at an offset that is a multiple of the alignment, a power of two. Returns false if
+    // there isn't enough free room in one piece, and always if the range is larger than the buffer.
+    bool Allocate(uint64_t ctBytes, uint64_t ctAlignment, uint64_t &iOffset);
+    // Free the allocation at the offset.
+    void Free(uint64_t iOffset);
+
+    // Get the size of the buffer, in bytes.
+    uint64_t GetSize() const { return _ctSize; }
+    // Are there no allocations?
+    bool IsEmpty() const { return _aallocAllocations.empty(); }
+
+private:
+    // A range of the buffer that was allocated.
+    struct Allocation {
+        uint64_t iOffset;
+        uint64_t iEnd;
+        bool bFreed;
+    };
+
+private:
+    // Allocations from the oldest to the newest.
+    std::deque<Allocation> _aallocAllocations;
+    uint64_t _ctSize = 0;
+};
@@ -0,0 +1,35 @@
+#include "../PrecompiledHeader.h"
+#include "TextureArrayPacker.h"
+
+#include <map>
+#include <tuple>
+
+
+// Pack the textures no larger than dimMaxSize along the longer side into arrays of at most ctMaxLayers layers.
+uint32_t TextureArrayPacker::Pack(const std::vector<TextureLayout> &alayTextures, uint32_t dimMaxSize, uint32_t ctMaxLayers, std::vector<TexturePlacement> &aplcPlacements) {
+    aplcPlacements.assign(alayTextures.size(), TexturePlacement{ ID_TEXTURE_NOT_PACKED, 0 });
+
+    // gather the small textures by layout, a map keeps the arrays in a stable order
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>, std::vector<uint32_t>> mapGroups;
+    for (uint32_t iTexture = 0; iTexture < alayTextures.size(); iTexture++) {
+        const TextureLayout &layTexture = alayTextures[iTexture];
+        if (std::max(layTexture.dimWidth, layTexture.dimHeight) > dimMaxSize) {
+            continue;
+        }
+        mapGroups[std::make_tuple(layTexture.idFormat, layTexture.dimWidth, layTexture.dimHeight, layTexture.ctLevels)].push_back(iTexture);
+    }
+
+    // split each group into arrays of up to the most layers, a texture left alone at the end keeps its own image
+    uint32_t ctArrays = 0;
+    for (const auto &pairGroup : mapGroups) {
+        const std::vector<uint32_t> &aiTextures = pairGroup.second;
+        for (size_t iFirst = 0; iFirst + 1 < aiTextures.size(); iFirst += ctMaxLayers) {
+            const size_t ctLayers = std::min<size_t>(ctMaxLayers, aiTextures.size() - iFirst);
+            for (uint32_t iLayer = 0; iLayer < ctLayers; iLayer++) {
+                aplcPlacements[aiTextures[iFirst + iLayer]] = TexturePlacement{ ctArrays, iLayer };
+            }
+            ctArrays++;
+        }
+    }
+    return ctArrays;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// Array index of a texture that wasn't packed into an array.
+static const uint32_t ID_TEXTURE_NOT_PACKED = UINT32_MAX;
+
+// Groups small textures into texture arrays. Textures in an array must match in format, size and number of levels, so
+// each one fills a whole layer and needs neither remapped texture coordinates nor gutters against bleeding between
+// neighbours in the coarser levels. Materials whose textures share an array can share one image and one descriptor
+// set, and select their texture by the layer.
+class TextureArrayPacker {
+public:
+    // Layout of a texture, the textures of an array all have the same one.
+    struct TextureLayout {
+        uint32_t idFormat;
+        uint32_t dimWidth;
+        uint32_t dimHeight;
+        uint32_t ctLevels;
+    };
+    // Where a texture ended up.
+    struct TexturePlacement {
+        // Array the texture is in, ID_TEXTURE_NOT_PACKED if it keeps an image of its own.
+        uint32_t iArray;
+        // Layer of the array that holds the texture.
+        uint32_t iLayer;
+    };
+
+    // Pack the textures no larger than dimMaxSize along the longer side into arrays of at most ctMaxLayers layers.
+    // Textures that are larger, or have no other texture of their layout to share an array with, aren't packed. The
+    // layers of an array are in the order of the textures. Returns the number of arrays.
+    static uint32_t Pack(const std::vector<TextureLayout> &alayTextures, uint32_t dimMaxSize, uint32_t ctMaxLayers, std::vector<TexturePlacement> &aplcPlacements);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+// Formats engine textures are stored in. The values are the matching VkFormat values, which is also how KTX2 files
+// identify their format.
+enum TextureFormat {
+    TEXTURE_FORMAT_INVALID = 0,
+    // Uncompressed, four bytes per texel.
+    TEXTURE_FORMAT_RGBA8 = 37,
+    // Opaque color, 8 bytes per 4x4 block.
+    TEXTURE_FORMAT_BC1_RGB = 131,
+    // Color with smooth alpha, 16 bytes per block - a BC4 alpha block followed by a BC1 color block.
+    TEXTURE_FORMAT_BC3 = 137,
+    // Two independent channels, e.g. normal map XY, 16 bytes per block - two BC4 blocks.
+    TEXTURE_FORMAT_BC5 = 141,
+    // High quality color with alpha, 16 bytes per block.
+    TEXTURE_FORMAT_BC7 = 145,
+};
+
+// Width and height of a compressed block, in texels.
+static const uint32_t CT_TEXTURE_BLOCK_SIZE = 4;
+
+// Is the format block compressed?
+static inline bool IsBlockCompressed(enum TextureFormat idFormat) {
+    return idFormat == TEXTURE_FORMAT_BC1_RGB || idFormat == TEXTURE_FORMAT_BC3 || idFormat == TEXTURE_FORMAT_BC5 || idFormat == TEXTURE_FORMAT_BC7;
+}
+
+// Get the size of one block of a compressed format, or of one texel of an uncompressed one, in bytes.
+static inline uint32_t GetTextureBlockBytes(enum TextureFormat idFormat) {
+    switch (idFormat) {
+        case TEXTURE_FORMAT_RGBA8: return 4;
+        case TEXTURE_FORMAT_BC1_RGB: return 8;
+        case TEXTURE_FORMAT_BC3: return 16;
+        case TEXTURE_FORMAT_BC5: return 16;
+        case TEXTURE_FORMAT_BC7: return 16;
+        default: return 0;
+    }
+}
+
+// Get the size of an image of the format, in bytes.
+static inline uint64_t GetTextureImageBytes(enum TextureFormat idFormat, uint32_t dimWidth, uint32_t dimHeight) {
+    if (!IsBlockCompressed(idFormat)) {
+        return uint64_t(dimWidth) * dimHeight * GetTextureBlockBytes(idFormat);
+    }
+    const uint64_t ctBlocksX = (dimWidth + CT_TEXTURE_BLOCK_SIZE - 1) / CT_TEXTURE_BLOCK_SIZE;
+    const uint64_t ctBlocksY = (dimHeight + CT_TEXTURE_BLOCK_SIZE - 1) / CT_TEXTURE_BLOCK_SIZE;
+    return ctBlocksX * ctBlocksY * GetTextureBlockBytes(idFormat);
+}
@@ -0,0 +1,126 @@
+#include "../PrecompiledHeader.h"
+#include "TextureStreamer.h"
+
+// Most levels loaded at the same time, so a view full of new textures is spread over several frames.
+static const uint32_t CT_MAX_LOADS_IN_FLIGHT = 4;
+
+
+// Add a texture with the sizes of its levels.
+uint32_t TextureStreamer::AddTexture(const std::vector<uint64_t> &actLevelBytes, uint32_t iPinnedLevel) {
+    StreamedTexture stexTexture;
+    stexTexture.actLevelBytes = actLevelBytes;
+    stexTexture.iPinnedLevel = std::min(iPinnedLevel, static_cast<uint32_t>(actLevelBytes.size() - 1));
+    stexTexture.iResidentLevel = stexTexture.iPinnedLevel;
+    stexTexture.iWantedLevel = stexTexture.iPinnedLevel;
+    stexTexture.iLastNeededFrame = _iFrame;
+    stexTexture.bLoading = false;
+    // the pinned levels are always resident, even when they alone go over the budget
+    for (uint32_t iLevel = stexTexture.iPinnedLevel; iLevel < actLevelBytes.size(); iLevel++) {
+        _ctUsedBytes += actLevelBytes[iLevel];
+    }
+    _astexTextures.push_back(stexTexture);
+    return static_cast<uint32_t>(_astexTextures.size() - 1);
+}
+
+
+// Remove all textures.
+void TextureStreamer::Clear() {
+    _astexTextures.clear();
+    _ctUsedBytes = 0;
+}
+
+
+// Set the finest level the texture needs for the current frame.
+void TextureStreamer::SetWantedLevel(uint32_t idTexture, uint32_t iLevel) {
+    StreamedTexture &stexTexture = _astexTextures[idTexture];
+    stexTexture.iWantedLevel = std::min(iLevel, stexTexture.iPinnedLevel);
+}
+
+
+// Decide what to do for the current frame.
+void TextureStreamer::Update(std::vector<uint32_t> &aidLoads, std::vector<uint32_t> &aidEvictions) {
+    aidLoads.clear();
+    aidEvictions.clear();
+    _iFrame++;
+
+    // textures that use all their resident levels this frame are the most recently needed ones; collect the textures
+    // that need finer levels, and count the loads still running
+    uint32_t ctLoading = 0;
+    std::vector<uint32_t> aidWanting;
+    for (uint32_t idTexture = 0; idTexture < _astexTextures.size(); idTexture++) {
+        StreamedTexture &stexTexture = _astexTextures[idTexture];
+        if (stexTexture.iWantedLevel <= stexTexture.iResidentLevel) {
+            stexTexture.iLastNeededFrame = _iFrame;
+        }
+        if (stexTexture.bLoading) {
+            ctLoading++;
+        } else if (stexTexture.iWantedLevel < stexTexture.iResidentLevel) {
+            aidWanting.push_back(idTexture);
+        }
+    }
+
+    // textures furthest from the level they need load first
+    std::stable_sort(aidWanting.begin(), aidWanting.end(), [this](uint32_t idA, uint32_t idB) {
+        const StreamedTexture &stexA = _astexTextures[idA];
+        const StreamedTexture &stexB = _astexTextures[idB];
+        return stexA.iResidentLevel - stexA.iWantedLevel > stexB.iResidentLevel - stexB.iWantedLevel;
+    });
+
+    for (uint32_t idTexture : aidWanting) {
+        if (ctLoading == CT_MAX_LOADS_IN_FLIGHT) {
+            break;
+        }
+        StreamedTexture &stexTexture = _astexTextures[idTexture];
+        const uint64_t ctLevelBytes = stexTexture.actLevelBytes[stexTexture.iResidentLevel - 1];
+        // make room by evicting levels nobody needed lately, the texture stays at its level if there is no room
+        while (_ctUsedBytes + ctLevelBytes > _ctBudget && EvictLeastRecentlyNeeded(idTexture, aidEvictions)) {
+        }
+        if (_ctUsedBytes + ctLevelBytes > _ctBudget) {
+            continue;
+        }
+        _ctUsedBytes += ctLevelBytes;
+        stexTexture.bLoading = true;
+        aidLoads.push_back(idTexture);
+        ctLoading++;
+    }
+}
+
+
+// The load of the texture's next level has finished.
+void TextureStreamer::FinishLoad(uint32_t idTexture) {
+    StreamedTexture &stexTexture = _astexTextures[idTexture];
+    stexTexture.bLoading = false;
+    stexTexture.iResidentLevel--;
+}
+
+
+// Evict the finest level of the texture whose finest level was needed least recently.
+bool TextureStreamer::EvictLeastRecentlyNeeded(uint32_t idExcluded, std::vector<uint32_t> &aidEvictions) {
+    // only levels finer than the one the texture wants this frame can go - a texture still streaming towards its
+    // wanted level needs all of its levels, though it wasn't needed at its resident level lately; a texture that is
+    // loading keeps its levels until the load is done, as the view of the new level takes in all of them
+    uint32_t idVictim = UINT32_MAX;
+    for (uint32_t idTexture = 0; idTexture < _astexTextures.size(); idTexture++) {
+        const StreamedTexture &stexTexture = _astexTextures[idTexture];
+        if (idTexture == idExcluded || stexTexture.bLoading || stexTexture.iResidentLevel >= stexTexture.iPinnedLevel ||
+            stexTexture.iResidentLevel >= stexTexture.iWantedLevel) {
+            continue;
+        }
+        if (idVictim == UINT32_MAX || stexTexture.iLastNeededFrame < _astexTextures[idVictim].iLastNeededFrame) {
+            idVictim = idTexture;
+        }
+    }
+    if (idVictim == UINT32_MAX) {
+        return false;
+    }
+
+    StreamedTexture &stexVictim = _astexTextures[idVictim];
+    _ctUsedBytes -= stexVictim.actLevelBytes[stexVictim.iResidentLevel];
+    stexVictim.iResidentLevel++;
+    assert(stexVictim.iResidentLevel <= stexVictim.iWantedLevel);
+    // a texture that loses several levels in one frame is still shrunk only once
+    if (std::find(aidEvictions.begin(), aidEvictions.end(), idVictim) == aidEvictions.end()) {
+        aidEvictions.push_back(idVictim);
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Decides which mip levels of streamed textures are resident in video memory. Every texture keeps its smallest levels,
+// from the pinned level down, resident at all times. Finer levels are loaded one at a time while the texture is seen
+// large enough on screen to need them, and when a load doesn't fit into the budget the finest levels of the textures
+// that were needed least recently are evicted to make room. The renderer allocates each texture's full mip chain up
+// front and only moves the first level its view samples, so the budget bounds the levels that are uploaded and sampled
+// rather than the memory the images take. The streamer only keeps the books - the renderer does the actual loading
+// and eviction and reports back when a load is done.
+class TextureStreamer {
+public:
+    // Set the most bytes resident levels and levels being loaded may add up to.
+    void SetBudget(uint64_t ctBudget) { _ctBudget = ctBudget; }
+    // Add a texture with the sizes of its levels, largest first. Levels from iPinnedLevel down are resident from the
+    // start and never evicted. Returns the id of the texture.
+    uint32_t AddTexture(const std::vector<uint64_t> &actLevelBytes, uint32_t iPinnedLevel);
+    // Remove all textures.
+    void Clear();
+
+    // Set the finest level the texture needs for the current frame.
+    void SetWantedLevel(uint32_t idTexture, uint32_t iLevel);
+    // Decide what to do for the current frame. Evicted textures already have their new resident level, loads are of
+    // the level just above the resident one and count against the budget until they are finished.
+    void Update(std::vector<uint32_t> &aidLoads, std::vector<uint32_t> &aidEvictions);
+    // The load of the texture's next level has finished, it is now resident.
+    void FinishLoad(uint32_t idTexture);
+
+    // Get the finest resident level of the texture.
+    uint32_t GetResidentLevel(uint32_t idTexture) const { return _astexTextures[idTexture].iResidentLevel; }
+    // Get the memory taken by resident levels and levels being loaded, in bytes.
+    uint64_t GetUsedBytes() const { return _ctUsedBytes; }
+
+private:
+    // Residency of one texture.
+    struct StreamedTexture {
+        // Size of each level, largest first.
+        std::vector<uint64_t> actLevelBytes;
+        // Finest level that is resident, levels from it down to the smallest are all resident.
+        uint32_t iResidentLevel;
+        // Levels from this one down are never evicted.
+        uint32_t iPinnedLevel;
+        // Finest level needed for the current frame.
+        uint32_t iWantedLevel;
+        // Frame in which the finest resident level was last needed.
+        uint64_t iLastNeededFrame;
+        // Is the level above the resident one being loaded?
+        bool bLoading;
+    };
+
+    // Evict the finest level of the texture whose finest level was needed least recently, skipping the texture that
+    // needs the room. Only levels finer than a texture's wanted level are evicted. Returns false if nothing can be
+    // evicted.
+    bool EvictLeastRecentlyNeeded(uint32_t idExcluded, std::vector<uint32_t> &aidEvictions);
+
+private:
+    std::vector<StreamedTexture> _astexTextures;
+    uint64_t _ctBudget = 0;
+    uint64_t _ctUsedBytes = 0;
+    // Number of the current frame, counts calls to Update.
+    uint64_t _iFrame = 0;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+// A single mesh vertex, as stored in vertex buffers and in imported mesh files.
+struct Vertex {
+    // Position in model space.
+    glm::vec3 vecPosition;
+    // Vertex color.
+    glm::vec3 colColor;
+    // Texture coordinates.
+    glm::vec2 vecTexCoords;
+};
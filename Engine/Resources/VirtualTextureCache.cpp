@@ -0,0 +1,224 @@
+#include "../PrecompiledHeader.h"
+#include "VirtualTextureCache.h"
+
+#include "VirtualTextureFile.h"
+
+// Most tiles loaded at the same time, so a view full of new tiles is spread over several frames.
+static const uint32_t CT_MAX_TILE_LOADS_IN_FLIGHT = 16;
+
+
+// Set the number of slots along each side of the cache texture.
+void VirtualTextureCache::Initialize(uint32_t ctSlotsX, uint32_t ctSlotsY) {
+    _ctSlotsX = ctSlotsX;
+    _aslotSlots.assign(ctSlotsX * ctSlotsY, CacheSlot{ ID_VIRTUAL_PAGE_MISSING, 0, false, false });
+    std::fill(_aiEntrySlots.begin(), _aiEntrySlots.end(), ID_VIRTUAL_PAGE_MISSING);
+    _bPageTableChanged = true;
+}
+
+
+// Add a virtual texture.
+uint32_t VirtualTextureCache::AddTexture(uint32_t dimWidth, uint32_t dimHeight) {
+    VirtualTexture vtexTexture;
+    vtexTexture.dimWidth = dimWidth;
+    vtexTexture.dimHeight = dimHeight;
+    vtexTexture.ctLevels = GetVirtualLevelCount(dimWidth, dimHeight);
+    vtexTexture.iFirstEntry = static_cast<uint32_t>(_aiEntrySlots.size());
+    uint32_t ctTiles = 0;
+    for (uint32_t iLevel = 0; iLevel < vtexTexture.ctLevels; iLevel++) {
+        vtexTexture.aiLevelFirstTiles.push_back(ctTiles);
+        ctTiles += GetVirtualTileCount(dimWidth, iLevel) * GetVirtualTileCount(dimHeight, iLevel);
+    }
+    _avtexTextures.push_back(vtexTexture);
+
+    // the coarsest level is a single tile, the last one
+    _aiEntrySlots.resize(_aiEntrySlots.size() + ctTiles, ID_VIRTUAL_PAGE_MISSING);
+    _aiPinnedEntries.push_back(vtexTexture.iFirstEntry + ctTiles - 1);
+    _bPageTableChanged = true;
+    return static_cast<uint32_t>(_avtexTextures.size() - 1);
+}
+
+
+// Remove all textures and empty the cache.
+void VirtualTextureCache::Clear() {
+    _avtexTextures.clear();
+    _aiEntrySlots.clear();
+    _aiPinnedEntries.clear();
+    _aiPageTable.clear();
+    for (CacheSlot &slotSlot : _aslotSlots) {
+        slotSlot = CacheSlot{ ID_VIRTUAL_PAGE_MISSING, 0, false, false };
+    }
+    _bPageTableChanged = true;
+}
+
+
+// Decide which tiles to load for the current frame from the feedback of the previous one.
+void VirtualTextureCache::Update(const uint32_t *aiFeedback, std::vector<TileLoad> &aloadLoads) {
+    aloadLoads.clear();
+    _iFrame++;
+
+    // a sampled tile is needed, and so are all its parents as they stand in for it; the missing ones are collected
+    std::vector<uint32_t> aiMissing;
+    for (uint32_t iEntry : _aiPinnedEntries) {
+        if (_aiEntrySlots[iEntry] == ID_VIRTUAL_PAGE_MISSING) {
+            aiMissing.push_back(iEntry);
+        }
+    }
+    const uint32_t ctEntries = GetPageEntryCount();
+    for (uint32_t iWord = 0; aiFeedback != nullptr && iWord < (ctEntries + 31) / 32; iWord++) {
+        for (uint32_t iBits = aiFeedback[iWord]; iBits != 0; iBits &= iBits - 1) {
+            uint32_t iBit = 0;
+            while ((iBits & (1u << iBit)) == 0) {
+                iBit++;
+            }
+            for (uint32_t iEntry = iWord * 32 + iBit; iEntry != ID_VIRTUAL_PAGE_MISSING && iEntry < ctEntries; iEntry = GetParentEntry(iEntry)) {
+                const uint32_t iSlot = _aiEntrySlots[iEntry];
+                if (iSlot != ID_VIRTUAL_PAGE_MISSING) {
+                    // the parents of a resident tile were marked when it was, or are marked below
+                    if (_aslotSlots[iSlot].iLastNeededFrame == _iFrame) {
+                        break;
+                    }
+                    _aslotSlots[iSlot].iLastNeededFrame = _iFrame;
+                } else {
+                    aiMissing.push_back(iEntry);
+                }
+            }
+        }
+    }
+
+    // coarse tiles first, the finer ones need them as a fallback and they cover more of the screen
+    std::sort(aiMissing.begin(), aiMissing.end());
+    aiMissing.erase(std::unique(aiMissing.begin(), aiMissing.end()), aiMissing.end());
+    std::stable_sort(aiMissing.begin(), aiMissing.end(), [this](uint32_t iEntryA, uint32_t iEntryB) {
+        uint32_t idTexture, iLevelA, iLevelB, iTileX, iTileY;
+        LocateEntry(iEntryA, idTexture, iLevelA, iTileX, iTileY);
+        LocateEntry(iEntryB, idTexture, iLevelB, iTileX, iTileY);
+        return iLevelA > iLevelB;
+    });
+
+    // tiles that are already on their way hold their entries in their slots
+    std::vector<uint32_t> aiLoadingEntries;
+    for (const CacheSlot &slotSlot : _aslotSlots) {
+        if (slotSlot.bLoading) {
+            aiLoadingEntries.push_back(slotSlot.iEntry);
+        }
+    }
+    std::sort(aiLoadingEntries.begin(), aiLoadingEntries.end());
+    uint32_t ctLoading = static_cast<uint32_t>(aiLoadingEntries.size());
+
+    for (uint32_t iEntry : aiMissing) {
+        // pinned tiles don't count against the limit, there is one per texture and nothing works without them
+        const bool bPinned = std::find(_aiPinnedEntries.begin(), _aiPinnedEntries.end(), iEntry) != _aiPinnedEntries.end();
+        if (ctLoading >= CT_MAX_TILE_LOADS_IN_FLIGHT && !bPinned) {
+            break;
+        }
+        if (std::binary_search(aiLoadingEntries.begin(), aiLoadingEntries.end(), iEntry)) {
+            continue;
+        }
+        const uint32_t iSlot = FindSlot();
+        if (iSlot == ID_VIRTUAL_PAGE_MISSING) {
+            break;
+        }
+        _aslotSlots[iSlot] = CacheSlot{ iEntry, _iFrame, true, bPinned };
+
+        uint32_t idTexture, iLevel, iTileX, iTileY;
+        LocateEntry(iEntry, idTexture, iLevel, iTileX, iTileY);
+        aloadLoads.push_back(TileLoad{ idTexture, iEntry - _avtexTextures[idTexture].iFirstEntry, iSlot });
+        ctLoading++;
+    }
+}
+
+
+// The tile is in its slot, the page table can point to it.
+void VirtualTextureCache::FinishLoad(const TileLoad &loadTile) {
+    CacheSlot &slotSlot = _aslotSlots[loadTile.iSlot];
+    slotSlot.bLoading = false;
+    _aiEntrySlots[slotSlot.iEntry] = loadTile.iSlot;
+    _bPageTableChanged = true;
+}
+
+
+// Get the page table, rebuilt if it changed.
+const std::vector<uint32_t> &VirtualTextureCache::TakePageTable() {
+    if (!_bPageTableChanged) {
+        return _aiPageTable;
+    }
+    _bPageTableChanged = false;
+
+    // levels are filled from the coarsest, so a missing tile takes over the entry of its parent
+    _aiPageTable.assign(_aiEntrySlots.size(), ID_VIRTUAL_PAGE_MISSING);
+    for (const VirtualTexture &vtexTexture : _avtexTextures) {
+        for (uint32_t iLevel = vtexTexture.ctLevels; iLevel-- > 0;) {
+            const uint32_t ctTilesX = GetVirtualTileCount(vtexTexture.dimWidth, iLevel);
+            const uint32_t ctTilesY = GetVirtualTileCount(vtexTexture.dimHeight, iLevel);
+            const uint32_t iLevelEntry = vtexTexture.iFirstEntry + vtexTexture.aiLevelFirstTiles[iLevel];
+            for (uint32_t iTileY = 0; iTileY < ctTilesY; iTileY++) {
+                for (uint32_t iTileX = 0; iTileX < ctTilesX; iTileX++) {
+                    const uint32_t iEntry = iLevelEntry + iTileY * ctTilesX + iTileX;
+                    const uint32_t iSlot = _aiEntrySlots[iEntry];
+                    if (iSlot != ID_VIRTUAL_PAGE_MISSING) {
+                        _aiPageTable[iEntry] = (iSlot % _ctSlotsX) | ((iSlot / _ctSlotsX) << 8) | (iLevel << 16);
+                    } else if (iLevel + 1 < vtexTexture.ctLevels) {
+                        const uint32_t iParentEntry = vtexTexture.iFirstEntry + vtexTexture.aiLevelFirstTiles[iLevel + 1] +
+                            (iTileY / 2) * GetVirtualTileCount(vtexTexture.dimWidth, iLevel + 1) + iTileX / 2;
+                        _aiPageTable[iEntry] = _aiPageTable[iParentEntry];
+                    }
+                }
+            }
+        }
+    }
+    return _aiPageTable;
+}
+
+
+// Find the texture, level and position of a page table entry.
+void VirtualTextureCache::LocateEntry(uint32_t iEntry, uint32_t &idTexture, uint32_t &iLevel, uint32_t &iTileX, uint32_t &iTileY) const {
+    idTexture = static_cast<uint32_t>(_avtexTextures.size() - 1);
+    while (_avtexTextures[idTexture].iFirstEntry > iEntry) {
+        idTexture--;
+    }
+    const VirtualTexture &vtexTexture = _avtexTextures[idTexture];
+    const uint32_t iTile = iEntry - vtexTexture.iFirstEntry;
+    iLevel = vtexTexture.ctLevels - 1;
+    while (vtexTexture.aiLevelFirstTiles[iLevel] > iTile) {
+        iLevel--;
+    }
+    const uint32_t ctTilesX = GetVirtualTileCount(vtexTexture.dimWidth, iLevel);
+    iTileX = (iTile - vtexTexture.aiLevelFirstTiles[iLevel]) % ctTilesX;
+    iTileY = (iTile - vtexTexture.aiLevelFirstTiles[iLevel]) / ctTilesX;
+}
+
+
+// Get the entry of the parent of a tile.
+uint32_t VirtualTextureCache::GetParentEntry(uint32_t iEntry) const {
+    uint32_t idTexture, iLevel, iTileX, iTileY;
+    LocateEntry(iEntry, idTexture, iLevel, iTileX, iTileY);
+    const VirtualTexture &vtexTexture = _avtexTextures[idTexture];
+    if (iLevel + 1 == vtexTexture.ctLevels) {
+        return ID_VIRTUAL_PAGE_MISSING;
+    }
+    return vtexTexture.iFirstEntry + vtexTexture.aiLevelFirstTiles[iLevel + 1] + (iTileY / 2) * GetVirtualTileCount(vtexTexture.dimWidth, iLevel + 1) + iTileX / 2;
+}
+
+
+// Find a slot for a new tile.
+uint32_t VirtualTextureCache::FindSlot() {
+    // tiles needed this frame, pinned tiles and tiles on their way stay
+    uint32_t iVictim = ID_VIRTUAL_PAGE_MISSING;
+    for (uint32_t iSlot = 0; iSlot < _aslotSlots.size(); iSlot++) {
+        const CacheSlot &slotSlot = _aslotSlots[iSlot];
+        if (slotSlot.iEntry == ID_VIRTUAL_PAGE_MISSING) {
+            return iSlot;
+        }
+        if (slotSlot.bLoading || slotSlot.bPinned || slotSlot.iLastNeededFrame == _iFrame) {
+            continue;
+        }
+        if (iVictim == ID_VIRTUAL_PAGE_MISSING || slotSlot.iLastNeededFrame < _aslotSlots[iVictim].iLastNeededFrame) {
+            iVictim = iSlot;
+        }
+    }
+    if (iVictim != ID_VIRTUAL_PAGE_MISSING) {
+        _aiEntrySlots[_aslotSlots[iVictim].iEntry] = ID_VIRTUAL_PAGE_MISSING;
+        _bPageTableChanged = true;
+    }
+    return iVictim;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Page table entry of a tile that has no resident tile covering it yet.
+static const uint32_t ID_VIRTUAL_PAGE_MISSING = UINT32_MAX;
+
+// Decides which tiles of virtual textures are in the slots of the tile cache, and builds the page table that maps each
+// tile to the slot of the finest resident tile covering it. Page table entries are the tiles of all textures, one after
+// another, and the renderer's feedback has one bit for each entry, set when the tile was sampled. Missing tiles are
+// loaded coarse first, so a tile's parents are there to stand in while it loads, and when the cache is full the tiles
+// that weren't needed for the longest time are evicted. The coarsest tile of each texture is always resident. The
+// cache only keeps the books - the renderer loads the tiles, uploads the page table and reports back.
+class VirtualTextureCache {
+public:
+    // A tile to load into a slot of the cache.
+    struct TileLoad {
+        uint32_t idTexture;
+        // Tile in the texture, numbered as in its file.
+        uint32_t iTile;
+        // Slot the tile goes into, slots are numbered row by row.
+        uint32_t iSlot;
+    };
+
+    // Set the number of slots along each side of the cache texture. Empties the cache, the textures stay.
+    void Initialize(uint32_t ctSlotsX, uint32_t ctSlotsY);
+    // Add a virtual texture, returns its id.
+    uint32_t AddTexture(uint32_t dimWidth, uint32_t dimHeight);
+    // Remove all textures and empty the cache.
+    void Clear();
+
+    // Get the page table entry of the texture's first tile.
+    uint32_t GetFirstPageEntry(uint32_t idTexture) const { return _avtexTextures[idTexture].iFirstEntry; }
+    // Get the number of page table entries of all textures.
+    uint32_t GetPageEntryCount() const { return static_cast<uint32_t>(_aiEntrySlots.size()); }
+    // Get the number of slots along the width of the cache texture.
+    uint32_t GetSlotCountX() const { return _ctSlotsX; }
+
+    // Decide which tiles to load for the current frame from the feedback of the previous one. Without feedback only
+    // the pinned tiles are loaded. Loads get a slot right away and count as in flight until they are finished.
+    void Update(const uint32_t *aiFeedback, std::vector<TileLoad> &aloadLoads);
+    // The tile is in its slot, the page table can point to it.
+    void FinishLoad(const TileLoad &loadTile);
+
+    // Did the page table change since it was last taken?
+    bool IsPageTableChanged() const { return _bPageTableChanged; }
+    // Get the page table, each entry has the slot in its lower 16 bits, x and then y, and the level of the resident
+    // tile in the next 8 bits. Rebuilt if it changed.
+    const std::vector<uint32_t> &TakePageTable();
+
+private:
+    // Entries and levels of a virtual texture.
+    struct VirtualTexture {
+        uint32_t dimWidth;
+        uint32_t dimHeight;
+        uint32_t ctLevels;
+        uint32_t iFirstEntry;
+        // First tile of each level, counting from the texture's first tile.
+        std::vector<uint32_t> aiLevelFirstTiles;
+    };
+    // A slot of the tile cache.
+    struct CacheSlot {
+        // Page table entry of the tile in the slot, ID_VIRTUAL_PAGE_MISSING if the slot is free.
+        uint32_t iEntry;
+        // Frame in which the tile was last needed.
+        uint64_t iLastNeededFrame;
+        // Is the tile being loaded? Its entry doesn't point to it yet.
+        bool bLoading;
+        // Is the tile never evicted?
+        bool bPinned;
+    };
+
+    // Find the texture, level and position of a page table entry.
+    void LocateEntry(uint32_t iEntry, uint32_t &idTexture, uint32_t &iLevel, uint32_t &iTileX, uint32_t &iTileY) const;
+    // Get the entry of the parent of a tile, ID_VIRTUAL_PAGE_MISSING for the coarsest tile.
+    uint32_t GetParentEntry(uint32_t iEntry) const;
+    // Find a slot for a new tile - a free one, or the one whose tile was needed least recently. Returns
+    // ID_VIRTUAL_PAGE_MISSING if every slot is in use this frame.
+    uint32_t FindSlot();
+
+private:
+    std::vector<VirtualTexture> _avtexTextures;
+    std::vector<CacheSlot> _aslotSlots;
+    uint32_t _ctSlotsX = 0;
+    // Slot of each page table entry's tile, ID_VIRTUAL_PAGE_MISSING if the tile isn't resident.
+    std::vector<uint32_t> _aiEntrySlots;
+    // Entries of the coarsest tiles, always resident.
+    std::vector<uint32_t> _aiPinnedEntries;
+    std::vector<uint32_t> _aiPageTable;
+    bool _bPageTableChanged = false;
+    // Number of the current frame, counts calls to Update.
+    uint64_t _iFrame = 0;
+};
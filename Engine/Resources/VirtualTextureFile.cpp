@@ -0,0 +1,114 @@
+#include "../PrecompiledHeader.h"
+#include "VirtualTextureFile.h"
+
+#include <stdexcept>
+
+#include "../Platform/FileSystem.h"
+
+
+VirtualTextureFileWriter::VirtualTextureFileWriter() :
+    _hdrHeader(), _ctTilesWritten(0)
+{
+}
+
+
+VirtualTextureFileWriter::~VirtualTextureFileWriter() {
+    // a writer that wasn't closed didn't produce a complete file, throw the partial one away
+    if (_fsFile.is_open()) {
+        _fsFile.close();
+        FileSystem::RemoveFile(_strTempFilename);
+    }
+}
+
+
+// Start writing a virtual texture.
+void VirtualTextureFileWriter::Open(const std::string &strFilename, enum TextureFormat idFormat, uint32_t dimWidth, uint32_t dimHeight) {
+    _strFilename = strFilename;
+    _strTempFilename = strFilename + ".tmp";
+    _fsFile.open(_strTempFilename, std::ios::binary | std::ios::trunc);
+    if (!_fsFile.is_open()) {
+        throw std::runtime_error("Failed to create file: " + _strTempFilename);
+    }
+
+    // the header is complete up front, the tiles follow it at an aligned offset
+    _hdrHeader = {};
+    _hdrHeader.idMagic = ID_VIRTUAL_TEXTURE_MAGIC;
+    _hdrHeader.idVersion = ID_VIRTUAL_TEXTURE_VERSION;
+    _hdrHeader.idFormat = idFormat;
+    _hdrHeader.dimWidth = dimWidth;
+    _hdrHeader.dimHeight = dimHeight;
+    _hdrHeader.ctLevels = GetVirtualLevelCount(dimWidth, dimHeight);
+    _hdrHeader.ctTileBytes = static_cast<uint32_t>(GetTextureImageBytes(idFormat, CT_VIRTUAL_TILE_STRIDE, CT_VIRTUAL_TILE_STRIDE));
+    _hdrHeader.offTiles = (sizeof(VirtualTextureHeader) + CT_VIRTUAL_TILE_ALIGNMENT - 1) / CT_VIRTUAL_TILE_ALIGNMENT * CT_VIRTUAL_TILE_ALIGNMENT;
+    _ctTilesWritten = 0;
+
+    static const char achZeros[CT_VIRTUAL_TILE_ALIGNMENT] = {};
+    _fsFile.write(reinterpret_cast<const char *>(&_hdrHeader), sizeof(_hdrHeader));
+    _fsFile.write(achZeros, static_cast<std::streamsize>(_hdrHeader.offTiles - sizeof(_hdrHeader)));
+}
+
+
+// Append the next tile.
+void VirtualTextureFileWriter::WriteTile(const uint8_t *pbTile) {
+    _fsFile.write(reinterpret_cast<const char *>(pbTile), _hdrHeader.ctTileBytes);
+    _ctTilesWritten++;
+}
+
+
+// Finish the file and move it over the target.
+void VirtualTextureFileWriter::Close() {
+    if (_ctTilesWritten != GetVirtualTotalTileCount(_hdrHeader.dimWidth, _hdrHeader.dimHeight)) {
+        throw std::runtime_error("Virtual texture is missing tiles: " + _strFilename);
+    }
+    _fsFile.close();
+    if (_fsFile.fail()) {
+        FileSystem::RemoveFile(_strTempFilename);
+        throw std::runtime_error("Failed to write file: " + _strTempFilename);
+    }
+
+    FileSystem::ReplaceFile(_strTempFilename, _strFilename);
+}
+
+
+// Map the file and check its header.
+void VirtualTextureFile::Open(const std::string &strFilename) {
+    _mfFile.Open(strFilename);
+
+    const VirtualTextureHeader *phdrHeader = reinterpret_cast<const VirtualTextureHeader *>(_mfFile.GetData());
+    if (_mfFile.GetSize() < sizeof(VirtualTextureHeader) || phdrHeader->idMagic != ID_VIRTUAL_TEXTURE_MAGIC) {
+        _mfFile.Close();
+        throw std::runtime_error("Not a virtual texture file: " + strFilename);
+    }
+    if (phdrHeader->idVersion != ID_VIRTUAL_TEXTURE_VERSION || phdrHeader->dimWidth == 0 || phdrHeader->dimHeight == 0 ||
+        phdrHeader->ctLevels != GetVirtualLevelCount(phdrHeader->dimWidth, phdrHeader->dimHeight)) {
+        _mfFile.Close();
+        throw std::runtime_error("Unsupported virtual texture file version: " + strFilename);
+    }
+
+    // check that all tiles are inside the file
+    const uint64_t ctTileBytes = uint64_t(GetVirtualTotalTileCount(phdrHeader->dimWidth, phdrHeader->dimHeight)) * phdrHeader->ctTileBytes;
+    if (phdrHeader->offTiles > _mfFile.GetSize() || ctTileBytes > _mfFile.GetSize() - phdrHeader->offTiles) {
+        _mfFile.Close();
+        throw std::runtime_error("Virtual texture file is truncated: " + strFilename);
+    }
+}
+
+
+// Get the encoded texels of a tile.
+const uint8_t *VirtualTextureFile::GetTile(uint32_t iTile) const {
+    const VirtualTextureHeader &hdrHeader = GetHeader();
+    return reinterpret_cast<const uint8_t *>(_mfFile.GetData() + hdrHeader.offTiles + uint64_t(iTile) * hdrHeader.ctTileBytes);
+}
+
+
+// Is the file a valid virtual texture of the current version?
+bool VirtualTextureFile::IsValid(const std::string &strFilename) {
+    try {
+        VirtualTextureFile vtfFile;
+        vtfFile.Open(strFilename);
+        return true;
+    }
+    catch (const std::runtime_error &) {
+        return false;
+    }
+}
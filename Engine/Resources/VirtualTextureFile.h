@@ -0,0 +1,122 @@
+#pragma once
+#include "../Platform/MappedFile.h"
+#include "TextureFormat.h"
+
+// Size of the content of a virtual texture tile, in texels along each side.
+static const uint32_t CT_VIRTUAL_TILE_SIZE = 128;
+// Texels of the neighbouring tiles repeated around each tile, so filtering never reads outside the tile.
+static const uint32_t CT_VIRTUAL_TILE_BORDER = 4;
+// Size of a tile with its border, as stored in the file and in the tile cache. A multiple of the block size.
+static const uint32_t CT_VIRTUAL_TILE_STRIDE = CT_VIRTUAL_TILE_SIZE + 2 * CT_VIRTUAL_TILE_BORDER;
+
+// Identifies the file as an engine virtual texture, 'GVTX'.
+static const uint32_t ID_VIRTUAL_TEXTURE_MAGIC = 0x58545647;
+// Version of the virtual texture format, files with other versions are reimported.
+static const uint32_t ID_VIRTUAL_TEXTURE_VERSION = 1;
+// Alignment of the tile data inside the file.
+static const uint64_t CT_VIRTUAL_TILE_ALIGNMENT = 16;
+
+// Header at the start of every virtual texture file. The tiles follow it, level by level from the full resolution one,
+// and row by row within a level. All tiles have the same size, so a tile is found from its position alone.
+struct VirtualTextureHeader {
+    uint32_t idMagic;
+    uint32_t idVersion;
+    // Format of the tiles, a TextureFormat.
+    uint32_t idFormat;
+    // Size of the full resolution level.
+    uint32_t dimWidth;
+    uint32_t dimHeight;
+    uint32_t ctLevels;
+    // Size of one tile with its border, in bytes.
+    uint32_t ctTileBytes;
+    uint32_t iReserved;
+    // Offset of the first tile from the start of the file.
+    uint64_t offTiles;
+};
+
+// Get the number of tiles along a side of a virtual texture level. Level L covers the texture at 1/2^L of its size,
+// rounded up, so a tile's parent in the next level is always at half its coordinates.
+static inline uint32_t GetVirtualTileCount(uint32_t dimSize, uint32_t iLevel) {
+    const uint32_t dimLevelSize = (dimSize + (1u << iLevel) - 1) >> iLevel;
+    return std::max((dimLevelSize + CT_VIRTUAL_TILE_SIZE - 1) / CT_VIRTUAL_TILE_SIZE, 1u);
+}
+
+// Get the number of levels of a virtual texture - down to the first level that is a single tile.
+static inline uint32_t GetVirtualLevelCount(uint32_t dimWidth, uint32_t dimHeight) {
+    uint32_t ctLevels = 1;
+    while (GetVirtualTileCount(dimWidth, ctLevels - 1) > 1 || GetVirtualTileCount(dimHeight, ctLevels - 1) > 1) {
+        ctLevels++;
+    }
+    return ctLevels;
+}
+
+// Get the total number of tiles in all levels of a virtual texture.
+static inline uint32_t GetVirtualTotalTileCount(uint32_t dimWidth, uint32_t dimHeight) {
+    uint32_t ctTiles = 0;
+    for (uint32_t iLevel = 0; iLevel < GetVirtualLevelCount(dimWidth, dimHeight); iLevel++) {
+        ctTiles += GetVirtualTileCount(dimWidth, iLevel) * GetVirtualTileCount(dimHeight, iLevel);
+    }
+    return ctTiles;
+}
+
+
+// Writes virtual texture files one tile at a time, so a huge texture never has to be encoded in memory as a whole. The
+// data goes to a temporary file that replaces the target only when the writer is closed.
+class VirtualTextureFileWriter {
+public:
+    VirtualTextureFileWriter();
+    ~VirtualTextureFileWriter();
+
+    // Start writing a virtual texture. Throws if the file can't be created.
+    void Open(const std::string &strFilename, enum TextureFormat idFormat, uint32_t dimWidth, uint32_t dimHeight);
+    // Append the next tile, ctTileBytes of encoded texels including the border.
+    void WriteTile(const uint8_t *pbTile);
+    // Finish the file and move it over the target. Throws if tiles are missing or the file can't be written.
+    void Close();
+
+public:
+    // Forbid copying, the writer owns its file.
+    VirtualTextureFileWriter(VirtualTextureFileWriter const &) = delete;
+    void operator = (VirtualTextureFileWriter const &) = delete;
+
+private:
+    std::string _strFilename;
+    std::string _strTempFilename;
+    std::ofstream _fsFile;
+    VirtualTextureHeader _hdrHeader;
+    // Number of tiles written so far.
+    uint32_t _ctTilesWritten;
+};
+
+
+// Read-only access to a virtual texture file. The file is memory mapped and tiles are read from it in place.
+class VirtualTextureFile {
+public:
+    // Map the file and check its header. Throws if the file is not a valid virtual texture of the current version.
+    void Open(const std::string &strFilename);
+    // Unmap the file.
+    void Close() { _mfFile.Close(); }
+
+    // Get the format of the tiles.
+    enum TextureFormat GetFormat() const { return static_cast<enum TextureFormat>(GetHeader().idFormat); }
+    // Get the size of the full resolution level.
+    uint32_t GetWidth() const { return GetHeader().dimWidth; }
+    uint32_t GetHeight() const { return GetHeader().dimHeight; }
+    // Get the number of levels.
+    uint32_t GetLevelCount() const { return GetHeader().ctLevels; }
+    // Get the size of one tile in bytes.
+    uint32_t GetTileBytes() const { return GetHeader().ctTileBytes; }
+    // Get the encoded texels of a tile. Tiles are numbered through all levels, from the full resolution one.
+    const uint8_t *GetTile(uint32_t iTile) const;
+
+    // Is the file a valid virtual texture of the current version? Doesn't throw.
+    static bool IsValid(const std::string &strFilename);
+
+private:
+    const VirtualTextureHeader &GetHeader() const {
+        return *reinterpret_cast<const VirtualTextureHeader *>(_mfFile.GetData());
+    }
+
+private:
+    MappedFile _mfFile;
+};
@@ -3,13 +3,60 @@
 #include <stdexcept>
 
 #include "Engine/Application/Application.h"
+#include "Engine/Import/ImportBenchmark.h"
+#include "Engine/Import/MeshImporter.h"
 
+// Frames rendered in each mode of the rendering benchmarks, unless given on the command line.
+static const uint32_t CT_DEFAULT_BENCHMARK_FRAMES = 500;
 
-int main() {
+
+// Run a command line tool instead of the application, if one was requested. Tools that render use the application.
+// Returns true if a tool was run.
+static bool RunTool(Application &app, int argc, char *argv[]) {
+    if (argc < 2) {
+        return false;
+    }
+    const std::string strTool = argv[1];
+
+    // compare OBJ import speed on the given files
+    if (strTool == "--benchmark-obj") {
+        ImportBenchmark::RunObjBenchmark(std::vector<std::string>(argv + 2, argv + argc));
+        return true;
+    }
+    // generate a large OBJ file to benchmark with, size is given in megabytes
+    if (strTool == "--generate-obj" && argc == 4) {
+        ImportBenchmark::GenerateObj(argv[2], std::strtoull(argv[3], nullptr, 10) * 1024 * 1024);
+        return true;
+    }
+    // compare image decoding speed on the given files
+    if (strTool == "--benchmark-images") {
+        ImportBenchmark::RunImageBenchmark(std::vector<std::string>(argv + 2, argv + argc));
+        return true;
+    }
+
+    // compare frame times with and without texture mipmaps, optionally for the given number of frames
+    if (strTool == "--benchmark-mipmaps" && argc <= 3) {
+        app.RunMipmapBenchmark(argc == 3 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : CT_DEFAULT_BENCHMARK_FRAMES);
+        return true;
+    }
+
+    // convert an OBJ file to the engine mesh format
+    if (strTool == "--import-obj" && argc == 4) {
+        MeshImporter::ImportObj(argv[2], argv[3]);
+        return true;
+    }
+
+    throw std::runtime_error("Unknown command line: " + strTool);
+}
+
+
+int main(int argc, char *argv[]) {
 	Application app;
 
 	try {
-		app.Run();
+		if (!RunTool(app, argc, argv)) {
+			app.Run();
+		}
 	}
 	catch (const std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;